@@ -0,0 +1,163 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "RawMeshLoader.h"
+#include "ThreadPool.h"
+
+/** Number of times each configuration is loaded, the fastest run is reported */
+#define DEFAULT_REPEATS 5
+
+/**
+ * Loads a file several times and keeps the fastest run, so that the page cache is warm and the
+ * result measures the decode rather than the disk.
+ * @param path The .raw file to load.
+ * @param mode The load mode to use.
+ * @param threadPool The workers for LOAD_PARALLEL, may be NULL.
+ * @param repeats The number of loads.
+ * @return the fastest load time in seconds, a negative value if the file could not be loaded.
+ */
+double bestLoadTime(const char* path, RawMeshLoader::LoadMode mode, ThreadPool* threadPool, unsigned int repeats) {
+	RawMeshLoader loader;
+	double best;
+	unsigned int i;
+
+	best = -1.0;
+	for (i = 0; i < repeats; i++) {
+		if (loader.load(path, mode, threadPool) == 0) {
+			return -1.0;
+		}
+
+		if ((best < 0.0) || (loader.getLoadTime() < best)) {
+			best = loader.getLoadTime();
+		}
+
+		loader.releaseArrays();
+	}
+
+	return best;
+}
+
+/**
+ * Prints one row of the results table.
+ * @param name The load mode.
+ * @param threads The number of threads used.
+ * @param seconds The load time.
+ * @param bytes The size of the file.
+ * @param baseline The time to compute the speedup against.
+ */
+void printRow(const char* name, unsigned int threads, double seconds, double bytes, double baseline) {
+	std::cout << std::left << std::setw(10) << name << std::right
+	          << std::setw(8) << threads
+	          << std::setw(12) << std::fixed << std::setprecision(2) << seconds * 1000.0
+	          << std::setw(12) << std::setprecision(0) << bytes / (1024.0 * 1024.0) / seconds
+	          << std::setw(10) << std::setprecision(2) << baseline / seconds << std::endl;
+}
+
+/**
+ * Measures how the .raw load time scales with the number of threads.
+ * Usage: LoadBenchmark model.raw [maxThreads] [repeats]
+ * @param argc The number of command line arguments.
+ * @param argv An array of strings containing the command line arguments.
+ * @return 0 on successful termination, otherwise some error code.
+ */
+int main(int argc, char **argv) {
+	RawMeshLoader loader;
+	std::vector<unsigned int> threadCounts;
+	unsigned int maxThreads;
+	unsigned int repeats;
+	unsigned int threads;
+	unsigned int i;
+	double bytes;
+	double baseline;
+	double seconds;
+
+	if (argc < 2) {
+		std::cout << "Usage: " << argv[0] << " model.raw [maxThreads] [repeats]" << std::endl;
+		return 1;
+	}
+
+	maxThreads = (argc > 2) ? static_cast<unsigned int>(atoi(argv[2])) : std::thread::hardware_concurrency();
+	repeats = (argc > 3) ? static_cast<unsigned int>(atoi(argv[3])) : DEFAULT_REPEATS;
+	if (maxThreads == 0) {
+		maxThreads = 1;
+	}
+	if (repeats == 0) {
+		repeats = 1;
+	}
+
+	if (loader.load(argv[1], RawMeshLoader::LOAD_MAPPED) == 0) {
+		std::cout << "Could not load " << argv[1] << std::endl;
+		return 1;
+	}
+	bytes = static_cast<double>(loader.getSize()) * RAW_MESH_RECORD_SIZE;
+	std::cout << argv[1] << ": " << loader.getSize() << " vertices, best of " << repeats << " runs" << std::endl;
+	loader.releaseArrays();
+
+	// Double the thread count up to the maximum, which is always included
+	for (threads = 1; threads < maxThreads; threads *= 2) {
+		threadCounts.push_back(threads);
+	}
+	threadCounts.push_back(maxThreads);
+
+	std::cout << std::left << std::setw(10) << "mode" << std::right << std::setw(8) << "threads" << std::setw(12) << "ms"
+	          << std::setw(12) << "MB/s" << std::setw(10) << "speedup" << std::endl;
+
+	baseline = bestLoadTime(argv[1], RawMeshLoader::LOAD_STREAM, NULL, repeats);
+	printRow("stream", 1, baseline, bytes, baseline);
+
+	for (i = 0; i < threadCounts.size(); i++) {
+		ThreadPool pool(threadCounts[i]);
+
+		seconds = bestLoadTime(argv[1], RawMeshLoader::LOAD_PARALLEL, &pool, repeats);
+		printRow("parallel", threadCounts[i], seconds, bytes, baseline);
+	}
+
+	return 0;
+}
+
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
@@ -0,0 +1,409 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef HAVE_EGL
+#	include "HeadlessContext.h"
+#endif
+#include "RawMeshLoader.h"
+#include "ShaderPermutation.h"
+#include "SoftwareRasterizer.h"
+#include "ThreadPool.h"
+
+/** Number of frames drawn for each thread count, the fastest frame is reported */
+#define DEFAULT_FRAMES 10
+/** Width of the image, in pixels */
+#define IMAGE_WIDTH 1024
+/** Height of the image, in pixels */
+#define IMAGE_HEIGHT 768
+/** The projection, the same as the cel shader's */
+#define FIELD_OF_VIEW 45.0f
+#define NEAR_PLANE 0.1f
+#define FAR_PLANE 100.0f
+/** The camera orbiting the model */
+#define VIEW_ANGLE 0.5f
+#define VIEW_PITCH 0.6f
+#define VIEW_DISTANCE 30.0f
+/** The largest difference in any channel for a pixel to count as the same in both images */
+#define PIXEL_TOLERANCE 16
+
+/** The background both renderers clear to */
+static const GLfloat BACKGROUND[3] = { 0.0f, 0.4f, 0.4f };
+/** The light, in the model's space */
+static const GLfloat LIGHT[4] = { 10.0f, 5.0f, 0.0f, 1.0f };
+
+/**
+ * Draws a mesh several times and keeps the fastest frame.
+ * @param mesh The mesh to draw.
+ * @param threadPool The workers to rasterize with.
+ * @param frames The number of frames.
+ * @param pixels Receives the image of the last frame.
+ * @return the fastest frame time in seconds.
+ */
+double bestFrameTime(const RawMeshLoader& mesh, ThreadPool& threadPool, unsigned int frames, std::vector<GLubyte>& pixels) {
+	std::chrono::steady_clock::time_point start;
+	SoftwareRasterizer rasterizer(&threadPool);
+	GLfloat modelView[16];
+	double best;
+	double seconds;
+	unsigned int i;
+
+	rasterizer.resize(IMAGE_WIDTH, IMAGE_HEIGHT);
+	rasterizer.setPerspective(FIELD_OF_VIEW, NEAR_PLANE, FAR_PLANE);
+	SoftwareRasterizer::orbitMatrix(VIEW_ANGLE, VIEW_PITCH, VIEW_DISTANCE, modelView);
+	rasterizer.setModelView(modelView);
+	rasterizer.setLight(LIGHT);
+
+	best = -1.0;
+	for (i = 0; i < frames; i++) {
+		start = std::chrono::steady_clock::now();
+		rasterizer.clear(BACKGROUND);
+		rasterizer.draw(mesh);
+		seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		if ((best < 0.0) || (seconds < best)) {
+			best = seconds;
+		}
+	}
+
+	pixels = rasterizer.getPixels();
+	return best;
+}
+
+#ifdef HAVE_EGL
+
+/**
+ * Compiles one of the cel shader's sources with the default ramp's defines in front.
+ * @param type GL_VERTEX_SHADER or GL_FRAGMENT_SHADER.
+ * @param path The path of the source.
+ * @return the shader, 0 if it can't be read or doesn't compile.
+ */
+GLuint compileShader(GLenum type, const char* path) {
+	std::ifstream inFile(path);
+	std::ostringstream source;
+	std::string text;
+	const GLchar *sourcePointer;
+	GLuint shader;
+	GLint compiled;
+
+	if (!inFile.good()) {
+		return 0;
+	}
+
+	source << ShaderPermutation::buildDefines(ShaderPermutation::defaultRamp(), false) << inFile.rdbuf();
+	text = source.str();
+	sourcePointer = text.c_str();
+
+	shader = glCreateShader(type);
+	glShaderSource(shader, 1, &sourcePointer, NULL);
+	glCompileShader(shader);
+	glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+
+	if (!compiled) {
+		glDeleteShader(shader);
+		return 0;
+	}
+
+	return shader;
+}
+
+/**
+ * Builds a projection matrix like gluPerspective, the same one SoftwareRasterizer::setPerspective uses.
+ * @param aspect The width of the image over its height.
+ * @param matrix Receives the matrix, in column major order.
+ */
+void perspectiveMatrix(GLfloat aspect, GLfloat matrix[16]) {
+	GLfloat f;
+	unsigned int i;
+
+	f = 1.0f / tanf(FIELD_OF_VIEW * static_cast<GLfloat>(M_PI) / 360.0f);
+	for (i = 0; i < 16; i++) {
+		matrix[i] = 0.0f;
+	}
+
+	matrix[0] = f / aspect;
+	matrix[5] = f;
+	matrix[10] = (FAR_PLANE + NEAR_PLANE) / (NEAR_PLANE - FAR_PLANE);
+	matrix[11] = -1.0f;
+	matrix[14] = 2.0f * FAR_PLANE * NEAR_PLANE / (NEAR_PLANE - FAR_PLANE);
+}
+
+/**
+ * Draws a mesh through OpenGL in an offscreen framebuffer several times, the way CelShader draws it with back
+ * face outlines, and keeps the fastest frame. Every frame is finished with glFinish before it is timed.
+ * @param mesh The mesh to draw.
+ * @param frames The number of frames.
+ * @param pixels Receives the image of the last frame.
+ * @param renderer Receives the name of the OpenGL renderer.
+ * @return the fastest frame time in seconds, negative if there is no OpenGL or the shaders can't be built.
+ */
+double bestGlFrameTime(const RawMeshLoader& mesh, unsigned int frames, std::vector<GLubyte>& pixels, std::string& renderer) {
+	HeadlessContext context;
+	std::chrono::steady_clock::time_point start;
+	std::vector<GLfloat> vertices;
+	GLfloat projection[16];
+	GLfloat modelView[16];
+	GLuint vertexShader;
+	GLuint fragmentShader;
+	GLuint program;
+	GLuint buffer;
+	GLint linked;
+	GLsizei vertexCount;
+	double best;
+	double seconds;
+	unsigned int i;
+	unsigned int j;
+
+	if (!context.create(IMAGE_WIDTH, IMAGE_HEIGHT)) {
+		return -1.0;
+	}
+	renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+
+	// The shaders are found relative to the working directory, like the application does
+	vertexShader = compileShader(GL_VERTEX_SHADER, "shaders/celShader.vs");
+	fragmentShader = compileShader(GL_FRAGMENT_SHADER, "shaders/celShader.frag");
+	if ((vertexShader == 0) || (fragmentShader == 0)) {
+		std::cout << "Could not compile shaders/celShader.vs and shaders/celShader.frag" << std::endl;
+		return -1.0;
+	}
+
+	program = glCreateProgram();
+	glAttachShader(program, vertexShader);
+	glAttachShader(program, fragmentShader);
+	glLinkProgram(program);
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+	if (!linked) {
+		glDeleteProgram(program);
+		return -1.0;
+	}
+
+	// Positions, normals and colours packed into one buffer, the GPU doesn't read the mapped file
+	vertexCount = static_cast<GLsizei>(mesh.getSize());
+	vertices.resize(static_cast<size_t>(vertexCount) * 9);
+	for (i = 0; i < mesh.getSize(); i++) {
+		for (j = 0; j < 3; j++) {
+			vertices[i * 9 + j] = mesh.getVertex(i)[j];
+			vertices[i * 9 + 3 + j] = mesh.getNormal(i)[j];
+			vertices[i * 9 + 6 + j] = mesh.getColour(i)[j];
+		}
+	}
+
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(GLfloat), &vertices[0], GL_STATIC_DRAW);
+	glVertexPointer(3, GL_FLOAT, 9 * sizeof(GLfloat), reinterpret_cast<const GLvoid*>(0));
+	glNormalPointer(GL_FLOAT, 9 * sizeof(GLfloat), reinterpret_cast<const GLvoid*>(3 * sizeof(GLfloat)));
+	glColorPointer(3, GL_FLOAT, 9 * sizeof(GLfloat), reinterpret_cast<const GLvoid*>(6 * sizeof(GLfloat)));
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glEnableClientState(GL_NORMAL_ARRAY);
+
+	glViewport(0, 0, IMAGE_WIDTH, IMAGE_HEIGHT);
+	perspectiveMatrix(static_cast<GLfloat>(IMAGE_WIDTH) / IMAGE_HEIGHT, projection);
+	glMatrixMode(GL_PROJECTION);
+	glLoadMatrixf(projection);
+	SoftwareRasterizer::orbitMatrix(VIEW_ANGLE, VIEW_PITCH, VIEW_DISTANCE, modelView);
+	glMatrixMode(GL_MODELVIEW);
+	glLoadMatrixf(modelView);
+	glLightfv(GL_LIGHT0, GL_POSITION, LIGHT);
+
+	glClearColor(BACKGROUND[0], BACKGROUND[1], BACKGROUND[2], 1.0f);
+	glEnable(GL_DEPTH_TEST);
+	glEnable(GL_CULL_FACE);
+	glLineWidth(RASTER_OUTLINE_WIDTH);
+
+	best = -1.0;
+	for (i = 0; i < frames; i++) {
+		start = std::chrono::steady_clock::now();
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+		// The back faces as thick black lines with a < depth test
+		glUseProgram(0);
+		glDisableClientState(GL_COLOR_ARRAY);
+		glColor3f(0.0f, 0.0f, 0.0f);
+		glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
+		glCullFace(GL_FRONT);
+		glDepthFunc(GL_LESS);
+		glDrawArrays(GL_TRIANGLES, 0, vertexCount);
+
+		// Then the front faces, cel shaded with a <= depth test
+		glUseProgram(program);
+		glEnableClientState(GL_COLOR_ARRAY);
+		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+		glCullFace(GL_BACK);
+		glDepthFunc(GL_LEQUAL);
+		glDrawArrays(GL_TRIANGLES, 0, vertexCount);
+
+		glFinish();
+		seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		if ((best < 0.0) || (seconds < best)) {
+			best = seconds;
+		}
+	}
+
+	pixels.resize(static_cast<size_t>(IMAGE_WIDTH) * IMAGE_HEIGHT * 3);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, IMAGE_WIDTH, IMAGE_HEIGHT, GL_RGB, GL_UNSIGNED_BYTE, &pixels[0]);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glDeleteBuffers(1, &buffer);
+	glDeleteProgram(program);
+
+	return best;
+}
+
+/**
+ * Counts the pixels that differ by more than PIXEL_TOLERANCE in any channel.
+ * @param a The first image, RGB bytes.
+ * @param b The second image, the same size.
+ * @return the number of pixels.
+ */
+size_t countDifferentPixels(const std::vector<GLubyte>& a, const std::vector<GLubyte>& b) {
+	size_t count;
+	size_t i;
+
+	count = 0;
+	for (i = 0; i + 2 < a.size(); i += 3) {
+		if ((abs(a[i] - b[i]) > PIXEL_TOLERANCE) || (abs(a[i + 1] - b[i + 1]) > PIXEL_TOLERANCE) || (abs(a[i + 2] - b[i + 2]) > PIXEL_TOLERANCE)) {
+			count++;
+		}
+	}
+
+	return count;
+}
+
+#endif
+
+/**
+ * Measures how the software rasterizer scales with the number of threads, and checks that every thread
+ * count draws the same image. When built with EGL the same frame is then drawn through OpenGL, at the same
+ * resolution and with the same back face outlines, to compare the software renderer with the GPU. Run it
+ * from the directory that holds shaders/ for that part.
+ * Usage: RasterBenchmark model.raw [maxThreads] [frames]
+ * @param argc The number of command line arguments.
+ * @param argv An array of strings containing the command line arguments.
+ * @return 0 on successful termination, otherwise some error code.
+ */
+int main(int argc, char **argv) {
+	RawMeshLoader mesh;
+	std::vector<unsigned int> threadCounts;
+	std::vector<GLubyte> reference;
+	std::vector<GLubyte> pixels;
+#ifdef HAVE_EGL
+	std::string renderer;
+	double softwareSeconds;
+#endif
+	unsigned int maxThreads;
+	unsigned int frames;
+	unsigned int threads;
+	unsigned int i;
+	double triangles;
+	double baseline;
+	double seconds;
+	int result;
+
+	if (argc < 2) {
+		std::cout << "Usage: " << argv[0] << " model.raw [maxThreads] [frames]" << std::endl;
+		return 1;
+	}
+
+	maxThreads = (argc > 2) ? static_cast<unsigned int>(atoi(argv[2])) : std::thread::hardware_concurrency();
+	frames = (argc > 3) ? static_cast<unsigned int>(atoi(argv[3])) : DEFAULT_FRAMES;
+	if (maxThreads == 0) {
+		maxThreads = 1;
+	}
+	if (frames == 0) {
+		frames = 1;
+	}
+
+	if (mesh.load(argv[1], RawMeshLoader::LOAD_MAPPED) == 0) {
+		std::cout << "Could not load " << argv[1] << std::endl;
+		return 1;
+	}
+	triangles = static_cast<double>(mesh.getSize() / 3);
+	std::cout << argv[1] << ": " << mesh.getSize() / 3 << " triangles at " << IMAGE_WIDTH << "x" << IMAGE_HEIGHT
+	          << ", best of " << frames << " frames" << std::endl;
+
+	// Double the thread count up to the maximum, which is always included
+	for (threads = 1; threads < maxThreads; threads *= 2) {
+		threadCounts.push_back(threads);
+	}
+	threadCounts.push_back(maxThreads);
+
+	std::cout << std::right << std::setw(8) << "threads" << std::setw(12) << "ms" << std::setw(12) << "Mtri/s"
+	          << std::setw(10) << "speedup" << std::endl;
+
+	result = 0;
+	baseline = 0.0;
+	seconds = 0.0;
+	for (i = 0; i < threadCounts.size(); i++) {
+		ThreadPool pool(threadCounts[i]);
+
+		seconds = bestFrameTime(mesh, pool, frames, pixels);
+		if (i == 0) {
+			baseline = seconds;
+			reference = pixels;
+		}
+		else if (pixels != reference) {
+			std::cout << "The image drawn on " << threadCounts[i] << " threads differs from the one drawn on "
+			          << threadCounts[0] << std::endl;
+			result = 2;
+		}
+
+		std::cout << std::setw(8) << threadCounts[i]
+		          << std::setw(12) << std::fixed << std::setprecision(2) << seconds * 1000.0
+		          << std::setw(12) << std::setprecision(2) << triangles / seconds / 1000000.0
+		          << std::setw(10) << std::setprecision(2) << baseline / seconds << std::endl;
+	}
+
+#ifdef HAVE_EGL
+	softwareSeconds = seconds;
+	seconds = bestGlFrameTime(mesh, frames, pixels, renderer);
+	if (seconds > 0.0) {
+		std::cout << std::setw(8) << "OpenGL" << std::setw(12) << seconds * 1000.0 << std::setw(12) << triangles / seconds / 1000000.0
+		          << std::setw(10) << baseline / seconds << "  (" << renderer << ")" << std::endl;
+		std::cout << "Software on " << threadCounts.back() << " threads takes " << softwareSeconds / seconds
+		          << " times as long as OpenGL, " << std::setprecision(3)
+		          << 100.0 * countDifferentPixels(reference, pixels) / (static_cast<double>(IMAGE_WIDTH) * IMAGE_HEIGHT)
+		          << "% of the pixels differ" << std::endl;
+	}
+	else {
+		std::cout << "OpenGL is not available, skipping the comparison" << std::endl;
+	}
+#else
+	std::cout << "Built without EGL, the OpenGL comparison is not available" << std::endl;
+#endif
+
+	return result;
+}
@@ -0,0 +1,591 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "VectorArray.h"
+#include "VectorN.h"
+
+/** Number of vectors in each array, small enough to stay in the cache */
+#define VECTOR_COUNT 4096
+/** Number of passes over the arrays for each measurement */
+#define DEFAULT_PASSES 2000
+/** Number of floats in each record of a .raw file, the views read the positions out of such records */
+#define RECORD_FLOATS 11
+
+/** Constant vectors, and expressions of them, are computed by the compiler */
+constexpr Vector3f CONSTANT_A(1.0f, 2.0f, 3.0f);
+constexpr Vector3f CONSTANT_B(4.0f, 5.0f, 6.0f);
+constexpr Vector3f CONSTANT_RESULT = CONSTANT_A + CONSTANT_B * 2.0f - CONSTANT_A / 2.0f;
+static_assert((CONSTANT_RESULT[0] == 8.5f) && (CONSTANT_RESULT[1] == 11.0f) && (CONSTANT_RESULT[2] == 13.5f),
+              "VectorN expressions of constant vectors should fold at compile time");
+
+/** The ways the expression a + b * s - a / t is computed */
+enum ExpressionForm {
+    /** A loop over the elements of each VectorN written out by hand */
+    EXPRESSION_HAND_WRITTEN,
+    /** A VectorN constructed from the expression */
+    EXPRESSION_CONSTRUCTED,
+    /** The expression assigned to a VectorN */
+    EXPRESSION_ASSIGNED
+};
+
+/** The operations on whole arrays of vectors */
+enum BulkOperation {
+    BULK_TRANSFORM,
+    BULK_NORMALIZE,
+    BULK_DOT,
+    BULK_BOUNDS,
+    BULK_CROSS
+};
+
+/** Where the vectors of a bulk operation are stored */
+enum BulkLayout {
+    /** A std::vector of Vector3f, with the operation done on one VectorN at a time */
+    BULK_VECTORN,
+    /** A Vector3fArray that owns its vectors */
+    BULK_ARRAY,
+    /** A Vector3fArray viewing the positions inside .raw file records */
+    BULK_VIEW
+};
+
+template <typename TYPE, int N>
+/** The vector as VectorN implemented it before its SIMD kernels, a loop over the elements for every
+ * operation, to measure the kernels against
+ */
+class ScalarVector {
+public:
+    ScalarVector() {
+        int i;
+
+        for (i = 0; i < N; i++) {
+            vec[i] = 0;
+        }
+    }
+
+    ScalarVector(const TYPE *arr) {
+        int i;
+
+        for (i = 0; i < N; i++) {
+            vec[i] = arr[i];
+        }
+    }
+
+    ScalarVector operator +(const ScalarVector& p) const {
+        ScalarVector result;
+        int i;
+
+        for (i = 0; i < N; i++) {
+            result.vec[i] = vec[i] + p.vec[i];
+        }
+
+        return result;
+    }
+
+    ScalarVector operator *(const TYPE& scalar) const {
+        ScalarVector result;
+        int i;
+
+        for (i = 0; i < N; i++) {
+            result.vec[i] = vec[i] * scalar;
+        }
+
+        return result;
+    }
+
+    TYPE dot(const ScalarVector& vector) const {
+        TYPE dotProduct;
+        int i;
+
+        dotProduct = vec[0] * vector.vec[0];
+        for (i = 1; i < N; i++) {
+            dotProduct += vec[i] * vector.vec[i];
+        }
+
+        return dotProduct;
+    }
+
+    void unitize() {
+        TYPE len;
+        int i;
+
+        len = (TYPE) sqrt(dot(*this));
+        for (i = 0; i < N; i++) {
+            vec[i] /= len;
+        }
+    }
+
+    ScalarVector cross(const ScalarVector& vector) const {
+        ScalarVector result;
+
+        result.vec[0] = vec[1] * vector.vec[2] - vec[2] * vector.vec[1];
+        result.vec[1] = -vec[0] * vector.vec[2] + vec[2] * vector.vec[0];
+        result.vec[2] = vec[0] * vector.vec[1] - vec[1] * vector.vec[0];
+
+        return result;
+    }
+
+private:
+    TYPE vec[N];
+};
+
+/** What a measurement computed, so that the compiler can't drop the work, and how long it took */
+struct Timing {
+    double checksum;
+    double nanoseconds;
+};
+
+template <typename VECTOR, typename TYPE, int N>
+/** Fills two arrays with the same pseudo random vectors for every vector type */
+void fill(std::vector<VECTOR>& a, std::vector<VECTOR>& b) {
+    TYPE values[N];
+    unsigned int i;
+    int j;
+
+    srand(1);
+    a.clear();
+    b.clear();
+    for (i = 0; i < VECTOR_COUNT; i++) {
+        for (j = 0; j < N; j++) {
+            values[j] = static_cast<TYPE>(rand() % 2001 - 1000) / 100 + 1;
+        }
+        a.push_back(VECTOR(values));
+
+        for (j = 0; j < N; j++) {
+            values[j] = static_cast<TYPE>(rand() % 2001 - 1000) / 100 - 1;
+        }
+        b.push_back(VECTOR(values));
+    }
+}
+
+template <typename VECTOR, typename TYPE, int N>
+/** a + b * s, then the dot product of the result with b, for every pair */
+Timing timeMultiplyAdd(unsigned int passes) {
+    std::chrono::steady_clock::time_point start;
+    std::vector<VECTOR> a;
+    std::vector<VECTOR> b;
+    Timing timing;
+    TYPE scale;
+    unsigned int pass;
+    unsigned int i;
+
+    fill<VECTOR, TYPE, N>(a, b);
+    timing.checksum = 0.0;
+    start = std::chrono::steady_clock::now();
+
+    for (pass = 0; pass < passes; pass++) {
+        scale = static_cast<TYPE>(pass % 7) / 8;
+        for (i = 0; i < VECTOR_COUNT; i++) {
+            timing.checksum += (a[i] + b[i] * scale).dot(b[i]);
+        }
+    }
+
+    timing.nanoseconds = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+                         (static_cast<double>(passes) * VECTOR_COUNT);
+    return timing;
+}
+
+template <typename VECTOR, typename TYPE, int N>
+/** Normalizes every vector */
+Timing timeUnitize(unsigned int passes) {
+    std::chrono::steady_clock::time_point start;
+    std::vector<VECTOR> a;
+    std::vector<VECTOR> b;
+    Timing timing;
+    VECTOR vector;
+    unsigned int pass;
+    unsigned int i;
+
+    fill<VECTOR, TYPE, N>(a, b);
+    timing.checksum = 0.0;
+    start = std::chrono::steady_clock::now();
+
+    for (pass = 0; pass < passes; pass++) {
+        for (i = 0; i < VECTOR_COUNT; i++) {
+            vector = a[(i + pass) % VECTOR_COUNT];
+            vector.unitize();
+            timing.checksum += vector.dot(b[i]);
+        }
+    }
+
+    timing.nanoseconds = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+                         (static_cast<double>(passes) * VECTOR_COUNT);
+    return timing;
+}
+
+template <typename VECTOR, typename TYPE, int N>
+/** The cross product of every pair, dotted with the first vector of the next pair */
+Timing timeCross(unsigned int passes) {
+    std::chrono::steady_clock::time_point start;
+    std::vector<VECTOR> a;
+    std::vector<VECTOR> b;
+    Timing timing;
+    unsigned int pass;
+    unsigned int i;
+
+    fill<VECTOR, TYPE, N>(a, b);
+    timing.checksum = 0.0;
+    start = std::chrono::steady_clock::now();
+
+    for (pass = 0; pass < passes; pass++) {
+        for (i = 0; i < VECTOR_COUNT; i++) {
+            timing.checksum += a[i].cross(b[i]).dot(a[(i + pass) % VECTOR_COUNT]);
+        }
+    }
+
+    timing.nanoseconds = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+                         (static_cast<double>(passes) * VECTOR_COUNT);
+    return timing;
+}
+
+template <typename TYPE, int N>
+/** Computes a + b * s - a / t for every pair into an array, then adds up the results. Every form reads
+ * and writes the same arrays of VectorN, so only the way the elements are computed differs.
+ */
+Timing timeExpression(ExpressionForm form, unsigned int passes) {
+    std::chrono::steady_clock::time_point start;
+    std::vector<VectorN<TYPE, N> > a;
+    std::vector<VectorN<TYPE, N> > b;
+    std::vector<VectorN<TYPE, N> > results(VECTOR_COUNT);
+    Timing timing;
+    TYPE scale;
+    TYPE divisor;
+    unsigned int pass;
+    unsigned int i;
+    int j;
+
+    fill<VectorN<TYPE, N>, TYPE, N>(a, b);
+    start = std::chrono::steady_clock::now();
+
+    for (pass = 0; pass < passes; pass++) {
+        scale = static_cast<TYPE>(pass % 7) / 8;
+        divisor = static_cast<TYPE>(pass % 5 + 1);
+
+        switch (form) {
+            case EXPRESSION_HAND_WRITTEN:
+                for (i = 0; i < VECTOR_COUNT; i++) {
+                    for (j = 0; j < N; j++) {
+                        results[i][j] = a[i][j] + b[i][j] * scale - a[i][j] / divisor;
+                    }
+                }
+                break;
+
+            case EXPRESSION_CONSTRUCTED:
+                for (i = 0; i < VECTOR_COUNT; i++) {
+                    VectorN<TYPE, N> result(a[i] + b[i] * scale - a[i] / divisor);
+
+                    results[i] = result;
+                }
+                break;
+
+            case EXPRESSION_ASSIGNED:
+                for (i = 0; i < VECTOR_COUNT; i++) {
+                    results[i] = a[i] + b[i] * scale - a[i] / divisor;
+                }
+                break;
+        }
+    }
+
+    timing.nanoseconds = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+                         (static_cast<double>(passes) * VECTOR_COUNT);
+
+    timing.checksum = 0.0;
+    for (i = 0; i < VECTOR_COUNT; i++) {
+        for (j = 0; j < N; j++) {
+            timing.checksum += results[i][j];
+        }
+    }
+
+    return timing;
+}
+
+/** Performs an operation on a whole array of Vector3f, then adds up the results */
+Timing timeBulk(BulkOperation operation, BulkLayout layout, unsigned int passes) {
+    std::chrono::steady_clock::time_point start;
+    std::vector<Vector3f> a;
+    std::vector<Vector3f> b;
+    std::vector<Vector3f> results(VECTOR_COUNT);
+    std::vector<float> records(VECTOR_COUNT * RECORD_FLOATS);
+    std::vector<float> dots(VECTOR_COUNT);
+    Vector3fArray arrayA(VECTOR_COUNT);
+    Vector3fArray arrayB(VECTOR_COUNT);
+    Vector3fArray arrayResults(VECTOR_COUNT);
+    ConstVector3fArray view;
+    const ConstVector3fArray *source;
+    Vector3f minimum;
+    Vector3f maximum;
+    float matrix[16];
+    Timing timing;
+    unsigned int pass;
+    unsigned int i;
+    int j;
+
+    fill<Vector3f, float, 3>(a, b);
+    for (i = 0; i < VECTOR_COUNT; i++) {
+        arrayA.set(i, a[i]);
+        arrayB.set(i, b[i]);
+        a[i].copyTo(&records[i * RECORD_FLOATS]);
+    }
+    view = ConstVector3fArray(records.data(), VECTOR_COUNT, RECORD_FLOATS * sizeof(float));
+    source = (layout == BULK_VIEW) ? &view : &arrayA;
+
+    // A rotation about z, a scale along z and a translation, column major
+    for (j = 0; j < 16; j++) {
+        matrix[j] = 0.0f;
+    }
+    matrix[0] = matrix[5] = 0.6f;
+    matrix[1] = 0.8f;
+    matrix[4] = -0.8f;
+    matrix[10] = 2.0f;
+    matrix[12] = 1.0f;
+    matrix[13] = 2.0f;
+    matrix[14] = 3.0f;
+    matrix[15] = 1.0f;
+
+    timing.checksum = 0.0;
+    start = std::chrono::steady_clock::now();
+
+    for (pass = 0; pass < passes; pass++) {
+        if (layout == BULK_VECTORN) {
+            switch (operation) {
+                case BULK_TRANSFORM:
+                    for (i = 0; i < VECTOR_COUNT; i++) {
+                        for (j = 0; j < 3; j++) {
+                            results[i][j] = matrix[j] * a[i][0] + matrix[4 + j] * a[i][1] + matrix[8 + j] * a[i][2] + matrix[12 + j];
+                        }
+                    }
+                    break;
+
+                case BULK_NORMALIZE:
+                    for (i = 0; i < VECTOR_COUNT; i++) {
+                        results[i] = a[i];
+                        results[i].unitize();
+                    }
+                    break;
+
+                case BULK_DOT:
+                    for (i = 0; i < VECTOR_COUNT; i++) {
+                        dots[i] = a[i].dot(b[pass % VECTOR_COUNT]);
+                    }
+                    break;
+
+                case BULK_BOUNDS:
+                    minimum = maximum = a[0];
+                    for (i = 1; i < VECTOR_COUNT; i++) {
+                        for (j = 0; j < 3; j++) {
+                            minimum[j] = std::min(minimum[j], a[i][j]);
+                            maximum[j] = std::max(maximum[j], a[i][j]);
+                        }
+                    }
+                    break;
+
+                case BULK_CROSS:
+                    for (i = 0; i < VECTOR_COUNT; i++) {
+                        results[i] = a[i].cross(b[i]);
+                    }
+                    break;
+            }
+        }
+        else {
+            switch (operation) {
+                case BULK_TRANSFORM:
+                    source->transform(matrix, 1.0f, arrayResults);
+                    break;
+
+                case BULK_NORMALIZE:
+                    source->normalize(arrayResults);
+                    break;
+
+                case BULK_DOT:
+                    source->dot(b[pass % VECTOR_COUNT], dots.data());
+                    break;
+
+                case BULK_BOUNDS:
+                    source->bounds(minimum, maximum);
+                    break;
+
+                case BULK_CROSS:
+                    source->cross(arrayB, arrayResults);
+                    break;
+            }
+        }
+
+        if (operation == BULK_BOUNDS) {
+            timing.checksum += minimum.dot(maximum);
+        }
+    }
+
+    timing.nanoseconds = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() /
+                         (static_cast<double>(passes) * VECTOR_COUNT);
+
+    for (i = 0; i < VECTOR_COUNT; i++) {
+        if (operation == BULK_DOT) {
+            timing.checksum += dots[i];
+        }
+        else if (operation != BULK_BOUNDS) {
+            for (j = 0; j < 3; j++) {
+                timing.checksum += (layout == BULK_VECTORN) ? results[i][j] : arrayResults[i][j];
+            }
+        }
+    }
+
+    return timing;
+}
+
+/**
+ * Prints one row of the results table.
+ * @param name The type and operation measured.
+ * @param scalar The measurement with the scalar loops.
+ * @param simd The measurement with VectorN.
+ */
+void printRow(const char* name, const Timing& scalar, const Timing& simd) {
+    std::cout << std::left << std::setw(24) << name << std::right << std::fixed
+              << std::setw(12) << std::setprecision(3) << scalar.nanoseconds
+              << std::setw(12) << simd.nanoseconds
+              << std::setw(10) << std::setprecision(2) << scalar.nanoseconds / simd.nanoseconds;
+
+    // Both add up the same values, but SIMD dot products add them in a different order
+    if (fabs(scalar.checksum - simd.checksum) > 1e-3 * (1.0 + fabs(scalar.checksum))) {
+        std::cout << "  results differ: " << scalar.checksum << " " << simd.checksum;
+    }
+    std::cout << std::endl;
+}
+
+/**
+ * Prints one row of the expression table.
+ * @param name The type measured.
+ * @param handWritten The measurement with the loops written out by hand.
+ * @param constructed The measurement with a VectorN constructed from the expression.
+ * @param assigned The measurement with the expression assigned to a VectorN.
+ */
+void printExpressionRow(const char* name, const Timing& handWritten, const Timing& constructed, const Timing& assigned) {
+    std::cout << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(3)
+              << std::setw(14) << handWritten.nanoseconds
+              << std::setw(14) << constructed.nanoseconds
+              << std::setw(14) << assigned.nanoseconds;
+
+    // The elements go through the same operations in the same order, so the results are identical
+    if ((constructed.checksum != handWritten.checksum) || (assigned.checksum != handWritten.checksum)) {
+        std::cout << "  results differ";
+    }
+    std::cout << std::endl;
+}
+
+/**
+ * Prints one row of the bulk operation table.
+ * @param name The operation measured.
+ * @param vectorN The measurement with a VectorN at a time.
+ * @param array The measurement with a Vector3fArray that owns its vectors.
+ * @param view The measurement with a Vector3fArray viewing .raw records.
+ */
+void printBulkRow(const char* name, const Timing& vectorN, const Timing& array, const Timing& view) {
+    std::cout << std::left << std::setw(24) << name << std::right << std::fixed << std::setprecision(3)
+              << std::setw(14) << vectorN.nanoseconds
+              << std::setw(14) << array.nanoseconds
+              << std::setw(14) << view.nanoseconds;
+
+    // The arrays add up the products in a different order than VectorN does
+    if ((fabs(array.checksum - vectorN.checksum) > 1e-3 * (1.0 + fabs(vectorN.checksum))) ||
+        (fabs(view.checksum - vectorN.checksum) > 1e-3 * (1.0 + fabs(vectorN.checksum)))) {
+        std::cout << "  results differ: " << vectorN.checksum << " " << array.checksum << " " << view.checksum;
+    }
+    std::cout << std::endl;
+}
+
+/**
+ * Measures VectorN's SIMD kernels against scalar loops, its expressions against loops written out by
+ * hand, and the bulk operations of VectorArray against a VectorN at a time.
+ * Usage: VectorBenchmark [passes]
+ * @param argc The number of command line arguments.
+ * @param argv An array of strings containing the command line arguments.
+ * @return 0 on successful termination, otherwise some error code.
+ */
+int main(int argc, char **argv) {
+    unsigned int passes;
+
+    passes = (argc > 1) ? static_cast<unsigned int>(atoi(argv[1])) : DEFAULT_PASSES;
+    if (passes == 0) {
+        passes = 1;
+    }
+
+#if defined(__AVX__)
+    std::cout << "Kernels: AVX" << std::endl;
+#elif defined(__SSE2__)
+    std::cout << "Kernels: SSE2" << std::endl;
+#elif defined(VECTORN_SIMD_FLOAT)
+    std::cout << "Kernels: NEON" << std::endl;
+#else
+    std::cout << "Kernels: none, VectorN uses scalar loops" << std::endl;
+#endif
+
+    std::cout << std::left << std::setw(24) << "operation" << std::right << std::setw(12) << "scalar ns"
+              << std::setw(12) << "VectorN ns" << std::setw(10) << "speedup" << std::endl;
+
+    printRow("Vector4f multiply add", timeMultiplyAdd<ScalarVector<float, 4>, float, 4>(passes),
+             timeMultiplyAdd<Vector4f, float, 4>(passes));
+    printRow("Vector4f unitize", timeUnitize<ScalarVector<float, 4>, float, 4>(passes),
+             timeUnitize<Vector4f, float, 4>(passes));
+    printRow("Vector3f multiply add", timeMultiplyAdd<ScalarVector<float, 3>, float, 3>(passes),
+             timeMultiplyAdd<Vector3f, float, 3>(passes));
+    printRow("Vector3f unitize", timeUnitize<ScalarVector<float, 3>, float, 3>(passes),
+             timeUnitize<Vector3f, float, 3>(passes));
+    printRow("Vector3f cross", timeCross<ScalarVector<float, 3>, float, 3>(passes),
+             timeCross<Vector3f, float, 3>(passes));
+    printRow("Vector4d multiply add", timeMultiplyAdd<ScalarVector<double, 4>, double, 4>(passes),
+             timeMultiplyAdd<Vector4d, double, 4>(passes));
+    printRow("Vector4d unitize", timeUnitize<ScalarVector<double, 4>, double, 4>(passes),
+             timeUnitize<Vector4d, double, 4>(passes));
+
+    std::cout << std::endl << std::left << std::setw(24) << "a + b * s - a / t" << std::right << std::setw(14)
+              << "by hand ns" << std::setw(14) << "construct ns" << std::setw(14) << "assign ns" << std::endl;
+
+    printExpressionRow("Vector4f", timeExpression<float, 4>(EXPRESSION_HAND_WRITTEN, passes),
+                       timeExpression<float, 4>(EXPRESSION_CONSTRUCTED, passes),
+                       timeExpression<float, 4>(EXPRESSION_ASSIGNED, passes));
+    printExpressionRow("Vector3f", timeExpression<float, 3>(EXPRESSION_HAND_WRITTEN, passes),
+                       timeExpression<float, 3>(EXPRESSION_CONSTRUCTED, passes),
+                       timeExpression<float, 3>(EXPRESSION_ASSIGNED, passes));
+    printExpressionRow("Vector4d", timeExpression<double, 4>(EXPRESSION_HAND_WRITTEN, passes),
+                       timeExpression<double, 4>(EXPRESSION_CONSTRUCTED, passes),
+                       timeExpression<double, 4>(EXPRESSION_ASSIGNED, passes));
+
+    std::cout << std::endl << std::left << std::setw(24) << "Vector3f bulk" << std::right << std::setw(14)
+              << "VectorN ns" << std::setw(14) << "array ns" << std::setw(14) << "view ns" << std::endl;
+
+    printBulkRow("transform", timeBulk(BULK_TRANSFORM, BULK_VECTORN, passes), timeBulk(BULK_TRANSFORM, BULK_ARRAY, passes),
+                 timeBulk(BULK_TRANSFORM, BULK_VIEW, passes));
+    printBulkRow("normalize", timeBulk(BULK_NORMALIZE, BULK_VECTORN, passes), timeBulk(BULK_NORMALIZE, BULK_ARRAY, passes),
+                 timeBulk(BULK_NORMALIZE, BULK_VIEW, passes));
+    printBulkRow("dot", timeBulk(BULK_DOT, BULK_VECTORN, passes), timeBulk(BULK_DOT, BULK_ARRAY, passes),
+                 timeBulk(BULK_DOT, BULK_VIEW, passes));
+    printBulkRow("bounds", timeBulk(BULK_BOUNDS, BULK_VECTORN, passes), timeBulk(BULK_BOUNDS, BULK_ARRAY, passes),
+                 timeBulk(BULK_BOUNDS, BULK_VIEW, passes));
+    printBulkRow("cross", timeBulk(BULK_CROSS, BULK_VECTORN, passes), timeBulk(BULK_CROSS, BULK_ARRAY, passes),
+                 timeBulk(BULK_CROSS, BULK_VIEW, passes));
+
+    return 0;
+}
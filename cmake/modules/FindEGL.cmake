@@ -0,0 +1,28 @@
+# - Try to find EGL
+# Once done this will define
+#  
+#  EGL_FOUND        - system has EGL
+#  EGL_INCLUDE_DIR  - the EGL include directory
+#  EGL_LIBRARIES    - Link these to use EGL
+#   
+# EGL is only used to render without a window, so it is fine for it to be
+# missing
+
+FIND_PATH(EGL_INCLUDE_DIR EGL/egl.h)
+FIND_LIBRARY(EGL_LIBRARY NAMES EGL libEGL)
+
+# handle the QUIETLY and REQUIRED arguments and set EGL_FOUND to TRUE if
+# all listed variables are TRUE
+INCLUDE(FindPackageHandleStandardArgs)
+FIND_PACKAGE_HANDLE_STANDARD_ARGS(EGL REQUIRED_VARS EGL_LIBRARY EGL_INCLUDE_DIR)
+
+IF(EGL_FOUND)
+
+    SET( EGL_LIBRARIES  ${EGL_LIBRARY} ${EGL_LIBRARIES})
+
+ENDIF(EGL_FOUND)
+
+MARK_AS_ADVANCED(
+  EGL_INCLUDE_DIR
+  EGL_LIBRARY
+)
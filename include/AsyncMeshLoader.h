@@ -0,0 +1,164 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __ASYNC_MESH_LOADER_H__
+#define __ASYNC_MESH_LOADER_H__
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+#include <thread>
+
+#include "ClusterBvh.h"
+#include "EdgeAdjacency.h"
+#include "IndexedMesh.h"
+#include "MeshBuffer.h"
+#include "RawMeshLoader.h"
+#include "ThreadPool.h"
+
+/** Number of bytes copied into GPU buffers per frame while a mesh is being uploaded */
+#define ASYNC_MESH_UPLOAD_BUDGET (1024 * 1024)
+
+class AsyncMeshLoader {
+	public:
+		/**
+		 * The stages a mesh goes through on its way to the GPU.
+		 */
+		enum State {
+			/** Nothing has been requested yet */
+			STATE_IDLE,
+			/** The worker thread is reading and processing the mesh */
+			STATE_LOADING,
+			/** The mesh is in memory and waiting to be uploaded */
+			STATE_LOADED,
+			/** The mesh is being copied into the GPU buffers, a part every frame */
+			STATE_UPLOADING,
+			/** The mesh is ready to be drawn */
+			STATE_READY,
+			/** The mesh could not be loaded */
+			STATE_FAILED
+		};
+
+		/**
+		 * Constructor.
+		 * @param basePath The path of the model without its extension. The compressed .rmc version is
+		 * used when it exists, otherwise the .raw version is loaded, welded and optimized.
+		 * @param threadPool Worker threads used to decode and load the model.
+		 */
+		AsyncMeshLoader(const std::string& basePath, ThreadPool& threadPool);
+
+		/**
+		 * Destructor. Waits for the worker thread to finish.
+		 */
+		~AsyncMeshLoader();
+
+		/**
+		 * Starts loading the mesh on a worker thread. Does nothing if it has already been started, so it
+		 * can be called every frame to prefetch a mesh that will be needed soon.
+		 */
+		void start();
+
+		/**
+		 * Moves the mesh along once it has been loaded, by uploading at most byteBudget bytes of it into
+		 * the buffer. Must be called from the thread owning the GL context, once per frame.
+		 * @param buffer The buffer to upload the mesh into.
+		 * @param quantize Whether the buffer should hold quantized vertices.
+		 * @param byteBudget The maximum number of bytes to upload in this call.
+		 * @return true if the mesh is ready to be drawn from buffer, false otherwise.
+		 */
+		bool update(MeshBuffer& buffer, bool quantize, size_t byteBudget = ASYNC_MESH_UPLOAD_BUDGET);
+
+		/**
+		 * Gets the current stage of the mesh.
+		 */
+		State getState() const;
+
+		/**
+		 * Checks if loading has been started and has not finished or failed yet.
+		 */
+		bool isBusy() const;
+
+		/**
+		 * Gets the cluster hierarchy of the mesh, which is valid once the state is STATE_READY.
+		 */
+		const ClusterBvh& getClusterBvh() const;
+
+		/**
+		 * Gets the edges of the mesh, which are valid once the state is STATE_READY.
+		 */
+		const EdgeAdjacency& getEdgeAdjacency() const;
+
+		/**
+		 * Waits for the worker thread and frees the CPU side copy of the mesh, its clusters and its edges.
+		 */
+		void release();
+
+	private:
+		/**
+		 * Reads and processes the mesh. Runs on the worker thread.
+		 */
+		void loadMesh();
+
+		/** The path of the model without its extension */
+		std::string basePath;
+		/** Worker threads used to decode and load the model */
+		ThreadPool& threadPool;
+		/** The thread running loadMesh */
+		std::thread worker;
+		/** The current State, written by the worker thread while loading */
+		std::atomic<int> state;
+		/** The loaded mesh, owned by the worker thread until the state is STATE_LOADED */
+		IndexedMesh mesh;
+		/** The clusters of the loaded mesh, built by the worker thread along with the mesh */
+		ClusterBvh clusterBvh;
+		/** The edges of the loaded mesh, built by the worker thread once the triangle order is final */
+		EdgeAdjacency edgeAdjacency;
+		/** The loader for the .raw version of the model */
+		RawMeshLoader meshLoader;
+
+		AsyncMeshLoader(const AsyncMeshLoader&);
+		AsyncMeshLoader& operator=(const AsyncMeshLoader&);
+};
+
+#endif
+
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
@@ -0,0 +1,176 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __BATCH_RENDERER_H__
+#define __BATCH_RENDERER_H__
+
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+
+#include "RawMeshLoader.h"
+#include "SoftwareRasterizer.h"
+#include "ThreadPool.h"
+
+/** The number of models kept loaded at once, the next one is loaded while the frames of the others are drawn */
+#define BATCH_MODELS_IN_FLIGHT 4
+/** The most frames a job may ask for, the images are numbered with four digits */
+#define BATCH_MAX_FRAMES 10000
+/** The projection every job uses, the same as the cel shader's */
+#define BATCH_FIELD_OF_VIEW 45.0f
+#define BATCH_NEAR_PLANE 0.1f
+#define BATCH_FAR_PLANE 100.0f
+
+/**
+ * Renders turntables of many models in one process with the software rasterizer, for thumbnailing assets
+ * without paying the start up of a process per asset.
+ *
+ * The jobs are read from a manifest, one per line:
+ *
+ *     model.raw imagePrefix width height frames pitch distance [turns]
+ *
+ * The camera orbits the model at the given pitch and distance, going round the given number of turns (1 by
+ * default) over the frames, and every frame is written to imagePrefixNNNN.ppm. Blank lines and lines
+ * starting with # are skipped.
+ *
+ * Each model is loaded once and shared by every job that draws it. Every frame is a separate task on the
+ * thread pool, drawn on a single thread with a rasterizer taken from a pool, so the cores are kept busy by
+ * drawing several frames at once rather than by splitting each frame up.
+ */
+class BatchRenderer {
+	public:
+		/**
+		 * Constructor.
+		 * @param threadCount The number of frames drawn at once, 0 for one per hardware thread.
+		 */
+		explicit BatchRenderer(unsigned int threadCount = 0);
+
+		/**
+		 * Destructor. Frees the rasterizers.
+		 */
+		~BatchRenderer();
+
+		/**
+		 * Reads the jobs from a manifest.
+		 * @param path The path of the manifest.
+		 * @return true if successfull, false if it could not be read or a line is malformed.
+		 */
+		bool loadManifest(const std::string& path);
+
+		/**
+		 * Draws every frame of every job, and blocks until they have all been written.
+		 * @return true if every frame was written, false otherwise.
+		 */
+		bool run();
+
+		/**
+		 * Prints the number of frames written and the throughput of the last run to stdout.
+		 */
+		void printReport() const;
+
+	private:
+		/**
+		 * A turntable to render.
+		 */
+		struct Job {
+			/** The model */
+			unsigned int model;
+			/** The images are written to imagePrefixNNNN.ppm */
+			std::string imagePrefix;
+			/** The size of the images */
+			int width;
+			int height;
+			/** The number of frames */
+			unsigned int frameCount;
+			/** The camera's pitch in radians, and distance from the model */
+			GLfloat pitch;
+			GLfloat distance;
+			/** The number of times the camera goes round the model over the frames */
+			GLfloat turns;
+		};
+
+		/**
+		 * A model shared by the jobs that draw it.
+		 */
+		struct Model {
+			/** The path of the .raw file */
+			std::string path;
+			/** The jobs that draw it */
+			std::vector<unsigned int> jobs;
+			/** The mesh, NULL while it isn't loaded */
+			RawMeshLoader *mesh;
+			/** The number of frames still to be drawn with the mesh, it is freed when the last one is done */
+			unsigned int remainingFrames;
+		};
+
+		/**
+		 * Draws a frame of a job and writes it out. Runs on the thread pool.
+		 * @param job The job.
+		 * @param frame The frame.
+		 */
+		void renderFrame(const Job& job, unsigned int frame);
+
+		/**
+		 * Takes an idle rasterizer, creating one if there are none.
+		 */
+		SoftwareRasterizer* acquireRasterizer();
+
+		/**
+		 * Records that a frame of a model is done, freeing the model after its last frame.
+		 * @param model The model.
+		 * @param written Whether the frame was written.
+		 * @param seconds The time the frame took.
+		 */
+		void finishFrame(unsigned int model, bool written, double seconds);
+
+		/** The workers the frames are drawn on */
+		ThreadPool threadPool;
+		/** The jobs, in the order they appear in the manifest */
+		std::vector<Job> jobs;
+		/** The models, in the order the jobs first use them */
+		std::vector<Model> models;
+		/** Rasterizers not drawing a frame */
+		std::vector<SoftwareRasterizer*> idleRasterizers;
+		/** Every rasterizer created, for the destructor */
+		std::vector<SoftwareRasterizer*> rasterizers;
+		/** Guards the models, the rasterizer pool and the statistics */
+		std::mutex mutex;
+		/** Signalled when a model is freed */
+		std::condition_variable modelFreed;
+		/** The number of models loaded */
+		unsigned int loadedModels;
+		/** The statistics of the last run */
+		unsigned long long framesWritten;
+		unsigned long long framesFailed;
+		unsigned int modelsFailed;
+		/** The time spent loading models, the time the frames took added together, and the wall clock time */
+		double loadSeconds;
+		double frameSeconds;
+		double runSeconds;
+
+		BatchRenderer(const BatchRenderer&);
+		BatchRenderer& operator=(const BatchRenderer&);
+};
+
+#endif
@@ -0,0 +1,130 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __BENCHMARK_H__
+#define __BENCHMARK_H__
+
+#include <string>
+#include <vector>
+
+#include "CelShader.h"
+
+/** The number of scenes the benchmark goes through */
+#define BENCHMARK_SCENE_COUNT 3
+/** The frames drawn before a scene is measured, so that its programs and meshes are ready */
+#define BENCHMARK_WARMUP_FRAMES 10
+/** The time every frame advances the light by, in seconds */
+#define BENCHMARK_TIMESTEP (1.0f / 60.0f)
+
+/**
+ * Draws a fixed number of frames of every scene along a scripted camera and light path, with a fixed
+ * timestep, so that runs can be compared with each other. Each frame is timed from the start of the
+ * step until the GPU has finished it.
+ */
+class Benchmark {
+	public:
+		/**
+		 * Constructor. Switches the cel shader to a fixed timestep.
+		 * @param celShader The cel shader to draw with.
+		 * @param framesPerScene The number of frames measured in each scene.
+		 */
+		Benchmark(CelShader& celShader, unsigned int framesPerScene);
+
+		/**
+		 * Draws the next frame of the benchmark.
+		 * @return false once every scene has been measured, true otherwise.
+		 */
+		bool runFrame();
+
+		/**
+		 * Prints the results as a table to stdout.
+		 */
+		void printTable() const;
+
+		/**
+		 * Writes the results to a JSON file.
+		 * @param path The path of the file.
+		 * @return true if successfull, false otherwise.
+		 */
+		bool writeJson(const std::string& path) const;
+
+	private:
+		/**
+		 * What was measured in a scene.
+		 */
+		struct SceneResult {
+			/** The time each frame took, in milliseconds */
+			std::vector<double> frameTimes;
+			/** The draws and primitives of all frames together */
+			unsigned long long drawCount;
+			unsigned long long primitiveCount;
+		};
+
+		/**
+		 * The frame time statistics of a scene, in milliseconds.
+		 */
+		struct Summary {
+			double mean;
+			double p50;
+			double p95;
+			double p99;
+			double max;
+		};
+
+		/**
+		 * Points the camera along the scripted path.
+		 * @param t How far along the path, 0 to 1.
+		 */
+		void setView(float t);
+
+		/**
+		 * Computes the frame time statistics of a scene.
+		 * @param result The scene's measurements.
+		 * @return the statistics.
+		 */
+		static Summary summarize(const SceneResult& result);
+
+		/**
+		 * Gets a percentile with the nearest rank method.
+		 * @param sorted The values, sorted in ascending order. Must not be empty.
+		 * @param percent The percentile, 0 to 100.
+		 * @return the value.
+		 */
+		static double percentile(const std::vector<double>& sorted, double percent);
+
+		/** The cel shader that draws the frames */
+		CelShader& celShader;
+		/** The number of frames measured in each scene */
+		unsigned int framesPerScene;
+		/** Whether primitives are counted, which needs OpenGL 3.0 */
+		bool countingPrimitives;
+		/** The scene being measured, BENCHMARK_SCENE_COUNT once all of them are done */
+		unsigned int scene;
+		/** The number of warm up frames drawn so far in the current scene */
+		unsigned int warmupFrame;
+		/** The number of frames measured so far in the current scene */
+		unsigned int frame;
+		/** What was measured in each scene */
+		SceneResult results[BENCHMARK_SCENE_COUNT];
+};
+
+#endif
@@ -23,13 +23,85 @@
 #ifndef __CEL_SHADER_H__
 #define __CEL_SHADER_H__
 
+#include <chrono>
+#include <functional>
+#include <map>
 #include <string>
+#include <vector>
 
+#include "AsyncMeshLoader.h"
+#include "ClusterBvh.h"
+#include "FrameProfiler.h"
+#include "Frustum.h"
+#include "InstanceBuffer.h"
+#include "MeshBuffer.h"
 #include "MiscGL.h"
-#include "RawMeshLoader.h"
+#include "OutlineRenderer.h"
+#include "PrimitiveCache.h"
+#include "ProgramCache.h"
+#include "RenderQueue.h"
+#include "ShaderPermutation.h"
+#include "SilhouetteExtractor.h"
+#include "ThreadPool.h"
+
+/** The scene that draws the loaded model */
+#define CEL_MODEL_SCENE 2
+/** The model that scene loads, without the .rmc or .raw extension */
+#define CEL_MODEL_PATH "models/concept-sedan-02-sport"
+
+/**
+ * Identifies a variant of the cel shader, so that finding one that is already compiled needs no strings.
+ */
+struct CelProgramKey {
+	/** The toon ramp */
+	ToonRamp ramp;
+	/** Whether the variant decodes quantized vertices */
+	bool quantized;
+	/** Whether the variant reads the instance attributes */
+	bool instanced;
+	/** Whether the variant writes the normals screen space outlines need */
+	bool writeNormals;
+
+	bool operator<(const CelProgramKey& other) const {
+		int order = ShaderPermutation::compareRamps(ramp, other.ramp);
+
+		if (order != 0) {
+			return order < 0;
+		}
+		if (quantized != other.quantized) {
+			return other.quantized;
+		}
+		if (instanced != other.instanced) {
+			return other.instanced;
+		}
+		return (writeNormals != other.writeNormals) && (other.writeNormals);
+	}
+
+	bool operator==(const CelProgramKey& other) const {
+		return (quantized == other.quantized) && (instanced == other.instanced) && (writeNormals == other.writeNormals) &&
+		       (ShaderPermutation::compareRamps(ramp, other.ramp) == 0);
+	}
+};
 
 class CelShader {
 	public:
+		/**
+		 * The ways the black outlines can be drawn.
+		 */
+		enum OutlineMode {
+			/** Every object is drawn a second time, as thick lines around its back faces */
+			OUTLINE_BACK_FACES,
+			/** Every object is drawn once and the outlines are found from the depth and normals */
+			OUTLINE_SCREEN_SPACE,
+			/**
+			 * Only the silhouette edges of the loaded model are drawn as thick lines. The primitives of the
+			 * other scenes don't have edge lists, they keep the back face outlines
+			 */
+			OUTLINE_SILHOUETTE_EDGES,
+			/** The number of outline modes */
+			OUTLINE_MODE_COUNT
+		};
+
 		/**
 		 * Constructor.
 		 * @param windowWidth The width of the window.
@@ -63,12 +135,140 @@ class CelShader {
 		void printShaderInfoLog(GLuint shader);
 
 		/**
-		 * Creates the shader objects, compiles them and attaches them to the program.
+		 * Creates the shader objects, compiles them and attaches them to the program. The paths are kept, so
+		 * that the other variants of the cel shader can be compiled as objects need them.
 		 * @param vertexShaderSource The path to the vertex shader source file.
 		 * @param fragmentShaderSource The path to the fragment shader source file.
+		 * @param quantizedVertexShaderSource The path to the vertex shader used for quantized meshes.
 		 * @return true if the shader was compiled and linked successfully, false otherwise.
 		 */
-		bool setupShaders(const std::string& vertexShaderSource, const std::string& fragmentShaderSource);
+		bool setupShaders(const std::string& vertexShaderSource, const std::string& fragmentShaderSource,
+		                  const std::string& quantizedVertexShaderSource);
+
+		/**
+		 * Gets the on-disk cache of linked programs, which createProgram consults before compiling.
+		 */
+		ProgramCache& getProgramCache();
+
+		/**
+		 * Selects whether loaded meshes are uploaded with quantized vertex attributes.
+		 * @param quantize true to quantize, false to keep full precision floats.
+		 */
+		void setQuantizeMeshes(bool quantize);
+
+		/**
+		 * Compiles the edge detection program of the screen space outline pass.
+		 * @param vertexShaderSource The path to the vertex shader source file.
+		 * @param fragmentShaderSource The path to the fragment shader source file.
+		 * @return true if screen space outlines can be used, false otherwise.
+		 */
+		bool setupOutlineShaders(const std::string& vertexShaderSource, const std::string& fragmentShaderSource);
+
+		/**
+		 * Sets the vertex shader the loaded model is drawn with when it is instanced. The fragment shader is
+		 * the cel shader's.
+		 * @param vertexShaderSource The path to the vertex shader source file.
+		 * @return true if instancing can be used, false otherwise.
+		 */
+		bool setupInstancedShaders(const std::string& vertexShaderSource);
+
+		/**
+		 * Sets how many copies of the loaded model are drawn, laid out in a grid. More than one copy is
+		 * drawn with a single instanced draw call per pass, and without frustum culling.
+		 * @param count The number of copies, at least 1.
+		 * @return true if the count was set, false if instancing isn't available.
+		 */
+		bool setInstanceCount(unsigned int count);
+
+		/**
+		 * Sets the framebuffer frames are drawn into instead of the window, and binds it.
+		 * @param framebuffer The framebuffer object, 0 for the window.
+		 */
+		void setTargetFramebuffer(GLuint framebuffer);
+
+		/**
+		 * Selects whether frames are shown in a GLUT window, which gets the statistics in its title and
+		 * has its buffers swapped after every frame.
+		 * @param windowed false when drawing without a window.
+		 */
+		void setWindowed(bool windowed);
+
+		/**
+		 * Selects the scene and points the camera at it.
+		 * @param scene The scene, 0 to 2.
+		 * @param viewAngle The camera's angle around the scene, in radians.
+		 * @param pitch The camera's pitch, in radians.
+		 * @param distance The camera's distance from the center of the scene.
+		 */
+		void setView(unsigned char scene, float viewAngle, float pitch, float distance);
+
+		/**
+		 * Checks if the selected scene can be drawn as it is meant to be, that is the loaded model isn't
+		 * still loading.
+		 */
+		bool isSceneReady() const;
+
+		/**
+		 * Makes every step advance the animation by the same time, instead of by the time that has passed
+		 * since the last step. The frame times of the outline modes aren't recorded while it is set.
+		 * @param timestep The time, in seconds, 0 to go back to measuring it.
+		 */
+		void setFixedTimestep(float timestep);
+
+		/**
+		 * Moves the light to a point on its path.
+		 * @param angle The angle around the scene, in radians.
+		 */
+		void setLightAngle(float angle);
+
+		/**
+		 * Selects whether the primitives drawn in each frame are counted with a query, which needs
+		 * OpenGL 3.0.
+		 * @param count true to count.
+		 * @return true if primitives are counted, false otherwise.
+		 */
+		bool setCountPrimitives(bool count);
+
+		/**
+		 * Gets the number of primitives drawn in the last frame, waiting for the GPU to finish it.
+		 * @return the count, 0 unless setCountPrimitives enabled it.
+		 */
+		GLuint getPrimitiveCount();
+
+		/**
+		 * Gets the profiler that times the passes of every frame.
+		 */
+		FrameProfiler& getProfiler();
+
+		/**
+		 * Sets the file the frame profile is written to when the program exits, and when c is pressed.
+		 * @param path The path of the CSV file, empty to only write it when c is pressed, to profile.csv.
+		 */
+		void setProfileCsvPath(const std::string& path);
+
+		/**
+		 * Gets the number of draws submitted in the last frame.
+		 */
+		unsigned int getDrawCount() const;
+
+		/**
+		 * Selects how the outlines are drawn. Screen space outlines are only selected if
+		 * setupOutlineShaders succeeded and the render targets could be created.
+		 * @param mode The outline mode.
+		 * @return true if the mode was selected, false if it isn't available.
+		 */
+		bool setOutlineMode(OutlineMode mode);
+
+		/**
+		 * Gets how the outlines are drawn.
+		 */
+		OutlineMode getOutlineMode() const;
+
+		/**
+		 * Gets the name of an outline mode, for reports.
+		 * @param mode The outline mode.
+		 */
+		static const char* getOutlineModeName(OutlineMode mode);
 
 		/**
 		 * Resizes the objects to fit tightly into the new window size.
@@ -131,29 +331,197 @@ class CelShader {
 		void renderMoreComplexScene();
 
 		/**
-		 * Renders a model imported from Blender.
+		 * Picks the level of detail of the loaded model whose error, projected onto the screen at the
+		 * current camera distance, stays below LOD_MAX_PIXEL_ERROR.
+		 * @param center The center of a sphere enclosing everything drawn with the level.
+		 * @param radius The radius of the sphere.
+		 * @param errorScale How much the model is scaled when it is drawn.
+		 */
+		void selectLod(const GLfloat center[3], GLfloat radius, GLfloat errorScale);
+
+		/**
+		 * Renders a model imported from Blender. The model is loaded in the background, until it is ready
+		 * the previous scene is shown instead.
 		 */
 		void renderComplexScene();
 
+		/**
+		 * Renders instanceCount copies of the loaded model.
+		 */
+		void renderInstances();
+
+		/**
+		 * Lays the copies of the loaded model out in a square grid that fits the view, each with its own
+		 * heading and tint, and uploads them.
+		 */
+		void buildInstances();
+
+		/**
+		 * Gets what frustum culling found while drawing the loaded model in the last frame.
+		 */
+		const ClusterCullStats& getCullStats() const;
+
 	private:
+		/**
+		 * The sections of a frame the profiler times.
+		 */
+		enum ProfilerSection {
+			/** Clearing, culling and queueing the draws */
+			SECTION_SCENE,
+			/** The back face outlines */
+			SECTION_OUTLINE_PASS,
+			/** The cel shaded objects */
+			SECTION_FILL_PASS,
+			/** The light's sphere */
+			SECTION_LIGHT_PASS,
+			/** Finding the screen space outlines and compositing them */
+			SECTION_COMPOSITE
+		};
+
+		/**
+		 * Writes the frame profile to a CSV file.
+		 * @param path The path of the file.
+		 * @return true if successfull, false otherwise.
+		 */
+		bool writeProfile(const std::string& path) const;
+
+		/**
+		 * Shows the culling statistics of the last frame in the window title, while the loaded model is
+		 * being drawn.
+		 */
+		void updateWindowTitle();
+
+		/**
+		 * Queues an object's back faces to be drawn as thick black lines, unless the outlines are found in
+		 * screen space.
+		 * @param draw Draws the object.
+		 * @param program The program to draw with, 0 for the fixed function pipeline.
+		 */
+		void queueOutline(const std::function<void()>& draw, GLuint program = 0);
+
+		/**
+		 * Queues an object's front faces to be drawn with the cel shader.
+		 * @param ramp The toon ramp the object is shaded with.
+		 * @param quantized Whether the object's vertices are quantized.
+		 * @param color The object's colour.
+		 * @param draw Draws the object.
+		 * @param instanced Whether the object is drawn with MeshBuffer::drawInstanced.
+		 */
+		void queueFill(const ToonRamp& ramp, bool quantized, const GLfloat color[3], const std::function<void()>& draw,
+		               bool instanced = false);
+
+		/**
+		 * Gets the variant of the cel shader for a toon ramp and the current outline mode, compiling it the
+		 * first time it is asked for.
+		 * @param ramp The toon ramp.
+		 * @param quantized Whether the variant decodes quantized vertices.
+		 * @param instanced Whether the variant reads the instance attributes of an InstanceBuffer.
+		 * @return the program, or the default program if the variant failed to compile.
+		 */
+		GLuint getCelProgram(const ToonRamp& ramp, bool quantized, bool instanced = false);
+
+		/**
+		 * Finds the silhouette of the loaded model from the current eye position, unless the camera hasn't
+		 * moved, and draws it.
+		 */
+		void renderSilhouette();
+
+		/**
+		 * Clears the frame times recorded for each outline mode.
+		 */
+		void resetOutlineTiming();
+
+		/**
+		 * Prints the average frame time of each outline mode in the current scene to stdout.
+		 */
+		void reportOutlineTiming() const;
+
+		/**
+		 * Compiles a vertex and a fragment shader and links them into a program.
+		 * @param vertexShaderSourcePath The path to the vertex shader source file.
+		 * @param fragmentShaderSourcePath The path to the fragment shader source file.
+		 * @param defines #define lines placed in front of both sources.
+		 * @return the program object, 0 if compiling or linking failed.
+		 */
+		GLuint createProgram(const std::string& vertexShaderSourcePath, const std::string& fragmentShaderSourcePath,
+		                     const std::string& defines = "");
+
+		/**
+		 * Builds the cel shader with the default ramp, writing normals if the outline mode needs them.
+		 * @param quantized Whether the program is for meshes with quantized vertices.
+		 * @param instanced Whether the program is for instanced draws.
+		 * @return the program object, 0 if its shaders are not set up or it failed to build.
+		 */
+		GLuint createDefaultProgram(bool quantized, bool instanced);
+
+		/**
+		 * Deletes a program and puts another in its place, unless the other failed to build.
+		 * @param program The program to replace.
+		 * @param replacement The new program, 0 to keep the old one.
+		 */
+		void replaceProgram(GLuint& program, GLuint replacement);
+
 		/** The total window width */
 		int windowWidth;
 		/** The total window height */
 		int windowHeight;
 		/** The program object used with the shaders */
 		GLuint celShaderProg;
+		/** The program object used for meshes with quantized vertices */
+		GLuint celShaderQuantizedProg;
+		/** The programs used for instanced draws, of meshes with plain and quantized vertices */
+		GLuint celShaderInstancedProg;
+		GLuint celShaderInstancedQuantizedProg;
+		/** The shader sources the cel shader variants are compiled from */
+		std::string celVertexShaderPath;
+		std::string celQuantizedVertexShaderPath;
+		std::string celInstancedVertexShaderPath;
+		std::string celFragmentShaderPath;
+		/** The cel shader variants compiled so far. Failed variants are kept as 0 */
+		std::map<CelProgramKey, GLuint> celPrograms;
+		/** The variant getCelProgram returned last, consecutive draws mostly ask for the same one */
+		CelProgramKey lastCelKey;
+		/** The program for lastCelKey, 0 if there is none yet */
+		GLuint lastCelProgram;
 		/** The light's position */
 		GLVector4f lightPos;
 		/** Parameter controlling light position */
 		float angle;
 		/** Time variable used to calculate time difference between frames */
-		unsigned long prevTime;
+		std::chrono::steady_clock::time_point prevTime;
 		/** Variable indicating the scene to be displayed */
 		unsigned char scene;
-		/** The model loader to use */
-		RawMeshLoader meshLoader;
+		/** Linked programs kept on disk from earlier runs */
+		ProgramCache programCache;
+		/** Worker threads for loading and processing meshes */
+		ThreadPool threadPool;
+		/** Loads the model of the complex scene in the background */
+		AsyncMeshLoader meshLoader;
+		/** The loaded model in GPU memory */
+		MeshBuffer meshBuffer;
+		/** The level of detail of the loaded model to draw */
+		unsigned int lodLevel;
+		/** The view volume, in the coordinate space of the loaded model */
+		Frustum frustum;
+		/** The index ranges of the visible clusters, reused every frame */
+		std::vector<GLsizei> drawCounts;
+		std::vector<const GLvoid*> drawOffsets;
+		/** The number of copies of the loaded model to draw */
+		unsigned int instanceCount;
+		/** The copies of the loaded model, rebuilt when instanceCount changes */
+		InstanceBuffer instanceBuffer;
+		/** How much each copy is scaled down so that all of them fit the view */
+		GLfloat instanceScale;
+		/** What culling found in the last frame */
+		ClusterCullStats cullStats;
+		/** The text currently in the window title */
+		std::string windowTitle;
+		/** The longest frame time seen while the model was loading, in seconds */
+		float loadingFrameTime;
 		/** time delta */
 		float dT;
+		/** The time every step advances the animation by, 0 to measure it */
+		float fixedTimestep;
 		/** mouse previous position */
 		GLVector2i mousePrev;
 		/** View angle */
@@ -162,6 +530,33 @@ class CelShader {
 		float pitch;
 		/** Camera distance */
 		float camDistance;
+		/** Whether loaded meshes are uploaded with quantized vertex attributes */
+		bool quantizeMeshes;
+		/** Whether frames are shown in a GLUT window */
+		bool windowed;
+		/** The meshes of the shapes the scenes are built from */
+		PrimitiveCache primitives;
+		/** The draws of the current frame, sorted by state before they are submitted */
+		RenderQueue renderQueue;
+		/** How the outlines are drawn */
+		OutlineMode outlineMode;
+		/** The edge detection program of the screen space outline pass */
+		GLuint outlineProg;
+		/** Counts the primitives drawn in a frame, 0 if they aren't counted */
+		GLuint primitivesQuery;
+		/** Times the sections of every frame */
+		FrameProfiler profiler;
+		/** Whether the profiler's overlay is drawn */
+		bool showProfiler;
+		/** The file the frame profile is written to on exit, empty to not write it */
+		std::string profileCsvPath;
+		/** The render targets and composite pass for screen space outlines */
+		OutlineRenderer outlineRenderer;
+		/** Finds and caches the silhouette of the loaded model */
+		SilhouetteExtractor silhouette;
+		/** The total time, in seconds, and the number of frames drawn with each outline mode */
+		double outlineFrameTime[OUTLINE_MODE_COUNT];
+		unsigned int outlineFrameCount[OUTLINE_MODE_COUNT];
 };
 
 #endif
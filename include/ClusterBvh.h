@@ -0,0 +1,168 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __CLUSTER_BVH_H__
+#define __CLUSTER_BVH_H__
+
+#include <vector>
+#include <GL/glew.h>
+
+#include "Frustum.h"
+#include "IndexedMesh.h"
+
+/** The number of triangles in each cluster */
+#define CLUSTER_BVH_TRIANGLES 256
+
+/**
+ * A run of consecutive triangles in the index buffer and the box around them.
+ */
+struct MeshCluster {
+	/** The first index of the cluster */
+	GLuint firstIndex;
+	/** The number of indices in the cluster */
+	GLuint indexCount;
+	/** The center of the bounding box */
+	GLfloat center[3];
+	/** The half size of the bounding box */
+	GLfloat extent[3];
+};
+
+/**
+ * A node of the hierarchy, covering a contiguous range of clusters.
+ */
+struct ClusterBvhNode {
+	/** The center of the bounding box */
+	GLfloat center[3];
+	/** The half size of the bounding box */
+	GLfloat extent[3];
+	/** The first cluster below the node */
+	GLuint firstCluster;
+	/** The number of clusters below the node */
+	GLuint clusterCount;
+	/** The children of the node, 0 for a leaf */
+	GLuint children[2];
+};
+
+/**
+ * What a call to cull found.
+ */
+struct ClusterCullStats {
+	/** The number of nodes tested against the frustum */
+	unsigned int nodesTested;
+	/** The number of clusters in the level */
+	unsigned int clusterCount;
+	/** The number of clusters that were found visible */
+	unsigned int clustersVisible;
+	/** The number of triangles in the level */
+	unsigned int triangleCount;
+	/** The number of triangles that were found visible */
+	unsigned int trianglesVisible;
+	/** The number of draw ranges the visible clusters were merged into */
+	unsigned int drawRanges;
+};
+
+class ClusterBvh {
+	public:
+		/**
+		 * Constructor.
+		 */
+		ClusterBvh();
+
+		/**
+		 * Splits every level of detail of a mesh into clusters of CLUSTER_BVH_TRIANGLES triangles and
+		 * builds a hierarchy of boxes over them. The triangles of a level are sorted along a Morton curve
+		 * before being cut into clusters, so both the clusters and the clusters below a node are spatially
+		 * compact. Each cluster is then optimized for the vertex cache again.
+		 * @param mesh The mesh, its index data is reordered in place.
+		 */
+		void build(IndexedMesh& mesh);
+
+		/**
+		 * Finds the clusters of a level of detail that intersect a frustum, and merges clusters that follow
+		 * each other in the index buffer into a single range for glMultiDrawElements.
+		 * @param frustum The frustum, in the mesh's coordinate space.
+		 * @param level The level of detail.
+		 * @param indexSize The size in bytes of one index in the index buffer.
+		 * @param counts Receives the number of indices in each range.
+		 * @param offsets Receives the byte offset of each range into the index buffer.
+		 * @param stats Receives what was found.
+		 */
+		void cull(const Frustum& frustum, unsigned int level, GLsizei indexSize, std::vector<GLsizei>& counts,
+		          std::vector<const GLvoid*>& offsets, ClusterCullStats& stats) const;
+
+		/**
+		 * Gets the number of levels of detail the hierarchy has been built for, 0 if it hasn't been built.
+		 */
+		unsigned int getLodCount() const;
+
+		/**
+		 * Frees the clusters and nodes.
+		 */
+		void release();
+
+	private:
+		/**
+		 * Builds the node covering a range of clusters and, recursively, its children.
+		 * @param firstCluster The first cluster.
+		 * @param clusterCount The number of clusters.
+		 * @return the index of the node.
+		 */
+		GLuint buildNode(GLuint firstCluster, GLuint clusterCount);
+
+		/**
+		 * Adds a cluster to the draw ranges, extending the last range if the cluster follows it.
+		 */
+		static void addRange(const MeshCluster& cluster, GLsizei indexSize, std::vector<GLsizei>& counts, std::vector<const GLvoid*>& offsets);
+
+		/** The clusters of every level */
+		std::vector<MeshCluster> clusters;
+		/** The nodes of every level */
+		std::vector<ClusterBvhNode> nodes;
+		/** The root node of each level */
+		std::vector<GLuint> roots;
+		/** The number of triangles in each level */
+		std::vector<GLuint> triangleCounts;
+};
+
+#endif
+
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
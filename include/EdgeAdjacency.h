@@ -0,0 +1,118 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __EDGE_ADJACENCY_H__
+#define __EDGE_ADJACENCY_H__
+
+#include <vector>
+#include <GL/glew.h>
+
+#include "IndexedMesh.h"
+
+/** Marks the missing second face of an edge on an open border */
+#define EDGE_ADJACENCY_NO_FACE 0xffffffffu
+
+/**
+ * The edges and faces of one level of detail, as ranges of the shared arrays.
+ */
+struct EdgeAdjacencyLevel {
+	/** The first face of the level */
+	GLuint firstFace;
+	/** The number of faces in the level */
+	GLuint faceCount;
+	/** The first edge of the level */
+	GLuint firstEdge;
+	/** The number of edges in the level */
+	GLuint edgeCount;
+};
+
+/**
+ * The edges of every level of detail of a mesh and the faces on either side of them, which is all that
+ * is needed to find the silhouette from a given eye position. Vertices that only differ in their normal,
+ * colour or UV are treated as one point, so attribute seams don't show up as open borders.
+ *
+ * The face planes are stored one component per array, so four faces at a time can be tested with SSE.
+ */
+class EdgeAdjacency {
+	public:
+		/**
+		 * Constructor.
+		 */
+		EdgeAdjacency();
+
+		/**
+		 * Finds the edges of every level of detail of a mesh. Should be called once the triangle order is
+		 * final, the faces are numbered in index buffer order.
+		 * @param mesh The mesh.
+		 */
+		void build(const IndexedMesh& mesh);
+
+		/**
+		 * Gets the number of levels of detail, 0 if nothing has been built.
+		 */
+		unsigned int getLodCount() const;
+
+		/**
+		 * Gets the ranges of a level of detail.
+		 * @param level The level, less than getLodCount.
+		 */
+		const EdgeAdjacencyLevel& getLevel(unsigned int level) const;
+
+		/**
+		 * Gets the face planes, nx * x + ny * y + nz * z + d is positive in front of a face.
+		 */
+		const GLfloat* getFaceNormalX() const;
+		const GLfloat* getFaceNormalY() const;
+		const GLfloat* getFaceNormalZ() const;
+		const GLfloat* getFaceDistance() const;
+
+		/**
+		 * Gets the two vertices of every edge, as indices into the mesh's vertex array.
+		 */
+		const GLuint* getEdgeVertices() const;
+
+		/**
+		 * Gets the two faces of every edge, relative to the first face of the edge's level. The second face
+		 * is EDGE_ADJACENCY_NO_FACE on open borders and on edges shared by more than two faces.
+		 */
+		const GLuint* getEdgeFaces() const;
+
+		/**
+		 * Frees the edges and faces.
+		 */
+		void release();
+
+	private:
+		/** The ranges of every level */
+		std::vector<EdgeAdjacencyLevel> levels;
+		/** The face planes of every level */
+		std::vector<GLfloat> faceNormalX;
+		std::vector<GLfloat> faceNormalY;
+		std::vector<GLfloat> faceNormalZ;
+		std::vector<GLfloat> faceDistance;
+		/** Two vertices per edge */
+		std::vector<GLuint> edgeVertices;
+		/** Two faces per edge */
+		std::vector<GLuint> edgeFaces;
+};
+
+#endif
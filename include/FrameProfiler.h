@@ -0,0 +1,202 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __FRAME_PROFILER_H__
+#define __FRAME_PROFILER_H__
+
+#include <chrono>
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+
+/** The most sections a frame can be split into */
+#define PROFILER_MAX_SECTIONS 8
+/** The number of frames kept in the history */
+#define PROFILER_HISTORY 600
+/** The number of frames the overlay averages over */
+#define PROFILER_OVERLAY_FRAMES 60
+/** The number of sets of timer queries, and so the number of frames the GPU may fall behind before it is waited for */
+#define PROFILER_QUERY_SETS 4
+
+/**
+ * Measures how long each section of a frame takes, on the CPU with a steady clock and on the GPU with timer
+ * queries. Frames take turns using PROFILER_QUERY_SETS sets of queries, and at the end of every frame the
+ * sets still in flight are polled and whatever results are available are collected. A set is only waited
+ * for when its turn comes round again before the GPU has finished it, so measuring doesn't stall the GPU
+ * unless it falls that many frames behind, and no result is ever dropped. The times of the last
+ * PROFILER_HISTORY frames are kept.
+ *
+ * Sections may nest on the CPU, but only one can be measured on the GPU at a time, so sections that are
+ * timed on the GPU must follow each other.
+ */
+class FrameProfiler {
+	public:
+		/**
+		 * The times measured in a frame, in milliseconds. GPU times are negative until they are collected, a
+		 * few frames later, and stay negative if the section didn't run or wasn't timed on the GPU.
+		 */
+		struct Frame {
+			/** The number of the frame, counting from 0 */
+			unsigned long number;
+			/** The time from the start to the end of the frame on the CPU */
+			double cpuTotal;
+			/** The time each section took */
+			double cpu[PROFILER_MAX_SECTIONS];
+			double gpu[PROFILER_MAX_SECTIONS];
+		};
+
+		/**
+		 * Measures a section for as long as it is in scope.
+		 */
+		class Scope {
+			public:
+				/**
+				 * Constructor. Starts measuring.
+				 * @param profiler The profiler.
+				 * @param section The section.
+				 */
+				Scope(FrameProfiler& profiler, unsigned int section);
+
+				/**
+				 * Destructor. Stops measuring.
+				 */
+				~Scope();
+
+			private:
+				/** The profiler */
+				FrameProfiler& profiler;
+				/** The section */
+				unsigned int section;
+		};
+
+		/**
+		 * Constructor.
+		 */
+		FrameProfiler();
+
+		/**
+		 * Destructor.
+		 */
+		~FrameProfiler();
+
+		/**
+		 * Adds a section.
+		 * @param name The name shown in the overlay and the CSV header.
+		 * @return the section's index, to pass to begin and end.
+		 */
+		unsigned int addSection(const std::string& name);
+
+		/**
+		 * Selects whether the sections are timed on the GPU as well, which needs OpenGL 3.3 or
+		 * ARB_timer_query.
+		 * @param enabled true to time on the GPU.
+		 * @return true if the sections are timed on the GPU, false otherwise.
+		 */
+		bool setGpuTiming(bool enabled);
+
+		/**
+		 * Starts measuring a frame.
+		 */
+		void beginFrame();
+
+		/**
+		 * Stops measuring the frame and collects the GPU times of earlier frames that have become available.
+		 */
+		void endFrame();
+
+		/**
+		 * Starts measuring a section of the current frame.
+		 * @param section The section.
+		 */
+		void begin(unsigned int section);
+
+		/**
+		 * Stops measuring a section of the current frame.
+		 * @param section The section.
+		 */
+		void end(unsigned int section);
+
+		/**
+		 * Gets the number of frames in the history.
+		 */
+		unsigned int getFrameCount() const;
+
+		/**
+		 * Gets a frame from the history.
+		 * @param age How many frames ago the frame was measured, 0 for the last one.
+		 * @return the frame.
+		 */
+		const Frame& getFrame(unsigned int age) const;
+
+		/**
+		 * Draws the average times of the last PROFILER_OVERLAY_FRAMES frames in the top left corner of the
+		 * window, with GLUT's bitmap font.
+		 * @param windowWidth The width of the window.
+		 * @param windowHeight The height of the window.
+		 */
+		void drawOverlay(int windowWidth, int windowHeight) const;
+
+		/**
+		 * Writes the history to a CSV file, a frame per line.
+		 * @param path The path of the file.
+		 * @return true if successfull, false otherwise.
+		 */
+		bool writeCsv(const std::string& path) const;
+
+		/**
+		 * Deletes the queries.
+		 */
+		void release();
+
+	private:
+		/**
+		 * Gets the frame being measured.
+		 */
+		Frame& currentFrame();
+
+		/**
+		 * Copies the results of a set of queries into the frame that used it.
+		 * @param set The set.
+		 * @param wait true to wait for results that aren't available yet, false to leave them pending.
+		 */
+		void collect(unsigned int set, bool wait);
+
+		/** The names of the sections */
+		std::vector<std::string> sectionNames;
+		/** The measured frames, frame n is kept at n % PROFILER_HISTORY */
+		std::vector<Frame> history;
+		/** The number of frames begun so far */
+		unsigned long frameNumber;
+		/** When the current frame and each of its sections started */
+		std::chrono::steady_clock::time_point frameStart;
+		std::chrono::steady_clock::time_point sectionStart[PROFILER_MAX_SECTIONS];
+		/** The sets of timer queries, frame n uses set n % PROFILER_QUERY_SETS. 0 when the GPU isn't timed */
+		GLuint queries[PROFILER_QUERY_SETS][PROFILER_MAX_SECTIONS];
+		/** The frame that last used each set */
+		unsigned long queryFrame[PROFILER_QUERY_SETS];
+		/** Which queries have been started and not collected yet */
+		bool queryPending[PROFILER_QUERY_SETS][PROFILER_MAX_SECTIONS];
+		/** The section being timed on the GPU, -1 if none is */
+		int gpuSection;
+};
+
+#endif
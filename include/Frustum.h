@@ -0,0 +1,103 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __FRUSTUM_H__
+#define __FRUSTUM_H__
+
+#include <GL/glew.h>
+
+/** The number of planes bounding the view volume */
+#define FRUSTUM_PLANES 6
+/** The planes are tested four at a time, the last group is padded with planes that pass everything */
+#define FRUSTUM_PLANE_SLOTS 8
+
+class Frustum {
+	public:
+		/**
+		 * The result of testing a volume against the frustum.
+		 */
+		enum Containment {
+			/** The volume is entirely outside the frustum */
+			OUTSIDE,
+			/** The volume crosses at least one plane */
+			INTERSECTING,
+			/** The volume is entirely inside the frustum */
+			INSIDE
+		};
+
+		/**
+		 * Constructor. The frustum passes everything until a matrix is set.
+		 */
+		Frustum();
+
+		/**
+		 * Extracts the planes from a combined projection and model view matrix, so that the frustum is in
+		 * the model's coordinate space.
+		 * @param matrix The column major projection * model view matrix.
+		 */
+		void setMatrix(const GLfloat matrix[16]);
+
+		/**
+		 * Extracts the planes from the current OpenGL projection and model view matrices.
+		 */
+		void extractFromGL();
+
+		/**
+		 * Tests an axis aligned box against every plane, four planes at a time with SSE where it is
+		 * available.
+		 * @param center The center of the box.
+		 * @param extent The half size of the box along each axis.
+		 * @return whether the box is inside, outside or intersecting the frustum.
+		 */
+		Containment testBox(const GLfloat center[3], const GLfloat extent[3]) const;
+
+	private:
+		/** The plane normals and distances, one array per component so four planes fit a register */
+		GLfloat planeX[FRUSTUM_PLANE_SLOTS];
+		GLfloat planeY[FRUSTUM_PLANE_SLOTS];
+		GLfloat planeZ[FRUSTUM_PLANE_SLOTS];
+		GLfloat planeD[FRUSTUM_PLANE_SLOTS];
+};
+
+#endif
+
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
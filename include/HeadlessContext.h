@@ -0,0 +1,90 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __HEADLESS_CONTEXT_H__
+#define __HEADLESS_CONTEXT_H__
+
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+
+/**
+ * An OpenGL context without a window, for rendering on machines without a display. The context is
+ * created through EGL, on Mesa's surfaceless platform when it is available so that neither a display
+ * server nor a GPU is needed, and everything is drawn into a framebuffer object.
+ *
+ * Only available when built with EGL (HAVE_EGL).
+ */
+class HeadlessContext {
+	public:
+		/**
+		 * Constructor.
+		 */
+		HeadlessContext();
+
+		/**
+		 * Destructor. Releases the context.
+		 */
+		~HeadlessContext();
+
+		/**
+		 * Creates the context, makes it current, initializes GLEW and creates the framebuffer, which is
+		 * left bound.
+		 * @param width The width of the framebuffer.
+		 * @param height The height of the framebuffer.
+		 * @return true if successfull, false otherwise.
+		 */
+		bool create(int width, int height);
+
+		/**
+		 * Gets the framebuffer everything is drawn into.
+		 */
+		GLuint getFramebuffer() const;
+
+		/**
+		 * Reads the framebuffer back and writes it to a binary PPM file.
+		 * @param path The path of the file.
+		 * @return true if successfull, false otherwise.
+		 */
+		bool writeImage(const std::string& path);
+
+		/**
+		 * Deletes the framebuffer and destroys the context.
+		 */
+		void release();
+
+	private:
+		/** The EGL display and context, kept as void* so EGL's headers stay out of this one */
+		void *display;
+		void *context;
+		/** The framebuffer and its colour and depth renderbuffers */
+		GLuint framebuffer;
+		GLuint colourRenderbuffer;
+		GLuint depthRenderbuffer;
+		/** The size of the framebuffer */
+		int width;
+		int height;
+		/** The pixels read back by writeImage, reused every frame */
+		std::vector<GLubyte> pixels;
+};
+
+#endif
@@ -0,0 +1,203 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __INDEXED_MESH_H__
+#define __INDEXED_MESH_H__
+
+#include <vector>
+#include <GL/glew.h>
+
+#include "RawMeshLoader.h"
+
+/**
+ * A single vertex of an indexed mesh. The layout matches a .raw record, so the arrays can be handed to
+ * OpenGL as one interleaved array.
+ */
+struct MeshVertex {
+	/** The vertex position */
+	GLfloat position[3];
+	/** The vertex normal */
+	GLfloat normal[3];
+	/** The vertex colour */
+	GLfloat colour[3];
+	/** The vertex UV */
+	GLfloat uv[2];
+};
+
+/**
+ * A level of detail of an indexed mesh, a range of the index buffer that draws a simplified version of
+ * the mesh with the same vertices.
+ */
+struct MeshLod {
+	/** The first index of the level */
+	GLuint firstIndex;
+	/** The number of indices in the level */
+	GLuint indexCount;
+	/** The largest distance between this level and the full mesh, in model units */
+	GLfloat error;
+};
+
+class IndexedMesh {
+	public:
+		/**
+		 * Constructor.
+		 */
+		IndexedMesh();
+
+		/**
+		 * Destructor.
+		 */
+		~IndexedMesh();
+
+		/**
+		 * Builds the mesh from the triangle soup held by a loader. Vertices whose position, normal, colour
+		 * and UV are bitwise identical are merged into one, and the triangles are rebuilt as indices into
+		 * the resulting unique vertex array.
+		 * @param loader The loader holding the triangle soup.
+		 * @return the number of unique vertices, 0 if the loader was empty.
+		 */
+		unsigned int weld(const RawMeshLoader& loader);
+
+		/**
+		 * Maps every vertex onto the first vertex with a bitwise identical position, so that vertices split
+		 * along an attribute seam can be recognised as the same point.
+		 * @param vertices The vertices.
+		 * @param vertexCount The number of vertices.
+		 * @param remap Receives the index of the first vertex at the same position as each vertex.
+		 */
+		static void buildPositionRemap(const MeshVertex* vertices, unsigned int vertexCount, std::vector<GLuint>& remap);
+
+		/**
+		 * Gets the unique vertex array.
+		 * @return a const pointer to the interleaved vertices.
+		 */
+		const MeshVertex* getVertices() const;
+
+		/**
+		 * Gets the number of unique vertices.
+		 */
+		unsigned int getVertexCount() const;
+
+		/**
+		 * Gets the index buffer, stored as either 16 or 32 bit values depending on the vertex count.
+		 * @return a const pointer to the index buffer.
+		 */
+		const GLvoid* getIndices() const;
+
+		/**
+		 * Gets the type of the values in the index buffer.
+		 * @return GL_UNSIGNED_SHORT or GL_UNSIGNED_INT.
+		 */
+		GLenum getIndexType() const;
+
+		/**
+		 * Gets the size in bytes of a single index.
+		 */
+		GLsizei getIndexSize() const;
+
+		/**
+		 * Gets the number of indices, three per triangle.
+		 */
+		unsigned int getIndexCount() const;
+
+		/**
+		 * Gets the vertex data for in place processing. Call updateIndexBuffer after changing it.
+		 */
+		std::vector<MeshVertex>& getVertexData();
+
+		/**
+		 * Gets the 32 bit index data for in place processing. Call updateIndexBuffer after changing it.
+		 */
+		std::vector<GLuint>& getIndexData();
+
+		/**
+		 * Gets the 32 bit index data.
+		 */
+		const std::vector<GLuint>& getIndexData() const;
+
+		/**
+		 * Gets the number of levels of detail. A mesh without a LOD chain has a single level covering every
+		 * index.
+		 */
+		unsigned int getLodCount() const;
+
+		/**
+		 * Gets a level of detail, level 0 being the full mesh.
+		 * @param level The level, less than getLodCount.
+		 */
+		MeshLod getLod(unsigned int level) const;
+
+		/**
+		 * Gets the LOD chain for in place processing. Empty if the mesh has no LOD chain.
+		 */
+		std::vector<MeshLod>& getLodData();
+
+		/**
+		 * Gets the LOD chain.
+		 */
+		const std::vector<MeshLod>& getLodData() const;
+
+		/**
+		 * Rebuilds the index buffer returned by getIndices from the 32 bit index data, choosing 16 bit
+		 * indices whenever the vertex count allows it.
+		 */
+		void updateIndexBuffer();
+
+		/**
+		 * Free's the vertex and index arrays and the LOD chain.
+		 */
+		void release();
+
+	private:
+		/** The unique vertices */
+		std::vector<MeshVertex> vertices;
+		/** The indices, always kept at full width for processing */
+		std::vector<GLuint> indices;
+		/** The indices narrowed to 16 bits, empty if the mesh needs 32 bit indices */
+		std::vector<GLushort> shortIndices;
+		/** The index ranges of the levels of detail, empty if there is only the full mesh */
+		std::vector<MeshLod> lods;
+};
+
+#endif
+
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
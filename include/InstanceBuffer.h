@@ -0,0 +1,98 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __INSTANCE_BUFFER_H__
+#define __INSTANCE_BUFFER_H__
+
+#include <vector>
+#include <GL/glew.h>
+
+/** The generic attribute locations of the three rows of the instance transform, and the instance colour */
+#define VERTEX_ATTRIB_INSTANCE_ROW 7
+#define VERTEX_ATTRIB_INSTANCE_COLOUR 10
+
+/**
+ * One copy of a mesh, as read by shaders/celShaderInstanced.vs.
+ */
+struct MeshInstance {
+	/** The top three rows of the affine transform from mesh to model space, which may only rotate, scale
+	 * uniformly and translate */
+	GLfloat rows[3][4];
+	/** The tint multiplied with the mesh's colours */
+	GLubyte colour[4];
+};
+
+/**
+ * Holds the per-instance attributes of many copies of a mesh in GPU memory, so that MeshBuffer::drawInstanced
+ * can draw all of them with one call.
+ */
+class InstanceBuffer {
+	public:
+		/**
+		 * Constructor.
+		 */
+		InstanceBuffer();
+
+		/**
+		 * Destructor. The GL objects must be released with release while the context is still current.
+		 */
+		~InstanceBuffer();
+
+		/**
+		 * Checks if the OpenGL implementation has instanced draws and per-instance attributes.
+		 */
+		static bool isSupported();
+
+		/**
+		 * Replaces the instances.
+		 * @param instances The instances.
+		 */
+		void upload(const std::vector<MeshInstance>& instances);
+
+		/**
+		 * Gets the number of instances.
+		 */
+		unsigned int getInstanceCount() const;
+
+		/**
+		 * Points the per-instance attributes into the buffer, advancing once per instance.
+		 */
+		void bind() const;
+
+		/**
+		 * Disables the per-instance attributes again, so they don't end up in other draws.
+		 */
+		void unbind() const;
+
+		/**
+		 * Deletes the GL buffer.
+		 */
+		void release();
+
+	private:
+		/** The buffer holding the instances */
+		GLuint buffer;
+		/** The number of instances in the buffer */
+		unsigned int instanceCount;
+};
+
+#endif
@@ -0,0 +1,248 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __MESH_BUFFER_H__
+#define __MESH_BUFFER_H__
+
+#include <cstddef>
+#include <vector>
+#include <GL/glew.h>
+
+#include "IndexedMesh.h"
+#include "InstanceBuffer.h"
+#include "VertexFormat.h"
+
+class MeshBuffer {
+	public:
+		/**
+		 * Constructor.
+		 */
+		MeshBuffer();
+
+		/**
+		 * Destructor. The GL objects must be released with release while the context is still current.
+		 */
+		~MeshBuffer();
+
+		/**
+		 * Uploads an indexed mesh into a vertex buffer and an index buffer in GPU memory, and records the
+		 * array setup for both render passes in vertex array objects when they are available.
+		 * @param mesh The mesh to upload.
+		 * @param releaseClientData If true the mesh's CPU side arrays are freed once they are uploaded.
+		 * @param quantize If true the vertices are stored as QuantizedVertex, which needs a shader that
+		 * decodes the normals from the VERTEX_ATTRIB_OCT_NORMAL attribute.
+		 * @return true if successfull, false otherwise.
+		 */
+		bool upload(IndexedMesh& mesh, bool releaseClientData, bool quantize = false);
+
+		/**
+		 * Starts uploading an indexed mesh without copying any data yet, so that the upload can be spread
+		 * over several frames with continueUpload. The mesh must not be modified until the upload has
+		 * completed.
+		 * @param mesh The mesh to upload.
+		 * @param releaseClientData If true the mesh's CPU side arrays are freed once they are uploaded.
+		 * @param quantize If true the vertices are stored as QuantizedVertex.
+		 * @return true if successfull, false otherwise.
+		 */
+		bool beginUpload(IndexedMesh& mesh, bool releaseClientData, bool quantize = false);
+
+		/**
+		 * Copies the next part of the mesh started by beginUpload into the buffers. Vertices are copied
+		 * first, then indices, and the mesh becomes drawable once both have been copied.
+		 * @param byteBudget The maximum number of bytes to copy in this call.
+		 * @return true if the upload has completed, false if there is more to copy.
+		 */
+		bool continueUpload(size_t byteBudget);
+
+		/**
+		 * Checks if an upload started by beginUpload is still in progress.
+		 */
+		bool isUploading() const;
+
+		/**
+		 * Gets the fraction of the current upload that has been copied.
+		 * @return a value between 0 and 1, 1 if no upload is in progress.
+		 */
+		float getUploadProgress() const;
+
+		/**
+		 * Draws one level of detail of the mesh from GPU memory.
+		 * @param withColour If false the colour array is left disabled so the current colour is used for
+		 * every vertex, as the outline pass needs.
+		 * @param level The level of detail to draw, 0 being the full mesh.
+		 */
+		void draw(bool withColour, unsigned int level = 0) const;
+
+		/**
+		 * Draws several ranges of the index buffer at once, such as the visible clusters found by
+		 * ClusterBvh::cull.
+		 * @param withColour Whether the colour array should be enabled.
+		 * @param counts The number of indices in each range.
+		 * @param offsets The byte offset of each range into the index buffer.
+		 * @param rangeCount The number of ranges.
+		 */
+		void drawRanges(bool withColour, const GLsizei* counts, const GLvoid* const* offsets, GLsizei rangeCount) const;
+
+		/**
+		 * Draws one level of detail of the mesh once per instance, with a single instanced draw call. The
+		 * current program has to be built from shaders/celShaderInstanced.vs, with QUANTIZED set for
+		 * quantized meshes.
+		 * @param withColour Whether the colour array should be enabled.
+		 * @param level The level of detail to draw, 0 being the full mesh.
+		 * @param instances The instances to draw.
+		 */
+		void drawInstanced(bool withColour, unsigned int level, const InstanceBuffer& instances) const;
+
+		/**
+		 * Replaces the list of lines drawn by drawLines, such as the silhouette found by
+		 * SilhouetteExtractor. The list is streamed into its own buffer, the index buffer is left alone.
+		 * @param indices Two indices into the vertex buffer per line.
+		 */
+		void uploadLines(const std::vector<GLuint>& indices);
+
+		/**
+		 * Draws the lines set by uploadLines, without the colour array.
+		 */
+		void drawLines() const;
+
+		/**
+		 * Checks if the mesh has been uploaded.
+		 * @return true if there is a mesh to draw, false otherwise.
+		 */
+		bool isUploaded() const;
+
+		/**
+		 * Checks if the vertex buffer holds quantized vertices.
+		 */
+		bool isQuantized() const;
+
+		/**
+		 * Gets the layout of the vertices in the vertex buffer.
+		 */
+		const VertexFormat& getVertexFormat() const;
+
+		/**
+		 * Gets the number of vertices in the vertex buffer.
+		 */
+		unsigned int getVertexCount() const;
+
+		/**
+		 * Gets the number of indices in the index buffer.
+		 */
+		unsigned int getIndexCount() const;
+
+		/**
+		 * Gets the size in bytes of one index in the index buffer.
+		 */
+		GLsizei getIndexSize() const;
+
+		/**
+		 * Gets the number of levels of detail in the index buffer.
+		 */
+		unsigned int getLodCount() const;
+
+		/**
+		 * Gets a level of detail, level 0 being the full mesh.
+		 * @param level The level, less than getLodCount.
+		 */
+		const MeshLod& getLod(unsigned int level) const;
+
+		/**
+		 * Gets a sphere enclosing the mesh.
+		 * @param center Receives the center of the sphere.
+		 * @param radius Receives the radius of the sphere.
+		 */
+		void getBoundingSphere(GLfloat center[3], GLfloat& radius) const;
+
+		/**
+		 * Deletes the GL buffer and vertex array objects.
+		 */
+		void release();
+
+	private:
+		/**
+		 * Binds the buffers and points the vertex, normal and colour arrays into the vertex buffer.
+		 * @param withColour Whether the colour array should be enabled.
+		 */
+		void setupArrays(bool withColour) const;
+
+		/** The buffer holding the interleaved vertices */
+		GLuint vertexBuffer;
+		/** The buffer holding the indices */
+		GLuint indexBuffer;
+		/** The buffer holding the indices of the lines set by uploadLines */
+		GLuint lineBuffer;
+		/** The number of indices in the line buffer */
+		unsigned int lineIndexCount;
+		/** Vertex array objects for drawing without (0) and with (1) the colour array, 0 if unsupported */
+		GLuint vertexArrays[2];
+		/** The number of vertices in the vertex buffer */
+		unsigned int vertexCount;
+		/** The number of indices in the index buffer */
+		unsigned int indexCount;
+		/** The type of the values in the index buffer */
+		GLenum indexType;
+		/** The layout of the vertices in the vertex buffer */
+		VertexFormat format;
+		/** Whether the vertices are quantized */
+		bool quantized;
+		/** The dequantization transform, position = center + q * scale */
+		GLfloat center[3];
+		GLfloat scale;
+		/** The index ranges of the levels of detail */
+		std::vector<MeshLod> lods;
+		/** The bounding sphere of the mesh */
+		GLfloat boundsCenter[3];
+		GLfloat boundsRadius;
+		/** The mesh being uploaded by continueUpload, NULL if no upload is in progress */
+		IndexedMesh *uploadMesh;
+		/** Whether to free uploadMesh's arrays once the upload completes */
+		bool uploadReleasesClientData;
+		/** The number of vertices of uploadMesh copied so far */
+		unsigned int uploadedVertices;
+		/** The number of indices of uploadMesh copied so far */
+		unsigned int uploadedIndices;
+};
+
+#endif
+
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
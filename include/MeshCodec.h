@@ -0,0 +1,136 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __MESH_CODEC_H__
+#define __MESH_CODEC_H__
+
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+
+#include "IndexedMesh.h"
+#include "ThreadPool.h"
+
+/** The number of vertices in each independently decodable vertex block */
+#define MESH_CODEC_BLOCK_VERTICES 16384
+/** The number of triangles in each independently decodable index block */
+#define MESH_CODEC_BLOCK_TRIANGLES 16384
+/** The number of values that share a bit width inside a stream */
+#define MESH_CODEC_GROUP_SIZE 32
+
+/**
+ * Reads and writes .rmc files, a compressed container for indexed meshes.
+ *
+ * The file starts with a header (magic "RMC1", vertex count, index count, block count) followed by a
+ * table with the type, first element, element count and byte size of every block, and then the blocks
+ * themselves. Vertex blocks store each of the 11 float channels of a MeshVertex as a separate stream,
+ * index blocks store a single stream of indices. A stream holds the zigzag encoded differences between
+ * consecutive values, bit-packed in groups of MESH_CODEC_GROUP_SIZE that share the smallest bit width
+ * able to hold them. Compression is lossless, and every block can be decoded on its own. Meshes with a
+ * LOD chain have one more block holding the MeshLod ranges uncompressed.
+ */
+class MeshCodec {
+	public:
+		/**
+		 * Writes a mesh to a compressed file, encoding the blocks in parallel.
+		 * @param mesh The mesh to write.
+		 * @param path The file to write to.
+		 * @param pool The threads to encode the blocks on.
+		 * @return true if successfull, false otherwise.
+		 */
+		static bool encode(const IndexedMesh& mesh, const std::string& path, ThreadPool& pool);
+
+		/**
+		 * Reads a mesh from a compressed file. Blocks are handed to the pool as soon as they have been read,
+		 * so decoding overlaps with reading the rest of the file.
+		 * @param path The file to read.
+		 * @param mesh Receives the mesh.
+		 * @param pool The threads to decode the blocks on.
+		 * @return true if successfull, false if the file is missing or corrupt.
+		 */
+		static bool decode(const std::string& path, IndexedMesh& mesh, ThreadPool& pool);
+
+		/**
+		 * Converts a .raw file into a compressed file. The triangle soup is welded, optimized and given a LOD
+		 * chain first, and the sizes before and after are printed to stdout.
+		 * @param rawPath The .raw file to read.
+		 * @param compressedPath The compressed file to write.
+		 * @param pool The threads to encode the blocks on.
+		 * @return true if successfull, false otherwise.
+		 */
+		static bool convert(const std::string& rawPath, const std::string& compressedPath, ThreadPool& pool);
+
+	private:
+		/**
+		 * Copies a LOD block into a LOD chain and checks that every level lies inside the index data.
+		 * @param data The contents of the block.
+		 * @param count The number of levels in the block.
+		 * @param indexCount The number of indices in the mesh.
+		 * @param lods Receives the levels.
+		 * @return true if every level is valid, false otherwise.
+		 */
+		static bool readLods(const unsigned char* data, unsigned int count, unsigned int indexCount, std::vector<MeshLod>& lods);
+
+		/**
+		 * Delta encodes and bit-packs a strided stream of 32 bit values.
+		 * @param values The first value.
+		 * @param count The number of values.
+		 * @param stride The distance between consecutive values, in values.
+		 * @param out The packed stream is appended to this.
+		 */
+		static void encodeStream(const GLuint* values, unsigned int count, unsigned int stride, std::vector<unsigned char>& out);
+
+		/**
+		 * Unpacks a stream written by encodeStream.
+		 * @param in The start of the packed stream.
+		 * @param end The end of the block the stream lives in.
+		 * @param count The number of values.
+		 * @param stride The distance between consecutive values, in values.
+		 * @param values Receives the first value.
+		 * @return the end of the packed stream, NULL if it runs past end.
+		 */
+		static const unsigned char* decodeStream(const unsigned char* in, const unsigned char* end, unsigned int count, unsigned int stride, GLuint* values);
+};
+
+#endif
+
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
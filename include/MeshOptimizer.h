@@ -0,0 +1,121 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __MESH_OPTIMIZER_H__
+#define __MESH_OPTIMIZER_H__
+
+#include <vector>
+#include <GL/glew.h>
+
+#include "IndexedMesh.h"
+
+/** The post-transform cache size that triangle orders are optimized for */
+#define MESH_OPTIMIZER_CACHE_SIZE 32
+
+class MeshOptimizer {
+	public:
+		/**
+		 * Runs every optimization stage on a mesh: vertex cache, then overdraw, then vertex fetch.
+		 * @param mesh The mesh to optimize in place.
+		 * @param report If true the ACMR and ATVR before and after are printed to stdout.
+		 */
+		static void optimize(IndexedMesh& mesh, bool report);
+
+		/**
+		 * Reorders triangles so that consecutive triangles share vertices, using Tom Forsyth's linear
+		 * speed vertex cache optimization.
+		 * @param indices The triangle list to reorder in place.
+		 * @param indexCount The number of indices in the list.
+		 * @param vertexCount The number of vertices the indices refer to.
+		 */
+		static void optimizeVertexCache(GLuint* indices, unsigned int indexCount, unsigned int vertexCount);
+
+		/**
+		 * Reorders clusters of a cache optimized triangle list so that outward facing clusters are drawn
+		 * first, which lets the depth test reject more of the fragments behind them.
+		 * @param indices The triangle list to reorder in place.
+		 * @param indexCount The number of indices in the list.
+		 * @param vertices The vertices the indices refer to.
+		 * @param threshold How much the ACMR may degrade (e.g. 1.05 for 5%) in exchange for smaller clusters.
+		 */
+		static void optimizeOverdraw(GLuint* indices, unsigned int indexCount, const MeshVertex* vertices, float threshold);
+
+		/**
+		 * Reorders the vertices in the order they are first referenced by the triangle list and remaps the
+		 * indices to match. Vertices that are never referenced are dropped.
+		 * @param mesh The mesh to reorder in place.
+		 */
+		static void optimizeVertexFetch(IndexedMesh& mesh);
+
+		/**
+		 * Computes the average cache miss ratio, the number of vertices transformed per triangle, using a
+		 * FIFO cache model.
+		 * @param indices The triangle list.
+		 * @param indexCount The number of indices in the list.
+		 * @param vertexCount The number of vertices the indices refer to.
+		 * @param cacheSize The number of entries in the simulated cache.
+		 * @return the ACMR, between 0.5 and 3.
+		 */
+		static float computeACMR(const GLuint* indices, unsigned int indexCount, unsigned int vertexCount, unsigned int cacheSize);
+
+		/**
+		 * Computes the average transform to vertex ratio, the number of times each referenced vertex is
+		 * transformed, using a FIFO cache model.
+		 * @param indices The triangle list.
+		 * @param indexCount The number of indices in the list.
+		 * @param vertexCount The number of vertices the indices refer to.
+		 * @param cacheSize The number of entries in the simulated cache.
+		 * @return the ATVR, 1 being optimal.
+		 */
+		static float computeATVR(const GLuint* indices, unsigned int indexCount, unsigned int vertexCount, unsigned int cacheSize);
+
+	private:
+		/**
+		 * Counts the cache misses of a triangle list with a FIFO cache model.
+		 * @param referenced If not NULL, receives the number of distinct vertices referenced.
+		 */
+		static unsigned int countCacheMisses(const GLuint* indices, unsigned int indexCount, unsigned int vertexCount, unsigned int cacheSize, unsigned int* referenced);
+};
+
+#endif
+
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
@@ -0,0 +1,91 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __MESH_SIMPLIFIER_H__
+#define __MESH_SIMPLIFIER_H__
+
+#include <vector>
+#include <GL/glew.h>
+
+#include "IndexedMesh.h"
+
+/** The largest number of levels in a LOD chain, including the full mesh */
+#define MESH_SIMPLIFIER_MAX_LODS 6
+/** The fraction of the previous level's triangles that each level of a LOD chain aims for */
+#define MESH_SIMPLIFIER_LOD_RATIO 0.5f
+/** The largest error a LOD may have, relative to the radius of the mesh */
+#define MESH_SIMPLIFIER_MAX_ERROR 0.05f
+
+class MeshSimplifier {
+	public:
+		/**
+		 * Builds a chain of progressively simpler levels of detail and appends their indices to the mesh's
+		 * index data. Every level reuses the mesh's vertices, so the whole chain can be drawn from one
+		 * vertex buffer. Each level is optimized for the vertex cache. The mesh should already have been
+		 * run through MeshOptimizer, and must not have a LOD chain yet.
+		 * @param mesh The mesh to build the chain for.
+		 * @param report If true the triangle count and error of every level are printed to stdout.
+		 * @return the number of levels, including the full mesh.
+		 */
+		static unsigned int buildLodChain(IndexedMesh& mesh, bool report);
+
+		/**
+		 * Simplifies a triangle list by collapsing edges in order of their quadric error. Vertices are only
+		 * ever collapsed onto other existing vertices, so the result indexes the same vertex array.
+		 * Vertices on an attribute seam (several vertices at one position) are never moved, and vertices
+		 * on an open border only slide along the border, so seams and outlines are kept intact.
+		 * @param vertices The vertices the indices refer to.
+		 * @param vertexCount The number of vertices.
+		 * @param indices The triangle list to simplify.
+		 * @param indexCount The number of indices in the list.
+		 * @param targetIndexCount Stop once the list has this many indices or fewer.
+		 * @param targetError Never collapse an edge whose error is larger than this, in model units.
+		 * @param result Receives the simplified triangle list.
+		 * @return the largest error of the collapsed edges, in model units.
+		 */
+		static float simplify(const MeshVertex* vertices, unsigned int vertexCount, const GLuint* indices, unsigned int indexCount,
+		                      unsigned int targetIndexCount, float targetError, std::vector<GLuint>& result);
+};
+
+#endif
+
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
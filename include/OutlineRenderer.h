@@ -0,0 +1,118 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __OUTLINE_RENDERER_H__
+#define __OUTLINE_RENDERER_H__
+
+#include <GL/glew.h>
+
+/**
+ * Draws cel shading outlines in screen space. The scene is rendered once into colour, normal and depth
+ * textures, and a full screen pass then darkens the pixels next to depth and normal discontinuities while
+ * copying the colour to the window.
+ *
+ * The cel shader writes the eye space normal to the second draw buffer with an alpha of 0. Anything else
+ * writes an alpha of 1 there, the clear colour and fixed function drawing included, so only geometry drawn
+ * with the cel shader gets an outline.
+ */
+class OutlineRenderer {
+	public:
+		/**
+		 * Constructor.
+		 */
+		OutlineRenderer();
+
+		/**
+		 * Destructor. The GL objects must be released with release while the context is still current.
+		 */
+		~OutlineRenderer();
+
+		/**
+		 * Checks if the OpenGL implementation has the framebuffer objects and multiple draw buffers this
+		 * needs.
+		 */
+		static bool isSupported();
+
+		/**
+		 * Sets the edge detection program, built from shaders/outline.vs and shaders/outline.frag.
+		 * @param program The program object, 0 to disable the pass.
+		 */
+		void setProgram(GLuint program);
+
+		/**
+		 * Sets the framebuffer the outlines are composited into, 0 for the window.
+		 * @param framebuffer The framebuffer object.
+		 */
+		void setTargetFramebuffer(GLuint framebuffer);
+
+		/**
+		 * (Re)creates the render targets for a new window size.
+		 * @param width The width of the window.
+		 * @param height The height of the window.
+		 * @return true if the framebuffer is complete, false otherwise.
+		 */
+		bool resize(int width, int height);
+
+		/**
+		 * Checks if the program is set and the render targets are complete.
+		 */
+		bool isReady() const;
+
+		/**
+		 * Redirects rendering into the colour and normal targets. Clear them afterwards as usual.
+		 */
+		void begin();
+
+		/**
+		 * Switches back to the target framebuffer and composites the colour target with the outlines into it.
+		 * @param nearPlane The distance to the near clipping plane, to linearize the depth.
+		 * @param farPlane The distance to the far clipping plane.
+		 * @param thickness The distance in pixels at which neighbours are compared.
+		 */
+		void end(GLfloat nearPlane, GLfloat farPlane, GLfloat thickness);
+
+		/**
+		 * Frees the render targets and the framebuffer. The program belongs to the caller.
+		 */
+		void release();
+
+	private:
+		/** The framebuffer object */
+		GLuint framebuffer;
+		/** The lit colour of the scene */
+		GLuint colourTexture;
+		/** The eye space normals, scaled into [0, 1], and whether each pixel gets an outline */
+		GLuint normalTexture;
+		/** The depth buffer */
+		GLuint depthTexture;
+		/** The edge detection program */
+		GLuint program;
+		/** The size of the targets */
+		int width;
+		int height;
+		/** Whether the framebuffer is complete */
+		bool complete;
+		/** The framebuffer the outlines are composited into, 0 for the window */
+		GLuint targetFramebuffer;
+};
+
+#endif
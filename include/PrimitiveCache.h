@@ -0,0 +1,154 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __PRIMITIVE_CACHE_H__
+#define __PRIMITIVE_CACHE_H__
+
+#include <functional>
+#include <map>
+#include <tuple>
+#include <GL/glew.h>
+
+#include "IndexedMesh.h"
+#include "MeshBuffer.h"
+
+/**
+ * Builds the shapes the scenes are made of as indexed meshes in GPU memory, once for each set of
+ * parameters, so they are drawn through MeshBuffer like a loaded model. The shapes match the
+ * glutSolid* functions of the same names in size, orientation and tessellation.
+ */
+class PrimitiveCache {
+	public:
+		/**
+		 * Constructor.
+		 */
+		PrimitiveCache();
+
+		/**
+		 * Destructor. The GL objects must be released with release while the context is still current.
+		 */
+		~PrimitiveCache();
+
+		/**
+		 * Gets a torus around the z axis.
+		 * @param innerRadius The radius of the tube.
+		 * @param outerRadius The distance from the center to the middle of the tube.
+		 * @param sides The number of segments around the tube.
+		 * @param rings The number of segments around the z axis.
+		 */
+		const MeshBuffer& getTorus(GLfloat innerRadius, GLfloat outerRadius, unsigned int sides, unsigned int rings);
+
+		/**
+		 * Gets a sphere around the origin with its poles on the z axis.
+		 * @param radius The radius.
+		 * @param slices The number of segments around the z axis.
+		 * @param stacks The number of segments from pole to pole.
+		 */
+		const MeshBuffer& getSphere(GLfloat radius, unsigned int slices, unsigned int stacks);
+
+		/**
+		 * Gets a closed cone with its base on the xy plane and its tip on the positive z axis.
+		 * @param base The radius of the base.
+		 * @param height The height.
+		 * @param slices The number of segments around the z axis.
+		 * @param stacks The number of segments from the base to the tip.
+		 */
+		const MeshBuffer& getCone(GLfloat base, GLfloat height, unsigned int slices, unsigned int stacks);
+
+		/**
+		 * Gets an axis aligned cube around the origin.
+		 * @param size The length of an edge.
+		 */
+		const MeshBuffer& getCube(GLfloat size);
+
+		/**
+		 * Gets a square on the xy plane around the origin, with a front face on both sides.
+		 * @param size The length of an edge.
+		 */
+		const MeshBuffer& getPlane(GLfloat size);
+
+		/**
+		 * Gets the number of meshes that have been built.
+		 */
+		unsigned int getMeshCount() const;
+
+		/**
+		 * Deletes the GL buffers of every mesh.
+		 */
+		void release();
+
+	private:
+		/**
+		 * The shapes the cache can build.
+		 */
+		enum Shape {
+			SHAPE_TORUS,
+			SHAPE_SPHERE,
+			SHAPE_CONE,
+			SHAPE_CUBE,
+			SHAPE_PLANE
+		};
+
+		/** The shape and the parameters it was built with */
+		typedef std::tuple<Shape, GLfloat, GLfloat, unsigned int, unsigned int> Key;
+
+		/**
+		 * Finds a mesh in the cache.
+		 * @param key The shape and its parameters.
+		 * @param mesh Set to the mesh, which is empty if it has to be built.
+		 * @return true if the mesh was already built, false otherwise.
+		 */
+		bool find(const Key& key, MeshBuffer*& mesh);
+
+		/**
+		 * Appends a grid of uSteps by vSteps quads, two triangles each, to a mesh. The grid is evaluated
+		 * at every corner, the triangles face the side that the cross product of the u and v directions
+		 * points to. Triangles that collapse at a pole or a tip are left out.
+		 * @param mesh The mesh to append to.
+		 * @param uSteps The number of quads along u.
+		 * @param vSteps The number of quads along v.
+		 * @param evaluate Sets the position and normal of the vertex at (u, v), both in [0, 1].
+		 */
+		static void appendGrid(IndexedMesh& mesh, unsigned int uSteps, unsigned int vSteps,
+		                       const std::function<void(GLfloat, GLfloat, MeshVertex&)>& evaluate);
+
+		/**
+		 * Appends a square to a mesh.
+		 * @param mesh The mesh to append to.
+		 * @param normal The direction the square faces, along one of the axes.
+		 * @param distance How far the square is from the origin along its normal.
+		 * @param halfSize Half the length of an edge.
+		 */
+		static void appendSquare(IndexedMesh& mesh, const GLfloat normal[3], GLfloat distance, GLfloat halfSize);
+
+		/**
+		 * Uploads a mesh that has been built into a cache entry.
+		 * @param mesh The mesh.
+		 * @param buffer The cache entry.
+		 */
+		static void upload(IndexedMesh& mesh, MeshBuffer& buffer);
+
+		/** The meshes built so far */
+		std::map<Key, MeshBuffer> meshes;
+};
+
+#endif
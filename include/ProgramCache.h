@@ -0,0 +1,133 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __PROGRAM_CACHE_H__
+#define __PROGRAM_CACHE_H__
+
+#include <string>
+#include <GL/glew.h>
+
+/** The directory linked program binaries are kept in, relative to the working directory */
+#define PROGRAM_CACHE_DIRECTORY "shadercache"
+
+/**
+ * A generic vertex attribute that is bound to a fixed index with glBindAttribLocation before linking.
+ */
+struct ProgramAttribBinding {
+	/** The attribute index */
+	GLuint index;
+	/** The name of the attribute in the shaders */
+	const GLchar *name;
+};
+
+/**
+ * Keeps linked shader programs on disk with glGetProgramBinary, so later runs can skip compiling and
+ * linking. Each binary is keyed by a hash of the shader sources, the attribute bindings and the GL vendor,
+ * renderer and version strings, so editing a shader, moving an attribute or updating the driver simply
+ * misses the cache. A binary the driver
+ * rejects is treated as a miss as well, and is replaced once the program has been compiled again.
+ */
+class ProgramCache {
+	public:
+		/**
+		 * Constructor.
+		 * @param directory The directory to keep the binaries in, created when the first one is stored.
+		 */
+		explicit ProgramCache(const std::string& directory);
+
+		/**
+		 * Checks if the OpenGL implementation can save and restore program binaries. Needs a current
+		 * context.
+		 */
+		static bool isSupported();
+
+		/**
+		 * Turns the cache on or off. It is on by default.
+		 */
+		void setEnabled(bool enabled);
+
+		/**
+		 * Checks if the cache is turned on and supported. The driver is only asked the first time, which
+		 * needs a current context.
+		 */
+		bool isEnabled();
+
+		/**
+		 * Creates a program from the binary stored for a pair of shader sources.
+		 * @param vertexSource The vertex shader source.
+		 * @param fragmentSource The fragment shader source.
+		 * @param bindings The attribute bindings the program was linked with.
+		 * @param bindingCount The number of bindings.
+		 * @return the linked program, 0 if there is no binary or the driver rejected it.
+		 */
+		GLuint load(const GLchar* vertexSource, const GLchar* fragmentSource, const ProgramAttribBinding* bindings, unsigned int bindingCount);
+
+		/**
+		 * Stores the binary of a program linked from a pair of shader sources. The program must have been
+		 * linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set.
+		 * @param vertexSource The vertex shader source.
+		 * @param fragmentSource The fragment shader source.
+		 * @param bindings The attribute bindings the program was linked with.
+		 * @param bindingCount The number of bindings.
+		 * @param program The linked program.
+		 * @return true if the binary was written, false otherwise.
+		 */
+		bool store(const GLchar* vertexSource, const GLchar* fragmentSource, const ProgramAttribBinding* bindings, unsigned int bindingCount, GLuint program);
+
+		/**
+		 * Gets the number of programs loaded from the cache.
+		 */
+		unsigned int getHits() const;
+
+		/**
+		 * Gets the number of programs that had to be compiled.
+		 */
+		unsigned int getMisses() const;
+
+	private:
+		/**
+		 * Hashes the shader sources and attribute bindings together with the driver identification.
+		 */
+		unsigned long long computeKey(const GLchar* vertexSource, const GLchar* fragmentSource, const ProgramAttribBinding* bindings, unsigned int bindingCount) const;
+
+		/**
+		 * Gets the path of the binary for a key.
+		 */
+		std::string getPath(unsigned long long key) const;
+
+		/** The directory the binaries are kept in */
+		std::string directory;
+		/** Whether the cache is turned on */
+		bool enabled;
+		/** Whether the driver has been asked about program binaries yet */
+		bool driverChecked;
+		/** Whether the driver supports program binaries */
+		bool supported;
+		/** Hash of the driver identification, set together with supported */
+		unsigned long long driverHash;
+		/** The number of programs loaded from the cache */
+		unsigned int hits;
+		/** The number of programs that had to be compiled */
+		unsigned int misses;
+};
+
+#endif
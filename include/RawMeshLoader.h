@@ -26,10 +26,29 @@
 #include <string>
 #include <GL/glew.h>
 
-#include "RawMeshLoader.h"
+#include "ThreadPool.h"
+
+/** Size of the vertex count at the start of a .raw file */
+#define RAW_MESH_HEADER_SIZE 4
+/** Number of floats in each .raw record: position, normal, colour and UV */
+#define RAW_MESH_RECORD_FLOATS 11
+/** Size in bytes of each .raw record */
+#define RAW_MESH_RECORD_SIZE (RAW_MESH_RECORD_FLOATS * 4)
 
 class RawMeshLoader {
 	public:
+		/**
+		 * The ways in which a mesh file can be brought into memory.
+		 */
+		enum LoadMode {
+			/** Read the file through a stream and scatter it into separate arrays */
+			LOAD_STREAM,
+			/** Map the file into memory and expose the interleaved records in place */
+			LOAD_MAPPED,
+			/** Map the file and scatter ranges of records into separate arrays on a thread pool */
+			LOAD_PARALLEL
+		};
+
 		/**
 		* Constructor.
 		*/
@@ -44,10 +63,19 @@ class RawMeshLoader {
 		 * Loads a mesh from the specified file. When it loads the mesh it sets up a multi element
 		 * array containing the vertices, normals and colours of earch vertex, if it is indeed in the
 		 * specified file.
+		 * In LOAD_MAPPED mode the file is mapped read-only and the arrays point directly at the
+		 * interleaved records inside the mapping, so nothing is copied. Every page is read once before
+		 * load returns, so the load time includes bringing the file into memory. Use the stride accessors
+		 * when walking the arrays, as they are no longer tightly packed.
+		 * In LOAD_PARALLEL mode the records are split into one range per worker of threadPool, and each
+		 * worker scatters its range into the same tightly packed arrays that LOAD_STREAM produces.
 		 * @param path The file to load the mesh from.
+		 * @param mode How the file should be brought into memory.
+		 * @param threadPool The workers used by LOAD_PARALLEL, if NULL the records are scattered on the
+		 * calling thread.
 		 * @return the number of vertices that was loaded, 0 if there was an error.
 		 */
-		unsigned int load(const std::string& path);
+		unsigned int load(const std::string& path, LoadMode mode = LOAD_STREAM, ThreadPool* threadPool = NULL);
 
 		/**
 		 * Gets the current vertex array.
@@ -73,17 +101,107 @@ class RawMeshLoader {
 		 */
 		const GLvoid* getUVArray() const;
 
+		/**
+		 * Gets the number of bytes between consecutive vertices in the vertex array.
+		 */
+		GLsizei getVertexStride() const;
+
+		/**
+		 * Gets the number of bytes between consecutive normals in the normal array.
+		 */
+		GLsizei getNormalStride() const;
+
+		/**
+		 * Gets the number of bytes between consecutive colours in the colour array.
+		 */
+		GLsizei getColourStride() const;
+
+		/**
+		 * Gets the number of bytes between consecutive UVs in the UV array.
+		 */
+		GLsizei getUVStride() const;
+
+		/**
+		 * Gets the position of a single vertex.
+		 * @param index The index of the vertex.
+		 * @return a pointer to the 3 floats making up the position.
+		 */
+		const GLfloat* getVertex(unsigned int index) const;
+
+		/**
+		 * Gets the normal of a single vertex.
+		 * @param index The index of the vertex.
+		 * @return a pointer to the 3 floats making up the normal.
+		 */
+		const GLfloat* getNormal(unsigned int index) const;
+
+		/**
+		 * Gets the colour of a single vertex.
+		 * @param index The index of the vertex.
+		 * @return a pointer to the 3 floats making up the colour.
+		 */
+		const GLfloat* getColour(unsigned int index) const;
+
+		/**
+		 * Gets the UV of a single vertex.
+		 * @param index The index of the vertex.
+		 * @return a pointer to the 2 floats making up the UV.
+		 */
+		const GLfloat* getUV(unsigned int index) const;
+
 		/**
 		 * Gets the number of elements stored in the arrays.
 		 */
 		const unsigned int getSize() const;
 
+		/**
+		 * Gets the mode that the current arrays were loaded with.
+		 */
+		LoadMode getLoadMode() const;
+
+		/**
+		 * Gets the wall clock time taken by the last call to load.
+		 * @return the load time in seconds.
+		 */
+		double getLoadTime() const;
+
+		/**
+		 * Gets the rate at which the last call to load consumed the file.
+		 * @return the load throughput in MB/s.
+		 */
+		double getLoadThroughput() const;
+
 		/**
 		 * Free's the current element arrays.
 		 */
 		void releaseArrays();
 
 	private:
+		/**
+		 * Maps the file into memory and points the arrays at the records inside the mapping.
+		 * @param path The file to map.
+		 * @return true if successfull, false otherwise.
+		 */
+		bool mapFile(const std::string& path);
+
+		/**
+		 * Unmaps the file mapped by mapFile, if there is one.
+		 */
+		void unmapFile();
+
+		/**
+		 * Reads a byte of every page of the mapping, so that the whole file is in memory.
+		 */
+		void touchPages() const;
+
+		/**
+		 * Copies a range of the interleaved records into the separate arrays.
+		 * @param records The first record in the file.
+		 * @param begin The first record to copy.
+		 * @param end One past the last record to copy.
+		 */
+		void scatterRecords(const unsigned char* records, unsigned int begin, unsigned int end);
+
 		/** The element array */
 		GLvoid *vertexArray;
 		/** The element array */
@@ -94,6 +212,26 @@ class RawMeshLoader {
 		GLvoid *uvArray;
 		/** The number of vertices in the element array */
 		unsigned int size;
+		/** Byte strides of the vertex, normal, colour and UV arrays */
+		GLsizei vertexStride;
+		GLsizei normalStride;
+		GLsizei colourStride;
+		GLsizei uvStride;
+		/** The mode the current arrays were loaded with */
+		LoadMode loadMode;
+		/** The start of the file mapping, NULL if no file is mapped */
+		void *mappedData;
+		/** The length of the file mapping in bytes */
+		size_t mappedLength;
+#ifdef _WIN32
+		/** The file and file mapping handles backing mappedData */
+		void *fileHandle;
+		void *mappingHandle;
+#endif
+		/** Wall clock seconds taken by the last load */
+		double loadTime;
+		/** Number of bytes consumed by the last load */
+		size_t loadBytes;
 };
 
 #endif
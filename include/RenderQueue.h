@@ -0,0 +1,172 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __RENDER_QUEUE_H__
+#define __RENDER_QUEUE_H__
+
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+#include <GL/glew.h>
+
+/**
+ * The pipeline state a draw needs. Only the states that differ from the previous draw are set.
+ */
+struct RenderState {
+	/** The program, 0 for the fixed function pipeline */
+	GLuint program;
+	/** The polygon mode of both faces */
+	GLenum polygonMode;
+	/** The face that is culled */
+	GLenum cullFace;
+	/** The depth comparison */
+	GLenum depthFunc;
+	/** The width of lines */
+	GLfloat lineWidth;
+};
+
+/**
+ * Collects a frame's draws and submits them sorted by pass, program, state and depth, so that objects
+ * sharing a state are drawn together and the state is set once for all of them.
+ */
+class RenderQueue {
+	public:
+		/**
+		 * The passes, in the order they are drawn.
+		 */
+		enum Pass {
+			/** Thick black outlines, which the fill pass draws over */
+			PASS_OUTLINE,
+			/** The shaded geometry */
+			PASS_FILL,
+			/** The light's sphere, drawn without the shader */
+			PASS_LIGHT,
+			/** The number of passes */
+			PASS_COUNT
+		};
+
+		/**
+		 * Constructor.
+		 * @param nearPlane The distance to the near clipping plane.
+		 * @param farPlane The distance to the far clipping plane.
+		 */
+		RenderQueue(GLfloat nearPlane, GLfloat farPlane);
+
+		/**
+		 * Drops the queued draws and the counters of the previous frame.
+		 */
+		void clear();
+
+		/**
+		 * Queues a draw with the current modelview matrix, which is restored when it is submitted.
+		 * @param pass The pass to draw in.
+		 * @param state The state to draw with.
+		 * @param color The colour set before drawing.
+		 * @param draw Issues the draw calls.
+		 */
+		void submit(Pass pass, const RenderState& state, const GLfloat color[3], const std::function<void()>& draw);
+
+		/**
+		 * Sorts the queued draws and submits them. The modelview matrix is left as it was, the states are
+		 * left as the last draw set them.
+		 */
+		void flush();
+
+		/**
+		 * Submits the queued draws of one pass, so that each pass can be timed on its own. The draws stay
+		 * queued until the next clear.
+		 * @param pass The pass.
+		 */
+		void flush(Pass pass);
+
+		/**
+		 * Gets the number of draws submitted since the last clear.
+		 */
+		unsigned int getDrawCount() const;
+
+		/**
+		 * Gets the number of state changes made since the last clear.
+		 */
+		unsigned int getStateChangeCount() const;
+
+		/**
+		 * Gets the number of state changes skipped since the last clear because the state was already set.
+		 */
+		unsigned int getSkippedStateChangeCount() const;
+
+	private:
+		/**
+		 * A queued draw.
+		 */
+		struct Item {
+			/** The state to draw with */
+			RenderState state;
+			/** The modelview matrix when the draw was queued */
+			GLfloat modelView[16];
+			/** The colour set before drawing */
+			GLfloat color[3];
+			/** Issues the draw calls */
+			std::function<void()> draw;
+		};
+
+		/**
+		 * Packs the pass, program, state and depth of a draw into a key that sorts in that order.
+		 * @param pass The pass.
+		 * @param item The draw.
+		 * @return the key.
+		 */
+		uint64_t makeKey(Pass pass, const Item& item) const;
+
+		/**
+		 * Submits a range of the sorted draws.
+		 * @param first The index in order of the first draw.
+		 * @param last The index in order after the last draw.
+		 */
+		void submitRange(unsigned int first, unsigned int last);
+
+		/**
+		 * Sets the states of a draw that differ from the current ones.
+		 * @param state The state to draw with.
+		 */
+		void applyState(const RenderState& state);
+
+		/** The distances to the clipping planes, the range depths are quantized to */
+		GLfloat nearPlane;
+		GLfloat farPlane;
+		/** The queued draws */
+		std::vector<Item> items;
+		/** The sort key and the index of each queued draw */
+		std::vector<std::pair<uint64_t, unsigned int> > order;
+		/** The state set by the last draw, only valid once stateValid is set */
+		RenderState current;
+		/** Whether current matches the GL state */
+		bool stateValid;
+		/** Whether order is sorted */
+		bool sorted;
+		/** Counters of the last flush */
+		unsigned int drawCount;
+		unsigned int stateChangeCount;
+		unsigned int skippedStateChangeCount;
+};
+
+#endif
@@ -0,0 +1,82 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __SHADER_PERMUTATION_H__
+#define __SHADER_PERMUTATION_H__
+
+#include <string>
+#include <GL/glew.h>
+
+/** The most bands a toon ramp can have */
+#define TOON_RAMP_MAX_BANDS 4
+
+/**
+ * The bands the cel shader quantizes the lighting into.
+ */
+struct ToonRamp {
+	/** The number of bands, between 1 and TOON_RAMP_MAX_BANDS */
+	unsigned int bandCount;
+	/** The intensity each band above the first starts at, in ascending order */
+	GLfloat thresholds[TOON_RAMP_MAX_BANDS - 1];
+	/** The brightness of each band */
+	GLfloat levels[TOON_RAMP_MAX_BANDS];
+	/** Whether the intensity includes a specular highlight, otherwise it is the diffuse term alone */
+	bool specular;
+};
+
+/**
+ * Builds the #define blocks that specialize shaders/celShader.frag. Every option is resolved by the
+ * preprocessor, so each variant only contains the instructions it needs and the ramp is evaluated without
+ * branches.
+ */
+class ShaderPermutation {
+	public:
+		/**
+		 * Gets the three band ramp with a specular highlight the cel shader has always used.
+		 */
+		static ToonRamp defaultRamp();
+
+		/**
+		 * Builds the #define block for a variant of the cel shader.
+		 * @param ramp The toon ramp.
+		 * @param writeNormals Whether the normal is written to the second draw buffer, as screen space
+		 * outlines need.
+		 * @return the block, one #define per line, to be placed in front of the shader sources.
+		 */
+		static std::string buildDefines(const ToonRamp& ramp, bool writeNormals);
+
+		/**
+		 * Orders ramps by the values buildDefines uses, so that ramps can key the compiled variants.
+		 * @param a The first ramp.
+		 * @param b The second ramp.
+		 * @return less than 0 if a comes first, 0 if they build the same variant, greater than 0 otherwise.
+		 */
+		static int compareRamps(const ToonRamp& a, const ToonRamp& b);
+
+	private:
+		/**
+		 * Gets the number of bands buildDefines uses for a ramp.
+		 */
+		static unsigned int clampBands(const ToonRamp& ramp);
+};
+
+#endif
@@ -0,0 +1,114 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __SILHOUETTE_EXTRACTOR_H__
+#define __SILHOUETTE_EXTRACTOR_H__
+
+#include <vector>
+#include <GL/glew.h>
+
+#include "EdgeAdjacency.h"
+#include "ThreadPool.h"
+
+/** Levels with fewer edges than this are searched on the calling thread, it isn't worth waking the pool */
+#define SILHOUETTE_PARALLEL_EDGES 16384
+
+/**
+ * Finds the silhouette edges of a mesh, the edges between a face turned towards the eye and one turned
+ * away from it, as a list of lines to draw. The faces are classified four at a time with SSE where it is
+ * available, and large levels are split over the thread pool. The list is kept for as long as the eye
+ * and level stay the same.
+ */
+class SilhouetteExtractor {
+	public:
+		/**
+		 * Constructor.
+		 */
+		SilhouetteExtractor();
+
+		/**
+		 * Finds the eye position in model space from a model view matrix made of rotations and
+		 * translations only.
+		 * @param modelView The column major model view matrix.
+		 * @param eye Receives the position of the eye.
+		 */
+		static void eyeFromModelView(const GLfloat modelView[16], GLfloat eye[3]);
+
+		/**
+		 * Finds the silhouette of a level of detail, unless it was already found for the same eye position
+		 * in the last call.
+		 * @param adjacency The edges of the mesh.
+		 * @param level The level of detail.
+		 * @param eye The eye position in model space.
+		 * @param threadPool The threads to split large levels over.
+		 * @return true if the lines have changed, false if the previous ones were kept.
+		 */
+		bool update(const EdgeAdjacency& adjacency, unsigned int level, const GLfloat eye[3], ThreadPool& threadPool);
+
+		/**
+		 * Gets the silhouette as pairs of indices into the mesh's vertex array, to be drawn as GL_LINES.
+		 */
+		const std::vector<GLuint>& getLines() const;
+
+		/**
+		 * Gets the number of edges in the level the silhouette was last found for.
+		 */
+		unsigned int getEdgeCount() const;
+
+		/**
+		 * Checks if the last call to update kept the previous lines.
+		 */
+		bool wasCached() const;
+
+		/**
+		 * Forgets the lines, so that the next call to update searches again.
+		 */
+		void invalidate();
+
+	private:
+		/**
+		 * Works out which of a range of faces are turned towards the eye.
+		 */
+		void classifyFaces(const EdgeAdjacency& adjacency, const EdgeAdjacencyLevel& info, const GLfloat eye[3], unsigned int begin, unsigned int end);
+
+		/**
+		 * Appends the silhouette edges among a range of edges to a list of lines.
+		 */
+		void collectEdges(const EdgeAdjacency& adjacency, const EdgeAdjacencyLevel& info, unsigned int begin, unsigned int end, std::vector<GLuint>& out) const;
+
+		/** Whether each face of the level is turned towards the eye */
+		std::vector<unsigned char> facing;
+		/** The lines found by each chunk of a parallel search, joined in order afterwards */
+		std::vector<std::vector<GLuint> > chunkLines;
+		/** The silhouette, two vertex indices per edge */
+		std::vector<GLuint> lines;
+		/** What the lines were found for */
+		const EdgeAdjacency *lastAdjacency;
+		unsigned int lastLevel;
+		GLfloat lastEye[3];
+		/** The number of edges in the last level */
+		unsigned int edgeCount;
+		/** Whether the last update kept the lines */
+		bool cached;
+};
+
+#endif
@@ -0,0 +1,293 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __SOFTWARE_RASTERIZER_H__
+#define __SOFTWARE_RASTERIZER_H__
+
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+
+#include "RawMeshLoader.h"
+#include "ShaderPermutation.h"
+#include "ThreadPool.h"
+
+/** The width and height of the screen tiles triangles are binned into, in pixels */
+#define RASTER_TILE_SIZE 32
+/** The width of the back face outlines, in pixels, the same as the line width of the GL outline pass */
+#define RASTER_OUTLINE_WIDTH 6.0f
+
+/**
+ * Draws cel shaded triangles on the CPU, for machines without a GPU. It reproduces what celShader.vs and
+ * celShader.frag draw, per pixel lighting quantized by a toon ramp, together with the back face outline
+ * pass: the back faces are drawn first as thick black lines with a < depth test, then the front faces are
+ * filled with a <= depth test.
+ *
+ * The vertices are transformed and the triangles are binned into RASTER_TILE_SIZE square tiles in
+ * parallel, then the tiles are rasterized in parallel four pixels at a time: the edge functions, the depth
+ * test and the depth and colour writes are done for the four at once, only the shading is done per pixel.
+ * Each tile is drawn by a single thread, in the order the triangles were given, so the image doesn't depend
+ * on the number of threads. Without a thread pool every step runs on the calling thread instead, for callers
+ * that draw several frames at once.
+ *
+ * Triangles crossing the near plane are dropped rather than clipped.
+ */
+class SoftwareRasterizer {
+	public:
+		/**
+		 * Constructor.
+		 * @param threadPool The workers that transform, bin and rasterize, NULL to draw on the calling thread.
+		 */
+		explicit SoftwareRasterizer(ThreadPool* threadPool = NULL);
+
+		/**
+		 * Sets the size of the image and reallocates it.
+		 * @param width The width in pixels.
+		 * @param height The height in pixels.
+		 */
+		void resize(int width, int height);
+
+		/**
+		 * Gets the width of the image in pixels.
+		 */
+		int getWidth() const;
+
+		/**
+		 * Gets the height of the image in pixels.
+		 */
+		int getHeight() const;
+
+		/**
+		 * Sets up a perspective projection, like gluPerspective, with the aspect ratio of the current size.
+		 * @param fieldOfView The vertical field of view, in degrees.
+		 * @param nearPlane The distance to the near clipping plane.
+		 * @param farPlane The distance to the far clipping plane.
+		 */
+		void setPerspective(GLfloat fieldOfView, GLfloat nearPlane, GLfloat farPlane);
+
+		/**
+		 * Sets the modelview matrix.
+		 * @param matrix The matrix, in column major order like glLoadMatrixf.
+		 */
+		void setModelView(const GLfloat matrix[16]);
+
+		/**
+		 * Positions the light. Like glLightfv, the position is transformed by the current modelview matrix.
+		 * @param position The position.
+		 */
+		void setLight(const GLfloat position[4]);
+
+		/**
+		 * Sets the toon ramp the triangles are shaded with.
+		 * @param ramp The toon ramp.
+		 */
+		void setRamp(const ToonRamp& ramp);
+
+		/**
+		 * Selects whether the back faces are drawn as outlines.
+		 * @param outlines true to draw the outlines.
+		 */
+		void setOutlines(bool outlines);
+
+		/**
+		 * Clears the image to a colour and the depth to the far plane.
+		 * @param colour The colour.
+		 */
+		void clear(const GLfloat colour[3]);
+
+		/**
+		 * Draws a loaded mesh, every three vertices making up a triangle.
+		 * @param mesh The mesh.
+		 */
+		void draw(const RawMeshLoader& mesh);
+
+		/**
+		 * Draws triangles, every three vertices making up one.
+		 * @param positions The positions, 3 floats per vertex.
+		 * @param positionStride The number of bytes from one position to the next.
+		 * @param normals The normals, 3 floats per vertex.
+		 * @param normalStride The number of bytes from one normal to the next.
+		 * @param colours The colours, 3 floats per vertex.
+		 * @param colourStride The number of bytes from one colour to the next.
+		 * @param vertexCount The number of vertices.
+		 */
+		void draw(const GLvoid* positions, GLsizei positionStride, const GLvoid* normals, GLsizei normalStride,
+		          const GLvoid* colours, GLsizei colourStride, unsigned int vertexCount);
+
+		/**
+		 * Gets the image, as RGB bytes with the bottom row first like glReadPixels.
+		 */
+		const std::vector<GLubyte>& getPixels() const;
+
+		/**
+		 * Writes the image to a binary PPM file.
+		 * @param path The path of the file.
+		 * @return true if successfull, false otherwise.
+		 */
+		bool writeImage(const std::string& path) const;
+
+		/**
+		 * Builds the modelview matrix CelShader::draw sets up, a camera orbiting the origin.
+		 * @param viewAngle The camera's angle around the origin, in radians.
+		 * @param pitch The camera's pitch, in radians.
+		 * @param distance The camera's distance from the origin.
+		 * @param matrix Receives the matrix, in column major order.
+		 */
+		static void orbitMatrix(GLfloat viewAngle, GLfloat pitch, GLfloat distance, GLfloat matrix[16]);
+
+	private:
+		/**
+		 * A transformed vertex.
+		 */
+		struct Vertex {
+			/** The window coordinates, with the depth from 0 to 1 */
+			GLfloat window[3];
+			/** 1 / w, for perspective correct interpolation */
+			GLfloat invW;
+			/** The position and normal in eye space */
+			GLfloat eye[3];
+			GLfloat normal[3];
+			/** The colour */
+			GLfloat colour[3];
+			/** Whether the vertex is in front of the near plane */
+			bool visible;
+		};
+
+		/**
+		 * A triangle set up for rasterizing.
+		 */
+		struct Triangle {
+			/** The vertices */
+			unsigned int vertices[3];
+			/**
+			 * The edge functions, edge i being opposite vertex i. Edge i at a pixel is
+			 * edgeX[i] * x + edgeY[i] * y + edgeC[i], and is positive inside a front face
+			 */
+			GLfloat edgeX[3];
+			GLfloat edgeY[3];
+			GLfloat edgeC[3];
+			/** 1 / twice the signed area */
+			GLfloat invArea;
+			/** The pixels the triangle may cover, the outlines included */
+			int minX;
+			int minY;
+			int maxX;
+			int maxY;
+			/** Whether the triangle faces away, and is drawn as an outline */
+			bool backFacing;
+		};
+
+		/**
+		 * Transforms a range of vertices.
+		 * @param begin The first vertex.
+		 * @param end One past the last vertex.
+		 */
+		void transformVertices(unsigned int begin, unsigned int end);
+
+		/**
+		 * Sets up a triangle and works out the pixels it covers.
+		 * @param triangle The triangle, with its vertices set.
+		 * @return true if the triangle is drawn, false if it is culled.
+		 */
+		bool setupTriangle(Triangle& triangle) const;
+
+		/**
+		 * Sets up a range of triangles and adds the ones that are drawn to the tiles they cover.
+		 * @param bin The set of tiles to add them to.
+		 * @param begin The first triangle.
+		 * @param end One past the last triangle.
+		 */
+		void binTriangles(unsigned int bin, unsigned int begin, unsigned int end);
+
+		/**
+		 * Draws the triangles binned into a tile.
+		 * @param tile The tile.
+		 */
+		void rasterizeTile(unsigned int tile);
+
+		/**
+		 * Fills the part of a front face inside a rectangle.
+		 * @param triangle The triangle.
+		 * @param x0 The left of the rectangle.
+		 * @param y0 The bottom of the rectangle.
+		 * @param x1 One past the right of the rectangle.
+		 * @param y1 One past the top of the rectangle.
+		 */
+		void fillTriangle(const Triangle& triangle, int x0, int y0, int x1, int y1);
+
+		/**
+		 * Draws the edges of a back face inside a rectangle as thick black lines.
+		 * @param triangle The triangle.
+		 * @param x0 The left of the rectangle.
+		 * @param y0 The bottom of the rectangle.
+		 * @param x1 One past the right of the rectangle.
+		 * @param y1 One past the top of the rectangle.
+		 */
+		void outlineTriangle(const Triangle& triangle, int x0, int y0, int x1, int y1);
+
+		/**
+		 * Shades a pixel the way celShader.frag does.
+		 * @param triangle The triangle covering the pixel.
+		 * @param weights The perspective correct barycentric coordinates of the pixel.
+		 * @param pixel Receives the RGB colour.
+		 */
+		void shade(const Triangle& triangle, const GLfloat weights[3], GLubyte pixel[3]) const;
+
+		/** The workers, NULL to draw on the calling thread */
+		ThreadPool *threadPool;
+		/** The size of the image */
+		int width;
+		int height;
+		/** The number of tiles across and down */
+		unsigned int tilesX;
+		unsigned int tilesY;
+		/** The colour and depth of every pixel, the bottom row first */
+		std::vector<GLubyte> pixels;
+		std::vector<GLfloat> depths;
+		/** The projection and modelview matrices, column major */
+		GLfloat projection[16];
+		GLfloat modelView[16];
+		/** The inverse transpose of the modelview matrix's rotation, column major */
+		GLfloat normalMatrix[9];
+		/** The distance to the near clipping plane */
+		GLfloat nearPlane;
+		/** The light's position in eye space */
+		GLfloat light[3];
+		/** The toon ramp */
+		ToonRamp ramp;
+		/** Whether the back faces are drawn as outlines */
+		bool outlines;
+		/** The source arrays of the current draw */
+		const GLubyte *sourcePositions;
+		const GLubyte *sourceNormals;
+		const GLubyte *sourceColours;
+		GLsizei positionStride;
+		GLsizei normalStride;
+		GLsizei colourStride;
+		/** The vertices and triangles of the current draw */
+		std::vector<Vertex> vertices;
+		std::vector<Triangle> triangles;
+		/** The triangles in each tile, a set of tiles per binning thread so that no locking is needed */
+		std::vector<std::vector<unsigned int> > bins;
+};
+
+#endif
@@ -0,0 +1,120 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __THREAD_POOL_H__
+#define __THREAD_POOL_H__
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+class ThreadPool {
+	public:
+		/**
+		 * Constructor. Starts the worker threads.
+		 * @param threadCount The number of worker threads, 0 to use one per hardware thread.
+		 */
+		explicit ThreadPool(unsigned int threadCount = 0);
+
+		/**
+		 * Destructor. Finishes the queued tasks and joins the worker threads.
+		 */
+		~ThreadPool();
+
+		/**
+		 * Queues a task to be run on one of the worker threads.
+		 * @param task The task to run.
+		 */
+		void enqueue(const std::function<void()>& task);
+
+		/**
+		 * Blocks until every queued task has finished, including tasks queued by other callers. Must not be
+		 * called from one of the pool's own tasks.
+		 */
+		void wait();
+
+		/**
+		 * Splits the range [0, count) into one contiguous chunk per worker, runs the chunks in parallel
+		 * and waits for all of them to finish. The calling thread runs chunks as well and only waits for
+		 * this call's chunks, so other work on the pool doesn't hold it up and it may be called from one
+		 * of the pool's tasks.
+		 * @param count The size of the range.
+		 * @param body Called with the [begin, end) of each chunk.
+		 */
+		void parallelFor(unsigned int count, const std::function<void(unsigned int, unsigned int)>& body);
+
+		/**
+		 * Gets the number of worker threads.
+		 */
+		unsigned int getThreadCount() const;
+
+	private:
+		/**
+		 * The loop run by every worker thread.
+		 */
+		void workerLoop();
+
+		/** The worker threads */
+		std::vector<std::thread> workers;
+		/** Tasks waiting for a worker */
+		std::deque<std::function<void()> > tasks;
+		/** Guards tasks, pending and stopping */
+		std::mutex mutex;
+		/** Signalled when a task is queued or the pool is stopping */
+		std::condition_variable taskAvailable;
+		/** Signalled when the last pending task finishes */
+		std::condition_variable tasksDone;
+		/** Number of tasks queued or running */
+		unsigned int pending;
+		/** Set when the workers should exit */
+		bool stopping;
+
+		ThreadPool(const ThreadPool&);
+		ThreadPool& operator=(const ThreadPool&);
+};
+
+#endif
+
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
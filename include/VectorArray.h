@@ -0,0 +1,868 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/** \file
+ * \brief A batch of n-dimensional vectors stored as a structure of arrays
+ * \author ME Chamberlain
+ */
+
+#ifndef __VECTOR_ARRAY_H__
+#define __VECTOR_ARRAY_H__
+
+#include <assert.h>
+#include <stddef.h>
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include "VectorN.h"
+
+template <typename TYPE, int N>
+class VectorArray;
+
+template <typename TYPE, int N>
+/** A batch of n-dimensional vectors that can only be read, the part of VectorArray that doesn't change
+ * the vectors. It is what a view of const data is, so writing through such a view doesn't compile:
+ *
+ *     ConstVectorArray<GLfloat, 3> positions(static_cast<const GLfloat*>(mesh.getVertexArray()), mesh.getSize(),
+ *                                            mesh.getVertexStride());
+ *
+ * A VectorArray is a ConstVectorArray too, so the bulk operations read either, and copying a VectorArray
+ * into a ConstVectorArray views its vectors for as long as it keeps them.
+ * \author ME Chamberlain
+ */
+class ConstVectorArray {
+public:
+    /** Constructs an empty array */
+    ConstVectorArray();
+
+    /** Constructs a read only view of interleaved vectors
+     * @param data The first element of the first vector
+     * @param size The number of vectors
+     * @param stride The number of bytes between consecutive vectors, 0 if they are tightly packed
+     */
+    ConstVectorArray(const TYPE *data, unsigned int size, size_t stride = 0);
+
+    /** Gets the number of vectors in the array */
+    unsigned int getSize() const;
+
+    /** Tests whether the array views vectors stored elsewhere */
+    bool isView() const;
+
+    /** Gets the vector at the given index.
+     * @param index The index of the vector to fetch.
+     * @return A copy of the vector at index.
+     */
+    VectorN<TYPE, N> get(unsigned int index) const;
+
+    /** Gets the given element of the first vector. The same element of the next vector is
+     * getElementStride() values further on.
+     * @param element The index of the element.
+     */
+    const TYPE* getElements(int element) const;
+
+    /** Gets the number of values between the same element of consecutive vectors, 1 for an array that
+     * owns its vectors
+     */
+    size_t getElementStride() const;
+
+    /* ===================== BULK OPERATIONS ===================== */
+
+    /** Multiplies every vector by a column major 4x4 matrix, as glLoadMatrix takes it. A 4 element vector
+     * is multiplied as it is, a 3 element one is extended with w and only the first three elements of the
+     * result are kept, there is no perspective divide.
+     * @param matrix The matrix to multiply by.
+     * @param w The fourth element of 3 element vectors, 1 for positions and 0 for directions.
+     * @param out Receives the results, it can be this array.
+     */
+    void transform(const TYPE *matrix, TYPE w, VectorArray<TYPE, N>& out) const;
+
+    /** Sets the length of every vector to one. A zero vector stays zero instead of being divided by zero.
+     * @param out Receives the results, it can be this array.
+     */
+    void normalize(VectorArray<TYPE, N>& out) const;
+
+    /** Calculates the dot product between every vector and the specified one.
+     * @param vector A vector
+     * @param out Receives getSize() dot products.
+     */
+    void dot(const VectorN<TYPE, N>& vector, TYPE *out) const;
+
+    /** Calculates the axis aligned bounding box of the vectors.
+     * @param minimum Receives the smallest value of each element.
+     * @param maximum Receives the largest value of each element.
+     * @return true if there was a vector to bound, false if the array is empty.
+     */
+    bool bounds(VectorN<TYPE, N>& minimum, VectorN<TYPE, N>& maximum) const;
+
+    /** Computes the cross product between every vector and the one at the same index in the specified
+     * array, for 3 element vectors only.
+     * @param array The vectors to compute the cross products with, as many as this array has.
+     * @param out Receives the results, it can be this array or the specified one.
+     */
+    void cross(const ConstVectorArray& array, VectorArray<TYPE, N>& out) const;
+
+    /* ===================== OPERATORS ===================== */
+
+    /** Returns the vector at the specified index. */
+    VectorN<TYPE, N> operator [](unsigned int index) const;
+
+protected:
+    /** The first value of each element */
+    const TYPE *elements[N];
+    /** The number of values between the same element of consecutive vectors */
+    size_t elementStride;
+    /** The number of vectors */
+    unsigned int size;
+    /** Whether the vectors are stored elsewhere */
+    bool view;
+
+private:
+    /** The operations on the same element of four vectors, the bulk of each operation */
+    typedef VectorNKernel<TYPE, 4> Lanes;
+    /** The operations on a single element, for the vectors left over after the groups of four */
+    typedef VectorNKernel<TYPE, 1> Lane;
+
+    /** The number of vectors the bulk operations work on at a time. The vectors of a view are copied into
+     * blocks this size on the stack, few enough to stay in the first level cache.
+     */
+    enum { BLOCK_SIZE = 256 };
+
+    /** Makes out ready to receive a result for every vector in this array */
+    void prepare(VectorArray<TYPE, N>& out) const;
+
+    /** Points source at each element of count vectors from begin onwards. The vectors of an array that owns
+     * them are used where they are, those of a view are copied into block first, BLOCK_SIZE values apart.
+     */
+    void readBlock(unsigned int begin, unsigned int count, TYPE *block, const TYPE **source) const;
+
+    /** Points destination at where the results for the vectors of out from begin onwards go, out itself
+     * if it owns its vectors, otherwise block, for writeBlock to copy into the view.
+     */
+    static void prepareBlock(VectorArray<TYPE, N>& out, unsigned int begin, TYPE *block, TYPE **destination);
+
+    /** Copies count results from block into out from begin onwards, if out is a view */
+    static void writeBlock(const TYPE *block, unsigned int begin, unsigned int count, VectorArray<TYPE, N>& out);
+
+    /* The bulk operations on the first count vectors of each element array, KERNEL::SIZE at a time, from
+     * begin onwards. Each returns the index of the first vector left over, for the next smaller KERNEL to
+     * finish.
+     *
+     * The SIMD stores may alias anything, so the element pointers are copied into locals first, or the
+     * compiler would read them again after every store.
+     */
+    template <typename KERNEL>
+    static unsigned int transformRange(const TYPE *const *source, TYPE *const *destination, unsigned int begin,
+                                       unsigned int count, const TYPE *matrix, TYPE w);
+
+    template <typename KERNEL>
+    static unsigned int normalizeRange(const TYPE *const *source, TYPE *const *destination, unsigned int begin,
+                                       unsigned int count);
+
+    template <typename KERNEL>
+    static unsigned int dotRange(const TYPE *const *source, TYPE *out, unsigned int begin, unsigned int count,
+                                 const VectorN<TYPE, N>& vector);
+
+    template <typename KERNEL>
+    static unsigned int boundsRange(const TYPE *const *source, unsigned int begin, unsigned int count,
+                                    TYPE *minimum, TYPE *maximum);
+
+    template <typename KERNEL>
+    static unsigned int crossRange(const TYPE *const *left, const TYPE *const *right, TYPE *const *destination,
+                                   unsigned int begin, unsigned int count);
+};
+
+template <typename TYPE, int N>
+/** A batch of n-dimensional vectors, for working on many vectors at once.
+ *
+ * An array that owns its vectors stores them as a structure of arrays, every first element, then every
+ * second element and so on. The bulk operations load the same element of four vectors into a register
+ * with VectorNKernel<TYPE, 4>, so they do four vectors at once whatever N is.
+ *
+ * An array can also view vectors stored elsewhere, interleaved with a byte stride the way glVertexPointer
+ * takes them, such as the positions of an array of MeshVertex:
+ *
+ *     VectorArray<GLfloat, 3> positions(vertices[0].position, vertexCount, sizeof(MeshVertex));
+ *
+ * The bulk operations on a view copy a block of vectors at a time onto the stack, element by element,
+ * loading four vectors whole and transposing them, run on that, and copy the results back, so the kernels
+ * still load whole registers. A view of const data is a ConstVectorArray instead.
+ * \author ME Chamberlain
+ */
+class VectorArray : public ConstVectorArray<TYPE, N> {
+public:
+    /** Constructs an empty array */
+    VectorArray();
+
+    /** Constructs an array owning the given number of zero vectors
+     * @param size The number of vectors
+     */
+    explicit VectorArray(unsigned int size);
+
+    /** Constructs a view of interleaved vectors
+     * @param data The first element of the first vector
+     * @param size The number of vectors
+     * @param stride The number of bytes between consecutive vectors, 0 if they are tightly packed
+     */
+    VectorArray(TYPE *data, unsigned int size, size_t stride = 0);
+
+    /** Constructs an array from another one. The vectors of an array that owns them are copied, a view
+     * is copied as a view of the same vectors.
+     * \param array The array to copy
+     */
+    VectorArray(const VectorArray& array);
+
+    /** Changes the number of vectors in an array that owns them. The vectors kept keep their values, the
+     * new ones are zero.
+     * @param size The new number of vectors
+     */
+    void resize(unsigned int size);
+
+    /** Sets the vector at the given index to the one specified.
+     * @param index The index of the vector to set.
+     * @param vector The new value for the vector at index.
+     */
+    void set(unsigned int index, const VectorN<TYPE, N>& vector);
+
+    using ConstVectorArray<TYPE, N>::getElements;
+
+    /** Gets the given element of the first vector, to change. The same element of the next vector is
+     * getElementStride() values further on.
+     * @param element The index of the element.
+     */
+    TYPE* getElements(int element);
+
+    /* ===================== OPERATORS ===================== */
+
+    /** The = operator. Copies an array, like the copy constructor does. */
+    VectorArray& operator =(const VectorArray& array);
+
+private:
+    /** Points elements at the storage of an array that owns its vectors */
+    void setupElements();
+
+    /** The vectors of an array that owns them, element by element */
+    std::vector<TYPE> storage;
+    /** The first value of each element, the same as elements but to change */
+    TYPE *writableElements[N];
+};
+
+
+/** A batch of 3-dimensional float vectors */
+typedef VectorArray<float,3>    Vector3fArray;
+/** A batch of 4-dimensional float vectors */
+typedef VectorArray<float,4>    Vector4fArray;
+/** A batch of 3-dimensional double vectors */
+typedef VectorArray<double,3>   Vector3dArray;
+/** A batch of 4-dimensional double vectors */
+typedef VectorArray<double,4>   Vector4dArray;
+
+/** A batch of 3-dimensional float vectors that can only be read */
+typedef ConstVectorArray<float,3>    ConstVector3fArray;
+/** A batch of 4-dimensional float vectors that can only be read */
+typedef ConstVectorArray<float,4>    ConstVector4fArray;
+/** A batch of 3-dimensional double vectors that can only be read */
+typedef ConstVectorArray<double,3>   ConstVector3dArray;
+/** A batch of 4-dimensional double vectors that can only be read */
+typedef ConstVectorArray<double,4>   ConstVector4dArray;
+
+// ====== IMPLEMENTATION ======
+template<typename TYPE, int N>
+ConstVectorArray<TYPE, N>::ConstVectorArray()
+    : elementStride(1), size(0), view(false)
+{
+    int i;
+
+    for (i = 0; i < N; i++) {
+        elements[i] = NULL;
+    }
+}
+
+template<typename TYPE, int N>
+ConstVectorArray<TYPE, N>::ConstVectorArray(const TYPE *data, unsigned int size, size_t stride)
+    : elementStride((stride != 0) ? stride / sizeof(TYPE) : N), size(size), view(true)
+{
+    int i;
+
+    assert((data != NULL) || (size == 0));
+    assert(stride % sizeof(TYPE) == 0);
+
+    for (i = 0; i < N; i++) {
+        elements[i] = data + i;
+    }
+}
+
+template<typename TYPE, int N>
+unsigned int ConstVectorArray<TYPE, N>::getSize() const {
+    return size;
+}
+
+template<typename TYPE, int N>
+bool ConstVectorArray<TYPE, N>::isView() const {
+    return view;
+}
+
+template<typename TYPE, int N>
+VectorN<TYPE, N> ConstVectorArray<TYPE, N>::get(unsigned int index) const {
+    VectorN<TYPE, N> result;
+    int i;
+
+    assert(index < size);
+
+    for (i = 0; i < N; i++) {
+        result[i] = elements[i][index * elementStride];
+    }
+
+    return result;
+}
+
+template<typename TYPE, int N>
+const TYPE* ConstVectorArray<TYPE, N>::getElements(int element) const {
+    assert((element >= 0) && (element < N));
+
+    return elements[element];
+}
+
+template<typename TYPE, int N>
+size_t ConstVectorArray<TYPE, N>::getElementStride() const {
+    return elementStride;
+}
+
+template<typename TYPE, int N>
+void ConstVectorArray<TYPE, N>::transform(const TYPE *matrix, TYPE w, VectorArray<TYPE, N>& out) const {
+    TYPE sourceBlock[N * BLOCK_SIZE];
+    TYPE destinationBlock[N * BLOCK_SIZE];
+    const TYPE *source[N];
+    TYPE *destination[N];
+    unsigned int begin;
+    unsigned int count;
+    unsigned int i;
+
+    static_assert((N == 3) || (N == 4), "VectorArray::transform needs 3 or 4 element vectors");
+    assert(matrix != NULL);
+
+    prepare(out);
+    for (begin = 0; begin < size; begin += BLOCK_SIZE) {
+        count = std::min(size - begin, static_cast<unsigned int>(BLOCK_SIZE));
+        readBlock(begin, count, sourceBlock, source);
+        prepareBlock(out, begin, destinationBlock, destination);
+
+        i = transformRange<Lanes>(source, destination, 0, count, matrix, w);
+        transformRange<Lane>(source, destination, i, count, matrix, w);
+
+        writeBlock(destinationBlock, begin, count, out);
+    }
+}
+
+template<typename TYPE, int N>
+void ConstVectorArray<TYPE, N>::normalize(VectorArray<TYPE, N>& out) const {
+    TYPE sourceBlock[N * BLOCK_SIZE];
+    TYPE destinationBlock[N * BLOCK_SIZE];
+    const TYPE *source[N];
+    TYPE *destination[N];
+    unsigned int begin;
+    unsigned int count;
+    unsigned int i;
+
+    prepare(out);
+    for (begin = 0; begin < size; begin += BLOCK_SIZE) {
+        count = std::min(size - begin, static_cast<unsigned int>(BLOCK_SIZE));
+        readBlock(begin, count, sourceBlock, source);
+        prepareBlock(out, begin, destinationBlock, destination);
+
+        i = normalizeRange<Lanes>(source, destination, 0, count);
+        normalizeRange<Lane>(source, destination, i, count);
+
+        writeBlock(destinationBlock, begin, count, out);
+    }
+}
+
+template<typename TYPE, int N>
+void ConstVectorArray<TYPE, N>::dot(const VectorN<TYPE, N>& vector, TYPE *out) const {
+    TYPE sourceBlock[N * BLOCK_SIZE];
+    const TYPE *source[N];
+    unsigned int begin;
+    unsigned int count;
+    unsigned int i;
+
+    assert((out != NULL) || (size == 0));
+
+    for (begin = 0; begin < size; begin += BLOCK_SIZE) {
+        count = std::min(size - begin, static_cast<unsigned int>(BLOCK_SIZE));
+        readBlock(begin, count, sourceBlock, source);
+
+        i = dotRange<Lanes>(source, out + begin, 0, count, vector);
+        dotRange<Lane>(source, out + begin, i, count, vector);
+    }
+}
+
+template<typename TYPE, int N>
+bool ConstVectorArray<TYPE, N>::bounds(VectorN<TYPE, N>& minimum, VectorN<TYPE, N>& maximum) const {
+    TYPE sourceBlock[N * BLOCK_SIZE];
+    const TYPE *source[N];
+    TYPE lower[N];
+    TYPE upper[N];
+    unsigned int begin;
+    unsigned int count;
+    unsigned int i;
+    int j;
+
+    if (size == 0) {
+        return false;
+    }
+
+    for (j = 0; j < N; j++) {
+        lower[j] = upper[j] = elements[j][0];
+    }
+
+    for (begin = 0; begin < size; begin += BLOCK_SIZE) {
+        count = std::min(size - begin, static_cast<unsigned int>(BLOCK_SIZE));
+        readBlock(begin, count, sourceBlock, source);
+
+        i = boundsRange<Lanes>(source, 0, count, lower, upper);
+        boundsRange<Lane>(source, i, count, lower, upper);
+    }
+
+    minimum = VectorN<TYPE, N>(lower);
+    maximum = VectorN<TYPE, N>(upper);
+
+    return true;
+}
+
+template<typename TYPE, int N>
+void ConstVectorArray<TYPE, N>::cross(const ConstVectorArray& array, VectorArray<TYPE, N>& out) const {
+    TYPE leftBlock[N * BLOCK_SIZE];
+    TYPE rightBlock[N * BLOCK_SIZE];
+    TYPE destinationBlock[N * BLOCK_SIZE];
+    const TYPE *left[N];
+    const TYPE *right[N];
+    TYPE *destination[N];
+    unsigned int begin;
+    unsigned int count;
+    unsigned int i;
+
+    static_assert(N == 3, "VectorArray::cross needs 3 element vectors");
+    assert(array.size == size);
+
+    prepare(out);
+    for (begin = 0; begin < size; begin += BLOCK_SIZE) {
+        count = std::min(size - begin, static_cast<unsigned int>(BLOCK_SIZE));
+        readBlock(begin, count, leftBlock, left);
+        array.readBlock(begin, count, rightBlock, right);
+        prepareBlock(out, begin, destinationBlock, destination);
+
+        i = crossRange<Lanes>(left, right, destination, 0, count);
+        crossRange<Lane>(left, right, destination, i, count);
+
+        writeBlock(destinationBlock, begin, count, out);
+    }
+}
+
+template<typename TYPE, int N>
+VectorN<TYPE, N> ConstVectorArray<TYPE, N>::operator [](unsigned int index) const {
+    return get(index);
+}
+
+template<typename TYPE, int N>
+void ConstVectorArray<TYPE, N>::prepare(VectorArray<TYPE, N>& out) const {
+    // An array that owns its vectors grows to fit, a view has to be the right size already
+    if (!out.isView()) {
+        out.resize(size);
+    }
+
+    assert(out.getSize() == size);
+}
+
+template<typename TYPE, int N>
+void ConstVectorArray<TYPE, N>::readBlock(unsigned int begin, unsigned int count, TYPE *block, const TYPE **source) const {
+    typename Lanes::Packet lanes[Lanes::SIZE];
+    const TYPE *first;
+    size_t stride;
+    size_t end;
+    unsigned int i;
+    int j;
+
+    if (elementStride == 1) {
+        for (j = 0; j < N; j++) {
+            source[j] = elements[j] + begin;
+        }
+        return;
+    }
+
+    for (j = 0; j < N; j++) {
+        source[j] = block + j * BLOCK_SIZE;
+    }
+
+    // Four vectors at a time are loaded whole and transposed, which reads Lanes::SIZE values of each. That is
+    // past the end of the last vectors when they have fewer elements, those are copied one value at a time.
+    first = elements[0];
+    stride = elementStride;
+    end = (size - 1) * stride + N;
+    i = 0;
+    if (N <= Lanes::SIZE) {
+        for (; (i + Lanes::SIZE <= count) && ((begin + i + Lanes::SIZE - 1) * stride + Lanes::SIZE <= end);
+               i += Lanes::SIZE) {
+            Lanes::transpose(first + (begin + i) * stride, stride, lanes);
+            for (j = 0; j < N; j++) {
+                Lanes::store(block + j * BLOCK_SIZE + i, lanes[j]);
+            }
+        }
+    }
+
+    for (; i < count; i++) {
+        for (j = 0; j < N; j++) {
+            block[j * BLOCK_SIZE + i] = first[(begin + i) * stride + j];
+        }
+    }
+}
+
+template<typename TYPE, int N>
+void ConstVectorArray<TYPE, N>::prepareBlock(VectorArray<TYPE, N>& out, unsigned int begin, TYPE *block,
+                                             TYPE **destination) {
+    int j;
+
+    for (j = 0; j < N; j++) {
+        destination[j] = (out.getElementStride() == 1) ? out.getElements(j) + begin : block + j * BLOCK_SIZE;
+    }
+}
+
+template<typename TYPE, int N>
+void ConstVectorArray<TYPE, N>::writeBlock(const TYPE *block, unsigned int begin, unsigned int count,
+                                           VectorArray<TYPE, N>& out) {
+    TYPE *first;
+    size_t stride;
+    unsigned int i;
+    int j;
+
+    if (out.getElementStride() == 1) {
+        return;
+    }
+
+    // The values between the vectors of a view belong to someone else, so the results go back one at a time
+    first = out.getElements(0);
+    stride = out.getElementStride();
+    for (i = 0; i < count; i++) {
+        for (j = 0; j < N; j++) {
+            first[(begin + i) * stride + j] = block[j * BLOCK_SIZE + i];
+        }
+    }
+}
+
+template<typename TYPE, int N>
+template<typename KERNEL>
+unsigned int ConstVectorArray<TYPE, N>::transformRange(const TYPE *const *source, TYPE *const *destination,
+                                                        unsigned int begin, unsigned int count, const TYPE *matrix,
+                                                        TYPE w) {
+    const TYPE *from[N];
+    TYPE *to[N];
+    typename KERNEL::Packet in[N];
+    typename KERNEL::Packet result;
+    unsigned int i;
+    int row;
+    int j;
+
+    for (j = 0; j < N; j++) {
+        from[j] = source[j];
+        to[j] = destination[j];
+    }
+
+    for (i = begin; i + KERNEL::SIZE <= count; i += KERNEL::SIZE) {
+        // Every element is loaded before any is stored, so the results can replace the vectors
+        for (j = 0; j < N; j++) {
+            in[j] = KERNEL::load(from[j] + i);
+        }
+
+        for (row = 0; row < N; row++) {
+            result = KERNEL::broadcast((N == 3) ? matrix[12 + row] * w : TYPE(0));
+            for (j = 0; j < N; j++) {
+                result = KERNEL::add(result, KERNEL::scale(in[j], matrix[j * 4 + row]));
+            }
+            KERNEL::store(to[row] + i, result);
+        }
+    }
+
+    return i;
+}
+
+template<typename TYPE, int N>
+template<typename KERNEL>
+unsigned int ConstVectorArray<TYPE, N>::normalizeRange(const TYPE *const *source, TYPE *const *destination,
+                                                        unsigned int begin, unsigned int count) {
+    const TYPE *from[N];
+    TYPE *to[N];
+    typename KERNEL::Packet in[N];
+    typename KERNEL::Packet length;
+    typename KERNEL::Packet smallest;
+    unsigned int i;
+    int j;
+
+    for (j = 0; j < N; j++) {
+        from[j] = source[j];
+        to[j] = destination[j];
+    }
+
+    // Dividing by at least the smallest normal value leaves zero vectors at zero
+    smallest = KERNEL::broadcast(std::numeric_limits<TYPE>::min());
+
+    for (i = begin; i + KERNEL::SIZE <= count; i += KERNEL::SIZE) {
+        for (j = 0; j < N; j++) {
+            in[j] = KERNEL::load(from[j] + i);
+        }
+
+        length = KERNEL::multiply(in[0], in[0]);
+        for (j = 1; j < N; j++) {
+            length = KERNEL::add(length, KERNEL::multiply(in[j], in[j]));
+        }
+        length = KERNEL::maximum(KERNEL::squareRoot(length), smallest);
+
+        for (j = 0; j < N; j++) {
+            KERNEL::store(to[j] + i, KERNEL::divide(in[j], length));
+        }
+    }
+
+    return i;
+}
+
+template<typename TYPE, int N>
+template<typename KERNEL>
+unsigned int ConstVectorArray<TYPE, N>::dotRange(const TYPE *const *source, TYPE *out, unsigned int begin,
+                                                  unsigned int count, const VectorN<TYPE, N>& vector) {
+    const TYPE *from[N];
+    TYPE factors[N];
+    typename KERNEL::Packet result;
+    unsigned int i;
+    int j;
+
+    for (j = 0; j < N; j++) {
+        from[j] = source[j];
+        factors[j] = vector[j];
+    }
+
+    for (i = begin; i + KERNEL::SIZE <= count; i += KERNEL::SIZE) {
+        result = KERNEL::scale(KERNEL::load(from[0] + i), factors[0]);
+        for (j = 1; j < N; j++) {
+            result = KERNEL::add(result, KERNEL::scale(KERNEL::load(from[j] + i), factors[j]));
+        }
+
+        KERNEL::store(out + i, result);
+    }
+
+    return i;
+}
+
+template<typename TYPE, int N>
+template<typename KERNEL>
+unsigned int ConstVectorArray<TYPE, N>::boundsRange(const TYPE *const *source, unsigned int begin, unsigned int count,
+                                                     TYPE *minimum, TYPE *maximum) {
+    const TYPE *from[N];
+    typename KERNEL::Packet lower[N];
+    typename KERNEL::Packet upper[N];
+    typename KERNEL::Packet in;
+    TYPE lanes[KERNEL::SIZE];
+    unsigned int i;
+    int j;
+    int k;
+
+    for (j = 0; j < N; j++) {
+        from[j] = source[j];
+        lower[j] = KERNEL::broadcast(minimum[j]);
+        upper[j] = KERNEL::broadcast(maximum[j]);
+    }
+
+    for (i = begin; i + KERNEL::SIZE <= count; i += KERNEL::SIZE) {
+        for (j = 0; j < N; j++) {
+            in = KERNEL::load(from[j] + i);
+            lower[j] = KERNEL::minimum(lower[j], in);
+            upper[j] = KERNEL::maximum(upper[j], in);
+        }
+    }
+
+    // Each lane has the bounds of every KERNEL::SIZE'th vector, combine them
+    for (j = 0; j < N; j++) {
+        KERNEL::store(lanes, lower[j]);
+        for (k = 0; k < KERNEL::SIZE; k++) {
+            minimum[j] = std::min(minimum[j], lanes[k]);
+        }
+
+        KERNEL::store(lanes, upper[j]);
+        for (k = 0; k < KERNEL::SIZE; k++) {
+            maximum[j] = std::max(maximum[j], lanes[k]);
+        }
+    }
+
+    return i;
+}
+
+template<typename TYPE, int N>
+template<typename KERNEL>
+unsigned int ConstVectorArray<TYPE, N>::crossRange(const TYPE *const *left, const TYPE *const *right,
+                                                    TYPE *const *destination, unsigned int begin, unsigned int count) {
+    const TYPE *a[3];
+    const TYPE *b[3];
+    TYPE *to[3];
+    typename KERNEL::Packet ax;
+    typename KERNEL::Packet ay;
+    typename KERNEL::Packet az;
+    typename KERNEL::Packet bx;
+    typename KERNEL::Packet by;
+    typename KERNEL::Packet bz;
+    unsigned int i;
+    int j;
+
+    for (j = 0; j < 3; j++) {
+        a[j] = left[j];
+        b[j] = right[j];
+        to[j] = destination[j];
+    }
+
+    for (i = begin; i + KERNEL::SIZE <= count; i += KERNEL::SIZE) {
+        // Both sides are loaded before anything is stored, so the results can replace either
+        ax = KERNEL::load(a[0] + i);
+        ay = KERNEL::load(a[1] + i);
+        az = KERNEL::load(a[2] + i);
+        bx = KERNEL::load(b[0] + i);
+        by = KERNEL::load(b[1] + i);
+        bz = KERNEL::load(b[2] + i);
+
+        KERNEL::store(to[0] + i, KERNEL::subtract(KERNEL::multiply(ay, bz), KERNEL::multiply(az, by)));
+        KERNEL::store(to[1] + i, KERNEL::subtract(KERNEL::multiply(az, bx), KERNEL::multiply(ax, bz)));
+        KERNEL::store(to[2] + i, KERNEL::subtract(KERNEL::multiply(ax, by), KERNEL::multiply(ay, bx)));
+    }
+
+    return i;
+}
+
+template<typename TYPE, int N>
+VectorArray<TYPE, N>::VectorArray() {
+    setupElements();
+}
+
+template<typename TYPE, int N>
+VectorArray<TYPE, N>::VectorArray(unsigned int size)
+    : storage(static_cast<size_t>(size) * N)
+{
+    this->size = size;
+    setupElements();
+}
+
+template<typename TYPE, int N>
+VectorArray<TYPE, N>::VectorArray(TYPE *data, unsigned int size, size_t stride)
+    : ConstVectorArray<TYPE, N>(data, size, stride)
+{
+    int i;
+
+    for (i = 0; i < N; i++) {
+        writableElements[i] = data + i;
+    }
+}
+
+template<typename TYPE, int N>
+VectorArray<TYPE, N>::VectorArray(const VectorArray& array)
+    : ConstVectorArray<TYPE, N>(array), storage(array.storage)
+{
+    int i;
+
+    if (this->view) {
+        for (i = 0; i < N; i++) {
+            writableElements[i] = array.writableElements[i];
+        }
+    }
+    else {
+        setupElements();
+    }
+}
+
+template<typename TYPE, int N>
+void VectorArray<TYPE, N>::setupElements() {
+    int i;
+
+    for (i = 0; i < N; i++) {
+        writableElements[i] = storage.data() + static_cast<size_t>(i) * this->size;
+        this->elements[i] = writableElements[i];
+    }
+}
+
+template<typename TYPE, int N>
+void VectorArray<TYPE, N>::resize(unsigned int size) {
+    std::vector<TYPE> resized;
+    int i;
+
+    assert(!this->view);
+
+    if (size == this->size) {
+        return;
+    }
+
+    // Every element array moves when the size changes, so the vectors are copied element by element
+    resized.resize(static_cast<size_t>(size) * N);
+    for (i = 0; i < N; i++) {
+        std::copy(this->elements[i], this->elements[i] + std::min(size, this->size),
+                  resized.begin() + static_cast<size_t>(i) * size);
+    }
+
+    storage.swap(resized);
+    this->size = size;
+    setupElements();
+}
+
+template<typename TYPE, int N>
+void VectorArray<TYPE, N>::set(unsigned int index, const VectorN<TYPE, N>& vector) {
+    int i;
+
+    assert(index < this->size);
+
+    for (i = 0; i < N; i++) {
+        writableElements[i][index * this->elementStride] = vector[i];
+    }
+}
+
+template<typename TYPE, int N>
+TYPE* VectorArray<TYPE, N>::getElements(int element) {
+    assert((element >= 0) && (element < N));
+
+    return writableElements[element];
+}
+
+template<typename TYPE, int N>
+VectorArray<TYPE, N>& VectorArray<TYPE, N>::operator =(const VectorArray& array) {
+    int i;
+
+    if (&array == this) {
+        return *this;
+    }
+
+    ConstVectorArray<TYPE, N>::operator =(array);
+    storage = array.storage;
+
+    if (this->view) {
+        for (i = 0; i < N; i++) {
+            writableElements[i] = array.writableElements[i];
+        }
+    }
+    else {
+        setupElements();
+    }
+
+    return *this;
+}
+
+#endif // __VECTOR_ARRAY_H__
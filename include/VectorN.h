@@ -30,17 +30,43 @@
 
 #include <math.h>
 #include <assert.h>
+#include <cstddef>
 #include <sstream>
 #include <string>
 
+#include "VectorNExpression.h"
+#include "VectorNSimd.h"
+
+template <int... INDICES>
+/** A list of element indices, to initialize every element of a vector in a constexpr constructor */
+struct VectorNIndices {
+};
+
+template <int COUNT, int... INDICES>
+/** Builds VectorNIndices<0, 1, ..., COUNT - 1> as type */
+struct VectorNMakeIndices : VectorNMakeIndices<COUNT - 1, COUNT - 1, INDICES...> {
+};
+
+template <int... INDICES>
+struct VectorNMakeIndices<0, INDICES...> {
+    typedef VectorNIndices<INDICES...> type;
+};
+
 template <typename TYPE, int N>
 /** A templated n-dimensional vector class
+ *
+ * The arithmetic is done by VectorNKernel, which uses SSE, AVX or NEON for Vector3f, Vector4f and
+ * Vector4d. A Vector3f is padded to four floats to fill a register.
+ *
+ * The +, - and scalar * and / operators come from VectorNExpression and build lazy expressions, which are
+ * computed in one pass when they are assigned to a vector. The constructors are constexpr, so constant
+ * vectors, and vectors built from them with the operators, are computed at compile time.
  * \author ME Chamberlain
  */
-class VectorN {
+class VectorN : public VectorNExpression<VectorN<TYPE, N>, TYPE, N> {
 public:
     /** Constructs the zero vector */
-    VectorN();
+    constexpr VectorN();
 
     /** Constructs a vector with the given values
      * @param v0 The first element of the vector
@@ -48,12 +74,19 @@ public:
      * @param v2 The third element of the vector
      * @param v3 The fourth element of the vector
      */
-    VectorN(TYPE v0, TYPE v1 = 0, TYPE v2 = 0, TYPE v3 = 0);
+    constexpr VectorN(TYPE v0, TYPE v1 = 0, TYPE v2 = 0, TYPE v3 = 0);
 
     /** Constructs a vector from another vector
      * \param v The vector to copy
      */
-    VectorN(const VectorN &v);
+    VectorN(const VectorN &v) = default;
+
+    template <typename EXPRESSION>
+    /** Constructs a vector from an expression, computing each element in turn. This is constexpr
+     * so that expressions of constant vectors fold at compile time.
+     * \param expression The expression to compute
+     */
+    constexpr VectorN(const VectorNExpression<EXPRESSION, TYPE, N>& expression);
 
     /** Constructs a vector from an array
      * \param arr The array to copy the vector values from
@@ -66,7 +99,7 @@ public:
      * @param index The index of the value to fetch.
      * @return A copy of the value at index.
      */
-    TYPE get(int index) const;
+    constexpr TYPE get(int index) const;
 
     /** Sets the value at the given index to the value specified.
      * @param index The index of the entry to set.
@@ -152,47 +185,36 @@ public:
 
     /* ===================== OPERATORS ===================== */
 
-    /** The + operator. Adds the values of one vector to another */
-	inline VectorN operator +(const VectorN &p) const;
-
     /** The = operator. Assign a vector to this instance. */
-    void operator =(const VectorN& vector);
+    VectorN& operator =(const VectorN& vector) = default;
+
+    template <typename EXPRESSION>
+    /** The = operator. Computes an expression into this instance, the whole vector at once. */
+    VectorN& operator =(const VectorNExpression<EXPRESSION, TYPE, N>& expression);
 
+    template <typename EXPRESSION>
     /** The += operator. Adds the values of the specified vector to this
      * one in place.
      */
-    void operator +=(const VectorN& vector);
-
-    /** The - operator. Subtracts the values of the specified vector from this one */
-	inline VectorN operator -(const VectorN &p) const;
+    VectorN& operator +=(const VectorNExpression<EXPRESSION, TYPE, N>& vector);
 
+    template <typename EXPRESSION>
     /** The -= operator. Subtracts the values of the specified vector from this
      * one in place.
      */
-    void operator -=(const VectorN& vector);
-
-    /** Negate all the elements in this vector and return the result
-     * without changing the vector.
-     */
-    inline VectorN operator-() const;
-
-    /** Scale a vector and return the result without changing the vector. */
-    inline VectorN operator *(const TYPE& scalar) const;
+    VectorN& operator -=(const VectorNExpression<EXPRESSION, TYPE, N>& vector);
 
     /** Scale this vector */
-    void operator *=(const TYPE& scalar);
-
-    /** Inverse scale a vector and return the result without changing the vector. */
-    inline VectorN operator /(const TYPE& scalar) const;
+    VectorN& operator *=(const TYPE& scalar);
 
     /** Inverse scale this vector */
-    void operator /=(const TYPE& scalar);
+    VectorN& operator /=(const TYPE& scalar);
 
     /** Returns a reference to the value at the specified index in this vector. */
     TYPE& operator [](int index);
 
     /** Returns a constant reference to the value at the specified index in this vector. */
-    const TYPE& operator [](int index) const;
+    constexpr const TYPE& operator [](int index) const;
 
     /** Test two vectors for equality. True iff every corresponding entry in the vectors are equal. */
     bool operator ==(const VectorN& vector) const;
@@ -200,9 +222,35 @@ public:
     /** Test two vectors for inequality. True iff any corresponding entries in the vectors are inequal. */
     bool operator !=(const VectorN& vector) const;
 
+    /* ================ EXPRESSION EVALUATION ================ */
+
+    /** Returns the value at the given index, as every expression does. */
+    constexpr TYPE coeff(int index) const;
+
+    /** Loads the whole vector into registers, as every expression does. */
+    typename VectorNKernel<TYPE, N>::Packet packet() const;
+
 protected:
-    /** The vector data */
-    TYPE vec[N];
+    /** The operations on the vector data */
+    typedef VectorNKernel<TYPE, N> Kernel;
+
+    /** The vector data, padded and aligned to suit Kernel. The alignment is capped at what new and
+     * std::allocator guarantee, since C++11 does not honour more, so a 32 byte AVX vector is only 16 byte
+     * aligned; the kernels load and store unaligned. */
+    alignas(Kernel::ALIGNMENT < alignof(std::max_align_t) ? static_cast<size_t>(Kernel::ALIGNMENT) : alignof(std::max_align_t))
+    TYPE vec[Kernel::SIZE];
+
+private:
+    template <int... INDICES>
+    /** Initializes every element, the padding included, from the given values */
+    constexpr VectorN(VectorNIndices<INDICES...>, TYPE v0, TYPE v1, TYPE v2, TYPE v3);
+
+    template <typename EXPRESSION, int... INDICES>
+    /** Initializes every element, the padding included, from an expression */
+    constexpr VectorN(VectorNIndices<INDICES...>, const EXPRESSION& expression);
+
+    /** Picks the value of an element from the values given to the constructor, 0 past them and for the padding */
+    static constexpr TYPE element(int index, TYPE v0, TYPE v1, TYPE v2, TYPE v3);
 };
 
 
@@ -229,41 +277,41 @@ typedef VectorN<int,4>      Vector4i;
 
 // ====== IMPLEMENTATION ======
 template<typename TYPE, int N>
-VectorN<TYPE, N>::VectorN() {
-    int i;
-
-    for (i = 0; i < N; i++) {
-        vec[i] = 0;
-    }
+constexpr VectorN<TYPE, N>::VectorN()
+    : vec()
+{
 }
 
 template<typename TYPE, int N>
-VectorN<TYPE, N>::VectorN(TYPE v0, TYPE v1, TYPE v2, TYPE v3) {
-    if (N >= 1) {
-        vec[0] = v0;
-    }
-
-    if (N >= 2) {
-        vec[1] = v1;
-    }
-
-    if (N >= 3) {
-        vec[2] = v2;
-    }
+constexpr VectorN<TYPE, N>::VectorN(TYPE v0, TYPE v1, TYPE v2, TYPE v3)
+    : VectorN(typename VectorNMakeIndices<Kernel::SIZE>::type(), v0, v1, v2, v3)
+{
+}
 
-    if (N >= 4) {
-        vec[3] = v3;
-    }
+template<typename TYPE, int N>
+template<typename EXPRESSION>
+constexpr VectorN<TYPE, N>::VectorN(const VectorNExpression<EXPRESSION, TYPE, N>& expression)
+    : VectorN(typename VectorNMakeIndices<Kernel::SIZE>::type(), expression.derived())
+{
+}
 
+template<typename TYPE, int N>
+template<int... INDICES>
+constexpr VectorN<TYPE, N>::VectorN(VectorNIndices<INDICES...>, TYPE v0, TYPE v1, TYPE v2, TYPE v3)
+    : vec{ element(INDICES, v0, v1, v2, v3)... }
+{
 }
 
 template<typename TYPE, int N>
-VectorN<TYPE, N>::VectorN(const VectorN &v) {
-    int i;
+template<typename EXPRESSION, int... INDICES>
+constexpr VectorN<TYPE, N>::VectorN(VectorNIndices<INDICES...>, const EXPRESSION& expression)
+    : vec{ expression.coeff(INDICES)... }
+{
+}
 
-    for (i = 0; i < N; i++) {
-        vec[i] = v.get(i);
-    }
+template<typename TYPE, int N>
+constexpr TYPE VectorN<TYPE, N>::element(int index, TYPE v0, TYPE v1, TYPE v2, TYPE v3) {
+    return (index >= N) ? TYPE(0) : (index == 0) ? v0 : (index == 1) ? v1 : (index == 2) ? v2 : (index == 3) ? v3 : TYPE(0);
 }
 
 template<typename TYPE, int N>
@@ -276,13 +324,15 @@ VectorN<TYPE, N>::VectorN(const TYPE *arr) {
     for (i = 0; i < N; i++) {
         vec[i] = arr[i];
     }
+
+    for (i = N; i < Kernel::SIZE; i++) {
+        vec[i] = 0;
+    }
 }
 
 template<typename TYPE, int N>
-TYPE VectorN<TYPE, N>::get(int index) const {
-   assert(index < N);
-
-   return vec[index];
+constexpr TYPE VectorN<TYPE, N>::get(int index) const {
+    return assert(index < N), vec[index];
 }
 
 template<typename TYPE, int N>
@@ -330,252 +380,246 @@ void VectorN<TYPE, N>::copyTo(TYPE* arr) const {
 
 template<typename TYPE, int N>
 void VectorN<TYPE, N>::setZero() {
-    int i;
-
-    for (i = 0; i < N; i++) {
-        vec[i] = 0;
-    }
+    Kernel::zero(vec);
 }
 
 template<typename TYPE, int N>
 bool VectorN<TYPE, N>::isZero() const {
-    int i;
-
-    for (i = 0; i < N; i++) {
-        if (vec[i] != 0) {
-            return false;
-        }
-    }
-
-    return true;
+    return Kernel::isZero(vec);
 }
 
 template<typename TYPE, int N>
 TYPE VectorN<TYPE, N>::length() const {
-    TYPE len;
-    int i;
-
-    len = vec[0] * vec[0];
-
-    for (i = 1; i < N; i++) {
-        len += vec[i] * vec[i];
-    }
-
-    return (TYPE) sqrt(len);
+    return (TYPE) sqrt(Kernel::dot(vec, vec));
 }
 
 template<typename TYPE, int N>
 TYPE VectorN<TYPE, N>::lengthSq() const {
-    TYPE len;
-    int i;
-
-    len = vec[0] * vec[0];
-
-    for (i = 1; i < N; i++) {
-        len += vec[i] * vec[i];
-    }
-
-    return len;
+    return Kernel::dot(vec, vec);
 }
 
 template<typename TYPE, int N>
 void VectorN<TYPE, N>::setLength(const TYPE &length) {
-    int i;
-
     unitize();
 
-    for (i = 0; i < N; i++) {
-        vec[i] *= length;
-    }
+    *this *= length;
 }
 
 template<typename TYPE, int N>
 void VectorN<TYPE, N>::unitize() {
     TYPE len;
-    int i;
 
     len = length();
 
     assert(len != 0);
 
-    for (i = 0; i < N; i++) {
-        vec[i] /= len;
-    }
+    *this /= len;
 }
 
 template<typename TYPE, int N>
 TYPE VectorN<TYPE, N>::distanceTo(const VectorN& vector) const {
-    VectorN diff = (vector - *this);
+    VectorN diff;
+
+    diff = vector - *this;
 
     return diff.length();
 }
 
 template<typename TYPE, int N>
 TYPE VectorN<TYPE, N>::distanceToSq(const VectorN& vector) const {
-    VectorN diff = (vector - *this);
+    VectorN diff;
+
+    diff = vector - *this;
 
     return diff.lengthSq();
 }
 
 template<typename TYPE, int N>
 TYPE VectorN<TYPE, N>::dot(const VectorN& vector) const {
-    TYPE dotProduct;
-    int i;
-
-    dotProduct = vec[0] * vector.get(0);
-    for (i = 1; i < N; i++) {
-        dotProduct += vec[i] * vector.get(i);
-    }
-
-    return dotProduct;
+    return Kernel::dot(vec, vector.vec);
 }
 
 /* ===================== OPERATORS ===================== */
 
 template<typename TYPE, int N>
-inline VectorN<TYPE, N> VectorN<TYPE, N>::operator +(const VectorN &p) const {
-    VectorN result;
-    int i;
+template<typename EXPRESSION>
+VectorN<TYPE, N>& VectorN<TYPE, N>::operator =(const VectorNExpression<EXPRESSION, TYPE, N>& expression) {
+    Kernel::store(vec, expression.derived().packet());
 
-    for (i = 0; i < N; i++) {
-        result.set(i, vec[i] + p.get(i));
-    }
+    return *this;
+}
 
-    return result;
+template<typename TYPE, int N>
+template<typename EXPRESSION>
+VectorN<TYPE, N>& VectorN<TYPE, N>::operator +=(const VectorNExpression<EXPRESSION, TYPE, N>& vector) {
+    Kernel::store(vec, Kernel::add(Kernel::load(vec), vector.derived().packet()));
+
+    return *this;
 }
 
 template<typename TYPE, int N>
-void VectorN<TYPE, N>::operator =(const VectorN& vector) {
-    int i;
+template<typename EXPRESSION>
+VectorN<TYPE, N>& VectorN<TYPE, N>::operator -=(const VectorNExpression<EXPRESSION, TYPE, N>& vector) {
+    Kernel::store(vec, Kernel::subtract(Kernel::load(vec), vector.derived().packet()));
 
-    for (i = 0; i < N; i++) {
-        vec[i] = vector.get(i);
-    }
+    return *this;
 }
 
 template<typename TYPE, int N>
-void VectorN<TYPE, N>::operator +=(const VectorN& vector) {
-    int i;
+VectorN<TYPE, N>& VectorN<TYPE, N>::operator *=(const TYPE& scalar) {
+    Kernel::store(vec, Kernel::scale(Kernel::load(vec), scalar));
 
-    for (i = 0; i < N; i++) {
-        vec[i] += vector.get(i);
-    }
+    return *this;
 }
 
 template<typename TYPE, int N>
-inline VectorN<TYPE, N> VectorN<TYPE, N>::operator -(const VectorN &p) const {
-    VectorN result;
-    int i;
+VectorN<TYPE, N>& VectorN<TYPE, N>::operator /=(const TYPE& scalar) {
+    Kernel::store(vec, Kernel::divide(Kernel::load(vec), scalar));
 
-    for (i = 0; i < N; i++) {
-        result.set(i, vec[i] - p.get(i));
-    }
+    return *this;
+}
 
-    return result;
+template<typename TYPE, int N>
+TYPE& VectorN<TYPE, N>::operator [](int index) {
+    assert(((index >= 0) && (index < N)));
+
+    return vec[index];
 }
 
 template<typename TYPE, int N>
-void VectorN<TYPE, N>::operator -=(const VectorN& vector) {
-    int i;
+constexpr const TYPE& VectorN<TYPE, N>::operator [](int index) const {
+    return assert(((index >= 0) && (index < N))), vec[index];
+}
 
-    for (i = 0; i < N; i++) {
-        vec[i] -= vector.get(i);
-    }
+template<typename TYPE, int N>
+bool VectorN<TYPE, N>::operator ==(const VectorN& vector) const {
+    return Kernel::equal(vec, vector.vec);
 }
 
 template<typename TYPE, int N>
-inline VectorN<TYPE, N> VectorN<TYPE, N>::operator-() const {
-    VectorN result;
-    int i;
+bool VectorN<TYPE, N>::operator !=(const VectorN& vector) const {
+    return !Kernel::equal(vec, vector.vec);
+}
 
-    for (i = 0; i < N; i++) {
-        result.set(i, -vec[i]);
-    }
+/* ================ EXPRESSION EVALUATION ================ */
 
-    return result;
+template<typename TYPE, int N>
+constexpr TYPE VectorN<TYPE, N>::coeff(int index) const {
+    return vec[index];
 }
 
 template<typename TYPE, int N>
-inline VectorN<TYPE, N> VectorN<TYPE, N>::operator *(const TYPE& scalar) const {
-    VectorN result;
-    int i;
+typename VectorNKernel<TYPE, N>::Packet VectorN<TYPE, N>::packet() const {
+    return Kernel::load(vec);
+}
 
-    for (i = 0; i < N; i++) {
-        result.set(i, vec[i] * scalar);
-    }
+template<typename DERIVED, typename TYPE, int N>
+VectorN<TYPE, N> VectorNExpression<DERIVED, TYPE, N>::evaluate() const {
+    VectorN<TYPE, N> result;
+
+    result = *this;
 
     return result;
 }
 
-template<typename TYPE, int N>
-void VectorN<TYPE, N>::operator *=(const TYPE& scalar) {
-    int i;
+template<typename DERIVED, typename TYPE, int N>
+TYPE VectorNExpression<DERIVED, TYPE, N>::get(int index) const {
+    return evaluate().get(index);
+}
 
-    for (i = 0; i < N; i++) {
-        vec[i] *= scalar;
-    }
+template<typename DERIVED, typename TYPE, int N>
+TYPE VectorNExpression<DERIVED, TYPE, N>::operator [](int index) const {
+    return evaluate()[index];
 }
 
-template<typename TYPE, int N>
-inline VectorN<TYPE, N> VectorN<TYPE, N>::operator /(const TYPE& scalar) const {
-    VectorN result;
-    int i;
+template<typename DERIVED, typename TYPE, int N>
+std::string VectorNExpression<DERIVED, TYPE, N>::toString() const {
+    return evaluate().toString();
+}
 
-    for (i = 0; i < N; i++) {
-        result.set(i, vec[i] / scalar);
-    }
+template<typename DERIVED, typename TYPE, int N>
+void VectorNExpression<DERIVED, TYPE, N>::copyTo(TYPE* arr) const {
+    evaluate().copyTo(arr);
+}
 
-    return result;
+template<typename DERIVED, typename TYPE, int N>
+bool VectorNExpression<DERIVED, TYPE, N>::isZero() const {
+    return evaluate().isZero();
 }
 
-template<typename TYPE, int N>
-void VectorN<TYPE, N>::operator /=(const TYPE& scalar) {
-    int i;
+template<typename DERIVED, typename TYPE, int N>
+TYPE VectorNExpression<DERIVED, TYPE, N>::length() const {
+    return evaluate().length();
+}
 
-    for (i = 0; i < N; i++) {
-        vec[i] /= scalar;
-    }
+template<typename DERIVED, typename TYPE, int N>
+TYPE VectorNExpression<DERIVED, TYPE, N>::lengthSq() const {
+    return evaluate().lengthSq();
 }
 
-template<typename TYPE, int N>
-TYPE& VectorN<TYPE, N>::operator [](int index) {
-    assert(((index >= 0) && (index < N)));
+template<typename DERIVED, typename TYPE, int N>
+TYPE VectorNExpression<DERIVED, TYPE, N>::distanceTo(const VectorN<TYPE, N>& vector) const {
+    return evaluate().distanceTo(vector);
+}
 
-    return vec[index];
+template<typename DERIVED, typename TYPE, int N>
+TYPE VectorNExpression<DERIVED, TYPE, N>::distanceToSq(const VectorN<TYPE, N>& vector) const {
+    return evaluate().distanceToSq(vector);
 }
 
-template<typename TYPE, int N>
-const TYPE& VectorN<TYPE, N>::operator [](int index) const {
-    assert(((index >= 0) && (index < N)));
+template<typename DERIVED, typename TYPE, int N>
+TYPE VectorNExpression<DERIVED, TYPE, N>::dot(const VectorN<TYPE, N>& vector) const {
+    return evaluate().dot(vector);
+}
 
-    return vec[index];
+template<typename DERIVED, typename TYPE, int N>
+VectorN<TYPE, N> VectorNExpression<DERIVED, TYPE, N>::cross(const VectorN<TYPE, N>& vector) const {
+    return evaluate().cross(vector);
 }
 
-template<typename TYPE, int N>
-bool VectorN<TYPE, N>::operator ==(const VectorN& vector) const {
-    int i;
+template<typename DERIVED, typename TYPE, int N>
+VectorN<TYPE, N> VectorNExpression<DERIVED, TYPE, N>::perp() const {
+    return evaluate().perp();
+}
 
-    for (i = 0; i < N; i++) {
-        if (vec[i] != vector.get(i)) {
-            return false;
-        }
-    }
+template<typename DERIVED, typename TYPE, int N>
+bool VectorNExpression<DERIVED, TYPE, N>::operator ==(const VectorN<TYPE, N>& vector) const {
+    return evaluate() == vector;
+}
 
-    return true;
+template<typename DERIVED, typename TYPE, int N>
+bool VectorNExpression<DERIVED, TYPE, N>::operator !=(const VectorN<TYPE, N>& vector) const {
+    return evaluate() != vector;
 }
 
-template<typename TYPE, int N>
-bool VectorN<TYPE, N>::operator !=(const VectorN& vector) const {
-    int i;
+/* ================ TYPE SPECIFIC METHODS ================ */
 
-    for (i = 0; i < N; i++) {
-        if (vec[i] != vector.get(i)) {
-            return true;
-        }
-    }
+// The other cross and perp specializations are in VectorN.cpp
+template<>
+Vector3d Vector3d::cross(const Vector3d& vector) const;
+
+template<>
+Vector2i Vector2i::perp() const;
 
-    return false;
+template<>
+Vector2f Vector2f::perp() const;
+
+template<>
+Vector2d Vector2d::perp() const;
+
+#if defined(VECTORN_SIMD_FLOAT)
+template<>
+inline Vector3f Vector3f::cross(const Vector3f& vector) const {
+    Vector3f result;
+
+    Kernel::cross(vec, vector.vec, result.vec);
+
+    return result;
 }
+#else
+template<>
+Vector3f Vector3f::cross(const Vector3f& vector) const;
+#endif
 
 #endif // __VECTORN_H__
 
@@ -0,0 +1,281 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/** \file
+ * \brief Lazy expressions of VectorN arithmetic
+ * \author ME Chamberlain
+ */
+
+#ifndef __VECTORN_EXPRESSION_H__
+#define __VECTORN_EXPRESSION_H__
+
+#include <string>
+
+#include "VectorNSimd.h"
+
+template <typename TYPE, int N>
+class VectorN;
+
+template <typename LEFT, typename RIGHT, typename TYPE, int N>
+class VectorNSum;
+
+template <typename LEFT, typename RIGHT, typename TYPE, int N>
+class VectorNDifference;
+
+template <typename OPERAND, typename TYPE, int N>
+class VectorNNegation;
+
+template <typename OPERAND, typename TYPE, int N>
+class VectorNProduct;
+
+template <typename OPERAND, typename TYPE, int N>
+class VectorNQuotient;
+
+template <typename EXPRESSION>
+/** How an expression holds an operand. Expressions are small and held by value */
+struct VectorNOperand {
+    typedef const EXPRESSION type;
+};
+
+template <typename TYPE, int N>
+/** Vectors are held by reference, an expression is evaluated within the statement that builds it */
+struct VectorNOperand<VectorN<TYPE, N> > {
+    typedef const VectorN<TYPE, N>& type;
+};
+
+template <typename DERIVED, typename TYPE, int N>
+/** The base of VectorN and of the expressions its operators build.
+ *
+ * The +, - and scalar * and / operators don't compute anything, they return an expression holding their
+ * operands. Assigning the expression to a VectorN, or constructing one from it, then computes every
+ * element in one go, so a + b * s - c needs no temporary vectors. The expressions are evaluated in two
+ * ways:
+ * - coeff(index) computes one element and is constexpr, so that vectors built from constant vectors fold
+ *   at compile time. Constructing a VectorN from an expression uses it.
+ * - packet() computes the whole vector in registers with VectorNKernel. Assigning an expression to a
+ *   VectorN, and the compound assignments, use it.
+ *
+ * The other const methods of VectorN are available on an expression too, they evaluate it first. An
+ * expression holds references to the vectors in it, so it must not outlive them, and storing one with
+ * auto is best avoided.
+ * \author ME Chamberlain
+ */
+class VectorNExpression {
+public:
+    /** Returns the expression as its actual type. */
+    constexpr const DERIVED& derived() const {
+        return static_cast<const DERIVED&>(*this);
+    }
+
+    /** Evaluates the expression into a vector. */
+    VectorN<TYPE, N> evaluate() const;
+
+    /* ===================== OPERATORS ===================== */
+
+    template <typename RIGHT>
+    /** The + operator. Adds the values of one vector to another */
+    constexpr VectorNSum<DERIVED, RIGHT, TYPE, N> operator +(const VectorNExpression<RIGHT, TYPE, N>& right) const {
+        return VectorNSum<DERIVED, RIGHT, TYPE, N>(derived(), right.derived());
+    }
+
+    template <typename RIGHT>
+    /** The - operator. Subtracts the values of the specified vector from this one */
+    constexpr VectorNDifference<DERIVED, RIGHT, TYPE, N> operator -(const VectorNExpression<RIGHT, TYPE, N>& right) const {
+        return VectorNDifference<DERIVED, RIGHT, TYPE, N>(derived(), right.derived());
+    }
+
+    /** Negate all the elements in this vector and return the result
+     * without changing the vector.
+     */
+    constexpr VectorNNegation<DERIVED, TYPE, N> operator -() const {
+        return VectorNNegation<DERIVED, TYPE, N>(derived());
+    }
+
+    /** Scale a vector and return the result without changing the vector. */
+    constexpr VectorNProduct<DERIVED, TYPE, N> operator *(const TYPE& scalar) const {
+        return VectorNProduct<DERIVED, TYPE, N>(derived(), scalar);
+    }
+
+    /** Inverse scale a vector and return the result without changing the vector. */
+    constexpr VectorNQuotient<DERIVED, TYPE, N> operator /(const TYPE& scalar) const {
+        return VectorNQuotient<DERIVED, TYPE, N>(derived(), scalar);
+    }
+
+    /* ================ EVALUATED ACCESSORS ================ */
+
+    /** Gets the value at the given index. */
+    TYPE get(int index) const;
+
+    /** Returns the value at the specified index. */
+    TYPE operator [](int index) const;
+
+    /** Creates a string representation of the vector. */
+    std::string toString() const;
+
+    /** Copies the values to an array. */
+    void copyTo(TYPE* arr) const;
+
+    /** Test whether this is the zero vector. */
+    bool isZero() const;
+
+    /** Returns the length. */
+    TYPE length() const;
+
+    /** Returns the length squared. */
+    TYPE lengthSq() const;
+
+    /** Calculates the distance to the vector specified. */
+    TYPE distanceTo(const VectorN<TYPE, N>& vector) const;
+
+    /** Calculates the square of the distance to the vector specified. */
+    TYPE distanceToSq(const VectorN<TYPE, N>& vector) const;
+
+    /** Calculates the dot product with the vector specified. */
+    TYPE dot(const VectorN<TYPE, N>& vector) const;
+
+    /** Computes the cross product with the vector specified. */
+    VectorN<TYPE, N> cross(const VectorN<TYPE, N>& vector) const;
+
+    /** Returns a vector perpendicular to this one. */
+    VectorN<TYPE, N> perp() const;
+
+    /** Test for equality with a vector. */
+    bool operator ==(const VectorN<TYPE, N>& vector) const;
+
+    /** Test for inequality with a vector. */
+    bool operator !=(const VectorN<TYPE, N>& vector) const;
+};
+
+template <typename LEFT, typename RIGHT, typename TYPE, int N>
+/** The sum of two vector expressions */
+class VectorNSum : public VectorNExpression<VectorNSum<LEFT, RIGHT, TYPE, N>, TYPE, N> {
+public:
+    constexpr VectorNSum(const LEFT& left, const RIGHT& right)
+        : left(left),
+          right(right)
+    {
+    }
+
+    constexpr TYPE coeff(int index) const {
+        return left.coeff(index) + right.coeff(index);
+    }
+
+    typename VectorNKernel<TYPE, N>::Packet packet() const {
+        return VectorNKernel<TYPE, N>::add(left.packet(), right.packet());
+    }
+
+private:
+    typename VectorNOperand<LEFT>::type left;
+    typename VectorNOperand<RIGHT>::type right;
+};
+
+template <typename LEFT, typename RIGHT, typename TYPE, int N>
+/** The difference of two vector expressions */
+class VectorNDifference : public VectorNExpression<VectorNDifference<LEFT, RIGHT, TYPE, N>, TYPE, N> {
+public:
+    constexpr VectorNDifference(const LEFT& left, const RIGHT& right)
+        : left(left),
+          right(right)
+    {
+    }
+
+    constexpr TYPE coeff(int index) const {
+        return left.coeff(index) - right.coeff(index);
+    }
+
+    typename VectorNKernel<TYPE, N>::Packet packet() const {
+        return VectorNKernel<TYPE, N>::subtract(left.packet(), right.packet());
+    }
+
+private:
+    typename VectorNOperand<LEFT>::type left;
+    typename VectorNOperand<RIGHT>::type right;
+};
+
+template <typename OPERAND, typename TYPE, int N>
+/** A negated vector expression */
+class VectorNNegation : public VectorNExpression<VectorNNegation<OPERAND, TYPE, N>, TYPE, N> {
+public:
+    constexpr explicit VectorNNegation(const OPERAND& operand)
+        : operand(operand)
+    {
+    }
+
+    constexpr TYPE coeff(int index) const {
+        return -operand.coeff(index);
+    }
+
+    typename VectorNKernel<TYPE, N>::Packet packet() const {
+        return VectorNKernel<TYPE, N>::negate(operand.packet());
+    }
+
+private:
+    typename VectorNOperand<OPERAND>::type operand;
+};
+
+template <typename OPERAND, typename TYPE, int N>
+/** A vector expression multiplied by a scalar */
+class VectorNProduct : public VectorNExpression<VectorNProduct<OPERAND, TYPE, N>, TYPE, N> {
+public:
+    constexpr VectorNProduct(const OPERAND& operand, const TYPE& scalar)
+        : operand(operand),
+          scalar(scalar)
+    {
+    }
+
+    constexpr TYPE coeff(int index) const {
+        return operand.coeff(index) * scalar;
+    }
+
+    typename VectorNKernel<TYPE, N>::Packet packet() const {
+        return VectorNKernel<TYPE, N>::scale(operand.packet(), scalar);
+    }
+
+private:
+    typename VectorNOperand<OPERAND>::type operand;
+    TYPE scalar;
+};
+
+template <typename OPERAND, typename TYPE, int N>
+/** A vector expression divided by a scalar */
+class VectorNQuotient : public VectorNExpression<VectorNQuotient<OPERAND, TYPE, N>, TYPE, N> {
+public:
+    constexpr VectorNQuotient(const OPERAND& operand, const TYPE& scalar)
+        : operand(operand),
+          scalar(scalar)
+    {
+    }
+
+    constexpr TYPE coeff(int index) const {
+        return operand.coeff(index) / scalar;
+    }
+
+    typename VectorNKernel<TYPE, N>::Packet packet() const {
+        return VectorNKernel<TYPE, N>::divide(operand.packet(), scalar);
+    }
+
+private:
+    typename VectorNOperand<OPERAND>::type operand;
+    TYPE scalar;
+};
+
+#endif // __VECTORN_EXPRESSION_H__
@@ -0,0 +1,816 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+/** \file
+ * \brief The element-wise operations behind VectorN, with SIMD versions for the 3 and 4 element float
+ * vectors and the 4 element double vector
+ * \author ME Chamberlain
+ */
+
+#ifndef __VECTORN_SIMD_H__
+#define __VECTORN_SIMD_H__
+
+#include <math.h>
+#include <stddef.h>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#if defined(__AVX__)
+#include <immintrin.h>
+#endif
+/** Defined when the float vectors have SIMD kernels, including the cross product of Vector3f */
+#define VECTORN_SIMD_FLOAT
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+/** Defined when the float vectors have SIMD kernels, including the cross product of Vector3f */
+#define VECTORN_SIMD_FLOAT
+#endif
+
+template <typename TYPE, int SIZE>
+/** The elements of a vector held as a value, the packet of the generic kernel
+ * \author ME Chamberlain
+ */
+struct VectorNPacket {
+    TYPE elements[SIZE];
+};
+
+template <typename TYPE, int N>
+/** The operations VectorN performs on its elements. This generic version goes through the elements one
+ * at a time, the specializations below handle the whole vector at once with SSE, AVX or NEON.
+ *
+ * The element-wise arithmetic works on a Packet, the whole vector loaded into registers, so that an
+ * expression of several operations loads each operand and stores the result only once. The reductions
+ * work on the stored elements.
+ *
+ * A vector is stored as SIZE elements, which may be more than N so that it fills a whole register. The
+ * padding elements carry no meaning, the reductions ignore them.
+ *
+ * The transpose, the operations between two packets, and the square root, minimum and maximum are for
+ * VectorArray, which fills a packet with the same element of SIZE different vectors.
+ * \author ME Chamberlain
+ */
+struct VectorNKernel {
+    /** The number of elements stored, padding included */
+    enum { SIZE = N };
+    /** The alignment of the stored elements, in bytes */
+    enum { ALIGNMENT = alignof(TYPE) };
+
+    /** A whole vector in registers */
+    typedef VectorNPacket<TYPE, SIZE> Packet;
+
+    static inline Packet load(const TYPE *a) {
+        Packet result;
+        int i;
+
+        for (i = 0; i < SIZE; i++) {
+            result.elements[i] = a[i];
+        }
+
+        return result;
+    }
+
+    static inline void store(TYPE *out, const Packet& a) {
+        int i;
+
+        for (i = 0; i < SIZE; i++) {
+            out[i] = a.elements[i];
+        }
+    }
+
+    /** Loads the first SIZE elements of SIZE vectors that are stride values apart into out, element i of
+     * every vector in out[i]
+     */
+    static inline void transpose(const TYPE *a, size_t stride, Packet *out) {
+        int i;
+        int j;
+
+        for (i = 0; i < SIZE; i++) {
+            for (j = 0; j < SIZE; j++) {
+                out[i].elements[j] = a[j * stride + i];
+            }
+        }
+    }
+
+    static inline Packet add(const Packet& a, const Packet& b) {
+        Packet result;
+        int i;
+
+        for (i = 0; i < SIZE; i++) {
+            result.elements[i] = a.elements[i] + b.elements[i];
+        }
+
+        return result;
+    }
+
+    static inline Packet subtract(const Packet& a, const Packet& b) {
+        Packet result;
+        int i;
+
+        for (i = 0; i < SIZE; i++) {
+            result.elements[i] = a.elements[i] - b.elements[i];
+        }
+
+        return result;
+    }
+
+    static inline Packet negate(const Packet& a) {
+        Packet result;
+        int i;
+
+        for (i = 0; i < SIZE; i++) {
+            result.elements[i] = -a.elements[i];
+        }
+
+        return result;
+    }
+
+    static inline Packet scale(const Packet& a, TYPE scalar) {
+        Packet result;
+        int i;
+
+        for (i = 0; i < SIZE; i++) {
+            result.elements[i] = a.elements[i] * scalar;
+        }
+
+        return result;
+    }
+
+    static inline Packet divide(const Packet& a, TYPE scalar) {
+        Packet result;
+        int i;
+
+        for (i = 0; i < SIZE; i++) {
+            result.elements[i] = a.elements[i] / scalar;
+        }
+
+        return result;
+    }
+
+    static inline Packet broadcast(TYPE scalar) {
+        Packet result;
+        int i;
+
+        for (i = 0; i < SIZE; i++) {
+            result.elements[i] = scalar;
+        }
+
+        return result;
+    }
+
+    static inline Packet multiply(const Packet& a, const Packet& b) {
+        Packet result;
+        int i;
+
+        for (i = 0; i < SIZE; i++) {
+            result.elements[i] = a.elements[i] * b.elements[i];
+        }
+
+        return result;
+    }
+
+    static inline Packet divide(const Packet& a, const Packet& b) {
+        Packet result;
+        int i;
+
+        for (i = 0; i < SIZE; i++) {
+            result.elements[i] = a.elements[i] / b.elements[i];
+        }
+
+        return result;
+    }
+
+    static inline Packet squareRoot(const Packet& a) {
+        Packet result;
+        int i;
+
+        for (i = 0; i < SIZE; i++) {
+            result.elements[i] = sqrt(a.elements[i]);
+        }
+
+        return result;
+    }
+
+    static inline Packet minimum(const Packet& a, const Packet& b) {
+        Packet result;
+        int i;
+
+        for (i = 0; i < SIZE; i++) {
+            result.elements[i] = (a.elements[i] < b.elements[i]) ? a.elements[i] : b.elements[i];
+        }
+
+        return result;
+    }
+
+    static inline Packet maximum(const Packet& a, const Packet& b) {
+        Packet result;
+        int i;
+
+        for (i = 0; i < SIZE; i++) {
+            result.elements[i] = (a.elements[i] > b.elements[i]) ? a.elements[i] : b.elements[i];
+        }
+
+        return result;
+    }
+
+    static inline void zero(TYPE *out) {
+        int i;
+
+        for (i = 0; i < SIZE; i++) {
+            out[i] = 0;
+        }
+    }
+
+    static inline TYPE dot(const TYPE *a, const TYPE *b) {
+        TYPE result;
+        int i;
+
+        result = a[0] * b[0];
+        for (i = 1; i < N; i++) {
+            result += a[i] * b[i];
+        }
+
+        return result;
+    }
+
+    static inline bool equal(const TYPE *a, const TYPE *b) {
+        int i;
+
+        for (i = 0; i < N; i++) {
+            if (a[i] != b[i]) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    static inline bool isZero(const TYPE *a) {
+        int i;
+
+        for (i = 0; i < N; i++) {
+            if (a[i] != 0) {
+                return false;
+            }
+        }
+
+        return true;
+    }
+};
+
+#if defined(__SSE2__)
+
+/** The operations on four floats in an SSE register, shared by the 3 and 4 element float vectors.
+ * The loads and stores are unaligned ones, which cost the same as aligned ones on aligned data, so
+ * that vectors inside heap blocks with a smaller alignment still work.
+ */
+struct VectorNKernelSse4f {
+    enum { SIZE = 4 };
+    enum { ALIGNMENT = 16 };
+
+    typedef __m128 Packet;
+
+    static inline Packet load(const float *a) {
+        return _mm_loadu_ps(a);
+    }
+
+    static inline void store(float *out, Packet a) {
+        _mm_storeu_ps(out, a);
+    }
+
+    static inline void transpose(const float *a, size_t stride, Packet *out) {
+        out[0] = _mm_loadu_ps(a);
+        out[1] = _mm_loadu_ps(a + stride);
+        out[2] = _mm_loadu_ps(a + 2 * stride);
+        out[3] = _mm_loadu_ps(a + 3 * stride);
+        _MM_TRANSPOSE4_PS(out[0], out[1], out[2], out[3]);
+    }
+
+    static inline Packet add(Packet a, Packet b) {
+        return _mm_add_ps(a, b);
+    }
+
+    static inline Packet subtract(Packet a, Packet b) {
+        return _mm_sub_ps(a, b);
+    }
+
+    static inline Packet negate(Packet a) {
+        return _mm_xor_ps(a, _mm_set1_ps(-0.0f));
+    }
+
+    static inline Packet scale(Packet a, float scalar) {
+        return _mm_mul_ps(a, _mm_set1_ps(scalar));
+    }
+
+    static inline Packet divide(Packet a, float scalar) {
+        return _mm_div_ps(a, _mm_set1_ps(scalar));
+    }
+
+    static inline Packet broadcast(float scalar) {
+        return _mm_set1_ps(scalar);
+    }
+
+    static inline Packet multiply(Packet a, Packet b) {
+        return _mm_mul_ps(a, b);
+    }
+
+    static inline Packet divide(Packet a, Packet b) {
+        return _mm_div_ps(a, b);
+    }
+
+    static inline Packet squareRoot(Packet a) {
+        return _mm_sqrt_ps(a);
+    }
+
+    static inline Packet minimum(Packet a, Packet b) {
+        return _mm_min_ps(a, b);
+    }
+
+    static inline Packet maximum(Packet a, Packet b) {
+        return _mm_max_ps(a, b);
+    }
+
+    static inline void zero(float *out) {
+        _mm_storeu_ps(out, _mm_setzero_ps());
+    }
+
+    static inline float dot(const float *a, const float *b) {
+        return sum(_mm_mul_ps(_mm_loadu_ps(a), _mm_loadu_ps(b)));
+    }
+
+    static inline bool equal(const float *a, const float *b) {
+        return _mm_movemask_ps(_mm_cmpeq_ps(_mm_loadu_ps(a), _mm_loadu_ps(b))) == 0xf;
+    }
+
+    static inline bool isZero(const float *a) {
+        return _mm_movemask_ps(_mm_cmpeq_ps(_mm_loadu_ps(a), _mm_setzero_ps())) == 0xf;
+    }
+
+    /** Adds up the four elements of a register, as (v0 + v1) + (v2 + v3) */
+    static inline float sum(__m128 v) {
+        __m128 swapped;
+
+        swapped = _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 3, 0, 1));
+        v = _mm_add_ps(v, swapped);
+        swapped = _mm_movehl_ps(swapped, v);
+
+        return _mm_cvtss_f32(_mm_add_ss(v, swapped));
+    }
+};
+
+template <>
+/** Four floats in an SSE register */
+struct VectorNKernel<float, 4> : VectorNKernelSse4f {
+};
+
+template <>
+/** Three floats padded to fill an SSE register, the fourth element is masked out of dot products and
+ * comparisons
+ */
+struct VectorNKernel<float, 3> : VectorNKernelSse4f {
+    static inline float dot(const float *a, const float *b) {
+        return sum(_mm_and_ps(_mm_mul_ps(_mm_loadu_ps(a), _mm_loadu_ps(b)), _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1))));
+    }
+
+    static inline bool equal(const float *a, const float *b) {
+        return (_mm_movemask_ps(_mm_cmpeq_ps(_mm_loadu_ps(a), _mm_loadu_ps(b))) & 0x7) == 0x7;
+    }
+
+    static inline bool isZero(const float *a) {
+        return (_mm_movemask_ps(_mm_cmpeq_ps(_mm_loadu_ps(a), _mm_setzero_ps())) & 0x7) == 0x7;
+    }
+
+    static inline void cross(const float *a, const float *b, float *out) {
+        __m128 left;
+        __m128 right;
+        __m128 result;
+
+        // a * b.yzx - a.yzx * b gives the cross product in zxy order
+        left = _mm_loadu_ps(a);
+        right = _mm_loadu_ps(b);
+        result = _mm_sub_ps(_mm_mul_ps(left, _mm_shuffle_ps(right, right, _MM_SHUFFLE(3, 0, 2, 1))),
+                            _mm_mul_ps(_mm_shuffle_ps(left, left, _MM_SHUFFLE(3, 0, 2, 1)), right));
+
+        _mm_storeu_ps(out, _mm_shuffle_ps(result, result, _MM_SHUFFLE(3, 0, 2, 1)));
+    }
+};
+
+#if defined(__AVX__)
+
+template <>
+/** Four doubles in an AVX register */
+struct VectorNKernel<double, 4> {
+    enum { SIZE = 4 };
+    enum { ALIGNMENT = 32 };
+
+    typedef __m256d Packet;
+
+    static inline Packet load(const double *a) {
+        return _mm256_loadu_pd(a);
+    }
+
+    static inline void store(double *out, Packet a) {
+        _mm256_storeu_pd(out, a);
+    }
+
+    static inline void transpose(const double *a, size_t stride, Packet *out) {
+        __m256d first;
+        __m256d second;
+        __m256d third;
+        __m256d fourth;
+
+        // Pairs of vectors interleaved within each 128 bit half, then the halves swapped between them
+        first = _mm256_unpacklo_pd(_mm256_loadu_pd(a), _mm256_loadu_pd(a + stride));
+        second = _mm256_unpackhi_pd(_mm256_loadu_pd(a), _mm256_loadu_pd(a + stride));
+        third = _mm256_unpacklo_pd(_mm256_loadu_pd(a + 2 * stride), _mm256_loadu_pd(a + 3 * stride));
+        fourth = _mm256_unpackhi_pd(_mm256_loadu_pd(a + 2 * stride), _mm256_loadu_pd(a + 3 * stride));
+
+        out[0] = _mm256_permute2f128_pd(first, third, 0x20);
+        out[1] = _mm256_permute2f128_pd(second, fourth, 0x20);
+        out[2] = _mm256_permute2f128_pd(first, third, 0x31);
+        out[3] = _mm256_permute2f128_pd(second, fourth, 0x31);
+    }
+
+    static inline Packet add(Packet a, Packet b) {
+        return _mm256_add_pd(a, b);
+    }
+
+    static inline Packet subtract(Packet a, Packet b) {
+        return _mm256_sub_pd(a, b);
+    }
+
+    static inline Packet negate(Packet a) {
+        return _mm256_xor_pd(a, _mm256_set1_pd(-0.0));
+    }
+
+    static inline Packet scale(Packet a, double scalar) {
+        return _mm256_mul_pd(a, _mm256_set1_pd(scalar));
+    }
+
+    static inline Packet divide(Packet a, double scalar) {
+        return _mm256_div_pd(a, _mm256_set1_pd(scalar));
+    }
+
+    static inline Packet broadcast(double scalar) {
+        return _mm256_set1_pd(scalar);
+    }
+
+    static inline Packet multiply(Packet a, Packet b) {
+        return _mm256_mul_pd(a, b);
+    }
+
+    static inline Packet divide(Packet a, Packet b) {
+        return _mm256_div_pd(a, b);
+    }
+
+    static inline Packet squareRoot(Packet a) {
+        return _mm256_sqrt_pd(a);
+    }
+
+    static inline Packet minimum(Packet a, Packet b) {
+        return _mm256_min_pd(a, b);
+    }
+
+    static inline Packet maximum(Packet a, Packet b) {
+        return _mm256_max_pd(a, b);
+    }
+
+    static inline void zero(double *out) {
+        _mm256_storeu_pd(out, _mm256_setzero_pd());
+    }
+
+    static inline double dot(const double *a, const double *b) {
+        __m256d product;
+        __m128d sums;
+
+        // (a0b0 + a2b2) + (a1b1 + a3b3)
+        product = _mm256_mul_pd(_mm256_loadu_pd(a), _mm256_loadu_pd(b));
+        sums = _mm_add_pd(_mm256_castpd256_pd128(product), _mm256_extractf128_pd(product, 1));
+
+        return _mm_cvtsd_f64(_mm_add_sd(sums, _mm_unpackhi_pd(sums, sums)));
+    }
+
+    static inline bool equal(const double *a, const double *b) {
+        return _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(a), _mm256_loadu_pd(b), _CMP_EQ_OQ)) == 0xf;
+    }
+
+    static inline bool isZero(const double *a) {
+        return _mm256_movemask_pd(_mm256_cmp_pd(_mm256_loadu_pd(a), _mm256_setzero_pd(), _CMP_EQ_OQ)) == 0xf;
+    }
+};
+
+#else
+
+/** Four doubles in two SSE2 registers, the packet of Vector4d without AVX */
+struct VectorNPacketSse4d {
+    __m128d low;
+    __m128d high;
+};
+
+template <>
+/** Four doubles in two SSE2 registers */
+struct VectorNKernel<double, 4> {
+    enum { SIZE = 4 };
+    enum { ALIGNMENT = 16 };
+
+    typedef VectorNPacketSse4d Packet;
+
+    static inline Packet load(const double *a) {
+        Packet result;
+
+        result.low = _mm_loadu_pd(a);
+        result.high = _mm_loadu_pd(a + 2);
+
+        return result;
+    }
+
+    static inline void store(double *out, const Packet& a) {
+        _mm_storeu_pd(out, a.low);
+        _mm_storeu_pd(out + 2, a.high);
+    }
+
+    static inline void transpose(const double *a, size_t stride, Packet *out) {
+        int i;
+
+        // Elements i and i + 1 of the first two vectors, then of the last two
+        for (i = 0; i < 4; i += 2) {
+            out[i].low = _mm_unpacklo_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(a + stride + i));
+            out[i + 1].low = _mm_unpackhi_pd(_mm_loadu_pd(a + i), _mm_loadu_pd(a + stride + i));
+            out[i].high = _mm_unpacklo_pd(_mm_loadu_pd(a + 2 * stride + i), _mm_loadu_pd(a + 3 * stride + i));
+            out[i + 1].high = _mm_unpackhi_pd(_mm_loadu_pd(a + 2 * stride + i), _mm_loadu_pd(a + 3 * stride + i));
+        }
+    }
+
+    static inline Packet add(const Packet& a, const Packet& b) {
+        Packet result;
+
+        result.low = _mm_add_pd(a.low, b.low);
+        result.high = _mm_add_pd(a.high, b.high);
+
+        return result;
+    }
+
+    static inline Packet subtract(const Packet& a, const Packet& b) {
+        Packet result;
+
+        result.low = _mm_sub_pd(a.low, b.low);
+        result.high = _mm_sub_pd(a.high, b.high);
+
+        return result;
+    }
+
+    static inline Packet negate(const Packet& a) {
+        __m128d sign = _mm_set1_pd(-0.0);
+        Packet result;
+
+        result.low = _mm_xor_pd(a.low, sign);
+        result.high = _mm_xor_pd(a.high, sign);
+
+        return result;
+    }
+
+    static inline Packet scale(const Packet& a, double scalar) {
+        __m128d factor = _mm_set1_pd(scalar);
+        Packet result;
+
+        result.low = _mm_mul_pd(a.low, factor);
+        result.high = _mm_mul_pd(a.high, factor);
+
+        return result;
+    }
+
+    static inline Packet divide(const Packet& a, double scalar) {
+        __m128d divisor = _mm_set1_pd(scalar);
+        Packet result;
+
+        result.low = _mm_div_pd(a.low, divisor);
+        result.high = _mm_div_pd(a.high, divisor);
+
+        return result;
+    }
+
+    static inline Packet broadcast(double scalar) {
+        Packet result;
+
+        result.low = result.high = _mm_set1_pd(scalar);
+
+        return result;
+    }
+
+    static inline Packet multiply(const Packet& a, const Packet& b) {
+        Packet result;
+
+        result.low = _mm_mul_pd(a.low, b.low);
+        result.high = _mm_mul_pd(a.high, b.high);
+
+        return result;
+    }
+
+    static inline Packet divide(const Packet& a, const Packet& b) {
+        Packet result;
+
+        result.low = _mm_div_pd(a.low, b.low);
+        result.high = _mm_div_pd(a.high, b.high);
+
+        return result;
+    }
+
+    static inline Packet squareRoot(const Packet& a) {
+        Packet result;
+
+        result.low = _mm_sqrt_pd(a.low);
+        result.high = _mm_sqrt_pd(a.high);
+
+        return result;
+    }
+
+    static inline Packet minimum(const Packet& a, const Packet& b) {
+        Packet result;
+
+        result.low = _mm_min_pd(a.low, b.low);
+        result.high = _mm_min_pd(a.high, b.high);
+
+        return result;
+    }
+
+    static inline Packet maximum(const Packet& a, const Packet& b) {
+        Packet result;
+
+        result.low = _mm_max_pd(a.low, b.low);
+        result.high = _mm_max_pd(a.high, b.high);
+
+        return result;
+    }
+
+    static inline void zero(double *out) {
+        _mm_storeu_pd(out, _mm_setzero_pd());
+        _mm_storeu_pd(out + 2, _mm_setzero_pd());
+    }
+
+    static inline double dot(const double *a, const double *b) {
+        __m128d sums;
+
+        // (a0b0 + a2b2) + (a1b1 + a3b3)
+        sums = _mm_add_pd(_mm_mul_pd(_mm_loadu_pd(a), _mm_loadu_pd(b)), _mm_mul_pd(_mm_loadu_pd(a + 2), _mm_loadu_pd(b + 2)));
+
+        return _mm_cvtsd_f64(_mm_add_sd(sums, _mm_unpackhi_pd(sums, sums)));
+    }
+
+    static inline bool equal(const double *a, const double *b) {
+        return (_mm_movemask_pd(_mm_cmpeq_pd(_mm_loadu_pd(a), _mm_loadu_pd(b))) &
+                _mm_movemask_pd(_mm_cmpeq_pd(_mm_loadu_pd(a + 2), _mm_loadu_pd(b + 2)))) == 0x3;
+    }
+
+    static inline bool isZero(const double *a) {
+        return (_mm_movemask_pd(_mm_cmpeq_pd(_mm_loadu_pd(a), _mm_setzero_pd())) &
+                _mm_movemask_pd(_mm_cmpeq_pd(_mm_loadu_pd(a + 2), _mm_setzero_pd()))) == 0x3;
+    }
+};
+
+#endif
+
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+
+/** The operations on four floats in a NEON register, shared by the 3 and 4 element float vectors.
+ * Vectors of doubles use the generic loops.
+ */
+struct VectorNKernelNeon4f {
+    enum { SIZE = 4 };
+    enum { ALIGNMENT = 16 };
+
+    typedef float32x4_t Packet;
+
+    static inline Packet load(const float *a) {
+        return vld1q_f32(a);
+    }
+
+    static inline void store(float *out, Packet a) {
+        vst1q_f32(out, a);
+    }
+
+    static inline void transpose(const float *a, size_t stride, Packet *out) {
+        float32x4x2_t front;
+        float32x4x2_t back;
+
+        // Elements 0 and 2 of the first two vectors interleaved, and 1 and 3, then the same for the last two
+        front = vtrnq_f32(vld1q_f32(a), vld1q_f32(a + stride));
+        back = vtrnq_f32(vld1q_f32(a + 2 * stride), vld1q_f32(a + 3 * stride));
+
+        out[0] = vcombine_f32(vget_low_f32(front.val[0]), vget_low_f32(back.val[0]));
+        out[1] = vcombine_f32(vget_low_f32(front.val[1]), vget_low_f32(back.val[1]));
+        out[2] = vcombine_f32(vget_high_f32(front.val[0]), vget_high_f32(back.val[0]));
+        out[3] = vcombine_f32(vget_high_f32(front.val[1]), vget_high_f32(back.val[1]));
+    }
+
+    static inline Packet add(Packet a, Packet b) {
+        return vaddq_f32(a, b);
+    }
+
+    static inline Packet subtract(Packet a, Packet b) {
+        return vsubq_f32(a, b);
+    }
+
+    static inline Packet negate(Packet a) {
+        return vnegq_f32(a);
+    }
+
+    static inline Packet scale(Packet a, float scalar) {
+        return vmulq_n_f32(a, scalar);
+    }
+
+    static inline Packet divide(Packet a, float scalar) {
+        return vdivq_f32(a, vdupq_n_f32(scalar));
+    }
+
+    static inline Packet broadcast(float scalar) {
+        return vdupq_n_f32(scalar);
+    }
+
+    static inline Packet multiply(Packet a, Packet b) {
+        return vmulq_f32(a, b);
+    }
+
+    static inline Packet divide(Packet a, Packet b) {
+        return vdivq_f32(a, b);
+    }
+
+    static inline Packet squareRoot(Packet a) {
+        return vsqrtq_f32(a);
+    }
+
+    static inline Packet minimum(Packet a, Packet b) {
+        return vminq_f32(a, b);
+    }
+
+    static inline Packet maximum(Packet a, Packet b) {
+        return vmaxq_f32(a, b);
+    }
+
+    static inline void zero(float *out) {
+        vst1q_f32(out, vdupq_n_f32(0.0f));
+    }
+
+    static inline float dot(const float *a, const float *b) {
+        return vaddvq_f32(vmulq_f32(vld1q_f32(a), vld1q_f32(b)));
+    }
+
+    static inline bool equal(const float *a, const float *b) {
+        return vminvq_u32(vceqq_f32(vld1q_f32(a), vld1q_f32(b))) != 0;
+    }
+
+    static inline bool isZero(const float *a) {
+        return vminvq_u32(vceqq_f32(vld1q_f32(a), vdupq_n_f32(0.0f))) != 0;
+    }
+};
+
+template <>
+/** Four floats in a NEON register */
+struct VectorNKernel<float, 4> : VectorNKernelNeon4f {
+};
+
+template <>
+/** Three floats padded to fill a NEON register, the fourth element is masked out of dot products and
+ * comparisons
+ */
+struct VectorNKernel<float, 3> : VectorNKernelNeon4f {
+    static inline float dot(const float *a, const float *b) {
+        return vaddvq_f32(vsetq_lane_f32(0.0f, vmulq_f32(vld1q_f32(a), vld1q_f32(b)), 3));
+    }
+
+    static inline bool equal(const float *a, const float *b) {
+        return vminvq_u32(vsetq_lane_u32(0xffffffffu, vceqq_f32(vld1q_f32(a), vld1q_f32(b)), 3)) != 0;
+    }
+
+    static inline bool isZero(const float *a) {
+        return vminvq_u32(vsetq_lane_u32(0xffffffffu, vceqq_f32(vld1q_f32(a), vdupq_n_f32(0.0f)), 3)) != 0;
+    }
+
+    static inline void cross(const float *a, const float *b, float *out) {
+        out[0] = a[1] * b[2] - a[2] * b[1];
+        out[1] = a[2] * b[0] - a[0] * b[2];
+        out[2] = a[0] * b[1] - a[1] * b[0];
+        out[3] = 0.0f;
+    }
+};
+
+#endif
+
+#endif // __VECTORN_SIMD_H__
@@ -0,0 +1,132 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __VERTEX_FORMAT_H__
+#define __VERTEX_FORMAT_H__
+
+#include <GL/glew.h>
+
+/** The generic attribute location that octahedrally encoded normals are bound to */
+#define VERTEX_ATTRIB_OCT_NORMAL 6
+
+/**
+ * The meaning of an attribute within a vertex.
+ */
+enum VertexSemantic {
+	VERTEX_POSITION,
+	VERTEX_NORMAL,
+	VERTEX_COLOUR,
+	VERTEX_UV,
+	VERTEX_SEMANTIC_COUNT
+};
+
+/**
+ * Describes where one attribute lives in a vertex and how OpenGL should read it.
+ */
+struct VertexAttribute {
+	/** The number of components, e.g. 3 for a position */
+	GLint components;
+	/** The GL type of each component */
+	GLenum type;
+	/** Whether integer components are mapped to [0, 1] or [-1, 1] */
+	GLboolean normalized;
+	/** The byte offset of the attribute from the start of the vertex */
+	GLsizei offset;
+};
+
+class VertexFormat {
+	public:
+		/**
+		 * Constructs an empty format.
+		 */
+		VertexFormat();
+
+		/**
+		 * Appends an attribute to the end of the vertex.
+		 * @param semantic What the attribute holds.
+		 * @param components The number of components.
+		 * @param type The GL type of each component.
+		 * @param normalized Whether integer components are normalized.
+		 */
+		void addAttribute(VertexSemantic semantic, GLint components, GLenum type, GLboolean normalized);
+
+		/**
+		 * Gets an attribute of the format.
+		 * @param semantic The attribute to look up.
+		 * @return a pointer to the attribute, NULL if the format doesn't have it.
+		 */
+		const VertexAttribute* getAttribute(VertexSemantic semantic) const;
+
+		/**
+		 * Gets the size of a whole vertex in bytes.
+		 */
+		GLsizei getStride() const;
+
+		/**
+		 * Points the GL vertex arrays at the attributes of the currently bound vertex buffer. Float normals
+		 * go through the fixed function normal array, packed normals through the generic attribute at
+		 * VERTEX_ATTRIB_OCT_NORMAL. UVs are not bound, as nothing is textured.
+		 * @param withColour Whether the colour array should be enabled.
+		 */
+		void setupArrays(bool withColour) const;
+
+		/**
+		 * The format of MeshVertex: 3 float position, 3 float normal, 3 float colour and 2 float UV.
+		 */
+		static VertexFormat floatFormat();
+
+		/**
+		 * The format of QuantizedVertex: 16 bit position, octahedral 16 bit normal, unorm8 colour and half
+		 * float UV.
+		 */
+		static VertexFormat quantizedFormat();
+
+	private:
+		/** The attributes, indexed by semantic */
+		VertexAttribute attributes[VERTEX_SEMANTIC_COUNT];
+		/** The size of a whole vertex in bytes */
+		GLsizei stride;
+};
+
+#endif
+
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
@@ -0,0 +1,109 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#ifndef __VERTEX_QUANTIZER_H__
+#define __VERTEX_QUANTIZER_H__
+
+#include <GL/glew.h>
+
+#include "IndexedMesh.h"
+
+/**
+ * A compressed vertex, 20 bytes against the 44 of a MeshVertex. Described by VertexFormat::quantizedFormat.
+ */
+struct QuantizedVertex {
+	/** The position relative to the mesh bounds, the fourth component is always 1 */
+	GLshort position[4];
+	/** The octahedrally encoded normal, as snorm16 */
+	GLshort normal[2];
+	/** The colour as unorm8, alpha is always 255 */
+	GLubyte colour[4];
+	/** The UV as half floats */
+	GLushort uv[2];
+};
+
+class VertexQuantizer {
+	public:
+		/**
+		 * Computes the dequantization transform for a set of vertices, position = center + q * scale. A
+		 * single scale is used for all axes so that the transform doesn't skew normals.
+		 * @param vertices The vertices to bound.
+		 * @param count The number of vertices.
+		 * @param center Receives the center of the bounding box.
+		 * @param scale Receives the size of one quantization step.
+		 */
+		static void computeTransform(const MeshVertex* vertices, unsigned int count, GLfloat center[3], GLfloat& scale);
+
+		/**
+		 * Quantizes vertices, four at a time with SSE where it is available.
+		 * @param in The vertices to quantize.
+		 * @param count The number of vertices.
+		 * @param center The center computed by computeTransform.
+		 * @param scale The scale computed by computeTransform.
+		 * @param out Receives the quantized vertices.
+		 */
+		static void encode(const MeshVertex* in, unsigned int count, const GLfloat center[3], GLfloat scale, QuantizedVertex* out);
+
+		/**
+		 * Expands quantized vertices back into floats, four at a time with SSE where it is available.
+		 * @param in The vertices to expand.
+		 * @param count The number of vertices.
+		 * @param center The center the vertices were quantized with.
+		 * @param scale The scale the vertices were quantized with.
+		 * @param out Receives the expanded vertices.
+		 */
+		static void decode(const QuantizedVertex* in, unsigned int count, const GLfloat center[3], GLfloat scale, MeshVertex* out);
+
+		/**
+		 * Converts a float to a half float, rounding to nearest.
+		 */
+		static GLushort floatToHalf(GLfloat value);
+
+		/**
+		 * Converts a half float to a float.
+		 */
+		static GLfloat halfToFloat(GLushort value);
+};
+
+#endif
+
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
@@ -1,28 +1,52 @@
+// Specialized by ShaderPermutation::buildDefines, the defaults are the original three band ramp
+#ifndef TOON_BANDS
+#define TOON_BANDS 3
+#define TOON_THRESHOLD_1 0.5
+#define TOON_THRESHOLD_2 0.9
+#define TOON_LEVEL_0 0.5
+#define TOON_LEVEL_1 0.7
+#define TOON_LEVEL_2 1.1
+#define TOON_SPECULAR 1
+#define WRITE_NORMALS 0
+#endif
+
 varying vec3 normal;
 varying vec3 position;
 
 void main()
 {
 	vec3 nn = normalize(normal);
-  vec3 light_pos = gl_LightSource[0].position;
+  vec3 light_pos = gl_LightSource[0].position.xyz;
   vec3 light_dir = normalize(position - light_pos);
+	float diffuse = max(dot(-light_dir, nn), 0.0);
+
+#if TOON_SPECULAR
   vec3 eye_dir = normalize(-position);
   vec3 reflect_dir = normalize(reflect(light_dir, nn));
-	
   float spec = max(dot(reflect_dir, eye_dir), 0.0);
-	float diffuse = max(dot(-light_dir, nn), 0.0);
 
   float intensity = 0.6 * diffuse + 0.4 * spec;
+#else
+	float intensity = diffuse;
+#endif
 
- 	if (intensity > 0.9) {
- 		intensity = 1.1;
- 	}
- 	else if (intensity > 0.5) {
- 		intensity = 0.7;
- 	}
- 	else {
- 		intensity = 0.5;
-  }
+	// Every band adds its step up from the band below, so the ramp needs no branches
+	float level = TOON_LEVEL_0;
+#if TOON_BANDS > 1
+	level += step(TOON_THRESHOLD_1, intensity) * (TOON_LEVEL_1 - TOON_LEVEL_0);
+#endif
+#if TOON_BANDS > 2
+	level += step(TOON_THRESHOLD_2, intensity) * (TOON_LEVEL_2 - TOON_LEVEL_1);
+#endif
+#if TOON_BANDS > 3
+	level += step(TOON_THRESHOLD_3, intensity) * (TOON_LEVEL_3 - TOON_LEVEL_2);
+#endif
 
-	gl_FragColor = gl_Color * intensity;
-} 
\ No newline at end of file
+#if WRITE_NORMALS
+	gl_FragData[0] = gl_Color * level;
+	// The normal for the screen space outline pass, the 0 alpha marks the pixel as outlined
+	gl_FragData[1] = vec4(nn * 0.5 + 0.5, 0.0);
+#else
+	gl_FragColor = gl_Color * level;
+#endif
+}
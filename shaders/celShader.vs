@@ -5,7 +5,7 @@ void main()
 {
 	gl_FrontColor = gl_Color;
 	normal = gl_NormalMatrix * gl_Normal;
-	position = gl_ModelViewMatrix * gl_Vertex;
+	position = (gl_ModelViewMatrix * gl_Vertex).xyz;
 	
 	gl_Position = ftransform();
 } 
\ No newline at end of file
@@ -0,0 +1,53 @@
+// Draws one copy of a mesh per instance. QUANTIZED selects the vertex layout of quantized meshes
+#ifndef QUANTIZED
+#define QUANTIZED 0
+#endif
+
+attribute vec4 instanceRow0;
+attribute vec4 instanceRow1;
+attribute vec4 instanceRow2;
+attribute vec4 instanceColour;
+
+#if QUANTIZED
+attribute vec2 octNormal;
+
+// The mesh's dequantization transform, position = xyz + q * w
+uniform vec4 dequantize;
+
+// Unfolds a normal that was projected onto an octahedron and flattened into a square
+vec3 decodeOctahedral(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+
+	if (n.z < 0.0) {
+		vec2 signs = vec2(e.x >= 0.0 ? 1.0 : -1.0, e.y >= 0.0 ? 1.0 : -1.0);
+		n.xy = (1.0 - abs(e.yx)) * signs;
+	}
+
+	return normalize(n);
+}
+#endif
+
+varying vec3 normal;
+varying vec3 position;
+
+void main()
+{
+#if QUANTIZED
+	vec4 local = vec4(dequantize.xyz + gl_Vertex.xyz * dequantize.w, 1.0);
+	vec3 localNormal = decodeOctahedral(octNormal);
+#else
+	vec4 local = gl_Vertex;
+	vec3 localNormal = gl_Normal;
+#endif
+
+	// The instance transform only scales uniformly, so it transforms normals too
+	vec4 model = vec4(dot(instanceRow0, local), dot(instanceRow1, local), dot(instanceRow2, local), 1.0);
+	vec3 modelNormal = vec3(dot(instanceRow0.xyz, localNormal), dot(instanceRow1.xyz, localNormal), dot(instanceRow2.xyz, localNormal));
+
+	gl_FrontColor = gl_Color * instanceColour;
+	normal = gl_NormalMatrix * modelNormal;
+	position = (gl_ModelViewMatrix * model).xyz;
+
+	gl_Position = gl_ModelViewProjectionMatrix * model;
+}
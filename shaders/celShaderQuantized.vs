@@ -0,0 +1,26 @@
+attribute vec2 octNormal;
+
+varying vec3 normal;
+varying vec3 position;
+
+// Unfolds a normal that was projected onto an octahedron and flattened into a square
+vec3 decodeOctahedral(vec2 e)
+{
+	vec3 n = vec3(e, 1.0 - abs(e.x) - abs(e.y));
+
+	if (n.z < 0.0) {
+		vec2 signs = vec2(e.x >= 0.0 ? 1.0 : -1.0, e.y >= 0.0 ? 1.0 : -1.0);
+		n.xy = (1.0 - abs(e.yx)) * signs;
+	}
+
+	return normalize(n);
+}
+	
+void main()
+{
+	gl_FrontColor = gl_Color;
+	normal = gl_NormalMatrix * decodeOctahedral(octNormal);
+	position = (gl_ModelViewMatrix * gl_Vertex).xyz;
+	
+	gl_Position = ftransform();
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+uniform sampler2D colourTexture;
+uniform sampler2D normalTexture;
+uniform sampler2D depthTexture;
+uniform vec2 texelSize;
+uniform vec2 clipPlanes;
+uniform float thickness;
+
+varying vec2 uv;
+
+// Turns a depth buffer value back into an eye space distance
+float linearDepth(vec2 coord)
+{
+	float z = texture2D(depthTexture, coord).r * 2.0 - 1.0;
+
+	return 2.0 * clipPlanes.x * clipPlanes.y / (clipPlanes.y + clipPlanes.x - z * (clipPlanes.y - clipPlanes.x));
+}
+
+void main()
+{
+	vec4 centreNormal = texture2D(normalTexture, uv);
+	vec3 n = centreNormal.xyz * 2.0 - 1.0;
+	float centreDepth = linearDepth(uv);
+	float edge = 0.0;
+
+	for (int i = -1; i <= 1; i++) {
+		for (int j = -1; j <= 1; j++) {
+			vec2 coord = uv + vec2(float(i), float(j)) * thickness * texelSize;
+			vec4 neighbourNormal = texture2D(normalTexture, coord);
+
+			// Only cel shaded geometry, which writes a 0 alpha, casts an outline
+			if (neighbourNormal.a < 0.5) {
+				float depth = linearDepth(coord);
+
+				// The line goes on the far side of a silhouette, where the back face lines used to show
+				if (centreDepth - depth > 0.02 * depth) {
+					edge = 1.0;
+				}
+				// Creases are marked on the side further from the camera, so they're only drawn once
+				else if ((centreNormal.a < 0.5) && (depth <= centreDepth) && (dot(n, neighbourNormal.xyz * 2.0 - 1.0) < 0.3)) {
+					edge = 1.0;
+				}
+			}
+		}
+	}
+
+	gl_FragColor = vec4(texture2D(colourTexture, uv).rgb * (1.0 - edge), 1.0);
+}
@@ -0,0 +1,8 @@
+varying vec2 uv;
+
+void main()
+{
+	uv = gl_Vertex.xy * 0.5 + 0.5;
+
+	gl_Position = gl_Vertex;
+}
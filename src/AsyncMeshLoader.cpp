@@ -0,0 +1,169 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <chrono>
+#include <iostream>
+
+#include "AsyncMeshLoader.h"
+#include "MeshCodec.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+
+AsyncMeshLoader::AsyncMeshLoader(const std::string& basePath, ThreadPool& threadPool)
+	: basePath(basePath),
+	  threadPool(threadPool),
+	  state(STATE_IDLE)
+{
+}
+
+AsyncMeshLoader::~AsyncMeshLoader() {
+	release();
+}
+
+void AsyncMeshLoader::start() {
+	if (state.load() != STATE_IDLE) {
+		return;
+	}
+
+	state.store(STATE_LOADING);
+	worker = std::thread(&AsyncMeshLoader::loadMesh, this);
+}
+
+bool AsyncMeshLoader::update(MeshBuffer& buffer, bool quantize, size_t byteBudget) {
+	switch (state.load()) {
+		case STATE_LOADED:
+			// The worker has finished with the mesh, from here on only this thread touches it
+			worker.join();
+
+			if (!buffer.beginUpload(mesh, true, quantize)) {
+				state.store(STATE_FAILED);
+				return false;
+			}
+
+			// Spend this frame's budget on the upload straight away
+			state.store(STATE_UPLOADING);
+			// fall through
+		case STATE_UPLOADING:
+			if (!buffer.continueUpload(byteBudget)) {
+				return false;
+			}
+
+			std::cout << "Vertex buffer = " << buffer.getVertexCount() * buffer.getVertexFormat().getStride() << " bytes" << std::endl;
+			state.store(STATE_READY);
+			return true;
+		case STATE_READY:
+			return buffer.isUploaded();
+		default:
+			return false;
+	}
+}
+
+AsyncMeshLoader::State AsyncMeshLoader::getState() const {
+	return static_cast<State>(state.load());
+}
+
+bool AsyncMeshLoader::isBusy() const {
+	int current;
+
+	current = state.load();
+
+	return (current == STATE_LOADING) || (current == STATE_LOADED) || (current == STATE_UPLOADING);
+}
+
+const ClusterBvh& AsyncMeshLoader::getClusterBvh() const {
+	return clusterBvh;
+}
+
+const EdgeAdjacency& AsyncMeshLoader::getEdgeAdjacency() const {
+	return edgeAdjacency;
+}
+
+void AsyncMeshLoader::release() {
+	if (worker.joinable()) {
+		worker.join();
+	}
+
+	clusterBvh.release();
+	edgeAdjacency.release();
+	meshLoader.releaseArrays();
+	mesh.release();
+}
+
+void AsyncMeshLoader::loadMesh() {
+	std::chrono::steady_clock::time_point start;
+
+	start = std::chrono::steady_clock::now();
+
+	// Prefer the compressed version of the model, it is smaller on disk and already welded and optimized
+	if (MeshCodec::decode(basePath + ".rmc", mesh, threadPool)) {
+		std::cout << "Decoded " << basePath << ".rmc on " << threadPool.getThreadCount() << " threads, unique vertices = "
+		          << mesh.getVertexCount() << std::endl;
+	}
+	else {
+		std::cout << "Loading " << basePath << ".raw in the background..." << std::endl;
+		std::cout << "Vertices = " << meshLoader.load(basePath + ".raw", RawMeshLoader::LOAD_PARALLEL, &threadPool) << std::endl;
+		std::cout << "Loaded in " << meshLoader.getLoadTime() << "s (" << meshLoader.getLoadThroughput() << " MB/s)" << std::endl;
+
+		// Merge the duplicated vertices of the triangle soup, the soup itself is no longer needed afterwards
+		std::cout << "Unique vertices = " << mesh.weld(meshLoader) << std::endl;
+		meshLoader.releaseArrays();
+
+		// The exporter's triangle order is arbitrary, reorder it for the post-transform cache
+		MeshOptimizer::optimize(mesh, true);
+	}
+
+	// Files converted before LOD chains existed don't have one, build it here instead
+	MeshSimplifier::buildLodChain(mesh, true);
+
+	// Cluster the triangles of every level for culling, this reorders them so it has to come last
+	clusterBvh.build(mesh);
+
+	// The edges refer to faces by their position in the index buffer, so they are found after clustering
+	edgeAdjacency.build(mesh);
+
+	std::cout << "Prepared " << basePath << " in "
+	          << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << "s" << std::endl;
+
+	state.store((mesh.getIndexCount() != 0) ? STATE_LOADED : STATE_FAILED);
+}
+
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
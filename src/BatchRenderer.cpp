@@ -0,0 +1,300 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+
+#include "BatchRenderer.h"
+
+BatchRenderer::BatchRenderer(unsigned int threadCount)
+	: threadPool(threadCount),
+	  loadedModels(0),
+	  framesWritten(0),
+	  framesFailed(0),
+	  modelsFailed(0),
+	  loadSeconds(0.0),
+	  frameSeconds(0.0),
+	  runSeconds(0.0)
+{
+}
+
+BatchRenderer::~BatchRenderer() {
+	unsigned int i;
+
+	for (i = 0; i < rasterizers.size(); i++) {
+		delete rasterizers[i];
+	}
+
+	for (i = 0; i < models.size(); i++) {
+		delete models[i].mesh;
+	}
+}
+
+bool BatchRenderer::loadManifest(const std::string& path) {
+	std::ifstream file(path.c_str());
+	std::map<std::string, unsigned int>::iterator found;
+	std::map<std::string, unsigned int> modelIndices;
+	std::string line;
+	std::string modelPath;
+	unsigned int lineNumber;
+	long long frameCount;
+	GLfloat turns;
+	Model model;
+	Job job;
+
+	if (!file) {
+		std::cout << "Could not open " << path << std::endl;
+		return false;
+	}
+
+	lineNumber = 0;
+	while (std::getline(file, line)) {
+		std::istringstream fields(line);
+
+		lineNumber++;
+		if ((!(fields >> modelPath)) || (modelPath[0] == '#')) {
+			continue;
+		}
+
+		if ((!(fields >> job.imagePrefix >> job.width >> job.height >> frameCount >> job.pitch >> job.distance)) ||
+		    (job.width <= 0) || (job.height <= 0)) {
+			std::cout << path << ":" << lineNumber << ": expected model.raw imagePrefix width height frames pitch distance [turns]"
+			          << std::endl;
+			return false;
+		}
+
+		// Read as signed so that a negative count is caught rather than wrapping around
+		if ((frameCount <= 0) || (frameCount > BATCH_MAX_FRAMES)) {
+			std::cout << path << ":" << lineNumber << ": the number of frames must be between 1 and " << BATCH_MAX_FRAMES
+			          << ", not " << frameCount << std::endl;
+			return false;
+		}
+		job.frameCount = static_cast<unsigned int>(frameCount);
+
+		job.turns = 1.0f;
+		if (fields >> turns) {
+			job.turns = turns;
+		}
+
+		// Jobs drawing the same model share it
+		found = modelIndices.find(modelPath);
+		if (found == modelIndices.end()) {
+			model.path = modelPath;
+			model.mesh = NULL;
+			model.remainingFrames = 0;
+			found = modelIndices.insert(std::make_pair(modelPath, static_cast<unsigned int>(models.size()))).first;
+			models.push_back(model);
+		}
+
+		job.model = found->second;
+		models[job.model].jobs.push_back(static_cast<unsigned int>(jobs.size()));
+		jobs.push_back(job);
+	}
+
+	return true;
+}
+
+bool BatchRenderer::run() {
+	std::chrono::steady_clock::time_point start;
+	std::chrono::steady_clock::time_point loadStart;
+	RawMeshLoader *mesh;
+	unsigned int frames;
+	unsigned int frame;
+	unsigned int job;
+	unsigned int i;
+	unsigned int j;
+
+	framesWritten = 0;
+	framesFailed = 0;
+	modelsFailed = 0;
+	loadSeconds = 0.0;
+	frameSeconds = 0.0;
+	start = std::chrono::steady_clock::now();
+
+	for (i = 0; i < models.size(); i++) {
+		frames = 0;
+		for (j = 0; j < models[i].jobs.size(); j++) {
+			frames += jobs[models[i].jobs[j]].frameCount;
+		}
+		if (frames == 0) {
+			continue;
+		}
+
+		// Only a few models are kept loaded, so a manifest of thousands of assets doesn't map them all at once
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+
+			while (loadedModels >= BATCH_MODELS_IN_FLIGHT) {
+				modelFreed.wait(lock);
+			}
+		}
+
+		// Mapping the file leaves the records where they are, the frames read them in place
+		loadStart = std::chrono::steady_clock::now();
+		mesh = new RawMeshLoader();
+		if (mesh->load(models[i].path, RawMeshLoader::LOAD_MAPPED) == 0) {
+			std::cout << "Could not load " << models[i].path << std::endl;
+			delete mesh;
+
+			std::unique_lock<std::mutex> lock(mutex);
+			modelsFailed++;
+			framesFailed += frames;
+			continue;
+		}
+		loadSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - loadStart).count();
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			models[i].mesh = mesh;
+			models[i].remainingFrames = frames;
+			loadedModels++;
+		}
+
+		for (j = 0; j < models[i].jobs.size(); j++) {
+			job = models[i].jobs[j];
+
+			for (frame = 0; frame < jobs[job].frameCount; frame++) {
+				threadPool.enqueue([this, job, frame]() {
+					renderFrame(jobs[job], frame);
+				});
+			}
+		}
+	}
+
+	threadPool.wait();
+	runSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+	return framesFailed == 0;
+}
+
+void BatchRenderer::printReport() const {
+	unsigned int threads;
+	double framesPerSecond;
+
+	threads = threadPool.getThreadCount();
+
+	std::cout << jobs.size() << " jobs over " << models.size() << " models, " << framesWritten << " frames written";
+	if (framesFailed != 0) {
+		std::cout << ", " << framesFailed << " failed";
+	}
+	if (modelsFailed != 0) {
+		std::cout << ", " << modelsFailed << " models could not be loaded";
+	}
+	std::cout << std::endl;
+
+	if (runSeconds <= 0.0) {
+		return;
+	}
+
+	framesPerSecond = framesWritten / runSeconds;
+	std::cout << std::fixed << std::setprecision(2) << runSeconds * 1000.0 << "ms, " << loadSeconds * 1000.0
+	          << "ms of it loading models" << std::endl;
+	std::cout << framesPerSecond << " frames per second on " << threads << " threads, " << framesPerSecond / threads
+	          <<  " frames per second per thread, the threads were busy " << 100.0 * frameSeconds / (runSeconds * threads)
+	          << "% of the time" << std::endl;
+	std::cout.unsetf(std::ios_base::floatfield);
+}
+
+void BatchRenderer::renderFrame(const Job& job, unsigned int frame) {
+	static const GLfloat background[3] = { 0.0f, 0.4f, 0.4f };
+	static const GLfloat identity[16] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f,
+	                                      0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+	// Above and to the right of the camera
+	static const GLfloat light[4] = { 10.0f, 10.0f, 0.0f, 1.0f };
+	std::chrono::steady_clock::time_point start;
+	std::ostringstream path;
+	SoftwareRasterizer *rasterizer;
+	GLfloat modelView[16];
+	GLfloat viewAngle;
+	bool written;
+
+	start = std::chrono::steady_clock::now();
+	rasterizer = acquireRasterizer();
+
+	if ((rasterizer->getWidth() != job.width) || (rasterizer->getHeight() != job.height)) {
+		rasterizer->resize(job.width, job.height);
+		rasterizer->setPerspective(BATCH_FIELD_OF_VIEW, BATCH_NEAR_PLANE, BATCH_FAR_PLANE);
+	}
+
+	// The light is placed in eye space, so that every frame of the turntable is lit the same way
+	rasterizer->setModelView(identity);
+	rasterizer->setLight(light);
+
+	viewAngle = 2.0f * static_cast<GLfloat>(M_PI) * job.turns * frame / job.frameCount;
+	SoftwareRasterizer::orbitMatrix(viewAngle, job.pitch, job.distance, modelView);
+	rasterizer->setModelView(modelView);
+
+	// The mesh was set before the frame was queued, and isn't freed until the frame is finished
+	rasterizer->clear(background);
+	rasterizer->draw(*models[job.model].mesh);
+
+	path << job.imagePrefix << std::setw(4) << std::setfill('0') << frame << ".ppm";
+	written = rasterizer->writeImage(path.str());
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		idleRasterizers.push_back(rasterizer);
+	}
+
+	finishFrame(job.model, written, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+}
+
+SoftwareRasterizer* BatchRenderer::acquireRasterizer() {
+	std::unique_lock<std::mutex> lock(mutex);
+	SoftwareRasterizer *rasterizer;
+
+	if (!idleRasterizers.empty()) {
+		rasterizer = idleRasterizers.back();
+		idleRasterizers.pop_back();
+		return rasterizer;
+	}
+
+	// Each draws on the thread that took it, the frames themselves are what run in parallel
+	rasterizer = new SoftwareRasterizer();
+	rasterizers.push_back(rasterizer);
+	return rasterizer;
+}
+
+void BatchRenderer::finishFrame(unsigned int model, bool written, double seconds) {
+	std::unique_lock<std::mutex> lock(mutex);
+
+	if (written) {
+		framesWritten++;
+	}
+	else {
+		framesFailed++;
+	}
+	frameSeconds += seconds;
+
+	models[model].remainingFrames--;
+	if (models[model].remainingFrames == 0) {
+		delete models[model].mesh;
+		models[model].mesh = NULL;
+		loadedModels--;
+		modelFreed.notify_one();
+	}
+}
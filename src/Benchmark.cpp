@@ -0,0 +1,226 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <GL/glew.h>
+
+#include "Benchmark.h"
+
+/** The camera's pitch and distance in the middle of the path, and how far they swing */
+#define PATH_PITCH 0.35f
+#define PATH_PITCH_SWING 0.15f
+#define PATH_DISTANCE 32.0f
+#define PATH_DISTANCE_SWING 5.0f
+
+Benchmark::Benchmark(CelShader& celShader, unsigned int framesPerScene)
+	: celShader(celShader),
+	  framesPerScene(std::max(framesPerScene, 1u)),
+	  countingPrimitives(false),
+	  scene(0),
+	  warmupFrame(0),
+	  frame(0)
+{
+	unsigned int i;
+
+	for (i = 0; i < BENCHMARK_SCENE_COUNT; i++) {
+		results[i].drawCount = 0;
+		results[i].primitiveCount = 0;
+	}
+
+	celShader.setFixedTimestep(BENCHMARK_TIMESTEP);
+	countingPrimitives = celShader.setCountPrimitives(true);
+}
+
+void Benchmark::setView(float t) {
+	float turn;
+
+	// One orbit around the scene, bobbing up and down twice and moving in and out once
+	turn = 2.0f * static_cast<float>(M_PI) * t;
+	celShader.setView(static_cast<unsigned char>(scene), turn, PATH_PITCH + PATH_PITCH_SWING * sinf(2.0f * turn),
+	                  PATH_DISTANCE + PATH_DISTANCE_SWING * cosf(turn));
+}
+
+bool Benchmark::runFrame() {
+	std::chrono::steady_clock::time_point start;
+	SceneResult *result;
+
+	if (scene >= BENCHMARK_SCENE_COUNT) {
+		return false;
+	}
+
+	// Warm up at the start of the path until the model has loaded and every program and mesh the scene needs
+	// has been created
+	if (warmupFrame < BENCHMARK_WARMUP_FRAMES) {
+		setView(0.0f);
+		celShader.step();
+		glFinish();
+
+		if (celShader.isSceneReady()) {
+			warmupFrame++;
+		}
+
+		// Every scene sees the light take the same path
+		if (warmupFrame == BENCHMARK_WARMUP_FRAMES) {
+			celShader.setLightAngle(0.0f);
+		}
+
+		return true;
+	}
+
+	result = &results[scene];
+	setView(static_cast<float>(frame) / framesPerScene);
+
+	// Wait for the GPU, otherwise only the time taken to queue the commands is measured
+	start = std::chrono::steady_clock::now();
+	celShader.step();
+	glFinish();
+	result->frameTimes.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+
+	result->drawCount += celShader.getDrawCount();
+	if (countingPrimitives) {
+		result->primitiveCount += celShader.getPrimitiveCount();
+	}
+
+	frame++;
+	if (frame == framesPerScene) {
+		scene++;
+		warmupFrame = 0;
+		frame = 0;
+	}
+
+	return scene < BENCHMARK_SCENE_COUNT;
+}
+
+Benchmark::Summary Benchmark::summarize(const SceneResult& result) {
+	std::vector<double> sorted;
+	Summary summary;
+	double total;
+	unsigned int i;
+
+	sorted = result.frameTimes;
+	std::sort(sorted.begin(), sorted.end());
+
+	total = 0.0;
+	for (i = 0; i < sorted.size(); i++) {
+		total += sorted[i];
+	}
+
+	summary.mean = total / sorted.size();
+	summary.p50 = percentile(sorted, 50.0);
+	summary.p95 = percentile(sorted, 95.0);
+	summary.p99 = percentile(sorted, 99.0);
+	summary.max = sorted.back();
+
+	return summary;
+}
+
+double Benchmark::percentile(const std::vector<double>& sorted, double percent) {
+	size_t rank;
+
+	rank = static_cast<size_t>(ceil(percent / 100.0 * sorted.size()));
+
+	return sorted[std::min(std::max(rank, static_cast<size_t>(1)), sorted.size()) - 1];
+}
+
+void Benchmark::printTable() const {
+	Summary summary;
+	unsigned int i;
+
+	std::cout << std::fixed << std::setprecision(3);
+	std::cout << "Benchmark with " << CelShader::getOutlineModeName(celShader.getOutlineMode()) << ", " << framesPerScene
+	          << " frames per scene, times in ms" << std::endl;
+	std::cout << std::setw(6) << "Scene" << std::setw(10) << "Mean" << std::setw(10) << "p50" << std::setw(10) << "p95"
+	          << std::setw(10) << "p99" << std::setw(10) << "Max" << std::setw(10) << "Draws" << std::setw(12) << "Primitives"
+	          << std::endl;
+
+	for (i = 0; i < BENCHMARK_SCENE_COUNT; i++) {
+		if (results[i].frameTimes.empty()) {
+			continue;
+		}
+
+		summary = summarize(results[i]);
+		std::cout << std::setw(6) << i << std::setw(10) << summary.mean << std::setw(10) << summary.p50 << std::setw(10)
+		          << summary.p95 << std::setw(10) << summary.p99 << std::setw(10) << summary.max << std::setw(10)
+		          << results[i].drawCount / results[i].frameTimes.size() << std::setw(12);
+
+		if (countingPrimitives) {
+			std::cout << results[i].primitiveCount / results[i].frameTimes.size() << std::endl;
+		}
+		else {
+			std::cout << "n/a" << std::endl;
+		}
+	}
+
+	std::cout.unsetf(std::ios_base::floatfield);
+	std::cout << std::setprecision(6);
+}
+
+bool Benchmark::writeJson(const std::string& path) const {
+	const char *separator;
+	Summary summary;
+	unsigned int i;
+
+	std::ofstream outFile(path.c_str(), std::ios_base::out);
+	if (!outFile.good()) {
+		return false;
+	}
+
+	// Draws and primitives are averages per frame, primitives are null without OpenGL 3.0. Primitives are everything
+	// the query counted, outline lines and points included, not just the triangles of the models
+	outFile << std::fixed << std::setprecision(4);
+	outFile << "{" << std::endl;
+	outFile << "\t\"outline_mode\": \"" << CelShader::getOutlineModeName(celShader.getOutlineMode()) << "\"," << std::endl;
+	outFile << "\t\"frames_per_scene\": " << framesPerScene << "," << std::endl;
+	outFile << "\t\"timestep_ms\": " << BENCHMARK_TIMESTEP * 1000.0f << "," << std::endl;
+	outFile << "\t\"scenes\": [";
+	separator = "";
+
+	for (i = 0; i < BENCHMARK_SCENE_COUNT; i++) {
+		if (results[i].frameTimes.empty()) {
+			continue;
+		}
+
+		summary = summarize(results[i]);
+		outFile << separator << std::endl;
+		separator = ",";
+		outFile << "\t\t{ \"scene\": " << i << ", \"frames\": " << results[i].frameTimes.size()
+		        << ", \"mean_ms\": " << summary.mean << ", \"p50_ms\": " << summary.p50 << ", \"p95_ms\": " << summary.p95
+		        << ", \"p99_ms\": " << summary.p99 << ", \"max_ms\": " << summary.max
+		        << ", \"draws\": " << static_cast<double>(results[i].drawCount) / results[i].frameTimes.size() << ", \"primitives\": ";
+
+		if (countingPrimitives) {
+			outFile << static_cast<double>(results[i].primitiveCount) / results[i].frameTimes.size() << " }";
+		}
+		else {
+			outFile << "null }";
+		}
+	}
+
+	outFile << std::endl << "\t]" << std::endl << "}" << std::endl;
+
+	return outFile.good();
+}
@@ -24,15 +24,16 @@
 #include <GL/glu.h>
 #include <GL/glut.h>
 
+#include <algorithm>
 #include <cstdlib>
-#include <ctime>
+#include <chrono>
 #include <cmath>
 #include <iostream>
 #include <fstream>
+#include <sstream>
 
 #include "CelShader.h"
 #include "MiscGL.h"
-#include "RawMeshLoader.h"
 
 #ifndef M_PI
 #	define M_PI 3.14159265358979323846264338327
@@ -44,23 +45,101 @@
 #define DRAW_GRID_ROWS 10
 #define DRAW_GRID_COLS 10
 
+/** The vertical field of view in degrees */
+#define FIELD_OF_VIEW 45.0f
+/** The largest error in pixels that a level of detail may show on screen */
+#define LOD_MAX_PIXEL_ERROR 1.0f
+/** The distances to the clipping planes */
+#define NEAR_PLANE 0.1f
+#define FAR_PLANE 100.0f
+/** How far from a silhouette, in pixels, the screen space outline reaches */
+#define OUTLINE_THICKNESS 3.0f
+/** The most copies of the loaded model the i key cycles up to */
+#define MAX_INSTANCES 100000
+/** The radius of the grid of copies, in radii of the model */
+#define INSTANCE_GRID_RADII 8.0f
+/** The file the c key writes the frame profile to, unless another was set */
+#define PROFILE_CSV_PATH "profile.csv"
+
+/** Two flat tones for the cube, whose faces never catch a highlight */
+static const ToonRamp CUBE_RAMP = { 2, { 0.5f }, { 0.6f, 1.0f }, false };
+/** Three diffuse bands for the cone */
+static const ToonRamp CONE_RAMP = { 3, { 0.3f, 0.7f }, { 0.4f, 0.7f, 1.0f }, false };
+/** The plane is a single tone */
+static const ToonRamp PLANE_RAMP = { 1, { }, { 0.8f }, false };
+/** Passes the colour through unchanged, for outlines that need the instanced vertex shader */
+static const ToonRamp OUTLINE_RAMP = { 1, { }, { 1.0f }, false };
+
+/** Back faces drawn as thick lines with a strict < depth test, without the shader */
+static const RenderState OUTLINE_STATE = { 0, GL_LINE, GL_FRONT, GL_LESS, 6.0f };
+/** Front faces filled with a <= depth test, so they draw over the outlines at the same depth. The program is
+ * the object's cel shader variant */
+static const RenderState FILL_STATE = { 0, GL_FILL, GL_BACK, GL_LEQUAL, 1.0f };
+/** The light sphere uses the fixed function pipeline */
+static const RenderState LIGHT_STATE = { 0, GL_FILL, GL_BACK, GL_LEQUAL, 1.0f };
+
+/** Packed normals and instances are fed through generic attributes, which have to be bound before linking */
+static const ProgramAttribBinding ATTRIB_BINDINGS[] = {
+	{ VERTEX_ATTRIB_OCT_NORMAL, "octNormal" },
+	{ VERTEX_ATTRIB_INSTANCE_ROW, "instanceRow0" },
+	{ VERTEX_ATTRIB_INSTANCE_ROW + 1, "instanceRow1" },
+	{ VERTEX_ATTRIB_INSTANCE_ROW + 2, "instanceRow2" },
+	{ VERTEX_ATTRIB_INSTANCE_COLOUR, "instanceColour" }
+};
+/** The number of entries in ATTRIB_BINDINGS */
+#define ATTRIB_BINDING_COUNT (sizeof(ATTRIB_BINDINGS) / sizeof(ATTRIB_BINDINGS[0]))
+
 CelShader::CelShader(int windowWidth, int windowHeight)
 	: windowWidth(windowWidth),
 	  windowHeight(windowHeight),
 	  celShaderProg(0),
+	  celShaderQuantizedProg(0),
+	  celShaderInstancedProg(0),
+	  celShaderInstancedQuantizedProg(0),
+	  lastCelKey(),
+	  lastCelProgram(0),
 	  lightPos(10.0f, 5.0f, 0.0f, 1.0f),
 	  angle(0),
 	  viewAngleXZ(0.0f),
 	  pitch(0.0f),
 	  camDistance(35.0f),
-	  prevTime(clock()),
+	  prevTime(std::chrono::steady_clock::now()),
 	  scene(0),
-	  dT(0)
+	  programCache(PROGRAM_CACHE_DIRECTORY),
+	  meshLoader(CEL_MODEL_PATH, threadPool),
+	  lodLevel(0),
+	  instanceCount(1),
+	  instanceScale(1.0f),
+	  windowTitle("Cel Shader"),
+	  loadingFrameTime(0.0f),
+	  dT(0),
+	  fixedTimestep(0.0f),
+	  quantizeMeshes(false),
+	  windowed(true),
+	  renderQueue(NEAR_PLANE, FAR_PLANE),
+	  outlineMode(OUTLINE_BACK_FACES),
+	  outlineProg(0),
+	  primitivesQuery(0),
+	  showProfiler(false)
 {
+	// In the order of ProfilerSection
+	profiler.addSection("scene");
+	profiler.addSection("outlines");
+	profiler.addSection("fill");
+	profiler.addSection("light");
+	profiler.addSection("composite");
+
+	resetOutlineTiming();
+	cullStats.nodesTested = 0;
+	cullStats.clusterCount = 0;
+	cullStats.clustersVisible = 0;
+	cullStats.triangleCount = 0;
+	cullStats.trianglesVisible = 0;
+	cullStats.drawRanges = 0;
 }
 
 CelShader::~CelShader() {
-	meshLoader.releaseArrays();
+	meshLoader.release();
 }
 
 bool CelShader::loadShader(const std::string& path, GLchar** source) {
@@ -125,17 +204,119 @@ void CelShader::printShaderInfoLog(GLuint shader) {
 	}
 }
 
-bool CelShader::setupShaders(const std::string& vertexShaderSourcePath, const std::string& fragmentShaderSourcePath) {
+bool CelShader::setupShaders(const std::string& vertexShaderSourcePath, const std::string& fragmentShaderSourcePath,
+                             const std::string& quantizedVertexShaderSourcePath) {
+	celVertexShaderPath = vertexShaderSourcePath;
+	celQuantizedVertexShaderPath = quantizedVertexShaderSourcePath;
+	celFragmentShaderPath = fragmentShaderSourcePath;
+
+	// The default ramp, which variants that fail to compile fall back to
+	celShaderProg = createDefaultProgram(false, false);
+
+	if (celShaderProg == 0) {
+		return false;
+	}
+
+	// Quantized meshes decode their normals in the vertex shader, the fragment shader is shared. Without
+	// it meshes are simply uploaded unquantized
+	celShaderQuantizedProg = createDefaultProgram(true, false);
+
+	glUseProgram(celShaderProg);
+
+	return true;
+}
+
+GLuint CelShader::getCelProgram(const ToonRamp& ramp, bool quantized, bool instanced) {
+	std::map<CelProgramKey, GLuint>::iterator it;
+	std::string vertexShaderPath;
+	std::string defines;
+	CelProgramKey key;
+	CelProgramKey fallbackKey;
+	GLuint program;
+
+	key.ramp = ramp;
+	key.quantized = quantized;
+	key.instanced = instanced;
+	key.writeNormals = (outlineMode == OUTLINE_SCREEN_SPACE);
+
+	// This is asked for every draw, and the defines are only built when a variant has to be compiled
+	if ((lastCelProgram != 0) && (key == lastCelKey)) {
+		return lastCelProgram;
+	}
+
+	it = celPrograms.find(key);
+	if (it != celPrograms.end()) {
+		program = it->second;
+	}
+	else {
+		defines = ShaderPermutation::buildDefines(ramp, key.writeNormals);
+
+		// The instanced vertex shader handles both vertex layouts itself
+		if (instanced) {
+			vertexShaderPath = celInstancedVertexShaderPath;
+			defines = std::string("#define QUANTIZED ") + (quantized ? "1" : "0") + "\n" + defines;
+		}
+		else {
+			vertexShaderPath = quantized ? celQuantizedVertexShaderPath : celVertexShaderPath;
+		}
+
+		program = vertexShaderPath.empty() ? 0 : createProgram(vertexShaderPath, celFragmentShaderPath, defines);
+		celPrograms[key] = program;
+	}
+
+	if (program == 0) {
+		// Fall back on the default ramp with the same inputs and outputs, and only then on the default programs
+		fallbackKey = key;
+		fallbackKey.ramp = ShaderPermutation::defaultRamp();
+
+		if (!(key == fallbackKey)) {
+			program = getCelProgram(fallbackKey.ramp, quantized, instanced);
+		}
+		else if (instanced) {
+			program = quantized ? celShaderInstancedQuantizedProg : celShaderInstancedProg;
+		}
+		else {
+			program = quantized ? celShaderQuantizedProg : celShaderProg;
+		}
+	}
+
+	lastCelKey = key;
+	lastCelProgram = program;
+
+	return program;
+}
+
+GLuint CelShader::createProgram(const std::string& vertexShaderSourcePath, const std::string& fragmentShaderSourcePath,
+                                const std::string& defines) {
+	GLuint program;
 	GLuint vertexShader;
 	GLuint fragmentShader;
 	GLint vertCompiled;
 	GLint fragCompiled;
 	GLint linked;
-	GLchar* vertexShaderSource;
-	GLchar* fragmentShaderSource;
+	GLchar* source;
+	std::string vertexShaderSource;
+	std::string fragmentShaderSource;
+	const GLchar* sourcePointer;
+	unsigned int i;
 
-	if ((!loadShader(vertexShaderSourcePath, &vertexShaderSource)) || (!loadShader(fragmentShaderSourcePath, &fragmentShaderSource))) {
-		return false;
+	// The defines go in front of each source, so they also end up in the cache key
+	if (!loadShader(vertexShaderSourcePath, &source)) {
+		return 0;
+	}
+	vertexShaderSource = defines + source;
+	delete[] source;
+
+	if (!loadShader(fragmentShaderSourcePath, &source)) {
+		return 0;
+	}
+	fragmentShaderSource = defines + source;
+	delete[] source;
+
+	// A program this driver has linked from the same sources before is restored without compiling
+	program = programCache.load(vertexShaderSource.c_str(), fragmentShaderSource.c_str(), ATTRIB_BINDINGS, ATTRIB_BINDING_COUNT);
+	if (program != 0) {
+		return program;
 	}
 
 	// Create shader objects
@@ -143,12 +324,10 @@ bool CelShader::setupShaders(const std::string& vertexShaderSourcePath, const st
 	fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
 
 	// Associate the shaders with their source files
-	glShaderSource(vertexShader, 1, const_cast<const GLchar**>(&vertexShaderSource), NULL);
-	glShaderSource(fragmentShader, 1, const_cast<const GLchar**>(&fragmentShaderSource), NULL);
-
-	// glShaderSource copies the source arrays, so we can delete them now
-	delete[] vertexShaderSource;
-	delete[] fragmentShaderSource;
+	sourcePointer = vertexShaderSource.c_str();
+	glShaderSource(vertexShader, 1, &sourcePointer, NULL);
+	sourcePointer = fragmentShaderSource.c_str();
+	glShaderSource(fragmentShader, 1, &sourcePointer, NULL);
 
 	//Compile the vertex shader
 	glCompileShader(vertexShader);
@@ -164,29 +343,286 @@ bool CelShader::setupShaders(const std::string& vertexShaderSourcePath, const st
 
 	if ((!vertCompiled) || (!fragCompiled)) {
 		std::cout << "compile error " << vertCompiled << " " << fragCompiled << std::endl;
-		return false;
+		glDeleteShader(vertexShader);
+		glDeleteShader(fragmentShader);
+		return 0;
 	}
 
 	// Create a program object to attach the shaders too
-	celShaderProg = glCreateProgram();
-	glAttachShader(celShaderProg, vertexShader);
-	glAttachShader(celShaderProg, fragmentShader);
+	program = glCreateProgram();
+	glAttachShader(program, vertexShader);
+	glAttachShader(program, fragmentShader);
+
+	for (i = 0; i < ATTRIB_BINDING_COUNT; i++) {
+		glBindAttribLocation(program, ATTRIB_BINDINGS[i].index, ATTRIB_BINDINGS[i].name);
+	}
+
+	// Ask the driver to keep the binary around, so it can be written to the cache
+	if (programCache.isEnabled()) {
+		glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+	}
 
 	// Link the program
-	glLinkProgram(celShaderProg);
+	glLinkProgram(program);
 // 	printOpenGLError();
-	glGetProgramiv(celShaderProg, GL_LINK_STATUS, &linked);
-// 	printProgramInfoLog(celShaderProg);
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+// 	printProgramInfoLog(program);
+
+	// The program keeps the shaders alive for as long as it needs them
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
 
 	if (!linked) {
+		glDeleteProgram(program);
+		program = 0;
+	}
+	else {
+		programCache.store(vertexShaderSource.c_str(), fragmentShaderSource.c_str(), ATTRIB_BINDINGS, ATTRIB_BINDING_COUNT, program);
+	}
+
+	return program;
+}
+
+ProgramCache& CelShader::getProgramCache() {
+	return programCache;
+}
+
+void CelShader::setQuantizeMeshes(bool quantize) {
+	quantizeMeshes = quantize;
+}
+
+bool CelShader::setupOutlineShaders(const std::string& vertexShaderSourcePath, const std::string& fragmentShaderSourcePath) {
+	if (!OutlineRenderer::isSupported()) {
 		return false;
 	}
 
-	glUseProgram(celShaderProg);
+	outlineProg = createProgram(vertexShaderSourcePath, fragmentShaderSourcePath);
+	outlineRenderer.setProgram(outlineProg);
+
+	return outlineProg != 0;
+}
+
+bool CelShader::setOutlineMode(OutlineMode mode) {
+	bool writeNormalsChanged;
+
+	if ((mode == OUTLINE_SCREEN_SPACE) && ((outlineProg == 0) || (!outlineRenderer.resize(windowWidth, windowHeight)))) {
+		std::cout << "Screen space outlines are not available" << std::endl;
+		return false;
+	}
+
+	// The targets are only needed while they are drawn into
+	if (mode != OUTLINE_SCREEN_SPACE) {
+		outlineRenderer.release();
+	}
+
+	writeNormalsChanged = ((mode == OUTLINE_SCREEN_SPACE) != (outlineMode == OUTLINE_SCREEN_SPACE));
+	outlineMode = mode;
+	std::cout << "Drawing " << getOutlineModeName(outlineMode) << std::endl;
+
+	// The default programs have to write the normals exactly when the screen space outlines read them
+	if (writeNormalsChanged) {
+		replaceProgram(celShaderProg, createDefaultProgram(false, false));
+		replaceProgram(celShaderQuantizedProg, createDefaultProgram(true, false));
+		replaceProgram(celShaderInstancedProg, createDefaultProgram(false, true));
+		replaceProgram(celShaderInstancedQuantizedProg, createDefaultProgram(true, true));
+		lastCelProgram = 0;
+	}
+
+	return true;
+}
+
+bool CelShader::setupInstancedShaders(const std::string& vertexShaderSourcePath) {
+	if (!InstanceBuffer::isSupported()) {
+		return false;
+	}
+
+	// The default programs check that the shader compiles at all, the variants are compiled as they are needed
+	celInstancedVertexShaderPath = vertexShaderSourcePath;
+	celShaderInstancedProg = createDefaultProgram(false, true);
+	if (celShaderInstancedProg == 0) {
+		celInstancedVertexShaderPath.clear();
+		return false;
+	}
+
+	celShaderInstancedQuantizedProg = createDefaultProgram(true, true);
+
+	return true;
+}
+
+GLuint CelShader::createDefaultProgram(bool quantized, bool instanced) {
+	std::string vertexShaderPath;
+	std::string defines;
+
+	defines = ShaderPermutation::buildDefines(ShaderPermutation::defaultRamp(), outlineMode == OUTLINE_SCREEN_SPACE);
+	if (instanced) {
+		vertexShaderPath = celInstancedVertexShaderPath;
+		defines = std::string("#define QUANTIZED ") + (quantized ? "1" : "0") + "\n" + defines;
+	}
+	else {
+		vertexShaderPath = quantized ? celQuantizedVertexShaderPath : celVertexShaderPath;
+	}
+
+	// Before the shaders are set up there is nothing to build
+	if (vertexShaderPath.empty()) {
+		return 0;
+	}
+
+	return createProgram(vertexShaderPath, celFragmentShaderPath, defines);
+}
+
+void CelShader::replaceProgram(GLuint& program, GLuint replacement) {
+	// A program that fails to build leaves the old one, which still draws, in place
+	if (replacement == 0) {
+		return;
+	}
+
+	if (program != 0) {
+		glDeleteProgram(program);
+	}
+	program = replacement;
+}
+
+bool CelShader::setInstanceCount(unsigned int count) {
+	count = std::max(count, 1u);
+
+	if ((count > 1) && (celInstancedVertexShaderPath.empty())) {
+		std::cout << "Instancing is not available" << std::endl;
+		return false;
+	}
+
+	instanceCount = count;
+
+	return true;
+}
+
+void CelShader::setTargetFramebuffer(GLuint framebuffer) {
+	outlineRenderer.setTargetFramebuffer(framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+}
+
+void CelShader::setWindowed(bool windowed) {
+	this->windowed = windowed;
+}
+
+void CelShader::setView(unsigned char scene, float viewAngle, float pitch, float distance) {
+	this->scene = scene % 3;
+	viewAngleXZ = viewAngle;
+	this->pitch = pitch;
+	camDistance = distance;
+}
+
+bool CelShader::isSceneReady() const {
+	AsyncMeshLoader::State state;
+
+	state = meshLoader.getState();
+
+	// A model that failed to load is as ready as it will ever be
+	return (scene != CEL_MODEL_SCENE) || (state == AsyncMeshLoader::STATE_READY) || (state == AsyncMeshLoader::STATE_FAILED);
+}
+
+void CelShader::setFixedTimestep(float timestep) {
+	fixedTimestep = std::max(timestep, 0.0f);
+}
+
+void CelShader::setLightAngle(float angle) {
+	this->angle = angle;
+}
+
+bool CelShader::setCountPrimitives(bool count) {
+	if ((count) && (primitivesQuery == 0) && (GLEW_VERSION_3_0)) {
+		glGenQueries(1, &primitivesQuery);
+	}
+	else if ((!count) && (primitivesQuery != 0)) {
+		glDeleteQueries(1, &primitivesQuery);
+		primitivesQuery = 0;
+	}
+
+	return (primitivesQuery != 0) == count;
+}
+
+GLuint CelShader::getPrimitiveCount() {
+	GLuint count;
+
+	count = 0;
+	if (primitivesQuery != 0) {
+		glGetQueryObjectuiv(primitivesQuery, GL_QUERY_RESULT, &count);
+	}
+
+	return count;
+}
+
+FrameProfiler& CelShader::getProfiler() {
+	return profiler;
+}
+
+void CelShader::setProfileCsvPath(const std::string& path) {
+	profileCsvPath = path;
+}
+
+bool CelShader::writeProfile(const std::string& path) const {
+	if (!profiler.writeCsv(path)) {
+		std::cout << "Could not write the frame profile to " << path << std::endl;
+		return false;
+	}
 
 	return true;
 }
 
+unsigned int CelShader::getDrawCount() const {
+	return renderQueue.getDrawCount();
+}
+
+CelShader::OutlineMode CelShader::getOutlineMode() const {
+	return outlineMode;
+}
+
+const char* CelShader::getOutlineModeName(OutlineMode mode) {
+	static const char *names[OUTLINE_MODE_COUNT] = { "back face outlines", "screen space outlines", "silhouette edge outlines" };
+
+	return (mode < OUTLINE_MODE_COUNT) ? names[mode] : "unknown outlines";
+}
+
+void CelShader::resetOutlineTiming() {
+	unsigned int mode;
+
+	for (mode = 0; mode < OUTLINE_MODE_COUNT; mode++) {
+		outlineFrameTime[mode] = 0.0;
+		outlineFrameCount[mode] = 0;
+	}
+}
+
+void CelShader::reportOutlineTiming() const {
+	unsigned int frames;
+	unsigned int mode;
+
+	frames = 0;
+	for (mode = 0; mode < OUTLINE_MODE_COUNT; mode++) {
+		frames += outlineFrameCount[mode];
+	}
+
+	if (frames == 0) {
+		return;
+	}
+
+	std::cout << "Scene " << static_cast<int>(scene);
+	if ((scene == CEL_MODEL_SCENE) && (instanceCount > 1)) {
+		std::cout << " with " << instanceCount << " instances";
+	}
+	std::cout << " average frame time:";
+	for (mode = 0; mode < OUTLINE_MODE_COUNT; mode++) {
+		if (outlineFrameCount[mode] > 0) {
+			std::cout << " " << getOutlineModeName(static_cast<OutlineMode>(mode)) << " " << outlineFrameTime[mode] * 1000.0 / outlineFrameCount[mode] << "ms ("
+			          << outlineFrameCount[mode] << " frames)";
+		}
+		else {
+			std::cout << " " << getOutlineModeName(static_cast<OutlineMode>(mode)) << " not measured";
+		}
+
+		std::cout << ((mode + 1 < OUTLINE_MODE_COUNT) ? "," : "");
+	}
+	std::cout << std::endl;
+}
+
 void CelShader::reshapeWindow(int windowWidth, int windowHeight) {
 	GLfloat ratio;
 
@@ -200,7 +636,7 @@ void CelShader::reshapeWindow(int windowWidth, int windowHeight) {
 	glLoadIdentity();
 
 	/* Set the perspective */
- 	gluPerspective(45.0f, ratio, 0.1f, 100.0f);
+ 	gluPerspective(FIELD_OF_VIEW, ratio, NEAR_PLANE, FAR_PLANE);
 
 	/* Setup the viewport */
 	glViewport(0, 0, static_cast<GLsizei>(windowWidth), static_cast<GLsizei>(windowHeight));
@@ -210,14 +646,35 @@ void CelShader::reshapeWindow(int windowWidth, int windowHeight) {
 
 	/* Reset The View */
 	glLoadIdentity();
+
+	// The screen space outline targets have to match the window, a minimized window keeps the old ones
+	if ((outlineMode == OUTLINE_SCREEN_SPACE) && (windowWidth > 0) && (windowHeight > 0) &&
+	    (!outlineRenderer.resize(windowWidth, windowHeight))) {
+		std::cout << "Could not create the outline framebuffer, drawing back face outlines" << std::endl;
+		setOutlineMode(OUTLINE_BACK_FACES);
+	}
 }
 
 void CelShader::quit() {
-	meshLoader.releaseArrays();
+	reportOutlineTiming();
+
+	meshLoader.release();
+	meshBuffer.release();
+	instanceBuffer.release();
+	primitives.release();
+	outlineRenderer.release();
+	setCountPrimitives(false);
+
+	if ((!profileCsvPath.empty()) && (writeProfile(profileCsvPath))) {
+		std::cout << "Frame profile written to " << profileCsvPath << std::endl;
+	}
+	profiler.release();
 	exit(0);
 }
 
 void CelShader::keyboardHandler(int key, int x, int y) {
+	OutlineMode mode;
+
 	switch (key) {
 		case 27: //Escape
 			quit();
@@ -256,7 +713,36 @@ void CelShader::keyboardHandler(int key, int x, int y) {
 		case '-':
 			camDistance *= 1.1f;
 			break;
+		case 'i':
+			// Frame times with different numbers of copies can't be compared
+			reportOutlineTiming();
+			resetOutlineTiming();
+
+			setInstanceCount((instanceCount >= MAX_INSTANCES) ? 1 : instanceCount * 10);
+			std::cout << instanceCount << " instances" << std::endl;
+			break;
+		case 'p':
+			showProfiler = !showProfiler;
+			break;
+		case 'c':
+			if (writeProfile(profileCsvPath.empty() ? PROFILE_CSV_PATH : profileCsvPath)) {
+				std::cout << "Frame profile written" << std::endl;
+			}
+			break;
+		case 'o':
+			reportOutlineTiming();
+
+			// Move on to the next mode that is available, back face outlines always are
+			mode = outlineMode;
+			do {
+				mode = static_cast<OutlineMode>((mode + 1) % OUTLINE_MODE_COUNT);
+			} while (!setOutlineMode(mode));
+			break;
 		default:
+			// Frame times of different scenes can't be compared
+			reportOutlineTiming();
+			resetOutlineTiming();
+
 			pitch = 0.0f;
 			viewAngleXZ = 0.0f;
 			camDistance = 35.0f;
@@ -275,8 +761,26 @@ void CelShader::mouseMotionHandler(int x, int y) {
 }
 
 void CelShader::step() {
-	dT = ((double) (clock() - prevTime)) / (double) CLOCKS_PER_SEC;
-	prevTime = clock();
+	std::chrono::steady_clock::time_point now;
+
+	// Measure wall clock time, clock() would also count the time spent by the loading threads
+	now = std::chrono::steady_clock::now();
+	dT = std::chrono::duration<float>(now - prevTime).count();
+	prevTime = now;
+
+	if (meshLoader.isBusy()) {
+		loadingFrameTime = std::max(loadingFrameTime, dT);
+	}
+	else if (fixedTimestep == 0.0f) {
+		// Loading frames would skew the comparison between the outline techniques
+		outlineFrameTime[outlineMode] += dT;
+		outlineFrameCount[outlineMode]++;
+	}
+
+	// A fixed timestep makes the animation the same on every run, however long the frames take
+	if (fixedTimestep > 0.0f) {
+		dT = fixedTimestep;
+	}
 
 	// Increase the parameter for the movement of the light
 	angle += dT * 0.5f;
@@ -292,92 +796,93 @@ void CelShader::step() {
 	draw();
 }
 
+void CelShader::queueOutline(const std::function<void()>& draw, GLuint program) {
+	static const GLfloat black[3] = { 0.0f, 0.0f, 0.0f };
+	RenderState state;
+
+	// The screen space pass finds the outlines from the filled geometry alone
+	if (outlineMode == OUTLINE_SCREEN_SPACE) {
+		return;
+	}
+
+	state = OUTLINE_STATE;
+	state.program = program;
+
+	renderQueue.submit(RenderQueue::PASS_OUTLINE, state, black, draw);
+}
+
+void CelShader::queueFill(const ToonRamp& ramp, bool quantized, const GLfloat color[3], const std::function<void()>& draw,
+                          bool instanced) {
+	RenderState state;
+
+	// Render the front faces, filled, using the depth buffer test of <= so that we can render over anything
+	// that is deeper or at the same depth. Thus only the thick outlines of the first pass remain. Each object
+	// uses the cheapest variant of the cel shader it needs
+	state = FILL_STATE;
+	state.program = getCelProgram(ramp, quantized, instanced);
+
+	renderQueue.submit(RenderQueue::PASS_FILL, state, color, draw);
+}
+
 void CelShader::renderBasicScene() {
+	static const GLfloat green[3] = { 0.0f, 1.0f, 0.0f };
+	const MeshBuffer *mesh;
+	std::function<void()> torus;
+
+	mesh = &primitives.getTorus(2.0f, 5.0f, 20, 40);
+	torus = [mesh]() { mesh->draw(false); };
+
 	glPushMatrix();
 
 	glRotatef(115, 1.0f, 0.0f, 0.0f);
 
-	// Render the back faces only, in wireframe first with thick black lines is a strict < test in the
-	// depth buffer
- 	glLineWidth(6.0f);
- 	glPolygonMode(GL_BACK, GL_LINE);
-	glDepthFunc(GL_LESS);
-	glCullFace(GL_FRONT);
- 	glColor3f(0.0f, 0.0f, 0.0f);
-	// Don't use the shader when rendering the wireframe back faces
-	glUseProgram(0);
- 	glutSolidTorus(2.0f, 5.0f, 20, 40);
-
-	// Render the front faces, filled, using the depth buffer test of <= so that we can render over anything
-	// that is deeper or at the same depth. Thus only the thick outlines of the first render remain
- 	glLineWidth(1.0f);
- 	glPolygonMode(GL_FRONT, GL_FILL);
-	glDepthFunc(GL_LEQUAL);
-	glCullFace(GL_BACK);
- 	glColor3f(0.0f, 1.0f, 0.0f);
-	// Use the cel shader when rendering
-	glUseProgram(celShaderProg);
-/*	glColor3f(0.0f, 1.0f, 0.0f);*/
- 	glutSolidTorus(2.0f, 5.0f, 20, 40);
+	queueOutline(torus);
+	queueFill(ShaderPermutation::defaultRamp(), false, green, torus);
 
 	glPopMatrix();
 }
 
 void CelShader::renderMoreComplexScene() {
+	static const GLfloat red[3] = { 1.0f, 0.0f, 0.0f };
+	static const GLfloat green[3] = { 0.0f, 1.0f, 0.0f };
+	static const GLfloat orange[3] = { 0.75f, 0.5f, 0.0f };
+	static const GLfloat blue[3] = { 0.0f, 0.5f, 0.75f };
+	const MeshBuffer *cubeMesh;
+	const MeshBuffer *sphereMesh;
+	const MeshBuffer *coneMesh;
+	const MeshBuffer *planeMesh;
+	std::function<void()> cube;
+	std::function<void()> sphere;
+	std::function<void()> cone;
+	std::function<void()> plane;
+
+	cubeMesh = &primitives.getCube(4.0f);
+	sphereMesh = &primitives.getSphere(3.0f, 80, 40);
+	coneMesh = &primitives.getCone(5.0f, 8.0f, 20, 20);
+	planeMesh = &primitives.getPlane(10.0f);
+
+	// The colour arrays are left off, every object has a single colour
+	cube = [cubeMesh]() { cubeMesh->draw(false); };
+	sphere = [sphereMesh]() { sphereMesh->draw(false); };
+	cone = [coneMesh]() { coneMesh->draw(false); };
+	plane = [planeMesh]() { planeMesh->draw(false); };
+
 	// Render the cube
 	glPushMatrix();
 	glRotatef(45, 0.0f, 1.0f, 0.0f);
 
-	// Render the back faces only, in wireframe first with thick black lines is a strict < test in the
-	// depth buffer
- 	glLineWidth(6.0f);
- 	glPolygonMode(GL_BACK, GL_LINE);
-	glDepthFunc(GL_LESS);
-	glCullFace(GL_FRONT);
- 	glColor3f(0.0f, 0.0f, 0.0f);
-	glUseProgram(0);
-	glutSolidCube(4.0f);
-
-	// Render the front faces, filled, using the depth buffer test of <= so that we can render over anything
-	// that is deeper or at the same depth. Thus only the thick outlines of the first render remain
- 	glLineWidth(1.0f);
- 	glPolygonMode(GL_FRONT, GL_FILL);
-	glDepthFunc(GL_LEQUAL);
-	glCullFace(GL_BACK);
- 	glColor3f(1.0f, 0.0f, 0.0f);
-	glUseProgram(celShaderProg);
-/*	glColor3f(0.0f, 1.0f, 0.0f);*/
-	glutSolidCube(4.0f);
+	queueOutline(cube);
+	queueFill(CUBE_RAMP, false, red, cube);
 
 	glPopMatrix();
 
 	// Render a sphere
 	glPushMatrix();
 	glTranslatef(-10.0f, 0.0f, 0.0f);
-// 	glFrontFace(GL_CW);
-
-	// Render the back faces only, in wireframe first with thick black lines is a strict < test in the
-	// depth buffer
- 	glLineWidth(6.0f);
- 	glPolygonMode(GL_BACK, GL_LINE);
-	glDepthFunc(GL_LESS);
-	glCullFace(GL_FRONT);
- 	glColor3f(0.0f, 0.0f, 0.0f);
-	glUseProgram(0);
-	glutSolidSphere(3.0f, 80, 40);
 
-	// Render the front faces, filled, using the depth buffer test of <= so that we can render over anything
-	// that is deeper or at the same depth. Thus only the thick outlines of the first render remain
- 	glLineWidth(1.0f);
- 	glPolygonMode(GL_FRONT, GL_FILL);
-	glDepthFunc(GL_LEQUAL);
-	glCullFace(GL_BACK);
- 	glColor3f(0.0f, 1.0f, 0.0f);
-	glUseProgram(celShaderProg);
-/*	glColor3f(0.0f, 1.0f, 0.0f);*/
-	glutSolidSphere(3.0f, 80, 40);
+	queueOutline(sphere);
+	queueFill(ShaderPermutation::defaultRamp(), false, green, sphere);
 
-// 	glFrontFace(GL_CCW);
 	glPopMatrix();
 
 	// Render the cone
@@ -385,26 +890,8 @@ void CelShader::renderMoreComplexScene() {
 	glTranslatef(10.0f, -5.0f, 0.0f);
 	glRotatef(-90, 1.0f, 0.0f, 0.0f);
 
-	// Render the back faces only, in wireframe first with thick black lines is a strict < test in the
-	// depth buffer
- 	glLineWidth(6.0f);
- 	glPolygonMode(GL_BACK, GL_LINE);
-	glDepthFunc(GL_LESS);
-	glCullFace(GL_FRONT);
- 	glColor3f(0.0f, 0.0f, 0.0f);
-	glUseProgram(0);
-	glutSolidCone(5.0, 8.0, 20, 20);
-
-	// Render the front faces, filled, using the depth buffer test of <= so that we can render over anything
-	// that is deeper or at the same depth. Thus only the thick outlines of the first render remain
- 	glLineWidth(1.0f);
- 	glPolygonMode(GL_FRONT, GL_FILL);
-	glDepthFunc(GL_LEQUAL);
-	glCullFace(GL_BACK);
- 	glColor3f(0.75f, 0.5f, 0.0f);
-	glUseProgram(celShaderProg);
-/*	glColor3f(0.0f, 1.0f, 0.0f);*/
-	glutSolidCone(5.0, 8.0, 20, 20);
+	queueOutline(cone);
+	queueFill(CONE_RAMP, false, orange, cone);
 
 	glPopMatrix();
 
@@ -413,61 +900,49 @@ void CelShader::renderMoreComplexScene() {
 	glTranslatef(-5.0f, -10.0f, 0.0f);
  	glRotatef(-45, 1.0f, 0.0f, 0.0f);
 
-	// Render the back faces only, in wireframe first with thick black lines is a strict < test in the
-	// depth buffer
- 	glLineWidth(6.0f);
- 	glPolygonMode(GL_BACK, GL_LINE);
-	glDepthFunc(GL_LESS);
-	glCullFace(GL_FRONT);
-	glUseProgram(0);
-	glBegin(GL_QUADS);
-	 	glColor3f(0.0f, 0.0f, 0.0f);
-		glNormal3f(0.0f, 0.0f, 1.0f);
-		glVertex3f(5.0f, 5.0f, 0.0f);
-		glVertex3f(-5.0f, 5.0f, 0.0f);
-		glVertex3f(-5.0f, -5.0f, 0.0f);
-		glVertex3f(5.0f, -5.0f, 0.0f);
-
-		// Have to render a back face, CW order
-		glNormal3f(0.0f, 0.0f, -1.0f);
-		glVertex3f(5.0f, -5.0f, 0.0f);
-		glVertex3f(-5.0f, -5.0f, 0.0f);
-		glVertex3f(-5.0f, 5.0f, 0.0f);
-		glVertex3f(5.0f, 5.0f, 0.0f);
-	glEnd();
-
-	// Render the front faces, filled, using the depth buffer test of <= so that we can render over anything
-	// that is deeper or at the same depth. Thus only the thick outlines of the first render remain
- 	glLineWidth(1.0f);
- 	glPolygonMode(GL_FRONT, GL_FILL);
-	glDepthFunc(GL_LEQUAL);
-	glCullFace(GL_BACK);
-	glUseProgram(celShaderProg);
-	glBegin(GL_QUADS);
-	 	glColor3f(0.0f, 0.5f, 0.75f);
-		glNormal3f(0.0f, 0.0f, 1.0f);
-		glVertex3f(5.0f, 5.0f, 0.0f);
-		glVertex3f(-5.0f, 5.0f, 0.0f);
-		glVertex3f(-5.0f, -5.0f, 0.0f);
-		glVertex3f(5.0f, -5.0f, 0.0f);
-
-		// Have to render a back face, CW order
-		glNormal3f(0.0f, 0.0f, -1.0f);
-		glVertex3f(5.0f, -5.0f, 0.0f);
-		glVertex3f(-5.0f, -5.0f, 0.0f);
-		glVertex3f(-5.0f, 5.0f, 0.0f);
-		glVertex3f(5.0f, 5.0f, 0.0f);
-	glEnd();
+	queueOutline(plane);
+	queueFill(PLANE_RAMP, false, blue, plane);
 
 	glPopMatrix();
 }
 
+void CelShader::selectLod(const GLfloat center[3], GLfloat radius, GLfloat errorScale) {
+	GLfloat distance;
+	GLfloat pixelsPerUnit;
+	unsigned int level;
+
+	// The camera orbits the origin, so no part of the model can be closer than this
+	distance = camDistance - sqrtf(center[0] * center[0] + center[1] * center[1] + center[2] * center[2]) - radius;
+	distance = std::max(distance, 0.1f);
+
+	// The size of one model unit in pixels at that distance
+	pixelsPerUnit = windowHeight / (2.0f * distance * tanf(FIELD_OF_VIEW * 0.5f * M_PI / 180.0f));
+
+	level = 0;
+	while ((level + 1 < meshBuffer.getLodCount()) && (meshBuffer.getLod(level + 1).error * errorScale * pixelsPerUnit <= LOD_MAX_PIXEL_ERROR)) {
+		level++;
+	}
+
+	if (level != lodLevel) {
+		std::cout << "LOD " << level << " (" << meshBuffer.getLod(level).indexCount / 3 << " triangles)" << std::endl;
+		lodLevel = level;
+	}
+}
+
 void CelShader::renderComplexScene() {
+	static const GLfloat white[3] = { 1.0f, 1.0f, 1.0f };
+	GLfloat center[3];
+	GLfloat radius;
 
-	// Load the mesh from file if it hasn't been loaded yet
-	if (meshLoader.getSize() == 0) {
-		std::cout << "Loading concept-sedan-02-sport.raw... (this may take a couple of seconds)" << std::endl;
-		std::cout << "Vertices = " << meshLoader.load("models/concept-sedan-02-sport.raw") << std::endl;
+	// Show the previous scene until the model has been loaded and uploaded
+	if (!meshBuffer.isUploaded()) {
+		renderMoreComplexScene();
+		return;
+	}
+
+	if (instanceCount > 1) {
+		renderInstances();
+		return;
 	}
 
 	glPushMatrix();
@@ -475,47 +950,175 @@ void CelShader::renderComplexScene() {
  	//glRotatef(45, 0.0f, 1.0f, 0.0f);
  	//glRotatef(-90, 1.0f, 0.0f, 0.0f);
 
-	// Render the back faces only, in wireframe first with thick black lines is a strict < test in the
-	// depth buffer
- 	glLineWidth(6.0f);
- 	glPolygonMode(GL_BACK, GL_LINE);
-	glDepthFunc(GL_LESS);
-	glCullFace(GL_FRONT);
-	glUseProgram(0);
-
-	// Disable the color array for glDrawArrays, as we want to use black at every vertex
-	glDisableClientState(GL_COLOR_ARRAY);
-	// Load the normal and vertex arrays from the mesh
-	glNormalPointer(GL_FLOAT, 0, meshLoader.getNormalArray());
-	glVertexPointer(3, GL_FLOAT, 0, meshLoader.getVertexArray());
-	glColor3f(0.0f, 0.0f, 0.0f);
-	glDrawArrays(GL_TRIANGLES, 0, meshLoader.getSize());
+	meshBuffer.getBoundingSphere(center, radius);
+	selectLod(center, radius, 1.0f);
 
-	// Render the front faces, filled, using the depth buffer test of <= so that we can render over anything
-	// that is deeper or at the same depth. Thus only the thick outlines of the first render remain
- 	glLineWidth(1.0f);
- 	glPolygonMode(GL_FRONT, GL_FILL);
-	glDepthFunc(GL_LEQUAL);
-	glCullFace(GL_BACK);
-	glUseProgram(celShaderProg);
+	// Only the clusters inside the view volume are drawn, in both passes
+	frustum.extractFromGL();
+	meshLoader.getClusterBvh().cull(frustum, lodLevel, meshBuffer.getIndexSize(), drawCounts, drawOffsets, cullStats);
+
+	// Draw without the color array, as we want to use black at every vertex
+	if (outlineMode == OUTLINE_SILHOUETTE_EDGES) {
+		queueOutline([this]() { renderSilhouette(); });
+	}
+	else {
+		queueOutline([this]() {
+			meshBuffer.drawRanges(false, drawCounts.data(), drawOffsets.data(), static_cast<GLsizei>(drawCounts.size()));
+		});
+	}
 
-	// Enable the color array
-	glEnableClientState(GL_COLOR_ARRAY);
-	// Load the colour array from the mesh
-	glColorPointer(3, GL_FLOAT, 0, meshLoader.getColourArray());
-	glNormalPointer(GL_FLOAT, 0, meshLoader.getNormalArray());
-	glVertexPointer(3, GL_FLOAT, 0, meshLoader.getVertexArray());
-	glDrawArrays(GL_TRIANGLES, 0, meshLoader.getSize());
+	// Draw with the mesh's colour array, which replaces the queued colour
+	queueFill(ShaderPermutation::defaultRamp(), meshBuffer.isQuantized(), white, [this]() {
+		meshBuffer.drawRanges(true, drawCounts.data(), drawOffsets.data(), static_cast<GLsizei>(drawCounts.size()));
+	});
 
 	glPopMatrix();
 }
 
+void CelShader::buildInstances() {
+	static const GLubyte tints[6][4] = {
+		{ 255, 255, 255, 255 }, { 255, 96, 96, 255 }, { 96, 160, 255, 255 },
+		{ 255, 224, 96, 255 }, { 128, 255, 128, 255 }, { 160, 160, 160, 255 }
+	};
+	std::vector<MeshInstance> instances;
+	GLfloat center[3];
+	GLfloat radius;
+	GLfloat spacing;
+	GLfloat heading;
+	GLfloat c;
+	GLfloat s;
+	unsigned int side;
+	unsigned int i;
+	unsigned int k;
+
+	meshBuffer.getBoundingSphere(center, radius);
+	side = static_cast<unsigned int>(ceilf(sqrtf(static_cast<float>(instanceCount))));
+	spacing = 2.2f * radius;
+
+	// Shrink the copies until the whole grid is no bigger than INSTANCE_GRID_RADII model radii
+	instanceScale = std::min(1.0f, 2.0f * INSTANCE_GRID_RADII * radius / (side * spacing));
+	spacing *= instanceScale;
+
+	instances.resize(instanceCount);
+	for (i = 0; i < instanceCount; i++) {
+		MeshInstance& instance = instances[i];
+
+		// A fixed heading and tint per copy, so every run draws the same lot
+		heading = static_cast<GLfloat>((i * 2654435761u) % 360) * M_PI / 180.0f;
+		c = cosf(heading) * instanceScale;
+		s = sinf(heading) * instanceScale;
+
+		instance.rows[0][0] = c;
+		instance.rows[0][1] = 0.0f;
+		instance.rows[0][2] = s;
+		instance.rows[1][0] = 0.0f;
+		instance.rows[1][1] = instanceScale;
+		instance.rows[1][2] = 0.0f;
+		instance.rows[2][0] = -s;
+		instance.rows[2][1] = 0.0f;
+		instance.rows[2][2] = c;
+
+		// Turn and scale each copy about the model's center, then move it to its place in the grid
+		instance.rows[0][3] = center[0] - (c * center[0] + s * center[2]) + ((i % side) - (side - 1) * 0.5f) * spacing;
+		instance.rows[1][3] = center[1] - instanceScale * center[1];
+		instance.rows[2][3] = center[2] - (-s * center[0] + c * center[2]) + ((i / side) - (side - 1) * 0.5f) * spacing;
+
+		for (k = 0; k < 4; k++) {
+			instance.colour[k] = tints[i % 6][k];
+		}
+	}
+
+	instanceBuffer.upload(instances);
+}
+
+void CelShader::renderInstances() {
+	static const GLfloat white[3] = { 1.0f, 1.0f, 1.0f };
+	GLfloat center[3];
+	GLfloat radius;
+	GLfloat gridRadius;
+	unsigned int side;
+	bool quantized;
+
+	if (instanceBuffer.getInstanceCount() != instanceCount) {
+		buildInstances();
+	}
+
+	// Every copy uses the level the nearest copy needs, which is at most the distance to the grid's corner
+	// plus a copy's radius nearer than the model
+	meshBuffer.getBoundingSphere(center, radius);
+	side = static_cast<unsigned int>(ceilf(sqrtf(static_cast<float>(instanceCount))));
+	gridRadius = (0.5f * sqrtf(2.0f) * side * 2.2f + 1.0f) * radius * instanceScale;
+	selectLod(center, gridRadius, instanceScale);
+
+	quantized = meshBuffer.isQuantized();
+
+	// The silhouette is only found for the single model, the copies are outlined from their back faces
+	queueOutline([this]() { meshBuffer.drawInstanced(false, lodLevel, instanceBuffer); }, getCelProgram(OUTLINE_RAMP, quantized, true));
+	queueFill(ShaderPermutation::defaultRamp(), quantized, white, [this]() {
+		meshBuffer.drawInstanced(true, lodLevel, instanceBuffer);
+	}, true);
+}
+
+void CelShader::renderSilhouette() {
+	GLfloat modelView[16];
+	GLfloat eye[3];
+
+	glGetFloatv(GL_MODELVIEW_MATRIX, modelView);
+	SilhouetteExtractor::eyeFromModelView(modelView, eye);
+
+	// Only a moving camera or a new level of detail changes the lines
+	if (silhouette.update(meshLoader.getEdgeAdjacency(), lodLevel, eye, threadPool)) {
+		meshBuffer.uploadLines(silhouette.getLines());
+	}
+
+	meshBuffer.drawLines();
+}
+
+const ClusterCullStats& CelShader::getCullStats() const {
+	return cullStats;
+}
+
+void CelShader::updateWindowTitle() {
+	std::ostringstream title;
+
+	title << "Cel Shader - " << renderQueue.getDrawCount() << " draws, " << renderQueue.getStateChangeCount()
+	      << " state changes (" << renderQueue.getSkippedStateChangeCount() << " skipped)";
+	if ((scene == CEL_MODEL_SCENE) && (meshBuffer.isUploaded()) && (instanceCount > 1)) {
+		title << ", " << instanceBuffer.getInstanceCount() << " instances at LOD " << lodLevel << " ("
+		      << meshBuffer.getLod(lodLevel).indexCount / 3 << " triangles each)";
+	}
+	else if ((scene == CEL_MODEL_SCENE) && (meshBuffer.isUploaded())) {
+		title << ", LOD " << lodLevel << ", " << cullStats.clustersVisible << "/" << cullStats.clusterCount << " clusters, "
+		      << cullStats.trianglesVisible << "/" << cullStats.triangleCount << " triangles in " << cullStats.drawRanges << " draws";
+
+		if (outlineMode == OUTLINE_SILHOUETTE_EDGES) {
+			title << ", " << silhouette.getLines().size() / 2 << "/" << silhouette.getEdgeCount() << " silhouette edges"
+			      << (silhouette.wasCached() ? " (cached)" : "");
+		}
+	}
+
+	// Only talk to the window system when something has changed
+	if (title.str() != windowTitle) {
+		windowTitle = title.str();
+		glutSetWindowTitle(windowTitle.c_str());
+	}
+}
+
 void CelShader::draw() {
+	static const GLfloat yellow[3] = { 0.75f, 0.75f, 0.0f };
+	const MeshBuffer *lightMesh;
 	GLfloat lightPosArray[4];
 
+	profiler.beginFrame();
+	profiler.begin(SECTION_SCENE);
+
+	// Draw the scene into the outline pass's targets instead of the window
+	if (outlineMode == OUTLINE_SCREEN_SPACE) {
+		outlineRenderer.begin();
+	}
+
 	glClear(GL_DEPTH_BUFFER_BIT | GL_COLOR_BUFFER_BIT);
 	glClearColor(0.0f, 0.4f, 0.4f, 1.0f);
- 	glLineWidth(1.0f);
 	glMatrixMode(GL_MODELVIEW);
 	glLoadIdentity();
 	glTranslatef(0.0f, 0.0f, -camDistance);
@@ -526,16 +1129,29 @@ void CelShader::draw() {
 	lightPos.copyTo(lightPosArray);
 	glLightfv(GL_LIGHT0, GL_POSITION, lightPosArray);
 
-	// Draw the light as a sphere
- 	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-	glColor3f(0.75f, 0.75f, 0.0f);
+	renderQueue.clear();
+
+	if (primitivesQuery != 0) {
+		glBeginQuery(GL_PRIMITIVES_GENERATED, primitivesQuery);
+	}
+
+	// Draw the light as a sphere, without the shader
 	glPushMatrix();
 	glTranslatef(lightPosArray[0], lightPosArray[1], lightPosArray[2]);
-	// Don't use the shader when rendering the light sphere
-	glUseProgram(0);
-	glutSolidSphere(1.0, 20, 10);
+	lightMesh = &primitives.getSphere(1.0f, 20, 10);
+	renderQueue.submit(RenderQueue::PASS_LIGHT, LIGHT_STATE, yellow, [lightMesh]() { lightMesh->draw(false); });
 	glPopMatrix();
 
+	// Start loading the model as soon as its scene is next in the cycle, and keep uploading it a part every
+	// frame so that no single frame has to wait for the whole mesh
+	if (scene != 0) {
+		meshLoader.start();
+	}
+
+	if ((meshLoader.isBusy()) && (meshLoader.update(meshBuffer, (quantizeMeshes) && (celShaderQuantizedProg != 0)))) {
+		std::cout << "Longest frame while loading = " << loadingFrameTime * 1000.0f << "ms" << std::endl;
+	}
+
 	// Render the selected scene
 	if (scene == 0) {
 		renderBasicScene();
@@ -547,9 +1163,44 @@ void CelShader::draw() {
 		renderComplexScene();
 	}
 
+	profiler.end(SECTION_SCENE);
+
+	// Draw everything queued, grouped by state, a pass at a time so that each can be timed
+	profiler.begin(SECTION_OUTLINE_PASS);
+	renderQueue.flush(RenderQueue::PASS_OUTLINE);
+	profiler.end(SECTION_OUTLINE_PASS);
+
+	profiler.begin(SECTION_FILL_PASS);
+	renderQueue.flush(RenderQueue::PASS_FILL);
+	profiler.end(SECTION_FILL_PASS);
+
+	profiler.begin(SECTION_LIGHT_PASS);
+	renderQueue.flush(RenderQueue::PASS_LIGHT);
+	profiler.end(SECTION_LIGHT_PASS);
+
+	if (outlineMode == OUTLINE_SCREEN_SPACE) {
+		FrameProfiler::Scope scope(profiler, SECTION_COMPOSITE);
+
+		outlineRenderer.end(NEAR_PLANE, FAR_PLANE, OUTLINE_THICKNESS);
+	}
+
+	if (primitivesQuery != 0) {
+		glEndQuery(GL_PRIMITIVES_GENERATED);
+	}
+
+	profiler.endFrame();
+
+	// The overlay needs GLUT's fonts, and isn't part of the measured frame
+	if ((windowed) && (showProfiler)) {
+		profiler.drawOverlay(windowWidth, windowHeight);
+	}
 
 	glFlush();
-	glutSwapBuffers();
+
+	if (windowed) {
+		updateWindowTitle();
+		glutSwapBuffers();
+	}
 }
 
 // Copyright (c) 2012, ME Chamberlain
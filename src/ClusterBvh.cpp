@@ -0,0 +1,345 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <vector>
+#include <algorithm>
+
+#include "ClusterBvh.h"
+#include "MeshOptimizer.h"
+
+/** The deepest a hierarchy over 32 bit cluster counts can get */
+#define MAX_DEPTH 64
+
+/** Marks a vertex that hasn't been given a cluster local index */
+#define NOT_FOUND 0xffffffffu
+
+/**
+ * Spreads the low 10 bits of a value out so that there are two zero bits between each of them.
+ */
+static inline GLuint spreadBits(GLuint value) {
+	value &= 0x3ff;
+	value = (value | (value << 16)) & 0x030000ff;
+	value = (value | (value << 8)) & 0x0300f00f;
+	value = (value | (value << 4)) & 0x030c30c3;
+	value = (value | (value << 2)) & 0x09249249;
+
+	return value;
+}
+
+/**
+ * Computes the 30 bit Morton code of a point, from its position inside a box.
+ */
+static GLuint mortonCode(const GLfloat point[3], const GLfloat minimum[3], const GLfloat size[3]) {
+	GLuint cell[3];
+	GLfloat t;
+	unsigned int k;
+
+	for (k = 0; k < 3; k++) {
+		t = (size[k] > 0.0f) ? (point[k] - minimum[k]) / size[k] : 0.0f;
+		cell[k] = static_cast<GLuint>(std::min(std::max(t, 0.0f), 1.0f) * 1023.0f);
+	}
+
+	return spreadBits(cell[0]) | (spreadBits(cell[1]) << 1) | (spreadBits(cell[2]) << 2);
+}
+
+ClusterBvh::ClusterBvh() {
+}
+
+void ClusterBvh::build(IndexedMesh& mesh) {
+	std::vector<GLuint>& indices = mesh.getIndexData();
+	std::vector<std::pair<GLuint, GLuint> > order;
+	std::vector<GLuint> reordered;
+	std::vector<GLuint> localIndex;
+	std::vector<GLuint> localVertices;
+	const MeshVertex *vertices;
+	MeshLod lod;
+	MeshCluster cluster;
+	GLfloat centroid[3];
+	GLfloat minimum[3];
+	GLfloat maximum[3];
+	GLfloat size[3];
+	GLuint triangleCount;
+	GLuint first;
+	GLuint end;
+	GLuint firstCluster;
+	GLuint *clusterIndices;
+	unsigned int level;
+	unsigned int i;
+	unsigned int j;
+	unsigned int k;
+
+	release();
+
+	vertices = mesh.getVertices();
+	localIndex.assign(mesh.getVertexCount(), NOT_FOUND);
+
+	for (level = 0; level < mesh.getLodCount(); level++) {
+		lod = mesh.getLod(level);
+		triangleCount = lod.indexCount / 3;
+		firstCluster = static_cast<GLuint>(clusters.size());
+
+		if (triangleCount == 0) {
+			roots.push_back(buildNode(firstCluster, 0));
+			triangleCounts.push_back(0);
+			continue;
+		}
+
+		// Sort the triangles along a Morton curve through the level's bounds, so that runs of consecutive
+		// triangles are spatially compact
+		for (k = 0; k < 3; k++) {
+			minimum[k] = maximum[k] = vertices[indices[lod.firstIndex]].position[k];
+		}
+		for (i = lod.firstIndex; i < lod.firstIndex + lod.indexCount; i++) {
+			for (k = 0; k < 3; k++) {
+				minimum[k] = std::min(minimum[k], vertices[indices[i]].position[k]);
+				maximum[k] = std::max(maximum[k], vertices[indices[i]].position[k]);
+			}
+		}
+		for (k = 0; k < 3; k++) {
+			size[k] = maximum[k] - minimum[k];
+		}
+
+		order.resize(triangleCount);
+		for (i = 0; i < triangleCount; i++) {
+			const GLuint *triangle = &indices[lod.firstIndex + i * 3];
+
+			for (k = 0; k < 3; k++) {
+				centroid[k] = (vertices[triangle[0]].position[k] + vertices[triangle[1]].position[k] + vertices[triangle[2]].position[k]) / 3.0f;
+			}
+			order[i] = std::make_pair(mortonCode(centroid, minimum, size), i);
+		}
+		std::sort(order.begin(), order.end());
+
+		reordered.resize(lod.indexCount);
+		for (i = 0; i < triangleCount; i++) {
+			for (k = 0; k < 3; k++) {
+				reordered[i * 3 + k] = indices[lod.firstIndex + order[i].second * 3 + k];
+			}
+		}
+
+		// Cut the sorted triangles into clusters
+		for (first = 0; first < lod.indexCount; first += CLUSTER_BVH_TRIANGLES * 3) {
+			end = std::min(first + CLUSTER_BVH_TRIANGLES * 3, lod.indexCount);
+			clusterIndices = &reordered[first];
+
+			// Sorting scattered the cache optimized order, so optimize each cluster again. The cluster's
+			// vertices are renumbered first so the optimizer only works on as many as the cluster uses
+			localVertices.clear();
+			for (i = 0; i < end - first; i++) {
+				if (localIndex[clusterIndices[i]] == NOT_FOUND) {
+					localIndex[clusterIndices[i]] = static_cast<GLuint>(localVertices.size());
+					localVertices.push_back(clusterIndices[i]);
+				}
+				clusterIndices[i] = localIndex[clusterIndices[i]];
+			}
+
+			MeshOptimizer::optimizeVertexCache(clusterIndices, end - first, static_cast<unsigned int>(localVertices.size()));
+
+			for (i = 0; i < end - first; i++) {
+				clusterIndices[i] = localVertices[clusterIndices[i]];
+			}
+			for (j = 0; j < localVertices.size(); j++) {
+				localIndex[localVertices[j]] = NOT_FOUND;
+			}
+
+			for (k = 0; k < 3; k++) {
+				minimum[k] = maximum[k] = vertices[clusterIndices[0]].position[k];
+			}
+			for (i = 1; i < end - first; i++) {
+				for (k = 0; k < 3; k++) {
+					minimum[k] = std::min(minimum[k], vertices[clusterIndices[i]].position[k]);
+					maximum[k] = std::max(maximum[k], vertices[clusterIndices[i]].position[k]);
+				}
+			}
+
+			cluster.firstIndex = lod.firstIndex + first;
+			cluster.indexCount = end - first;
+			for (k = 0; k < 3; k++) {
+				cluster.center[k] = 0.5f * (minimum[k] + maximum[k]);
+				cluster.extent[k] = 0.5f * (maximum[k] - minimum[k]);
+			}
+			clusters.push_back(cluster);
+		}
+
+		std::copy(reordered.begin(), reordered.end(), indices.begin() + lod.firstIndex);
+
+		roots.push_back(buildNode(firstCluster, static_cast<GLuint>(clusters.size()) - firstCluster));
+		triangleCounts.push_back(triangleCount);
+	}
+
+	mesh.updateIndexBuffer();
+}
+
+GLuint ClusterBvh::buildNode(GLuint firstCluster, GLuint clusterCount) {
+	ClusterBvhNode node;
+	GLfloat minimum[3];
+	GLfloat maximum[3];
+	GLuint index;
+	GLuint half;
+	GLuint left;
+	GLuint right;
+	unsigned int i;
+	unsigned int k;
+
+	for (k = 0; k < 3; k++) {
+		minimum[k] = 0.0f;
+		maximum[k] = 0.0f;
+	}
+
+	for (i = firstCluster; i < firstCluster + clusterCount; i++) {
+		for (k = 0; k < 3; k++) {
+			if ((i == firstCluster) || (clusters[i].center[k] - clusters[i].extent[k] < minimum[k])) {
+				minimum[k] = clusters[i].center[k] - clusters[i].extent[k];
+			}
+			if ((i == firstCluster) || (clusters[i].center[k] + clusters[i].extent[k] > maximum[k])) {
+				maximum[k] = clusters[i].center[k] + clusters[i].extent[k];
+			}
+		}
+	}
+
+	for (k = 0; k < 3; k++) {
+		node.center[k] = 0.5f * (minimum[k] + maximum[k]);
+		node.extent[k] = 0.5f * (maximum[k] - minimum[k]);
+	}
+	node.firstCluster = firstCluster;
+	node.clusterCount = clusterCount;
+	node.children[0] = 0;
+	node.children[1] = 0;
+
+	index = static_cast<GLuint>(nodes.size());
+	nodes.push_back(node);
+
+	// Clusters are in Morton order, so splitting the range in half splits the space as well
+	if (clusterCount > 1) {
+		half = clusterCount / 2;
+		left = buildNode(firstCluster, half);
+		right = buildNode(firstCluster + half, clusterCount - half);
+
+		nodes[index].children[0] = left;
+		nodes[index].children[1] = right;
+	}
+
+	return index;
+}
+
+void ClusterBvh::addRange(const MeshCluster& cluster, GLsizei indexSize, std::vector<GLsizei>& counts, std::vector<const GLvoid*>& offsets) {
+	const GLvoid *offset;
+
+	offset = reinterpret_cast<const GLvoid*>(static_cast<size_t>(cluster.firstIndex) * indexSize);
+
+	if ((!counts.empty()) && (static_cast<const GLubyte*>(offsets.back()) + counts.back() * indexSize == offset)) {
+		counts.back() += cluster.indexCount;
+		return;
+	}
+
+	counts.push_back(cluster.indexCount);
+	offsets.push_back(offset);
+}
+
+void ClusterBvh::cull(const Frustum& frustum, unsigned int level, GLsizei indexSize, std::vector<GLsizei>& counts,
+                      std::vector<const GLvoid*>& offsets, ClusterCullStats& stats) const {
+	GLuint stack[MAX_DEPTH];
+	unsigned int depth;
+	unsigned int i;
+	Frustum::Containment containment;
+
+	counts.clear();
+	offsets.clear();
+	stats.nodesTested = 0;
+	stats.clusterCount = 0;
+	stats.clustersVisible = 0;
+	stats.triangleCount = 0;
+	stats.trianglesVisible = 0;
+	stats.drawRanges = 0;
+
+	if (level >= roots.size()) {
+		return;
+	}
+
+	stats.clusterCount = nodes[roots[level]].clusterCount;
+	stats.triangleCount = triangleCounts[level];
+
+	// Children are pushed right first, so the clusters come out in index buffer order and merge
+	depth = 0;
+	stack[depth++] = roots[level];
+	while (depth > 0) {
+		const ClusterBvhNode& node = nodes[stack[--depth]];
+
+		if (node.clusterCount == 0) {
+			continue;
+		}
+
+		stats.nodesTested++;
+		containment = frustum.testBox(node.center, node.extent);
+
+		if (containment == Frustum::OUTSIDE) {
+			continue;
+		}
+
+		if ((containment == Frustum::INSIDE) || (node.children[0] == 0)) {
+			for (i = node.firstCluster; i < node.firstCluster + node.clusterCount; i++) {
+				addRange(clusters[i], indexSize, counts, offsets);
+				stats.trianglesVisible += clusters[i].indexCount / 3;
+			}
+			stats.clustersVisible += node.clusterCount;
+			continue;
+		}
+
+		stack[depth++] = node.children[1];
+		stack[depth++] = node.children[0];
+	}
+
+	stats.drawRanges = static_cast<unsigned int>(counts.size());
+}
+
+unsigned int ClusterBvh::getLodCount() const {
+	return static_cast<unsigned int>(roots.size());
+}
+
+void ClusterBvh::release() {
+	std::vector<MeshCluster>().swap(clusters);
+	std::vector<ClusterBvhNode>().swap(nodes);
+	std::vector<GLuint>().swap(roots);
+	std::vector<GLuint>().swap(triangleCounts);
+}
+
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
@@ -0,0 +1,160 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "EdgeAdjacency.h"
+
+EdgeAdjacency::EdgeAdjacency() {
+}
+
+void EdgeAdjacency::build(const IndexedMesh& mesh) {
+	const std::vector<GLuint>& indices = mesh.getIndexData();
+	std::vector<std::pair<unsigned long long, GLuint> > halfEdges;
+	std::vector<GLuint> remap;
+	const MeshVertex *vertices;
+	const GLfloat *p[3];
+	const GLuint *triangle;
+	EdgeAdjacencyLevel info;
+	MeshLod lod;
+	GLfloat e1[3];
+	GLfloat e2[3];
+	GLfloat normal[3];
+	unsigned long long key;
+	GLuint a;
+	GLuint b;
+	unsigned int level;
+	unsigned int face;
+	unsigned int i;
+	unsigned int j;
+	unsigned int k;
+
+	release();
+
+	vertices = mesh.getVertices();
+	IndexedMesh::buildPositionRemap(vertices, mesh.getVertexCount(), remap);
+
+	for (level = 0; level < mesh.getLodCount(); level++) {
+		lod = mesh.getLod(level);
+
+		info.firstFace = static_cast<GLuint>(faceNormalX.size());
+		info.faceCount = lod.indexCount / 3;
+		info.firstEdge = static_cast<GLuint>(edgeFaces.size() / 2);
+
+		halfEdges.clear();
+		for (face = 0; face < info.faceCount; face++) {
+			triangle = &indices[lod.firstIndex + face * 3];
+
+			for (k = 0; k < 3; k++) {
+				p[k] = vertices[triangle[k]].position;
+			}
+			for (k = 0; k < 3; k++) {
+				e1[k] = p[1][k] - p[0][k];
+				e2[k] = p[2][k] - p[0][k];
+			}
+			normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+			normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+			normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+
+			// The plane doesn't need a unit normal, only the sign of the distance is ever used
+			faceNormalX.push_back(normal[0]);
+			faceNormalY.push_back(normal[1]);
+			faceNormalZ.push_back(normal[2]);
+			faceDistance.push_back(-(normal[0] * p[0][0] + normal[1] * p[0][1] + normal[2] * p[0][2]));
+
+			// Key the edges by position, so both sides of an attribute seam find each other
+			for (k = 0; k < 3; k++) {
+				a = remap[triangle[k]];
+				b = remap[triangle[(k + 1) % 3]];
+
+				if (a != b) {
+					key = (static_cast<unsigned long long>(std::min(a, b)) << 32) | std::max(a, b);
+					halfEdges.push_back(std::make_pair(key, face));
+				}
+			}
+		}
+
+		std::sort(halfEdges.begin(), halfEdges.end());
+
+		for (i = 0; i < halfEdges.size(); i = j) {
+			j = i + 1;
+			while ((j < halfEdges.size()) && (halfEdges[j].first == halfEdges[i].first)) {
+				j++;
+			}
+
+			edgeVertices.push_back(static_cast<GLuint>(halfEdges[i].first >> 32));
+			edgeVertices.push_back(static_cast<GLuint>(halfEdges[i].first & 0xffffffffu));
+
+			// Only an edge between exactly two faces can be tested, borders and non-manifold edges are
+			// always part of the outline
+			edgeFaces.push_back(halfEdges[i].second);
+			edgeFaces.push_back((j - i == 2) ? halfEdges[i + 1].second : EDGE_ADJACENCY_NO_FACE);
+		}
+
+		info.edgeCount = static_cast<GLuint>(edgeFaces.size() / 2) - info.firstEdge;
+		levels.push_back(info);
+	}
+}
+
+unsigned int EdgeAdjacency::getLodCount() const {
+	return static_cast<unsigned int>(levels.size());
+}
+
+const EdgeAdjacencyLevel& EdgeAdjacency::getLevel(unsigned int level) const {
+	return levels[level];
+}
+
+const GLfloat* EdgeAdjacency::getFaceNormalX() const {
+	return faceNormalX.data();
+}
+
+const GLfloat* EdgeAdjacency::getFaceNormalY() const {
+	return faceNormalY.data();
+}
+
+const GLfloat* EdgeAdjacency::getFaceNormalZ() const {
+	return faceNormalZ.data();
+}
+
+const GLfloat* EdgeAdjacency::getFaceDistance() const {
+	return faceDistance.data();
+}
+
+const GLuint* EdgeAdjacency::getEdgeVertices() const {
+	return edgeVertices.data();
+}
+
+const GLuint* EdgeAdjacency::getEdgeFaces() const {
+	return edgeFaces.data();
+}
+
+void EdgeAdjacency::release() {
+	std::vector<EdgeAdjacencyLevel>().swap(levels);
+	std::vector<GLfloat>().swap(faceNormalX);
+	std::vector<GLfloat>().swap(faceNormalY);
+	std::vector<GLfloat>().swap(faceNormalZ);
+	std::vector<GLfloat>().swap(faceDistance);
+	std::vector<GLuint>().swap(edgeVertices);
+	std::vector<GLuint>().swap(edgeFaces);
+}
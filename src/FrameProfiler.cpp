@@ -0,0 +1,339 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <GL/glew.h>
+#include <GL/glu.h>
+#include <GL/glut.h>
+
+#include "FrameProfiler.h"
+
+/** The height of a line of the overlay, in pixels */
+#define OVERLAY_LINE_HEIGHT 15
+/** The distance of the overlay from the window's top left corner, in pixels */
+#define OVERLAY_MARGIN 10
+
+FrameProfiler::Scope::Scope(FrameProfiler& profiler, unsigned int section)
+	: profiler(profiler),
+	  section(section)
+{
+	profiler.begin(section);
+}
+
+FrameProfiler::Scope::~Scope() {
+	profiler.end(section);
+}
+
+FrameProfiler::FrameProfiler()
+	: history(PROFILER_HISTORY),
+	  frameNumber(0),
+	  gpuSection(-1)
+{
+	unsigned int set;
+	unsigned int i;
+
+	for (set = 0; set < PROFILER_QUERY_SETS; set++) {
+		queryFrame[set] = 0;
+
+		for (i = 0; i < PROFILER_MAX_SECTIONS; i++) {
+			queries[set][i] = 0;
+			queryPending[set][i] = false;
+		}
+	}
+}
+
+FrameProfiler::~FrameProfiler() {
+}
+
+unsigned int FrameProfiler::addSection(const std::string& name) {
+	if (sectionNames.size() < PROFILER_MAX_SECTIONS) {
+		sectionNames.push_back(name);
+	}
+
+	return static_cast<unsigned int>(sectionNames.size()) - 1;
+}
+
+bool FrameProfiler::setGpuTiming(bool enabled) {
+	unsigned int set;
+
+	if ((enabled) && (queries[0][0] == 0) && ((GLEW_VERSION_3_3) || (GLEW_ARB_timer_query))) {
+		for (set = 0; set < PROFILER_QUERY_SETS; set++) {
+			glGenQueries(PROFILER_MAX_SECTIONS, queries[set]);
+		}
+	}
+	else if (!enabled) {
+		release();
+	}
+
+	return (queries[0][0] != 0) == enabled;
+}
+
+FrameProfiler::Frame& FrameProfiler::currentFrame() {
+	return history[frameNumber % PROFILER_HISTORY];
+}
+
+void FrameProfiler::beginFrame() {
+	Frame& frame = currentFrame();
+	unsigned int set;
+	unsigned int i;
+
+	frame.number = frameNumber;
+	frame.cpuTotal = 0.0;
+
+	for (i = 0; i < PROFILER_MAX_SECTIONS; i++) {
+		frame.cpu[i] = 0.0;
+		frame.gpu[i] = -1.0;
+	}
+
+	// The set was last used PROFILER_QUERY_SETS frames ago, so this only waits if the GPU is that far behind
+	set = frameNumber % PROFILER_QUERY_SETS;
+	collect(set, true);
+	queryFrame[set] = frameNumber;
+
+	frameStart = std::chrono::steady_clock::now();
+}
+
+void FrameProfiler::endFrame() {
+	Frame& frame = currentFrame();
+	unsigned int age;
+
+	frame.cpuTotal = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - frameStart).count();
+
+	// Take whatever the earlier frames' queries have finished, oldest first, and leave the rest for later
+	for (age = PROFILER_QUERY_SETS - 1; age > 0; age--) {
+		if (frameNumber >= age) {
+			collect((frameNumber - age) % PROFILER_QUERY_SETS, false);
+		}
+	}
+
+	frameNumber++;
+}
+
+void FrameProfiler::collect(unsigned int set, bool wait) {
+	Frame& frame = history[queryFrame[set] % PROFILER_HISTORY];
+	GLuint64 elapsed;
+	GLint available;
+	unsigned int i;
+
+	for (i = 0; i < PROFILER_MAX_SECTIONS; i++) {
+		if (!queryPending[set][i]) {
+			continue;
+		}
+
+		if (!wait) {
+			glGetQueryObjectiv(queries[set][i], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available) {
+				continue;
+			}
+		}
+
+		// Waits for the GPU if the result isn't available yet
+		glGetQueryObjectui64v(queries[set][i], GL_QUERY_RESULT, &elapsed);
+		frame.gpu[i] = elapsed / 1000000.0;
+		queryPending[set][i] = false;
+	}
+}
+
+void FrameProfiler::begin(unsigned int section) {
+	unsigned int set;
+
+	if (section >= sectionNames.size()) {
+		return;
+	}
+
+	sectionStart[section] = std::chrono::steady_clock::now();
+
+	// Timer queries can't nest, and a query can only be used once per frame
+	set = frameNumber % PROFILER_QUERY_SETS;
+	if ((gpuSection < 0) && (queries[set][section] != 0) && (!queryPending[set][section])) {
+		glBeginQuery(GL_TIME_ELAPSED, queries[set][section]);
+		queryPending[set][section] = true;
+		gpuSection = static_cast<int>(section);
+	}
+}
+
+void FrameProfiler::end(unsigned int section) {
+	if (section >= sectionNames.size()) {
+		return;
+	}
+
+	currentFrame().cpu[section] += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - sectionStart[section]).count();
+
+	if (gpuSection == static_cast<int>(section)) {
+		glEndQuery(GL_TIME_ELAPSED);
+		gpuSection = -1;
+	}
+}
+
+unsigned int FrameProfiler::getFrameCount() const {
+	return static_cast<unsigned int>(std::min(frameNumber, static_cast<unsigned long>(PROFILER_HISTORY)));
+}
+
+const FrameProfiler::Frame& FrameProfiler::getFrame(unsigned int age) const {
+	return history[(frameNumber - 1 - age) % PROFILER_HISTORY];
+}
+
+void FrameProfiler::drawOverlay(int windowWidth, int windowHeight) const {
+	std::vector<std::string> lines;
+	std::ostringstream line;
+	double cpu[PROFILER_MAX_SECTIONS];
+	double gpu[PROFILER_MAX_SECTIONS];
+	unsigned int gpuFrames[PROFILER_MAX_SECTIONS];
+	double cpuTotal;
+	unsigned int frames;
+	unsigned int age;
+	unsigned int i;
+	GLint program;
+	size_t c;
+
+	frames = std::min(getFrameCount(), static_cast<unsigned int>(PROFILER_OVERLAY_FRAMES));
+	if (frames == 0) {
+		return;
+	}
+
+	cpuTotal = 0.0;
+	for (i = 0; i < sectionNames.size(); i++) {
+		cpu[i] = 0.0;
+		gpu[i] = 0.0;
+		gpuFrames[i] = 0;
+	}
+
+	for (age = 0; age < frames; age++) {
+		const Frame& frame = getFrame(age);
+
+		cpuTotal += frame.cpuTotal;
+		for (i = 0; i < sectionNames.size(); i++) {
+			cpu[i] += frame.cpu[i];
+
+			if (frame.gpu[i] >= 0.0) {
+				gpu[i] += frame.gpu[i];
+				gpuFrames[i]++;
+			}
+		}
+	}
+
+	line << std::fixed << std::setprecision(2) << "frame      cpu " << std::setw(6) << cpuTotal / frames << " ms";
+	lines.push_back(line.str());
+
+	for (i = 0; i < sectionNames.size(); i++) {
+		line.str("");
+		line << std::left << std::setw(10) << sectionNames[i] << std::right << " cpu " << std::setw(6) << cpu[i] / frames << " ms  gpu ";
+
+		if (gpuFrames[i] > 0) {
+			line << std::setw(6) << gpu[i] / gpuFrames[i] << " ms";
+		}
+		else {
+			line << std::setw(6) << "-";
+		}
+
+		lines.push_back(line.str());
+	}
+
+	// Draw in window coordinates with the fixed function pipeline, leaving the states as they were
+	glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+	glUseProgram(0);
+	glPushAttrib(GL_ENABLE_BIT | GL_CURRENT_BIT);
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_LIGHTING);
+	glDisable(GL_TEXTURE_2D);
+
+	glMatrixMode(GL_PROJECTION);
+	glPushMatrix();
+	glLoadIdentity();
+	gluOrtho2D(0.0, windowWidth, 0.0, windowHeight);
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+	glLoadIdentity();
+
+	glColor3f(1.0f, 1.0f, 1.0f);
+	for (i = 0; i < lines.size(); i++) {
+		glRasterPos2i(OVERLAY_MARGIN, windowHeight - OVERLAY_MARGIN - static_cast<int>(i + 1) * OVERLAY_LINE_HEIGHT);
+
+		for (c = 0; c < lines[i].size(); c++) {
+			glutBitmapCharacter(GLUT_BITMAP_9_BY_15, lines[i][c]);
+		}
+	}
+
+	glPopMatrix();
+	glMatrixMode(GL_PROJECTION);
+	glPopMatrix();
+	glMatrixMode(GL_MODELVIEW);
+
+	glPopAttrib();
+	glUseProgram(program);
+}
+
+bool FrameProfiler::writeCsv(const std::string& path) const {
+	unsigned int frames;
+	unsigned int age;
+	unsigned int i;
+
+	std::ofstream outFile(path.c_str(), std::ios_base::out);
+	if (!outFile.good()) {
+		return false;
+	}
+
+	outFile << "frame,cpu_total_ms";
+	for (i = 0; i < sectionNames.size(); i++) {
+		outFile << "," << sectionNames[i] << "_cpu_ms," << sectionNames[i] << "_gpu_ms";
+	}
+	outFile << std::endl;
+
+	// Oldest first, GPU times that weren't measured are left empty
+	outFile << std::fixed << std::setprecision(4);
+	frames = getFrameCount();
+	for (age = frames; age > 0; age--) {
+		const Frame& frame = getFrame(age - 1);
+
+		outFile << frame.number << "," << frame.cpuTotal;
+		for (i = 0; i < sectionNames.size(); i++) {
+			outFile << "," << frame.cpu[i] << ",";
+
+			if (frame.gpu[i] >= 0.0) {
+				outFile << frame.gpu[i];
+			}
+		}
+		outFile << std::endl;
+	}
+
+	return outFile.good();
+}
+
+void FrameProfiler::release() {
+	unsigned int set;
+	unsigned int i;
+
+	for (set = 0; set < PROFILER_QUERY_SETS; set++) {
+		if (queries[set][0] != 0) {
+			glDeleteQueries(PROFILER_MAX_SECTIONS, queries[set]);
+		}
+
+		// Results that were still on their way are lost with the queries
+		for (i = 0; i < PROFILER_MAX_SECTIONS; i++) {
+			queries[set][i] = 0;
+			queryPending[set][i] = false;
+		}
+	}
+}
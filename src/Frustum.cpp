@@ -0,0 +1,177 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <cmath>
+#include <GL/glew.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#	include <emmintrin.h>
+#	define FRUSTUM_SSE
+#endif
+
+#include "Frustum.h"
+
+Frustum::Frustum() {
+	unsigned int i;
+
+	// Planes that every point lies in front of
+	for (i = 0; i < FRUSTUM_PLANE_SLOTS; i++) {
+		planeX[i] = 0.0f;
+		planeY[i] = 0.0f;
+		planeZ[i] = 0.0f;
+		planeD[i] = 1.0f;
+	}
+}
+
+void Frustum::setMatrix(const GLfloat matrix[16]) {
+	GLfloat row[4][4];
+	GLfloat sign;
+	GLfloat length;
+	unsigned int plane;
+	unsigned int i;
+
+	for (i = 0; i < 4; i++) {
+		row[i][0] = matrix[i];
+		row[i][1] = matrix[4 + i];
+		row[i][2] = matrix[8 + i];
+		row[i][3] = matrix[12 + i];
+	}
+
+	// Gribb and Hartmann: left, right, bottom, top, near and far are the fourth row plus or minus the
+	// first three
+	for (plane = 0; plane < FRUSTUM_PLANES; plane++) {
+		sign = ((plane & 1) == 0) ? 1.0f : -1.0f;
+
+		planeX[plane] = row[3][0] + sign * row[plane / 2][0];
+		planeY[plane] = row[3][1] + sign * row[plane / 2][1];
+		planeZ[plane] = row[3][2] + sign * row[plane / 2][2];
+		planeD[plane] = row[3][3] + sign * row[plane / 2][3];
+
+		length = sqrtf(planeX[plane] * planeX[plane] + planeY[plane] * planeY[plane] + planeZ[plane] * planeZ[plane]);
+		if (length > 0.0f) {
+			planeX[plane] /= length;
+			planeY[plane] /= length;
+			planeZ[plane] /= length;
+			planeD[plane] /= length;
+		}
+	}
+}
+
+void Frustum::extractFromGL() {
+	GLfloat projection[16];
+	GLfloat modelView[16];
+	GLfloat combined[16];
+	unsigned int column;
+	unsigned int i;
+
+	glGetFloatv(GL_PROJECTION_MATRIX, projection);
+	glGetFloatv(GL_MODELVIEW_MATRIX, modelView);
+
+	for (column = 0; column < 4; column++) {
+		for (i = 0; i < 4; i++) {
+			combined[column * 4 + i] = projection[i] * modelView[column * 4] + projection[4 + i] * modelView[column * 4 + 1] +
+			                           projection[8 + i] * modelView[column * 4 + 2] + projection[12 + i] * modelView[column * 4 + 3];
+		}
+	}
+
+	setMatrix(combined);
+}
+
+Frustum::Containment Frustum::testBox(const GLfloat center[3], const GLfloat extent[3]) const {
+#ifdef FRUSTUM_SSE
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7fffffff));
+	__m128 cx = _mm_set1_ps(center[0]);
+	__m128 cy = _mm_set1_ps(center[1]);
+	__m128 cz = _mm_set1_ps(center[2]);
+	__m128 ex = _mm_set1_ps(extent[0]);
+	__m128 ey = _mm_set1_ps(extent[1]);
+	__m128 ez = _mm_set1_ps(extent[2]);
+	__m128 outside = _mm_setzero_ps();
+	__m128 crossing = _mm_setzero_ps();
+	unsigned int group;
+
+	for (group = 0; group < FRUSTUM_PLANE_SLOTS; group += 4) {
+		__m128 nx = _mm_loadu_ps(planeX + group);
+		__m128 ny = _mm_loadu_ps(planeY + group);
+		__m128 nz = _mm_loadu_ps(planeZ + group);
+		__m128 distance;
+		__m128 radius;
+
+		// Signed distance of the center, and the box's half size projected onto the normal
+		distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, cx), _mm_mul_ps(ny, cy)), _mm_add_ps(_mm_mul_ps(nz, cz), _mm_loadu_ps(planeD + group)));
+		radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_and_ps(nx, absMask), ex), _mm_mul_ps(_mm_and_ps(ny, absMask), ey)),
+		                    _mm_mul_ps(_mm_and_ps(nz, absMask), ez));
+
+		outside = _mm_or_ps(outside, _mm_cmplt_ps(_mm_add_ps(distance, radius), _mm_setzero_ps()));
+		crossing = _mm_or_ps(crossing, _mm_cmplt_ps(_mm_sub_ps(distance, radius), _mm_setzero_ps()));
+	}
+
+	if (_mm_movemask_ps(outside) != 0) {
+		return OUTSIDE;
+	}
+
+	return (_mm_movemask_ps(crossing) != 0) ? INTERSECTING : INSIDE;
+#else
+	Containment result;
+	GLfloat distance;
+	GLfloat radius;
+	unsigned int plane;
+
+	result = INSIDE;
+	for (plane = 0; plane < FRUSTUM_PLANES; plane++) {
+		distance = planeX[plane] * center[0] + planeY[plane] * center[1] + planeZ[plane] * center[2] + planeD[plane];
+		radius = fabsf(planeX[plane]) * extent[0] + fabsf(planeY[plane]) * extent[1] + fabsf(planeZ[plane]) * extent[2];
+
+		if (distance + radius < 0.0f) {
+			return OUTSIDE;
+		}
+
+		if (distance - radius < 0.0f) {
+			result = INTERSECTING;
+		}
+	}
+
+	return result;
+#endif
+}
+
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
@@ -0,0 +1,241 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <GL/glew.h>
+#ifdef HAVE_EGL
+#	include <EGL/egl.h>
+#	include <EGL/eglext.h>
+#endif
+
+#include "HeadlessContext.h"
+
+HeadlessContext::HeadlessContext()
+	: display(NULL),
+	  context(NULL),
+	  framebuffer(0),
+	  colourRenderbuffer(0),
+	  depthRenderbuffer(0),
+	  width(0),
+	  height(0)
+{
+}
+
+HeadlessContext::~HeadlessContext() {
+	release();
+}
+
+#ifdef HAVE_EGL
+
+/**
+ * Opens the EGL display, preferring Mesa's surfaceless platform, which needs no display server.
+ */
+static EGLDisplay openDisplay() {
+	PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay;
+	const char *extensions;
+	EGLDisplay display;
+
+	display = EGL_NO_DISPLAY;
+
+	// Client extensions are queried without a display
+	extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+	getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+
+	if ((extensions != NULL) && (strstr(extensions, "EGL_MESA_platform_surfaceless") != NULL) && (getPlatformDisplay != NULL)) {
+		display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+	}
+
+	if (display == EGL_NO_DISPLAY) {
+		display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+	}
+
+	return display;
+}
+
+bool HeadlessContext::create(int width, int height) {
+	// No surface is ever created, so any surface type will do
+	static const EGLint configAttributes[] = { EGL_SURFACE_TYPE, 0, EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT, EGL_NONE };
+	EGLDisplay eglDisplay;
+	EGLContext eglContext;
+	EGLConfig config;
+	EGLint configCount;
+	GLenum err;
+
+	release();
+
+	eglDisplay = openDisplay();
+	if ((eglDisplay == EGL_NO_DISPLAY) || (!eglInitialize(eglDisplay, NULL, NULL))) {
+		std::cout << "Could not open an EGL display" << std::endl;
+		return false;
+	}
+	display = eglDisplay;
+
+	// The fixed function pipeline is still used, so the context has to be a desktop compatibility one
+	if ((!eglBindAPI(EGL_OPENGL_API)) || (!eglChooseConfig(eglDisplay, configAttributes, &config, 1, &configCount)) ||
+	    (configCount == 0)) {
+		std::cout << "EGL has no desktop OpenGL config" << std::endl;
+		release();
+		return false;
+	}
+
+	eglContext = eglCreateContext(eglDisplay, config, EGL_NO_CONTEXT, NULL);
+	if (eglContext == EGL_NO_CONTEXT) {
+		std::cout << "Could not create an EGL context" << std::endl;
+		release();
+		return false;
+	}
+	context = eglContext;
+
+	// Made current without a surface, everything is drawn into the framebuffer object
+	if (!eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, eglContext)) {
+		std::cout << "Could not make the EGL context current without a surface" << std::endl;
+		release();
+		return false;
+	}
+
+	// GLEW looks for a GLX display as well, which a headless machine doesn't have. The GL entry points are
+	// loaded before that check
+	glewExperimental = GL_TRUE;
+	err = glewInit();
+#ifdef GLEW_ERROR_NO_GLX_DISPLAY
+	if (err == GLEW_ERROR_NO_GLX_DISPLAY) {
+		err = GLEW_OK;
+	}
+#endif
+	if ((err != GLEW_OK) || ((!GLEW_VERSION_3_0) && (!GLEW_ARB_framebuffer_object))) {
+		std::cout << "Failed to initialise glew or no framebuffer objects" << std::endl;
+		release();
+		return false;
+	}
+
+	this->width = width;
+	this->height = height;
+
+	glGenRenderbuffers(1, &colourRenderbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, colourRenderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+	glGenRenderbuffers(1, &depthRenderbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, depthRenderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colourRenderbuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthRenderbuffer);
+
+	if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+		std::cout << "The headless framebuffer is not complete" << std::endl;
+		release();
+		return false;
+	}
+
+	// Without a window there is no back buffer to draw into or read from
+	glDrawBuffer(GL_COLOR_ATTACHMENT0);
+	glReadBuffer(GL_COLOR_ATTACHMENT0);
+
+	std::cout << "Rendering headless with " << glGetString(GL_RENDERER) << ", OpenGL " << glGetString(GL_VERSION) << std::endl;
+
+	return true;
+}
+
+#else
+
+bool HeadlessContext::create(int width, int height) {
+	std::cout << "Built without EGL, headless rendering is not available" << std::endl;
+
+	return false;
+}
+
+#endif
+
+GLuint HeadlessContext::getFramebuffer() const {
+	return framebuffer;
+}
+
+bool HeadlessContext::writeImage(const std::string& path) {
+	std::ofstream file;
+	size_t rowSize;
+	int y;
+
+	if (framebuffer == 0) {
+		return false;
+	}
+
+	rowSize = static_cast<size_t>(width) * 3;
+	pixels.resize(rowSize * height);
+
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glPixelStorei(GL_PACK_ALIGNMENT, 1);
+	glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, &pixels[0]);
+
+	file.open(path.c_str(), std::ios::out | std::ios::binary);
+	if (!file.good()) {
+		std::cout << "Could not write " << path << std::endl;
+		return false;
+	}
+
+	// PPM rows go from the top down, OpenGL's from the bottom up
+	file << "P6\n" << width << " " << height << "\n255\n";
+	for (y = height - 1; y >= 0; y--) {
+		file.write(reinterpret_cast<const char*>(&pixels[y * rowSize]), rowSize);
+	}
+
+	return file.good();
+}
+
+void HeadlessContext::release() {
+	if (framebuffer != 0) {
+		glDeleteFramebuffers(1, &framebuffer);
+		framebuffer = 0;
+	}
+
+	if (colourRenderbuffer != 0) {
+		glDeleteRenderbuffers(1, &colourRenderbuffer);
+		colourRenderbuffer = 0;
+	}
+
+	if (depthRenderbuffer != 0) {
+		glDeleteRenderbuffers(1, &depthRenderbuffer);
+		depthRenderbuffer = 0;
+	}
+
+#ifdef HAVE_EGL
+	if (context != NULL) {
+		eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		eglDestroyContext(display, context);
+		context = NULL;
+	}
+
+	if (display != NULL) {
+		eglTerminate(display);
+		display = NULL;
+	}
+#endif
+
+	width = 0;
+	height = 0;
+}
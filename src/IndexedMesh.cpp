@@ -0,0 +1,267 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <cstring>
+#include <vector>
+
+#include "IndexedMesh.h"
+
+/** Marks an empty slot in the welding hash table */
+#define EMPTY_SLOT 0xffffffffu
+
+/**
+ * Copies a vertex out of the loader's arrays, folding -0.0 into 0.0 so that both weld together.
+ */
+static void fetchVertex(const RawMeshLoader& loader, unsigned int index, MeshVertex& vertex) {
+	GLfloat *dst;
+	unsigned int i;
+
+	memcpy(vertex.position, loader.getVertex(index), sizeof(vertex.position));
+	memcpy(vertex.normal, loader.getNormal(index), sizeof(vertex.normal));
+	memcpy(vertex.colour, loader.getColour(index), sizeof(vertex.colour));
+	memcpy(vertex.uv, loader.getUV(index), sizeof(vertex.uv));
+
+	// The attributes are stored back to back, so walk them as one array of floats
+	dst = vertex.position;
+	for (i = 0; i < RAW_MESH_RECORD_FLOATS; i++) {
+		if (dst[i] == 0.0f) {
+			dst[i] = 0.0f;
+		}
+	}
+}
+
+/**
+ * FNV-1a over the bit patterns of every attribute of a vertex.
+ */
+static unsigned int hashVertex(const MeshVertex& vertex) {
+	const unsigned char *bytes = reinterpret_cast<const unsigned char*>(&vertex);
+	unsigned int hash = 2166136261u;
+	unsigned int i;
+
+	for (i = 0; i < sizeof(MeshVertex); i++) {
+		hash ^= bytes[i];
+		hash *= 16777619u;
+	}
+
+	return hash;
+}
+
+IndexedMesh::IndexedMesh() {
+}
+
+IndexedMesh::~IndexedMesh() {
+}
+
+unsigned int IndexedMesh::weld(const RawMeshLoader& loader) {
+	std::vector<GLuint> table;
+	MeshVertex vertex;
+	unsigned int soupSize;
+	unsigned int mask;
+	unsigned int slot;
+	unsigned int i;
+
+	release();
+
+	soupSize = loader.getSize();
+	if (soupSize == 0) {
+		return 0;
+	}
+
+	// Open addressing table, kept at most half full so probe sequences stay short
+	mask = 1;
+	while (mask < soupSize * 2) {
+		mask <<= 1;
+	}
+	table.assign(mask, EMPTY_SLOT);
+	mask--;
+
+	vertices.reserve(soupSize / 4);
+	indices.resize(soupSize - soupSize % 3);
+
+	for (i = 0; i < indices.size(); i++) {
+		fetchVertex(loader, i, vertex);
+
+		slot = hashVertex(vertex) & mask;
+		while ((table[slot] != EMPTY_SLOT) && (memcmp(&vertices[table[slot]], &vertex, sizeof(MeshVertex)) != 0)) {
+			slot = (slot + 1) & mask;
+		}
+
+		if (table[slot] == EMPTY_SLOT) {
+			table[slot] = static_cast<GLuint>(vertices.size());
+			vertices.push_back(vertex);
+		}
+
+		indices[i] = table[slot];
+	}
+
+	updateIndexBuffer();
+
+	return static_cast<unsigned int>(vertices.size());
+}
+
+void IndexedMesh::buildPositionRemap(const MeshVertex* vertices, unsigned int vertexCount, std::vector<GLuint>& remap) {
+	std::vector<GLuint> table;
+	const unsigned char *bytes;
+	unsigned int hash;
+	unsigned int mask;
+	unsigned int slot;
+	unsigned int i;
+	unsigned int j;
+
+	mask = 1;
+	while (mask < vertexCount * 2) {
+		mask <<= 1;
+	}
+	table.assign(mask, EMPTY_SLOT);
+	mask--;
+
+	remap.resize(vertexCount);
+	for (i = 0; i < vertexCount; i++) {
+		// FNV-1a over the bit patterns of the position
+		bytes = reinterpret_cast<const unsigned char*>(vertices[i].position);
+		hash = 2166136261u;
+		for (j = 0; j < sizeof(vertices[i].position); j++) {
+			hash = (hash ^ bytes[j]) * 16777619u;
+		}
+
+		slot = hash & mask;
+		while ((table[slot] != EMPTY_SLOT) &&
+		       (memcmp(vertices[table[slot]].position, vertices[i].position, sizeof(vertices[i].position)) != 0)) {
+			slot = (slot + 1) & mask;
+		}
+
+		if (table[slot] == EMPTY_SLOT) {
+			table[slot] = i;
+		}
+		remap[i] = table[slot];
+	}
+}
+
+const MeshVertex* IndexedMesh::getVertices() const {
+	return vertices.empty() ? NULL : &vertices[0];
+}
+
+unsigned int IndexedMesh::getVertexCount() const {
+	return static_cast<unsigned int>(vertices.size());
+}
+
+const GLvoid* IndexedMesh::getIndices() const {
+	if (!shortIndices.empty()) {
+		return &shortIndices[0];
+	}
+
+	return indices.empty() ? NULL : &indices[0];
+}
+
+GLenum IndexedMesh::getIndexType() const {
+	return shortIndices.empty() ? GL_UNSIGNED_INT : GL_UNSIGNED_SHORT;
+}
+
+GLsizei IndexedMesh::getIndexSize() const {
+	return shortIndices.empty() ? sizeof(GLuint) : sizeof(GLushort);
+}
+
+unsigned int IndexedMesh::getIndexCount() const {
+	return static_cast<unsigned int>(indices.size());
+}
+
+std::vector<MeshVertex>& IndexedMesh::getVertexData() {
+	return vertices;
+}
+
+std::vector<GLuint>& IndexedMesh::getIndexData() {
+	return indices;
+}
+
+const std::vector<GLuint>& IndexedMesh::getIndexData() const {
+	return indices;
+}
+
+unsigned int IndexedMesh::getLodCount() const {
+	return lods.empty() ? 1 : static_cast<unsigned int>(lods.size());
+}
+
+MeshLod IndexedMesh::getLod(unsigned int level) const {
+	MeshLod full;
+
+	if (lods.empty()) {
+		full.firstIndex = 0;
+		full.indexCount = static_cast<GLuint>(indices.size());
+		full.error = 0.0f;
+
+		return full;
+	}
+
+	return lods[level];
+}
+
+std::vector<MeshLod>& IndexedMesh::getLodData() {
+	return lods;
+}
+
+const std::vector<MeshLod>& IndexedMesh::getLodData() const {
+	return lods;
+}
+
+void IndexedMesh::updateIndexBuffer() {
+	unsigned int i;
+
+	shortIndices.clear();
+
+	if ((indices.empty()) || (vertices.size() > 0x10000)) {
+		return;
+	}
+
+	shortIndices.resize(indices.size());
+	for (i = 0; i < indices.size(); i++) {
+		shortIndices[i] = static_cast<GLushort>(indices[i]);
+	}
+}
+
+void IndexedMesh::release() {
+	std::vector<MeshVertex>().swap(vertices);
+	std::vector<GLuint>().swap(indices);
+	std::vector<GLushort>().swap(shortIndices);
+	std::vector<MeshLod>().swap(lods);
+}
+
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
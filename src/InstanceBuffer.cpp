@@ -0,0 +1,97 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <cstddef>
+#include <vector>
+#include <GL/glew.h>
+
+#include "InstanceBuffer.h"
+
+InstanceBuffer::InstanceBuffer()
+	: buffer(0),
+	  instanceCount(0)
+{
+}
+
+InstanceBuffer::~InstanceBuffer() {
+}
+
+bool InstanceBuffer::isSupported() {
+	return GLEW_VERSION_3_3;
+}
+
+void InstanceBuffer::upload(const std::vector<MeshInstance>& instances) {
+	if (buffer == 0) {
+		glGenBuffers(1, &buffer);
+	}
+
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	glBufferData(GL_ARRAY_BUFFER, instances.size() * sizeof(MeshInstance), instances.empty() ? NULL : &instances[0], GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	instanceCount = static_cast<unsigned int>(instances.size());
+}
+
+unsigned int InstanceBuffer::getInstanceCount() const {
+	return instanceCount;
+}
+
+void InstanceBuffer::bind() const {
+	unsigned int i;
+
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+
+	for (i = 0; i < 3; i++) {
+		glEnableVertexAttribArray(VERTEX_ATTRIB_INSTANCE_ROW + i);
+		glVertexAttribPointer(VERTEX_ATTRIB_INSTANCE_ROW + i, 4, GL_FLOAT, GL_FALSE, sizeof(MeshInstance),
+		                      reinterpret_cast<const GLvoid*>(offsetof(MeshInstance, rows) + i * 4 * sizeof(GLfloat)));
+		glVertexAttribDivisor(VERTEX_ATTRIB_INSTANCE_ROW + i, 1);
+	}
+
+	glEnableVertexAttribArray(VERTEX_ATTRIB_INSTANCE_COLOUR);
+	glVertexAttribPointer(VERTEX_ATTRIB_INSTANCE_COLOUR, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(MeshInstance),
+	                      reinterpret_cast<const GLvoid*>(offsetof(MeshInstance, colour)));
+	glVertexAttribDivisor(VERTEX_ATTRIB_INSTANCE_COLOUR, 1);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void InstanceBuffer::unbind() const {
+	unsigned int i;
+
+	for (i = 0; i < 3; i++) {
+		glVertexAttribDivisor(VERTEX_ATTRIB_INSTANCE_ROW + i, 0);
+		glDisableVertexAttribArray(VERTEX_ATTRIB_INSTANCE_ROW + i);
+	}
+
+	glVertexAttribDivisor(VERTEX_ATTRIB_INSTANCE_COLOUR, 0);
+	glDisableVertexAttribArray(VERTEX_ATTRIB_INSTANCE_COLOUR);
+}
+
+void InstanceBuffer::release() {
+	if (buffer != 0) {
+		glDeleteBuffers(1, &buffer);
+		buffer = 0;
+	}
+
+	instanceCount = 0;
+}
@@ -0,0 +1,468 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+#include <GL/glew.h>
+
+#include "MeshBuffer.h"
+#include "VectorArray.h"
+#include "VertexQuantizer.h"
+
+MeshBuffer::MeshBuffer()
+	: vertexBuffer(0),
+	  indexBuffer(0),
+	  lineBuffer(0),
+	  lineIndexCount(0),
+	  vertexCount(0),
+	  indexCount(0),
+	  indexType(GL_UNSIGNED_INT),
+	  quantized(false),
+	  scale(1.0f),
+	  boundsRadius(0.0f),
+	  uploadMesh(NULL),
+	  uploadReleasesClientData(false),
+	  uploadedVertices(0),
+	  uploadedIndices(0)
+{
+	vertexArrays[0] = 0;
+	vertexArrays[1] = 0;
+	center[0] = center[1] = center[2] = 0.0f;
+	boundsCenter[0] = boundsCenter[1] = boundsCenter[2] = 0.0f;
+}
+
+MeshBuffer::~MeshBuffer() {
+}
+
+bool MeshBuffer::upload(IndexedMesh& mesh, bool releaseClientData, bool quantize) {
+	if (!beginUpload(mesh, releaseClientData, quantize)) {
+		return false;
+	}
+
+	return continueUpload(static_cast<size_t>(-1));
+}
+
+bool MeshBuffer::beginUpload(IndexedMesh& mesh, bool releaseClientData, bool quantize) {
+	const MeshVertex *vertices;
+	Vector3f minimum;
+	Vector3f maximum;
+	unsigned int i;
+	unsigned int k;
+
+	release();
+
+	if ((mesh.getVertexCount() == 0) || (mesh.getIndexCount() == 0)) {
+		return false;
+	}
+
+	vertexCount = mesh.getVertexCount();
+	indexCount = mesh.getIndexCount();
+	indexType = mesh.getIndexType();
+
+	// The LOD ranges and the bounds are needed for drawing, long after the mesh itself has been freed
+	lods.resize(mesh.getLodCount());
+	for (i = 0; i < lods.size(); i++) {
+		lods[i] = mesh.getLod(i);
+	}
+
+	// Bound the positions in place, four vertices at a time
+	vertices = mesh.getVertices();
+	ConstVector3fArray(vertices[0].position, vertexCount, sizeof(MeshVertex)).bounds(minimum, maximum);
+	for (k = 0; k < 3; k++) {
+		boundsCenter[k] = 0.5f * (minimum[k] + maximum[k]);
+	}
+	boundsRadius = 0.5f * sqrtf((maximum[0] - minimum[0]) * (maximum[0] - minimum[0]) + (maximum[1] - minimum[1]) * (maximum[1] - minimum[1]) +
+	                            (maximum[2] - minimum[2]) * (maximum[2] - minimum[2]));
+
+	quantized = quantize;
+	if (quantized) {
+		format = VertexFormat::quantizedFormat();
+		VertexQuantizer::computeTransform(mesh.getVertices(), vertexCount, center, scale);
+	}
+	else {
+		format = VertexFormat::floatFormat();
+	}
+
+	// Only allocate the storage here, the data is copied in pieces by continueUpload
+	glGenBuffers(1, &vertexBuffer);
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glBufferData(GL_ARRAY_BUFFER, vertexCount * format.getStride(), NULL, GL_STATIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glGenBuffers(1, &indexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCount * mesh.getIndexSize(), NULL, GL_STATIC_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	uploadMesh = &mesh;
+	uploadReleasesClientData = releaseClientData;
+	uploadedVertices = 0;
+	uploadedIndices = 0;
+
+	return true;
+}
+
+bool MeshBuffer::continueUpload(size_t byteBudget) {
+	std::vector<QuantizedVertex> quantizedVertices;
+	unsigned int count;
+	unsigned int i;
+	GLsizei stride;
+	GLsizei indexSize;
+
+	if (uploadMesh == NULL) {
+		return true;
+	}
+
+	stride = format.getStride();
+	indexSize = uploadMesh->getIndexSize();
+
+	// Copy at least one vertex or index per call so that a small budget still makes progress
+	if (uploadedVertices < vertexCount) {
+		count = static_cast<unsigned int>(std::min<size_t>(vertexCount - uploadedVertices, std::max<size_t>(byteBudget / stride, 1)));
+
+		glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+		if (quantized) {
+			quantizedVertices.resize(count);
+			VertexQuantizer::encode(uploadMesh->getVertices() + uploadedVertices, count, center, scale, &quantizedVertices[0]);
+			glBufferSubData(GL_ARRAY_BUFFER, uploadedVertices * stride, count * stride, &quantizedVertices[0]);
+		}
+		else {
+			glBufferSubData(GL_ARRAY_BUFFER, uploadedVertices * stride, count * stride, uploadMesh->getVertices() + uploadedVertices);
+		}
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		uploadedVertices += count;
+		byteBudget -= std::min<size_t>(byteBudget, count * stride);
+	}
+
+	if ((uploadedVertices == vertexCount) && (uploadedIndices < indexCount) && (byteBudget > 0)) {
+		count = static_cast<unsigned int>(std::min<size_t>(indexCount - uploadedIndices, std::max<size_t>(byteBudget / indexSize, 1)));
+
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+		glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, uploadedIndices * indexSize, count * indexSize,
+		                static_cast<const GLubyte*>(uploadMesh->getIndices()) + uploadedIndices * indexSize);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+		uploadedIndices += count;
+	}
+
+	if (uploadedIndices < indexCount) {
+		return false;
+	}
+
+	// Record the array setup of each pass once, so drawing is a single bind
+	if ((GLEW_VERSION_3_0) || (GLEW_ARB_vertex_array_object)) {
+		glGenVertexArrays(2, vertexArrays);
+
+		for (i = 0; i < 2; i++) {
+			glBindVertexArray(vertexArrays[i]);
+			setupArrays(i == 1);
+		}
+
+		glBindVertexArray(0);
+	}
+
+	// Client side vertex arrays are used elsewhere, they must not be read as buffer offsets
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	if (uploadReleasesClientData) {
+		uploadMesh->release();
+	}
+
+	uploadMesh = NULL;
+
+	return true;
+}
+
+bool MeshBuffer::isUploading() const {
+	return uploadMesh != NULL;
+}
+
+float MeshBuffer::getUploadProgress() const {
+	if (uploadMesh == NULL) {
+		return 1.0f;
+	}
+
+	return static_cast<float>(uploadedVertices + uploadedIndices) / static_cast<float>(vertexCount + indexCount);
+}
+
+void MeshBuffer::setupArrays(bool withColour) const {
+	glBindBuffer(GL_ARRAY_BUFFER, vertexBuffer);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+
+	format.setupArrays(withColour);
+}
+
+void MeshBuffer::draw(bool withColour, unsigned int level) const {
+	const GLvoid *first;
+	GLsizei count;
+
+	if (!isUploaded()) {
+		return;
+	}
+
+	level = std::min(level, static_cast<unsigned int>(lods.size() - 1));
+	count = lods[level].indexCount;
+	first = reinterpret_cast<const GLvoid*>(static_cast<size_t>(lods[level].firstIndex) * getIndexSize());
+
+	drawRanges(withColour, &count, &first, 1);
+}
+
+void MeshBuffer::drawRanges(bool withColour, const GLsizei* counts, const GLvoid* const* offsets, GLsizei rangeCount) const {
+	if ((!isUploaded()) || (rangeCount == 0)) {
+		return;
+	}
+
+	// Quantized positions are relative to the mesh bounds, scale them back up
+	if (quantized) {
+		glPushMatrix();
+		glTranslatef(center[0], center[1], center[2]);
+		glScalef(scale, scale, scale);
+	}
+
+	if (vertexArrays[0] != 0) {
+		glBindVertexArray(vertexArrays[withColour ? 1 : 0]);
+	}
+	else {
+		setupArrays(withColour);
+	}
+
+	if (rangeCount == 1) {
+		glDrawElements(GL_TRIANGLES, counts[0], indexType, offsets[0]);
+	}
+	else {
+		glMultiDrawElements(GL_TRIANGLES, counts, indexType, const_cast<const GLvoid**>(offsets), rangeCount);
+	}
+
+	if (vertexArrays[0] != 0) {
+		glBindVertexArray(0);
+	}
+	else {
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		// Restore the client state that main sets up
+		if (quantized) {
+			glDisableVertexAttribArray(VERTEX_ATTRIB_OCT_NORMAL);
+		}
+		glEnableClientState(GL_NORMAL_ARRAY);
+		glEnableClientState(GL_COLOR_ARRAY);
+	}
+
+	if (quantized) {
+		glPopMatrix();
+	}
+}
+
+void MeshBuffer::drawInstanced(bool withColour, unsigned int level, const InstanceBuffer& instances) const {
+	const GLvoid *first;
+	GLsizei count;
+	GLint program;
+
+	if ((!isUploaded()) || (instances.getInstanceCount() == 0)) {
+		return;
+	}
+
+	level = std::min(level, static_cast<unsigned int>(lods.size() - 1));
+	count = lods[level].indexCount;
+	first = reinterpret_cast<const GLvoid*>(static_cast<size_t>(lods[level].firstIndex) * getIndexSize());
+
+	// The instance transform is applied after the dequantization, so the shader has to do both
+	if (quantized) {
+		glGetIntegerv(GL_CURRENT_PROGRAM, &program);
+		glUniform4f(glGetUniformLocation(program, "dequantize"), center[0], center[1], center[2], scale);
+	}
+
+	if (vertexArrays[0] != 0) {
+		glBindVertexArray(vertexArrays[withColour ? 1 : 0]);
+	}
+	else {
+		setupArrays(withColour);
+	}
+
+	instances.bind();
+	glDrawElementsInstanced(GL_TRIANGLES, count, indexType, first, instances.getInstanceCount());
+	instances.unbind();
+
+	if (vertexArrays[0] != 0) {
+		glBindVertexArray(0);
+	}
+	else {
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		// Restore the client state that main sets up
+		if (quantized) {
+			glDisableVertexAttribArray(VERTEX_ATTRIB_OCT_NORMAL);
+		}
+		glEnableClientState(GL_NORMAL_ARRAY);
+		glEnableClientState(GL_COLOR_ARRAY);
+	}
+}
+
+bool MeshBuffer::isQuantized() const {
+	return quantized;
+}
+
+const VertexFormat& MeshBuffer::getVertexFormat() const {
+	return format;
+}
+
+void MeshBuffer::uploadLines(const std::vector<GLuint>& indices) {
+	if (lineBuffer == 0) {
+		glGenBuffers(1, &lineBuffer);
+	}
+
+	// Respecify the whole store every time, so the driver doesn't have to wait for the last frame's draw
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, lineBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.empty() ? NULL : &indices[0], GL_STREAM_DRAW);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+
+	lineIndexCount = static_cast<unsigned int>(indices.size());
+}
+
+void MeshBuffer::drawLines() const {
+	if ((!isUploaded()) || (lineIndexCount == 0)) {
+		return;
+	}
+
+	if (quantized) {
+		glPushMatrix();
+		glTranslatef(center[0], center[1], center[2]);
+		glScalef(scale, scale, scale);
+	}
+
+	if (vertexArrays[0] != 0) {
+		glBindVertexArray(vertexArrays[0]);
+	}
+	else {
+		setupArrays(false);
+	}
+
+	// The element buffer binding is part of the vertex array object, so the triangle indices have to be
+	// bound again before it is released
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, lineBuffer);
+	glDrawElements(GL_LINES, lineIndexCount, GL_UNSIGNED_INT, NULL);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer);
+
+	if (vertexArrays[0] != 0) {
+		glBindVertexArray(0);
+	}
+	else {
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		// Restore the client state that main sets up
+		if (quantized) {
+			glDisableVertexAttribArray(VERTEX_ATTRIB_OCT_NORMAL);
+		}
+		glEnableClientState(GL_NORMAL_ARRAY);
+		glEnableClientState(GL_COLOR_ARRAY);
+	}
+
+	if (quantized) {
+		glPopMatrix();
+	}
+}
+
+bool MeshBuffer::isUploaded() const {
+	return (indexCount != 0) && (uploadMesh == NULL);
+}
+
+unsigned int MeshBuffer::getVertexCount() const {
+	return vertexCount;
+}
+
+unsigned int MeshBuffer::getIndexCount() const {
+	return indexCount;
+}
+
+GLsizei MeshBuffer::getIndexSize() const {
+	return (indexType == GL_UNSIGNED_SHORT) ? sizeof(GLushort) : sizeof(GLuint);
+}
+
+unsigned int MeshBuffer::getLodCount() const {
+	return static_cast<unsigned int>(lods.size());
+}
+
+const MeshLod& MeshBuffer::getLod(unsigned int level) const {
+	return lods[level];
+}
+
+void MeshBuffer::getBoundingSphere(GLfloat center[3], GLfloat& radius) const {
+	center[0] = boundsCenter[0];
+	center[1] = boundsCenter[1];
+	center[2] = boundsCenter[2];
+	radius = boundsRadius;
+}
+
+void MeshBuffer::release() {
+	if (vertexArrays[0] != 0) {
+		glDeleteVertexArrays(2, vertexArrays);
+		vertexArrays[0] = 0;
+		vertexArrays[1] = 0;
+	}
+
+	if (vertexBuffer != 0) {
+		glDeleteBuffers(1, &vertexBuffer);
+		vertexBuffer = 0;
+	}
+
+	if (indexBuffer != 0) {
+		glDeleteBuffers(1, &indexBuffer);
+		indexBuffer = 0;
+	}
+
+	if (lineBuffer != 0) {
+		glDeleteBuffers(1, &lineBuffer);
+		lineBuffer = 0;
+	}
+
+	lineIndexCount = 0;
+
+	vertexCount = 0;
+	indexCount = 0;
+	uploadMesh = NULL;
+	lods.clear();
+}
+
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
@@ -0,0 +1,545 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <cstddef>
+#include <cstring>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <utility>
+#include <atomic>
+#include <chrono>
+
+#include "MeshCodec.h"
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+#include "RawMeshLoader.h"
+
+/** Identifies a compressed mesh file */
+static const char MESH_CODEC_MAGIC[4] = { 'R', 'M', 'C', '1' };
+
+/** Block types in the block table */
+#define BLOCK_VERTICES 0
+#define BLOCK_INDICES 1
+#define BLOCK_LODS 2
+
+/** The number of 32 bit channels in a MeshVertex */
+#define VERTEX_CHANNELS (sizeof(MeshVertex) / sizeof(GLuint))
+
+/**
+ * The file header.
+ */
+struct MeshCodecHeader {
+	char magic[4];
+	GLuint vertexCount;
+	GLuint indexCount;
+	GLuint blockCount;
+};
+
+/**
+ * An entry of the block table.
+ */
+struct MeshCodecBlock {
+	/** BLOCK_VERTICES, BLOCK_INDICES or BLOCK_LODS */
+	GLuint type;
+	/** The first vertex or index in the block */
+	GLuint first;
+	/** The number of vertices, indices or levels in the block */
+	GLuint count;
+	/** The size of the block in bytes */
+	GLuint size;
+};
+
+/**
+ * Checks that a set of [first, first + count) ranges covers [0, total) exactly once.
+ * @param ranges The ranges as (first, count) pairs, sorted in place.
+ * @param total The size of the range to cover.
+ */
+static bool tilesRange(std::vector<std::pair<GLuint, GLuint> >& ranges, GLuint total) {
+	GLuint next;
+	size_t i;
+
+	std::sort(ranges.begin(), ranges.end());
+
+	next = 0;
+	for (i = 0; i < ranges.size(); i++) {
+		if (ranges[i].first != next) {
+			return false;
+		}
+		next += ranges[i].second;
+	}
+
+	return next == total;
+}
+
+/**
+ * Checks the block table against the header and the size of the file, before anything is allocated
+ * from it. Every block has to lie inside the file, the blocks have to account for every byte after the
+ * table, and the vertex and index blocks have to tile their arrays without gaps or overlaps.
+ * @param header The file header.
+ * @param table The block table.
+ * @param dataSize The number of bytes after the block table.
+ */
+static bool validateTable(const MeshCodecHeader& header, const std::vector<MeshCodecBlock>& table, unsigned long long dataSize) {
+	std::vector<std::pair<GLuint, GLuint> > vertexRanges;
+	std::vector<std::pair<GLuint, GLuint> > indexRanges;
+	unsigned long long totalSize;
+	unsigned long long groups;
+	unsigned int lodBlocks;
+	size_t b;
+
+	if (header.indexCount % 3 != 0) {
+		return false;
+	}
+
+	totalSize = 0;
+	lodBlocks = 0;
+	for (b = 0; b < table.size(); b++) {
+		const MeshCodecBlock& block = table[b];
+		GLuint total = (block.type == BLOCK_VERTICES) ? header.vertexCount : header.indexCount;
+
+		if ((block.type > BLOCK_LODS) || (block.size == 0) || (block.size > dataSize - totalSize)) {
+			return false;
+		}
+		totalSize += block.size;
+
+		if (block.type == BLOCK_LODS) {
+			lodBlocks++;
+			if ((lodBlocks > 1) || (block.first != 0) || (static_cast<unsigned long long>(block.count) * sizeof(MeshLod) != block.size)) {
+				return false;
+			}
+			continue;
+		}
+
+		if ((block.count == 0) || (block.first > total) || (block.count > total - block.first)) {
+			return false;
+		}
+
+		// Every group of every stream costs at least its width byte, so a small block cannot claim many values
+		groups = (static_cast<unsigned long long>(block.count) + MESH_CODEC_GROUP_SIZE - 1) / MESH_CODEC_GROUP_SIZE;
+		if (block.type == BLOCK_VERTICES) {
+			if (groups * VERTEX_CHANNELS > block.size) {
+				return false;
+			}
+			vertexRanges.push_back(std::make_pair(block.first, block.count));
+		}
+		else {
+			if (groups > block.size) {
+				return false;
+			}
+			indexRanges.push_back(std::make_pair(block.first, block.count));
+		}
+	}
+
+	return (totalSize == dataSize) && (tilesRange(vertexRanges, header.vertexCount)) && (tilesRange(indexRanges, header.indexCount));
+}
+
+/**
+ * Maps small negative and positive differences onto small unsigned numbers.
+ */
+static inline GLuint zigzag(GLuint delta) {
+	return (delta << 1) ^ static_cast<GLuint>(static_cast<GLint>(delta) >> 31);
+}
+
+/**
+ * Undoes zigzag.
+ */
+static inline GLuint unzigzag(GLuint value) {
+	return (value >> 1) ^ (0u - (value & 1));
+}
+
+/**
+ * Counts the bits needed to hold a value.
+ */
+static inline unsigned int bitWidth(GLuint value) {
+	unsigned int width = 0;
+
+	while (value != 0) {
+		width++;
+		value >>= 1;
+	}
+
+	return width;
+}
+
+void MeshCodec::encodeStream(const GLuint* values, unsigned int count, unsigned int stride, std::vector<unsigned char>& out) {
+	GLuint group[MESH_CODEC_GROUP_SIZE];
+	GLuint previous;
+	GLuint word;
+	unsigned int groupStart;
+	unsigned int width;
+	unsigned int bits;
+	unsigned int i;
+
+	previous = 0;
+	for (groupStart = 0; groupStart < count; groupStart += MESH_CODEC_GROUP_SIZE) {
+		width = 0;
+
+		for (i = 0; i < MESH_CODEC_GROUP_SIZE; i++) {
+			if (groupStart + i < count) {
+				GLuint value = values[static_cast<size_t>(groupStart + i) * stride];
+
+				group[i] = zigzag(value - previous);
+				previous = value;
+			}
+			else {
+				group[i] = 0;
+			}
+
+			width = std::max(width, bitWidth(group[i]));
+		}
+
+		// One width byte, then the group packed least significant bit first into width 32 bit words
+		out.push_back(static_cast<unsigned char>(width));
+
+		word = 0;
+		bits = 0;
+		for (i = 0; (i < MESH_CODEC_GROUP_SIZE) && (width != 0); i++) {
+			word |= group[i] << bits;
+			bits += width;
+
+			if (bits >= 32) {
+				out.insert(out.end(), reinterpret_cast<unsigned char*>(&word), reinterpret_cast<unsigned char*>(&word) + sizeof(word));
+				bits -= 32;
+				word = (bits != 0) ? group[i] >> (width - bits) : 0;
+			}
+		}
+	}
+}
+
+const unsigned char* MeshCodec::decodeStream(const unsigned char* in, const unsigned char* end, unsigned int count, unsigned int stride, GLuint* values) {
+	GLuint previous;
+	GLuint mask;
+	GLuint words[32];
+	unsigned long long accumulator;
+	unsigned int groupStart;
+	unsigned int width;
+	unsigned int bits;
+	unsigned int word;
+	unsigned int i;
+
+	previous = 0;
+	for (groupStart = 0; groupStart < count; groupStart += MESH_CODEC_GROUP_SIZE) {
+		if (in >= end) {
+			return NULL;
+		}
+
+		width = *in++;
+		if ((width > 32) || (end - in < static_cast<std::ptrdiff_t>(width * sizeof(GLuint)))) {
+			return NULL;
+		}
+
+		memcpy(words, in, width * sizeof(GLuint));
+		in += width * sizeof(GLuint);
+
+		mask = (width == 32) ? 0xffffffffu : ((1u << width) - 1);
+		accumulator = 0;
+		bits = 0;
+		word = 0;
+		for (i = 0; (i < MESH_CODEC_GROUP_SIZE) && (groupStart + i < count); i++) {
+			if (bits < width) {
+				accumulator |= static_cast<unsigned long long>(words[word++]) << bits;
+				bits += 32;
+			}
+
+			previous += unzigzag(static_cast<GLuint>(accumulator) & mask);
+			values[static_cast<size_t>(groupStart + i) * stride] = previous;
+
+			accumulator >>= width;
+			bits -= width;
+		}
+	}
+
+	return in;
+}
+
+bool MeshCodec::encode(const IndexedMesh& mesh, const std::string& path, ThreadPool& pool) {
+	std::vector<MeshCodecBlock> table;
+	std::vector<std::vector<unsigned char> > blocks;
+	MeshCodecHeader header;
+	unsigned int vertexCount;
+	unsigned int indexCount;
+	unsigned int first;
+	unsigned int b;
+
+	vertexCount = mesh.getVertexCount();
+	indexCount = mesh.getIndexCount() - mesh.getIndexCount() % 3;
+
+	for (first = 0; first < vertexCount; first += MESH_CODEC_BLOCK_VERTICES) {
+		MeshCodecBlock block = { BLOCK_VERTICES, first, std::min(static_cast<unsigned int>(MESH_CODEC_BLOCK_VERTICES), vertexCount - first), 0 };
+		table.push_back(block);
+	}
+
+	for (first = 0; first < indexCount; first += MESH_CODEC_BLOCK_TRIANGLES * 3) {
+		MeshCodecBlock block = { BLOCK_INDICES, first, std::min(static_cast<unsigned int>(MESH_CODEC_BLOCK_TRIANGLES * 3), indexCount - first), 0 };
+		table.push_back(block);
+	}
+
+	// Every block is encoded on its own, so they can all be done at once
+	blocks.resize(table.size());
+
+	// The LOD chain is a handful of ranges, it is stored as is
+	if (!mesh.getLodData().empty()) {
+		const std::vector<MeshLod>& lods = mesh.getLodData();
+		MeshCodecBlock block = { BLOCK_LODS, 0, static_cast<GLuint>(lods.size()), 0 };
+
+		table.push_back(block);
+		blocks.push_back(std::vector<unsigned char>(reinterpret_cast<const unsigned char*>(&lods[0]),
+		                                            reinterpret_cast<const unsigned char*>(&lods[0] + lods.size())));
+	}
+
+	for (b = 0; b < table.size(); b++) {
+		if (table[b].type == BLOCK_LODS) {
+			continue;
+		}
+
+		pool.enqueue([&mesh, &table, &blocks, b]() {
+			const MeshCodecBlock& block = table[b];
+			unsigned int channel;
+
+			if (block.type == BLOCK_VERTICES) {
+				const GLuint *channels = reinterpret_cast<const GLuint*>(mesh.getVertices() + block.first);
+
+				for (channel = 0; channel < VERTEX_CHANNELS; channel++) {
+					encodeStream(channels + channel, block.count, VERTEX_CHANNELS, blocks[b]);
+				}
+			}
+			else {
+				encodeStream(&mesh.getIndexData()[block.first], block.count, 1, blocks[b]);
+			}
+		});
+	}
+	pool.wait();
+
+	for (b = 0; b < table.size(); b++) {
+		table[b].size = static_cast<GLuint>(blocks[b].size());
+	}
+
+	std::ofstream outFile(path.c_str(), std::ios_base::out | std::ios_base::binary);
+	if (!outFile.good()) {
+		return false;
+	}
+
+	memcpy(header.magic, MESH_CODEC_MAGIC, sizeof(header.magic));
+	header.vertexCount = vertexCount;
+	header.indexCount = indexCount;
+	header.blockCount = static_cast<GLuint>(table.size());
+
+	outFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	if (!table.empty()) {
+		outFile.write(reinterpret_cast<const char*>(&table[0]), table.size() * sizeof(MeshCodecBlock));
+	}
+
+	for (b = 0; b < blocks.size(); b++) {
+		if (!blocks[b].empty()) {
+			outFile.write(reinterpret_cast<const char*>(&blocks[b][0]), blocks[b].size());
+		}
+	}
+
+	return outFile.good();
+}
+
+bool MeshCodec::readLods(const unsigned char* data, unsigned int count, unsigned int indexCount, std::vector<MeshLod>& lods) {
+	unsigned int i;
+
+	lods.resize(count);
+	memcpy(&lods[0], data, count * sizeof(MeshLod));
+
+	for (i = 0; i < count; i++) {
+		if ((lods[i].firstIndex > indexCount) || (lods[i].indexCount > indexCount - lods[i].firstIndex) || (lods[i].indexCount % 3 != 0)) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+bool MeshCodec::decode(const std::string& path, IndexedMesh& mesh, ThreadPool& pool) {
+	std::ifstream inFile(path.c_str(), std::ios_base::in | std::ios_base::binary);
+	std::vector<MeshCodecBlock> table;
+	std::atomic<bool> corrupt(false);
+	MeshCodecHeader header;
+	MeshVertex *vertices;
+	GLuint *indices;
+	unsigned long long fileSize;
+	unsigned long long tableEnd;
+	unsigned int vertexCount;
+	unsigned int b;
+
+	if (!inFile.good()) {
+		return false;
+	}
+
+	inFile.seekg(0, std::ios_base::end);
+	fileSize = static_cast<unsigned long long>(inFile.tellg());
+	inFile.seekg(0, std::ios_base::beg);
+
+	inFile.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if ((!inFile.good()) || (memcmp(header.magic, MESH_CODEC_MAGIC, sizeof(header.magic)) != 0)) {
+		return false;
+	}
+
+	// The table has to fit in the file before it is allocated
+	tableEnd = sizeof(header) + static_cast<unsigned long long>(header.blockCount) * sizeof(MeshCodecBlock);
+	if (tableEnd > fileSize) {
+		return false;
+	}
+
+	table.resize(header.blockCount);
+	if (!table.empty()) {
+		inFile.read(reinterpret_cast<char*>(&table[0]), table.size() * sizeof(MeshCodecBlock));
+		if (!inFile.good()) {
+			return false;
+		}
+	}
+
+	if (!validateTable(header, table, fileSize - tableEnd)) {
+		return false;
+	}
+
+	mesh.release();
+	mesh.getVertexData().resize(header.vertexCount);
+	mesh.getIndexData().resize(header.indexCount);
+	vertices = mesh.getVertexData().empty() ? NULL : &mesh.getVertexData()[0];
+	indices = mesh.getIndexData().empty() ? NULL : &mesh.getIndexData()[0];
+	vertexCount = header.vertexCount;
+
+	for (b = 0; b < table.size(); b++) {
+		const MeshCodecBlock block = table[b];
+		std::shared_ptr<std::vector<unsigned char> > data(new std::vector<unsigned char>(block.size));
+
+		inFile.read(reinterpret_cast<char*>(&(*data)[0]), block.size);
+		if (!inFile.good()) {
+			corrupt = true;
+			break;
+		}
+
+		if (block.type == BLOCK_LODS) {
+			if (!readLods(&(*data)[0], block.count, header.indexCount, mesh.getLodData())) {
+				corrupt = true;
+				break;
+			}
+
+			continue;
+		}
+
+		// Decode this block while the next one is being read
+		pool.enqueue([block, data, vertices, indices, vertexCount, &corrupt]() {
+			const unsigned char *in = &(*data)[0];
+			const unsigned char *end = in + data->size();
+			unsigned int channel;
+			unsigned int i;
+
+			if (block.type == BLOCK_VERTICES) {
+				GLuint *channels = reinterpret_cast<GLuint*>(vertices + block.first);
+
+				for (channel = 0; (channel < VERTEX_CHANNELS) && (in != NULL); channel++) {
+					in = decodeStream(in, end, block.count, VERTEX_CHANNELS, channels + channel);
+				}
+			}
+			else {
+				in = decodeStream(in, end, block.count, 1, indices + block.first);
+
+				for (i = 0; (i < block.count) && (in != NULL); i++) {
+					if (indices[block.first + i] >= vertexCount) {
+						in = NULL;
+					}
+				}
+			}
+
+			if (in == NULL) {
+				corrupt = true;
+			}
+		});
+	}
+	pool.wait();
+
+	if (corrupt) {
+		mesh.release();
+		return false;
+	}
+
+	mesh.updateIndexBuffer();
+
+	return true;
+}
+
+bool MeshCodec::convert(const std::string& rawPath, const std::string& compressedPath, ThreadPool& pool) {
+	RawMeshLoader loader;
+	IndexedMesh mesh;
+	std::ifstream compressedFile;
+	std::chrono::steady_clock::time_point start;
+	double rawSize;
+	double compressedSize;
+
+	if (loader.load(rawPath, RawMeshLoader::LOAD_MAPPED) == 0) {
+		std::cout << "Could not load " << rawPath << std::endl;
+		return false;
+	}
+
+	rawSize = static_cast<double>(RAW_MESH_HEADER_SIZE) + static_cast<double>(loader.getSize()) * RAW_MESH_RECORD_SIZE;
+
+	mesh.weld(loader);
+	loader.releaseArrays();
+
+	// Vertices in first use order and cache friendly triangles also make the deltas smaller
+	MeshOptimizer::optimize(mesh, true);
+	MeshSimplifier::buildLodChain(mesh, true);
+
+	start = std::chrono::steady_clock::now();
+	if (!encode(mesh, compressedPath, pool)) {
+		std::cout << "Could not write " << compressedPath << std::endl;
+		return false;
+	}
+
+	compressedFile.open(compressedPath.c_str(), std::ios_base::in | std::ios_base::binary | std::ios_base::ate);
+	compressedSize = static_cast<double>(compressedFile.tellg());
+
+	std::cout << rawPath << ": " << rawSize / (1024.0 * 1024.0) << " MB -> " << compressedPath << ": "
+	          << compressedSize / (1024.0 * 1024.0) << " MB (" << rawSize / compressedSize << ":1) in "
+	          << std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() << "s" << std::endl;
+
+	return true;
+}
+
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
@@ -0,0 +1,513 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+
+#include "MeshOptimizer.h"
+
+/** Marks a vertex that is not in the simulated cache, or has not been remapped yet */
+#define NOT_FOUND 0xffffffffu
+
+/** The largest valence the vertex score table has an entry for */
+#define MAX_VALENCE 32
+
+/** Score given to the vertices of the most recently emitted triangle */
+#define LAST_TRIANGLE_SCORE 0.75f
+/** How quickly the score falls off with the cache position */
+#define CACHE_DECAY_POWER 1.5f
+/** Weight of the bonus given to vertices with few remaining triangles */
+#define VALENCE_BOOST_SCALE 2.0f
+/** How quickly the valence bonus falls off with the number of remaining triangles */
+#define VALENCE_BOOST_POWER 0.5f
+
+/** Scores indexed by position in the cache */
+static float cachePositionScores[MESH_OPTIMIZER_CACHE_SIZE];
+/** Scores indexed by the number of triangles still to be emitted that use the vertex */
+static float valenceScores[MAX_VALENCE + 1];
+/** Whether the score tables have been filled in */
+static bool scoreTablesBuilt = false;
+
+static void buildScoreTables() {
+	unsigned int i;
+
+	for (i = 0; i < MESH_OPTIMIZER_CACHE_SIZE; i++) {
+		if (i < 3) {
+			// The vertices of the last triangle are deliberately scored lower, so the optimizer doesn't
+			// keep hammering the same few vertices and strand others that are about to be evicted
+			cachePositionScores[i] = LAST_TRIANGLE_SCORE;
+		}
+		else {
+			cachePositionScores[i] = powf(1.0f - static_cast<float>(i - 3) / static_cast<float>(MESH_OPTIMIZER_CACHE_SIZE - 3), CACHE_DECAY_POWER);
+		}
+	}
+
+	valenceScores[0] = 0.0f;
+	for (i = 1; i <= MAX_VALENCE; i++) {
+		valenceScores[i] = VALENCE_BOOST_SCALE * powf(static_cast<float>(i), -VALENCE_BOOST_POWER);
+	}
+
+	scoreTablesBuilt = true;
+}
+
+/**
+ * Scores a vertex by how much it is worth emitting one of its triangles next.
+ * @param cachePosition The vertex position in the cache, or NOT_FOUND if it isn't cached.
+ * @param liveTriangles The number of triangles still to be emitted that use the vertex.
+ */
+static float vertexScore(unsigned int cachePosition, unsigned int liveTriangles) {
+	float score;
+
+	if (liveTriangles == 0) {
+		return -1.0f;
+	}
+
+	score = 0.0f;
+	if (cachePosition < MESH_OPTIMIZER_CACHE_SIZE) {
+		score = cachePositionScores[cachePosition];
+	}
+
+	return score + valenceScores[std::min(liveTriangles, static_cast<unsigned int>(MAX_VALENCE))];
+}
+
+void MeshOptimizer::optimize(IndexedMesh& mesh, bool report) {
+	std::vector<GLuint>& indices = mesh.getIndexData();
+	float acmrBefore;
+	float atvrBefore;
+
+	if (indices.empty()) {
+		return;
+	}
+
+	acmrBefore = computeACMR(&indices[0], indices.size(), mesh.getVertexCount(), MESH_OPTIMIZER_CACHE_SIZE);
+	atvrBefore = computeATVR(&indices[0], indices.size(), mesh.getVertexCount(), MESH_OPTIMIZER_CACHE_SIZE);
+
+	optimizeVertexCache(&indices[0], indices.size(), mesh.getVertexCount());
+	optimizeOverdraw(&indices[0], indices.size(), mesh.getVertices(), 1.05f);
+	optimizeVertexFetch(mesh);
+
+	if (report) {
+		std::cout << "Vertex cache (" << MESH_OPTIMIZER_CACHE_SIZE << " entries): ACMR "
+		          << acmrBefore << " -> " << computeACMR(&indices[0], indices.size(), mesh.getVertexCount(), MESH_OPTIMIZER_CACHE_SIZE)
+		          << ", ATVR " << atvrBefore << " -> " << computeATVR(&indices[0], indices.size(), mesh.getVertexCount(), MESH_OPTIMIZER_CACHE_SIZE)
+		          << std::endl;
+	}
+}
+
+void MeshOptimizer::optimizeVertexCache(GLuint* indices, unsigned int indexCount, unsigned int vertexCount) {
+	std::vector<unsigned int> liveTriangles(vertexCount, 0);
+	std::vector<unsigned int> adjacencyOffsets(vertexCount + 1, 0);
+	std::vector<unsigned int> adjacency;
+	std::vector<unsigned int> fill;
+	std::vector<unsigned int> cachePositions(vertexCount, NOT_FOUND);
+	std::vector<float> vertexScores(vertexCount);
+	std::vector<float> triangleScores;
+	std::vector<bool> emitted;
+	std::vector<GLuint> output;
+	std::vector<GLuint> cache;
+	std::vector<GLuint> newCache;
+	unsigned int triangleCount;
+	unsigned int bestTriangle;
+	unsigned int fresh;
+	unsigned int cursor;
+	unsigned int t;
+	unsigned int i;
+	unsigned int j;
+	unsigned int k;
+	float bestScore;
+
+	triangleCount = indexCount / 3;
+	if (triangleCount == 0) {
+		return;
+	}
+
+	if (!scoreTablesBuilt) {
+		buildScoreTables();
+	}
+
+	// Build the vertex to triangle adjacency in one flat array
+	for (i = 0; i < triangleCount * 3; i++) {
+		liveTriangles[indices[i]]++;
+	}
+
+	for (i = 0; i < vertexCount; i++) {
+		adjacencyOffsets[i + 1] = adjacencyOffsets[i] + liveTriangles[i];
+	}
+
+	adjacency.resize(triangleCount * 3);
+	fill.assign(adjacencyOffsets.begin(), adjacencyOffsets.end() - 1);
+	for (i = 0; i < triangleCount * 3; i++) {
+		adjacency[fill[indices[i]]++] = i / 3;
+	}
+
+	for (i = 0; i < vertexCount; i++) {
+		vertexScores[i] = vertexScore(NOT_FOUND, liveTriangles[i]);
+	}
+
+	triangleScores.resize(triangleCount);
+	emitted.assign(triangleCount, false);
+	bestTriangle = 0;
+	bestScore = -1.0f;
+	for (t = 0; t < triangleCount; t++) {
+		triangleScores[t] = vertexScores[indices[t * 3]] + vertexScores[indices[t * 3 + 1]] + vertexScores[indices[t * 3 + 2]];
+
+		if (triangleScores[t] > bestScore) {
+			bestScore = triangleScores[t];
+			bestTriangle = t;
+		}
+	}
+
+	output.reserve(triangleCount * 3);
+	cache.reserve(MESH_OPTIMIZER_CACHE_SIZE + 3);
+	newCache.reserve(MESH_OPTIMIZER_CACHE_SIZE + 3);
+	cursor = 0;
+
+	while (output.size() < triangleCount * 3) {
+		// Nothing in the cache has triangles left, so restart from the next unemitted triangle
+		if (bestTriangle == NOT_FOUND) {
+			while (emitted[cursor]) {
+				cursor++;
+			}
+			bestTriangle = cursor;
+		}
+
+		emitted[bestTriangle] = true;
+		newCache.clear();
+
+		for (i = 0; i < 3; i++) {
+			GLuint v = indices[bestTriangle * 3 + i];
+			unsigned int begin = adjacencyOffsets[v];
+			unsigned int end = begin + liveTriangles[v];
+
+			output.push_back(v);
+
+			// Remove the triangle from the vertex's live triangles
+			for (j = begin; j < end; j++) {
+				if (adjacency[j] == bestTriangle) {
+					adjacency[j] = adjacency[end - 1];
+					liveTriangles[v]--;
+					break;
+				}
+			}
+
+			if (std::find(newCache.begin(), newCache.end(), v) == newCache.end()) {
+				newCache.push_back(v);
+			}
+		}
+
+		// The triangle's vertices move to the front, the rest of the cache shifts back behind them
+		fresh = newCache.size();
+		for (i = 0; i < cache.size(); i++) {
+			if (std::find(newCache.begin(), newCache.begin() + fresh, cache[i]) == newCache.begin() + fresh) {
+				newCache.push_back(cache[i]);
+			}
+		}
+
+		// Rescore every vertex that was in the cache, including the ones that just fell out of it
+		for (i = 0; i < newCache.size(); i++) {
+			GLuint v = newCache[i];
+
+			cachePositions[v] = (i < MESH_OPTIMIZER_CACHE_SIZE) ? i : NOT_FOUND;
+			vertexScores[v] = vertexScore(cachePositions[v], liveTriangles[v]);
+		}
+
+		// Pick the best triangle among those touching the cache
+		bestTriangle = NOT_FOUND;
+		bestScore = -1.0f;
+		for (i = 0; i < newCache.size(); i++) {
+			GLuint v = newCache[i];
+
+			for (j = adjacencyOffsets[v]; j < adjacencyOffsets[v] + liveTriangles[v]; j++) {
+				t = adjacency[j];
+				k = t * 3;
+				triangleScores[t] = vertexScores[indices[k]] + vertexScores[indices[k + 1]] + vertexScores[indices[k + 2]];
+
+				if (triangleScores[t] > bestScore) {
+					bestScore = triangleScores[t];
+					bestTriangle = t;
+				}
+			}
+		}
+
+		if (newCache.size() > MESH_OPTIMIZER_CACHE_SIZE) {
+			newCache.resize(MESH_OPTIMIZER_CACHE_SIZE);
+		}
+		cache.swap(newCache);
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+void MeshOptimizer::optimizeOverdraw(GLuint* indices, unsigned int indexCount, const MeshVertex* vertices, float threshold) {
+	std::vector<unsigned int> clusterStarts;
+	std::vector<unsigned int> hardStarts;
+	std::vector<float> clusterKeys;
+	std::vector<unsigned int> order;
+	std::vector<unsigned int> cacheTimes;
+	std::vector<GLuint> output;
+	unsigned int triangleCount;
+	unsigned int vertexCount;
+	unsigned int time;
+	unsigned int misses;
+	unsigned int h;
+	unsigned int c;
+	unsigned int t;
+	unsigned int i;
+	float meshCentroid[3] = { 0.0f, 0.0f, 0.0f };
+	float meshArea;
+
+	triangleCount = indexCount / 3;
+	if (triangleCount == 0) {
+		return;
+	}
+
+	vertexCount = 0;
+	for (i = 0; i < triangleCount * 3; i++) {
+		vertexCount = std::max(vertexCount, indices[i] + 1);
+	}
+
+	// Hard boundaries are where the cache optimizer had to restart, every vertex of the triangle missed
+	cacheTimes.assign(vertexCount, 0);
+	time = MESH_OPTIMIZER_CACHE_SIZE + 1;
+	for (t = 0; t < triangleCount; t++) {
+		misses = 0;
+		for (i = 0; i < 3; i++) {
+			GLuint v = indices[t * 3 + i];
+
+			if (time - cacheTimes[v] > MESH_OPTIMIZER_CACHE_SIZE) {
+				cacheTimes[v] = time++;
+				misses++;
+			}
+		}
+
+		if ((t == 0) || (misses == 3)) {
+			hardStarts.push_back(t);
+		}
+	}
+	hardStarts.push_back(triangleCount);
+
+	// Split the hard clusters further wherever the ACMR up to that point stays within the threshold of
+	// the cluster's ACMR, so that restarting the cache costs little
+	for (h = 0; h + 1 < hardStarts.size(); h++) {
+		unsigned int start = hardStarts[h];
+		unsigned int end = hardStarts[h + 1];
+		float clusterThreshold;
+
+		// Count the cluster's misses on its own, starting from an empty cache
+		time += MESH_OPTIMIZER_CACHE_SIZE + 1;
+		misses = 0;
+		for (i = start * 3; i < end * 3; i++) {
+			if (time - cacheTimes[indices[i]] > MESH_OPTIMIZER_CACHE_SIZE) {
+				cacheTimes[indices[i]] = time++;
+				misses++;
+			}
+		}
+		clusterThreshold = threshold * static_cast<float>(misses) / static_cast<float>(end - start);
+
+		clusterStarts.push_back(start);
+
+		time += MESH_OPTIMIZER_CACHE_SIZE + 1;
+		misses = 0;
+		for (t = start; t < end; t++) {
+			for (i = 0; i < 3; i++) {
+				GLuint v = indices[t * 3 + i];
+
+				if (time - cacheTimes[v] > MESH_OPTIMIZER_CACHE_SIZE) {
+					cacheTimes[v] = time++;
+					misses++;
+				}
+			}
+
+			if ((t + 1 < end) && (t - clusterStarts.back() >= 8) && (misses <= clusterThreshold * (t - clusterStarts.back() + 1))) {
+				clusterStarts.push_back(t + 1);
+				time += MESH_OPTIMIZER_CACHE_SIZE + 1;
+				misses = 0;
+			}
+		}
+	}
+	clusterStarts.push_back(triangleCount);
+
+	// Area weighted centroid of the whole mesh
+	std::vector<float> clusterData((clusterStarts.size() - 1) * 6, 0.0f);
+	meshArea = 0.0f;
+	for (c = 0; c + 1 < clusterStarts.size(); c++) {
+		float *centroid = &clusterData[c * 6];
+		float *normal = centroid + 3;
+		float clusterArea = 0.0f;
+
+		for (t = clusterStarts[c]; t < clusterStarts[c + 1]; t++) {
+			const GLfloat *p0 = vertices[indices[t * 3]].position;
+			const GLfloat *p1 = vertices[indices[t * 3 + 1]].position;
+			const GLfloat *p2 = vertices[indices[t * 3 + 2]].position;
+			float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+			float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+			float area = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+			for (i = 0; i < 3; i++) {
+				centroid[i] += area * (p0[i] + p1[i] + p2[i]) / 3.0f;
+				normal[i] += n[i];
+			}
+			clusterArea += area;
+		}
+
+		for (i = 0; i < 3; i++) {
+			meshCentroid[i] += centroid[i];
+		}
+		meshArea += clusterArea;
+
+		if (clusterArea > 0.0f) {
+			for (i = 0; i < 3; i++) {
+				centroid[i] /= clusterArea;
+			}
+		}
+	}
+
+	if (meshArea > 0.0f) {
+		for (i = 0; i < 3; i++) {
+			meshCentroid[i] /= meshArea;
+		}
+	}
+
+	// Clusters that face away from the centre of the mesh are likely to occlude the rest, draw them first
+	clusterKeys.resize(clusterStarts.size() - 1);
+	order.resize(clusterStarts.size() - 1);
+	for (c = 0; c < order.size(); c++) {
+		const float *centroid = &clusterData[c * 6];
+		const float *normal = centroid + 3;
+		float length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+		clusterKeys[c] = 0.0f;
+		if (length > 0.0f) {
+			for (i = 0; i < 3; i++) {
+				clusterKeys[c] += (centroid[i] - meshCentroid[i]) * normal[i] / length;
+			}
+		}
+		order[c] = c;
+	}
+
+	std::stable_sort(order.begin(), order.end(), [&clusterKeys](unsigned int a, unsigned int b) {
+		return clusterKeys[a] > clusterKeys[b];
+	});
+
+	output.reserve(triangleCount * 3);
+	for (c = 0; c < order.size(); c++) {
+		output.insert(output.end(), indices + clusterStarts[order[c]] * 3, indices + clusterStarts[order[c] + 1] * 3);
+	}
+
+	std::copy(output.begin(), output.end(), indices);
+}
+
+void MeshOptimizer::optimizeVertexFetch(IndexedMesh& mesh) {
+	std::vector<MeshVertex>& vertices = mesh.getVertexData();
+	std::vector<GLuint>& indices = mesh.getIndexData();
+	std::vector<GLuint> remap(vertices.size(), NOT_FOUND);
+	std::vector<MeshVertex> reordered;
+	unsigned int i;
+
+	reordered.reserve(vertices.size());
+
+	for (i = 0; i < indices.size(); i++) {
+		if (remap[indices[i]] == NOT_FOUND) {
+			remap[indices[i]] = static_cast<GLuint>(reordered.size());
+			reordered.push_back(vertices[indices[i]]);
+		}
+
+		indices[i] = remap[indices[i]];
+	}
+
+	vertices.swap(reordered);
+	mesh.updateIndexBuffer();
+}
+
+float MeshOptimizer::computeACMR(const GLuint* indices, unsigned int indexCount, unsigned int vertexCount, unsigned int cacheSize) {
+	if (indexCount < 3) {
+		return 0.0f;
+	}
+
+	return static_cast<float>(countCacheMisses(indices, indexCount, vertexCount, cacheSize, NULL)) / static_cast<float>(indexCount / 3);
+}
+
+float MeshOptimizer::computeATVR(const GLuint* indices, unsigned int indexCount, unsigned int vertexCount, unsigned int cacheSize) {
+	unsigned int misses;
+	unsigned int referenced;
+
+	misses = countCacheMisses(indices, indexCount, vertexCount, cacheSize, &referenced);
+
+	if (referenced == 0) {
+		return 0.0f;
+	}
+
+	return static_cast<float>(misses) / static_cast<float>(referenced);
+}
+
+unsigned int MeshOptimizer::countCacheMisses(const GLuint* indices, unsigned int indexCount, unsigned int vertexCount, unsigned int cacheSize, unsigned int* referenced) {
+	// A vertex is in the FIFO if fewer than cacheSize misses happened since it was inserted
+	std::vector<unsigned int> cacheTimes(vertexCount, 0);
+	unsigned int time;
+	unsigned int misses;
+	unsigned int i;
+
+	time = cacheSize + 1;
+	misses = 0;
+	for (i = 0; i < indexCount - indexCount % 3; i++) {
+		if (time - cacheTimes[indices[i]] > cacheSize) {
+			cacheTimes[indices[i]] = time++;
+			misses++;
+		}
+	}
+
+	if (referenced != NULL) {
+		*referenced = 0;
+		for (i = 0; i < vertexCount; i++) {
+			if (cacheTimes[i] != 0) {
+				(*referenced)++;
+			}
+		}
+	}
+
+	return misses;
+}
+
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
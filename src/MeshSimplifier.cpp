@@ -0,0 +1,556 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <cmath>
+#include <cstring>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+
+#include "MeshOptimizer.h"
+#include "MeshSimplifier.h"
+
+/** The largest number of collapse passes per call to simplify */
+#define MAX_PASSES 100
+/** Weight of the planes that keep open borders in place, relative to the surface planes */
+#define BORDER_WEIGHT 10.0
+/** Collapses that turn a triangle by more than acos of this are rejected */
+#define MIN_NORMAL_DOT 0.25
+/** A level has to remove at least this fraction of the previous level's triangles to be kept */
+#define MIN_LOD_REDUCTION 0.1f
+
+/**
+ * How a vertex position may move during simplification.
+ */
+enum VertexKind {
+	/** Surrounded by triangles, may collapse onto any neighbour */
+	KIND_MANIFOLD,
+	/** On an open border, may only collapse along the border */
+	KIND_BORDER,
+	/** On an attribute seam or a non-manifold edge, never moves */
+	KIND_LOCKED
+};
+
+/**
+ * A symmetric 4x4 error quadric, the sum of the squared distances to a set of weighted planes.
+ */
+struct Quadric {
+	double a00, a11, a22;
+	double a10, a20, a21;
+	double b0, b1, b2;
+	double c;
+	/** The total weight of the planes */
+	double w;
+};
+
+/**
+ * A candidate edge collapse.
+ */
+struct Collapse {
+	/** The vertex that is removed */
+	GLuint from;
+	/** The vertex it is merged into */
+	GLuint to;
+	/** The quadric error of the collapse */
+	double error;
+
+	bool operator<(const Collapse& other) const {
+		return error < other.error;
+	}
+};
+
+static void quadricAdd(Quadric& q, const Quadric& r) {
+	q.a00 += r.a00;
+	q.a11 += r.a11;
+	q.a22 += r.a22;
+	q.a10 += r.a10;
+	q.a20 += r.a20;
+	q.a21 += r.a21;
+	q.b0 += r.b0;
+	q.b1 += r.b1;
+	q.b2 += r.b2;
+	q.c += r.c;
+	q.w += r.w;
+}
+
+/**
+ * Adds the plane n.p + d = 0, which must have a unit normal, with the given weight.
+ */
+static void quadricAddPlane(Quadric& q, double nx, double ny, double nz, double d, double weight) {
+	q.a00 += nx * nx * weight;
+	q.a11 += ny * ny * weight;
+	q.a22 += nz * nz * weight;
+	q.a10 += ny * nx * weight;
+	q.a20 += nz * nx * weight;
+	q.a21 += nz * ny * weight;
+	q.b0 += nx * d * weight;
+	q.b1 += ny * d * weight;
+	q.b2 += nz * d * weight;
+	q.c += d * d * weight;
+	q.w += weight;
+}
+
+/**
+ * Evaluates a quadric at a point.
+ * @return the weighted mean of the squared distances to the planes.
+ */
+static double quadricError(const Quadric& q, const GLfloat* p) {
+	double x = p[0];
+	double y = p[1];
+	double z = p[2];
+	double rx;
+	double ry;
+	double rz;
+	double error;
+
+	rx = q.a00 * x + q.a10 * y + q.a20 * z;
+	ry = q.a10 * x + q.a11 * y + q.a21 * z;
+	rz = q.a20 * x + q.a21 * y + q.a22 * z;
+
+	error = rx * x + ry * y + rz * z + 2.0 * (q.b0 * x + q.b1 * y + q.b2 * z) + q.c;
+
+	return fabs(error) / ((q.w > 0.0) ? q.w : 1.0);
+}
+
+/**
+ * Computes the unnormalized normal of a triangle.
+ */
+static void triangleNormal(const GLfloat* p0, const GLfloat* p1, const GLfloat* p2, double normal[3]) {
+	double e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+	double e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+
+	normal[0] = e1[1] * e2[2] - e1[2] * e2[1];
+	normal[1] = e1[2] * e2[0] - e1[0] * e2[2];
+	normal[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+/**
+ * Builds the list of triangles around every vertex, as offsets into a shared array of triangle numbers.
+ */
+static void buildAdjacency(const std::vector<GLuint>& indices, unsigned int vertexCount, std::vector<GLuint>& offsets, std::vector<GLuint>& triangles) {
+	std::vector<GLuint> fill;
+	unsigned int i;
+
+	offsets.assign(vertexCount + 1, 0);
+	for (i = 0; i < indices.size(); i++) {
+		offsets[indices[i] + 1]++;
+	}
+	for (i = 0; i < vertexCount; i++) {
+		offsets[i + 1] += offsets[i];
+	}
+
+	triangles.resize(indices.size());
+	fill.assign(offsets.begin(), offsets.end() - 1);
+	for (i = 0; i < indices.size(); i++) {
+		triangles[fill[indices[i]]++] = i / 3;
+	}
+}
+
+float MeshSimplifier::simplify(const MeshVertex* vertices, unsigned int vertexCount, const GLuint* indices, unsigned int indexCount,
+                               unsigned int targetIndexCount, float targetError, std::vector<GLuint>& result) {
+	std::vector<GLuint> remap;
+	std::vector<GLuint> edgeOffsets;
+	std::vector<GLuint> edgeTargets;
+	std::vector<GLuint> adjacencyOffsets;
+	std::vector<GLuint> adjacency;
+	std::vector<unsigned char> kinds;
+	std::vector<unsigned char> touched;
+	std::vector<Quadric> quadrics;
+	std::vector<Collapse> candidates;
+	std::vector<GLuint> collapseTo;
+	std::vector<GLuint> collapsed;
+	Quadric zero;
+	double maxError;
+	double errorLimit;
+	double normal[3];
+	double length;
+	unsigned int removed;
+	unsigned int goal;
+	unsigned int pass;
+	unsigned int triangleCount;
+	unsigned int i;
+	unsigned int j;
+	unsigned int k;
+
+	result.assign(indices, indices + indexCount - indexCount % 3);
+	if (result.empty()) {
+		return 0.0f;
+	}
+
+	IndexedMesh::buildPositionRemap(vertices, vertexCount, remap);
+	triangleCount = static_cast<unsigned int>(result.size() / 3);
+
+	// Directed edges between positions, an edge without a twin running the other way lies on a border
+	buildAdjacency(result, vertexCount, edgeOffsets, edgeTargets);
+	for (i = 0; i < vertexCount; i++) {
+		for (j = edgeOffsets[i]; j < edgeOffsets[i + 1]; j++) {
+			// Replace each triangle around the vertex with the position the edge leaving it points to
+			const GLuint *triangle = &result[edgeTargets[j] * 3];
+
+			k = (triangle[0] == i) ? 1 : ((triangle[1] == i) ? 2 : 0);
+			edgeTargets[j] = remap[triangle[k]];
+		}
+	}
+
+	kinds.assign(vertexCount, KIND_MANIFOLD);
+	for (i = 0; i < vertexCount; i++) {
+		// A position shared by several vertices is an attribute seam
+		if (remap[i] != i) {
+			kinds[remap[i]] = KIND_LOCKED;
+		}
+	}
+
+	// Gather the outgoing edges of every position from all of its vertices
+	{
+		std::vector<std::vector<GLuint> > outgoing(vertexCount);
+
+		for (i = 0; i < vertexCount; i++) {
+			for (j = edgeOffsets[i]; j < edgeOffsets[i + 1]; j++) {
+				outgoing[remap[i]].push_back(edgeTargets[j]);
+			}
+		}
+
+		for (i = 0; i < vertexCount; i++) {
+			for (j = 0; j < outgoing[i].size(); j++) {
+				GLuint target = outgoing[i][j];
+
+				if (std::count(outgoing[i].begin(), outgoing[i].end(), target) > 1) {
+					// Shared by more than two triangles
+					kinds[i] = KIND_LOCKED;
+					kinds[target] = KIND_LOCKED;
+				}
+				else if (std::find(outgoing[target].begin(), outgoing[target].end(), i) == outgoing[target].end()) {
+					if (kinds[i] == KIND_MANIFOLD) {
+						kinds[i] = KIND_BORDER;
+					}
+					if (kinds[target] == KIND_MANIFOLD) {
+						kinds[target] = KIND_BORDER;
+					}
+				}
+			}
+		}
+
+		memset(&zero, 0, sizeof(zero));
+		quadrics.assign(vertexCount, zero);
+
+		for (i = 0; i < triangleCount; i++) {
+			const GLfloat *p[3];
+
+			for (k = 0; k < 3; k++) {
+				p[k] = vertices[result[i * 3 + k]].position;
+			}
+
+			triangleNormal(p[0], p[1], p[2], normal);
+			length = sqrt(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+			if (length == 0.0) {
+				continue;
+			}
+			normal[0] /= length;
+			normal[1] /= length;
+			normal[2] /= length;
+
+			// Every corner accumulates the plane of the triangle, weighted by its area
+			for (k = 0; k < 3; k++) {
+				quadricAddPlane(quadrics[remap[result[i * 3 + k]]], normal[0], normal[1], normal[2],
+				                -(normal[0] * p[0][0] + normal[1] * p[0][1] + normal[2] * p[0][2]), length * 0.5);
+			}
+
+			// Open edges also get a plane at right angles to the triangle, which keeps the outline in place
+			for (k = 0; k < 3; k++) {
+				GLuint a = remap[result[i * 3 + k]];
+				GLuint b = remap[result[i * 3 + (k + 1) % 3]];
+				double edge[3] = { p[(k + 1) % 3][0] - p[k][0], p[(k + 1) % 3][1] - p[k][1], p[(k + 1) % 3][2] - p[k][2] };
+				double side[3];
+				double sideLength;
+
+				if (std::find(outgoing[b].begin(), outgoing[b].end(), a) != outgoing[b].end()) {
+					continue;
+				}
+
+				side[0] = edge[1] * normal[2] - edge[2] * normal[1];
+				side[1] = edge[2] * normal[0] - edge[0] * normal[2];
+				side[2] = edge[0] * normal[1] - edge[1] * normal[0];
+				sideLength = sqrt(side[0] * side[0] + side[1] * side[1] + side[2] * side[2]);
+				if (sideLength == 0.0) {
+					continue;
+				}
+
+				quadricAddPlane(quadrics[a], side[0] / sideLength, side[1] / sideLength, side[2] / sideLength,
+				                -(side[0] * p[k][0] + side[1] * p[k][1] + side[2] * p[k][2]) / sideLength, sideLength * sideLength * BORDER_WEIGHT);
+				quadricAddPlane(quadrics[b], side[0] / sideLength, side[1] / sideLength, side[2] / sideLength,
+				                -(side[0] * p[k][0] + side[1] * p[k][1] + side[2] * p[k][2]) / sideLength, sideLength * sideLength * BORDER_WEIGHT);
+			}
+		}
+	}
+
+	collapseTo.resize(vertexCount);
+	maxError = 0.0;
+	errorLimit = static_cast<double>(targetError) * static_cast<double>(targetError);
+
+	for (pass = 0; (pass < MAX_PASSES) && (result.size() > targetIndexCount); pass++) {
+		buildAdjacency(result, vertexCount, adjacencyOffsets, adjacency);
+		triangleCount = static_cast<unsigned int>(result.size() / 3);
+
+		// Rank every edge by the cheaper of its two allowed collapse directions
+		candidates.clear();
+		for (i = 0; i < triangleCount; i++) {
+			for (k = 0; k < 3; k++) {
+				GLuint ends[2] = { result[i * 3 + k], result[i * 3 + (k + 1) % 3] };
+				Collapse best;
+				unsigned int direction;
+
+				best.error = -1.0;
+				for (direction = 0; direction < 2; direction++) {
+					GLuint from = ends[direction];
+					GLuint to = ends[1 - direction];
+					Quadric q;
+					unsigned int shared;
+
+					if ((kinds[remap[from]] == KIND_LOCKED) || (remap[from] == remap[to])) {
+						continue;
+					}
+
+					// Border vertices may only slide along an edge that is still open
+					if (kinds[remap[from]] == KIND_BORDER) {
+						shared = 0;
+						for (j = adjacencyOffsets[from]; j < adjacencyOffsets[from + 1]; j++) {
+							const GLuint *triangle = &result[adjacency[j] * 3];
+
+							if ((remap[triangle[0]] == remap[to]) || (remap[triangle[1]] == remap[to]) || (remap[triangle[2]] == remap[to])) {
+								shared++;
+							}
+						}
+
+						if (shared != 1) {
+							continue;
+						}
+					}
+
+					q = quadrics[remap[from]];
+					quadricAdd(q, quadrics[remap[to]]);
+
+					if ((best.error < 0.0) || (quadricError(q, vertices[to].position) < best.error)) {
+						best.from = from;
+						best.to = to;
+						best.error = quadricError(q, vertices[to].position);
+					}
+				}
+
+				if (best.error >= 0.0) {
+					candidates.push_back(best);
+				}
+			}
+		}
+
+		std::sort(candidates.begin(), candidates.end());
+
+		for (i = 0; i < vertexCount; i++) {
+			collapseTo[i] = i;
+		}
+		touched.assign(vertexCount, 0);
+		goal = static_cast<unsigned int>(result.size() - targetIndexCount) / 3;
+		removed = 0;
+
+		for (i = 0; (i < candidates.size()) && (removed < goal); i++) {
+			const Collapse& collapse = candidates[i];
+			GLuint from = collapse.from;
+			GLuint to = collapse.to;
+			bool flipped;
+			unsigned int shared;
+
+			if (collapse.error > errorLimit) {
+				break;
+			}
+
+			// Only one collapse per neighbourhood and pass, so the flip test below sees the final positions
+			if ((touched[remap[from]]) || (touched[remap[to]])) {
+				continue;
+			}
+
+			flipped = false;
+			shared = 0;
+			for (j = adjacencyOffsets[from]; (j < adjacencyOffsets[from + 1]) && (!flipped); j++) {
+				const GLuint *triangle = &result[adjacency[j] * 3];
+				const GLfloat *before[3];
+				const GLfloat *after[3];
+				double normalAfter[3];
+				double dot;
+				double lengths;
+
+				if ((remap[triangle[0]] == remap[to]) || (remap[triangle[1]] == remap[to]) || (remap[triangle[2]] == remap[to])) {
+					// This triangle disappears with the collapse
+					shared++;
+					continue;
+				}
+
+				for (k = 0; k < 3; k++) {
+					before[k] = vertices[triangle[k]].position;
+					after[k] = (triangle[k] == from) ? vertices[to].position : before[k];
+				}
+
+				triangleNormal(before[0], before[1], before[2], normal);
+				triangleNormal(after[0], after[1], after[2], normalAfter);
+				dot = normal[0] * normalAfter[0] + normal[1] * normalAfter[1] + normal[2] * normalAfter[2];
+				lengths = sqrt((normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]) *
+				               (normalAfter[0] * normalAfter[0] + normalAfter[1] * normalAfter[1] + normalAfter[2] * normalAfter[2]));
+
+				if ((lengths == 0.0) || (dot < MIN_NORMAL_DOT * lengths)) {
+					flipped = true;
+				}
+			}
+
+			if (flipped) {
+				continue;
+			}
+
+			collapseTo[from] = to;
+			quadricAdd(quadrics[remap[to]], quadrics[remap[from]]);
+			maxError = std::max(maxError, collapse.error);
+			removed += shared;
+
+			for (j = adjacencyOffsets[from]; j < adjacencyOffsets[from + 1]; j++) {
+				for (k = 0; k < 3; k++) {
+					touched[remap[result[adjacency[j] * 3 + k]]] = 1;
+				}
+			}
+		}
+
+		if (removed == 0) {
+			break;
+		}
+
+		// Apply the collapses and drop the triangles that have become degenerate
+		collapsed.clear();
+		for (i = 0; i < triangleCount; i++) {
+			GLuint a = collapseTo[result[i * 3 + 0]];
+			GLuint b = collapseTo[result[i * 3 + 1]];
+			GLuint c = collapseTo[result[i * 3 + 2]];
+
+			if ((remap[a] != remap[b]) && (remap[b] != remap[c]) && (remap[c] != remap[a])) {
+				collapsed.push_back(a);
+				collapsed.push_back(b);
+				collapsed.push_back(c);
+			}
+		}
+		result.swap(collapsed);
+	}
+
+	return static_cast<float>(sqrt(maxError));
+}
+
+unsigned int MeshSimplifier::buildLodChain(IndexedMesh& mesh, bool report) {
+	std::vector<GLuint> previous;
+	std::vector<GLuint> simplified;
+	std::vector<GLuint>& indices = mesh.getIndexData();
+	std::vector<MeshLod>& lods = mesh.getLodData();
+	const MeshVertex *vertices;
+	MeshLod lod;
+	GLfloat minimum[3];
+	GLfloat maximum[3];
+	GLfloat radius;
+	GLfloat maxError;
+	GLfloat error;
+	unsigned int vertexCount;
+	unsigned int level;
+	unsigned int i;
+	unsigned int k;
+
+	vertexCount = mesh.getVertexCount();
+	vertices = mesh.getVertices();
+
+	if ((!lods.empty()) || (indices.size() < 3)) {
+		return mesh.getLodCount();
+	}
+
+	// The error limit scales with the size of the mesh
+	for (k = 0; k < 3; k++) {
+		minimum[k] = maximum[k] = vertices[0].position[k];
+	}
+	for (i = 1; i < vertexCount; i++) {
+		for (k = 0; k < 3; k++) {
+			minimum[k] = std::min(minimum[k], vertices[i].position[k]);
+			maximum[k] = std::max(maximum[k], vertices[i].position[k]);
+		}
+	}
+	radius = 0.5f * sqrtf((maximum[0] - minimum[0]) * (maximum[0] - minimum[0]) + (maximum[1] - minimum[1]) * (maximum[1] - minimum[1]) +
+	                      (maximum[2] - minimum[2]) * (maximum[2] - minimum[2]));
+	maxError = MESH_SIMPLIFIER_MAX_ERROR * radius;
+
+	lod.firstIndex = 0;
+	lod.indexCount = static_cast<GLuint>(indices.size());
+	lod.error = 0.0f;
+	lods.push_back(lod);
+	previous = indices;
+
+	// Each level simplifies the one before it, so the errors of the levels add up
+	for (level = 1; level < MESH_SIMPLIFIER_MAX_LODS; level++) {
+		error = simplify(vertices, vertexCount, &previous[0], static_cast<unsigned int>(previous.size()),
+		                 static_cast<unsigned int>(previous.size() * MESH_SIMPLIFIER_LOD_RATIO) / 3 * 3, maxError - lods.back().error, simplified);
+
+		if ((simplified.empty()) || (simplified.size() > previous.size() * (1.0f - MIN_LOD_REDUCTION))) {
+			break;
+		}
+
+		MeshOptimizer::optimizeVertexCache(&simplified[0], static_cast<unsigned int>(simplified.size()), vertexCount);
+
+		lod.firstIndex = static_cast<GLuint>(indices.size());
+		lod.indexCount = static_cast<GLuint>(simplified.size());
+		lod.error = lods.back().error + error;
+		lods.push_back(lod);
+
+		indices.insert(indices.end(), simplified.begin(), simplified.end());
+		previous.swap(simplified);
+	}
+
+	mesh.updateIndexBuffer();
+
+	if (report) {
+		for (level = 0; level < lods.size(); level++) {
+			std::cout << "LOD " << level << ": " << lods[level].indexCount / 3 << " triangles, error " << lods[level].error
+			          << " (" << 100.0f * lods[level].error / radius << "% of radius)" << std::endl;
+		}
+	}
+
+	return static_cast<unsigned int>(lods.size());
+}
+
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
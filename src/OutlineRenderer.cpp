@@ -0,0 +1,190 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <cstddef>
+#include <GL/glew.h>
+
+#include "OutlineRenderer.h"
+
+OutlineRenderer::OutlineRenderer()
+	: framebuffer(0),
+	  colourTexture(0),
+	  normalTexture(0),
+	  depthTexture(0),
+	  program(0),
+	  width(0),
+	  height(0),
+	  complete(false),
+	  targetFramebuffer(0)
+{
+}
+
+OutlineRenderer::~OutlineRenderer() {
+}
+
+bool OutlineRenderer::isSupported() {
+	return (GLEW_VERSION_3_0) || ((GLEW_ARB_framebuffer_object) && (GLEW_VERSION_2_0));
+}
+
+void OutlineRenderer::setProgram(GLuint program) {
+	this->program = program;
+
+	if (program == 0) {
+		return;
+	}
+
+	// The samplers never change, only the uniforms that depend on the window and projection do
+	glUseProgram(program);
+	glUniform1i(glGetUniformLocation(program, "colourTexture"), 0);
+	glUniform1i(glGetUniformLocation(program, "normalTexture"), 1);
+	glUniform1i(glGetUniformLocation(program, "depthTexture"), 2);
+	glUseProgram(0);
+}
+
+void OutlineRenderer::setTargetFramebuffer(GLuint framebuffer) {
+	targetFramebuffer = framebuffer;
+}
+
+/**
+ * Creates a texture to render into, sampled without filtering so neighbouring pixels don't bleed together.
+ */
+static GLuint createTarget(GLint internalFormat, GLenum format, GLenum type, int width, int height) {
+	GLuint texture;
+
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, format, type, NULL);
+
+	return texture;
+}
+
+bool OutlineRenderer::resize(int width, int height) {
+	release();
+
+	if ((!isSupported()) || (width <= 0) || (height <= 0)) {
+		return false;
+	}
+
+	this->width = width;
+	this->height = height;
+
+	colourTexture = createTarget(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, width, height);
+	normalTexture = createTarget(GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, width, height);
+	depthTexture = createTarget(GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT, GL_UNSIGNED_INT, width, height);
+	// Sample the depth itself, not the result of a comparison
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_NONE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	glGenFramebuffers(1, &framebuffer);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, colourTexture, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, normalTexture, 0);
+	glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthTexture, 0);
+	complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+	glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+
+	if (!complete) {
+		release();
+	}
+
+	return complete;
+}
+
+bool OutlineRenderer::isReady() const {
+	return (program != 0) && (complete);
+}
+
+void OutlineRenderer::begin() {
+	static const GLenum drawBuffers[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
+
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glDrawBuffers(2, drawBuffers);
+}
+
+void OutlineRenderer::end(GLfloat nearPlane, GLfloat farPlane, GLfloat thickness) {
+	glBindFramebuffer(GL_FRAMEBUFFER, targetFramebuffer);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, colourTexture);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, normalTexture);
+	glActiveTexture(GL_TEXTURE2);
+	glBindTexture(GL_TEXTURE_2D, depthTexture);
+
+	glUseProgram(program);
+	glUniform2f(glGetUniformLocation(program, "texelSize"), 1.0f / width, 1.0f / height);
+	glUniform2f(glGetUniformLocation(program, "clipPlanes"), nearPlane, farPlane);
+	glUniform1f(glGetUniformLocation(program, "thickness"), thickness);
+
+	// Every pixel of the window is written, so neither the depth test nor culling is needed
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_CULL_FACE);
+	glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
+
+	// The vertex shader passes the corners straight through as clip space positions
+	glBegin(GL_QUADS);
+		glVertex2f(-1.0f, -1.0f);
+		glVertex2f(1.0f, -1.0f);
+		glVertex2f(1.0f, 1.0f);
+		glVertex2f(-1.0f, 1.0f);
+	glEnd();
+
+	glEnable(GL_CULL_FACE);
+	glEnable(GL_DEPTH_TEST);
+	glUseProgram(0);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void OutlineRenderer::release() {
+	if (framebuffer != 0) {
+		glDeleteFramebuffers(1, &framebuffer);
+		framebuffer = 0;
+	}
+
+	if (colourTexture != 0) {
+		glDeleteTextures(1, &colourTexture);
+		colourTexture = 0;
+	}
+
+	if (normalTexture != 0) {
+		glDeleteTextures(1, &normalTexture);
+		normalTexture = 0;
+	}
+
+	if (depthTexture != 0) {
+		glDeleteTextures(1, &depthTexture);
+		depthTexture = 0;
+	}
+
+	width = 0;
+	height = 0;
+	complete = false;
+}
@@ -0,0 +1,289 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <cmath>
+#include <functional>
+#include <map>
+#include <vector>
+#include <GL/glew.h>
+
+#include "PrimitiveCache.h"
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+PrimitiveCache::PrimitiveCache() {
+}
+
+PrimitiveCache::~PrimitiveCache() {
+}
+
+bool PrimitiveCache::find(const Key& key, MeshBuffer*& mesh) {
+	std::map<Key, MeshBuffer>::iterator it;
+
+	it = meshes.find(key);
+	if (it != meshes.end()) {
+		mesh = &it->second;
+		return true;
+	}
+
+	mesh = &meshes[key];
+
+	return false;
+}
+
+void PrimitiveCache::appendGrid(IndexedMesh& mesh, unsigned int uSteps, unsigned int vSteps,
+                                const std::function<void(GLfloat, GLfloat, MeshVertex&)>& evaluate) {
+	std::vector<MeshVertex>& vertices = mesh.getVertexData();
+	std::vector<GLuint>& indices = mesh.getIndexData();
+	GLuint corners[4];
+	GLuint first;
+	unsigned int i;
+	unsigned int j;
+	unsigned int k;
+
+	first = static_cast<GLuint>(vertices.size());
+
+	// The seam gets its own column of vertices, so the UVs can wrap
+	for (i = 0; i <= uSteps; i++) {
+		for (j = 0; j <= vSteps; j++) {
+			MeshVertex vertex;
+
+			evaluate(static_cast<GLfloat>(i) / uSteps, static_cast<GLfloat>(j) / vSteps, vertex);
+			vertex.colour[0] = vertex.colour[1] = vertex.colour[2] = 1.0f;
+			vertex.uv[0] = static_cast<GLfloat>(i) / uSteps;
+			vertex.uv[1] = static_cast<GLfloat>(j) / vSteps;
+			vertices.push_back(vertex);
+		}
+	}
+
+	for (i = 0; i < uSteps; i++) {
+		for (j = 0; j < vSteps; j++) {
+			corners[0] = first + i * (vSteps + 1) + j;
+			corners[1] = first + (i + 1) * (vSteps + 1) + j;
+			corners[2] = first + (i + 1) * (vSteps + 1) + j + 1;
+			corners[3] = first + i * (vSteps + 1) + j + 1;
+
+			// A collapsed edge means a pole or a tip, the triangle next to it has no area
+			for (k = 0; k < 2; k++) {
+				const GLfloat *a = vertices[corners[0]].position;
+				const GLfloat *b = vertices[corners[k + 1]].position;
+				const GLfloat *c = vertices[corners[k + 2]].position;
+
+				if (((a[0] == b[0]) && (a[1] == b[1]) && (a[2] == b[2])) || ((b[0] == c[0]) && (b[1] == c[1]) && (b[2] == c[2])) ||
+				    ((a[0] == c[0]) && (a[1] == c[1]) && (a[2] == c[2]))) {
+					continue;
+				}
+
+				indices.push_back(corners[0]);
+				indices.push_back(corners[k + 1]);
+				indices.push_back(corners[k + 2]);
+			}
+		}
+	}
+}
+
+void PrimitiveCache::appendSquare(IndexedMesh& mesh, const GLfloat normal[3], GLfloat distance, GLfloat halfSize) {
+	GLfloat tangent[3];
+	GLfloat bitangent[3];
+
+	// Any axis perpendicular to the normal will do, the bitangent completes a right handed frame so that
+	// tangent x bitangent is the normal
+	tangent[0] = (normal[2] != 0.0f) ? 1.0f : 0.0f;
+	tangent[1] = (normal[0] != 0.0f) ? 1.0f : 0.0f;
+	tangent[2] = (normal[1] != 0.0f) ? 1.0f : 0.0f;
+	bitangent[0] = normal[1] * tangent[2] - normal[2] * tangent[1];
+	bitangent[1] = normal[2] * tangent[0] - normal[0] * tangent[2];
+	bitangent[2] = normal[0] * tangent[1] - normal[1] * tangent[0];
+
+	appendGrid(mesh, 1, 1, [&](GLfloat u, GLfloat v, MeshVertex& vertex) {
+		unsigned int k;
+
+		for (k = 0; k < 3; k++) {
+			vertex.position[k] = normal[k] * distance + ((2.0f * u - 1.0f) * tangent[k] + (2.0f * v - 1.0f) * bitangent[k]) * halfSize;
+			vertex.normal[k] = normal[k];
+		}
+	});
+}
+
+void PrimitiveCache::upload(IndexedMesh& mesh, MeshBuffer& buffer) {
+	mesh.updateIndexBuffer();
+	buffer.upload(mesh, true);
+}
+
+const MeshBuffer& PrimitiveCache::getTorus(GLfloat innerRadius, GLfloat outerRadius, unsigned int sides, unsigned int rings) {
+	IndexedMesh mesh;
+	MeshBuffer *buffer;
+
+	if (find(Key(SHAPE_TORUS, innerRadius, outerRadius, sides, rings), buffer)) {
+		return *buffer;
+	}
+
+	// u goes around the z axis and v around the tube, which makes the triangles face outwards
+	appendGrid(mesh, rings, sides, [=](GLfloat u, GLfloat v, MeshVertex& vertex) {
+		GLfloat theta = 2.0f * M_PI * u;
+		GLfloat phi = 2.0f * M_PI * v;
+
+		vertex.normal[0] = cosf(phi) * cosf(theta);
+		vertex.normal[1] = cosf(phi) * sinf(theta);
+		vertex.normal[2] = sinf(phi);
+		vertex.position[0] = (outerRadius + innerRadius * cosf(phi)) * cosf(theta);
+		vertex.position[1] = (outerRadius + innerRadius * cosf(phi)) * sinf(theta);
+		vertex.position[2] = innerRadius * sinf(phi);
+	});
+
+	upload(mesh, *buffer);
+
+	return *buffer;
+}
+
+const MeshBuffer& PrimitiveCache::getSphere(GLfloat radius, unsigned int slices, unsigned int stacks) {
+	IndexedMesh mesh;
+	MeshBuffer *buffer;
+
+	if (find(Key(SHAPE_SPHERE, radius, 0.0f, slices, stacks), buffer)) {
+		return *buffer;
+	}
+
+	// u goes from the north pole to the south pole and v around the z axis
+	appendGrid(mesh, stacks, slices, [=](GLfloat u, GLfloat v, MeshVertex& vertex) {
+		GLfloat phi = M_PI * u;
+		GLfloat theta = 2.0f * M_PI * v;
+		unsigned int k;
+
+		vertex.normal[0] = sinf(phi) * cosf(theta);
+		vertex.normal[1] = sinf(phi) * sinf(theta);
+		vertex.normal[2] = cosf(phi);
+
+		// Pin the poles exactly, so the collapsed triangles around them are recognised
+		if ((u == 0.0f) || (u == 1.0f)) {
+			vertex.normal[0] = 0.0f;
+			vertex.normal[1] = 0.0f;
+			vertex.normal[2] = (u == 0.0f) ? 1.0f : -1.0f;
+		}
+
+		for (k = 0; k < 3; k++) {
+			vertex.position[k] = vertex.normal[k] * radius;
+		}
+	});
+
+	upload(mesh, *buffer);
+
+	return *buffer;
+}
+
+const MeshBuffer& PrimitiveCache::getCone(GLfloat base, GLfloat height, unsigned int slices, unsigned int stacks) {
+	IndexedMesh mesh;
+	MeshBuffer *buffer;
+	GLfloat slope;
+
+	if (find(Key(SHAPE_CONE, base, height, slices, stacks), buffer)) {
+		return *buffer;
+	}
+
+	slope = sqrtf(base * base + height * height);
+
+	// The side, u goes around the z axis and v from the base to the tip
+	appendGrid(mesh, slices, stacks, [=](GLfloat u, GLfloat v, MeshVertex& vertex) {
+		GLfloat theta = 2.0f * M_PI * u;
+
+		vertex.normal[0] = height * cosf(theta) / slope;
+		vertex.normal[1] = height * sinf(theta) / slope;
+		vertex.normal[2] = base / slope;
+		vertex.position[0] = (v < 1.0f) ? (1.0f - v) * base * cosf(theta) : 0.0f;
+		vertex.position[1] = (v < 1.0f) ? (1.0f - v) * base * sinf(theta) : 0.0f;
+		vertex.position[2] = v * height;
+	});
+
+	// The base, a disc facing down. v goes from the rim to the center
+	appendGrid(mesh, slices, 1, [=](GLfloat u, GLfloat v, MeshVertex& vertex) {
+		GLfloat theta = 2.0f * M_PI * u;
+
+		vertex.normal[0] = 0.0f;
+		vertex.normal[1] = 0.0f;
+		vertex.normal[2] = -1.0f;
+		vertex.position[0] = (v < 1.0f) ? base * cosf(theta) : 0.0f;
+		vertex.position[1] = (v < 1.0f) ? -base * sinf(theta) : 0.0f;
+		vertex.position[2] = 0.0f;
+	});
+
+	upload(mesh, *buffer);
+
+	return *buffer;
+}
+
+const MeshBuffer& PrimitiveCache::getCube(GLfloat size) {
+	static const GLfloat normals[6][3] = {
+		{ 1.0f, 0.0f, 0.0f }, { -1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f },
+		{ 0.0f, -1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 0.0f, 0.0f, -1.0f }
+	};
+	IndexedMesh mesh;
+	MeshBuffer *buffer;
+	unsigned int i;
+
+	if (find(Key(SHAPE_CUBE, size, 0.0f, 1, 1), buffer)) {
+		return *buffer;
+	}
+
+	// Every face has its own vertices, so the corners keep the face normals
+	for (i = 0; i < 6; i++) {
+		appendSquare(mesh, normals[i], 0.5f * size, 0.5f * size);
+	}
+
+	upload(mesh, *buffer);
+
+	return *buffer;
+}
+
+const MeshBuffer& PrimitiveCache::getPlane(GLfloat size) {
+	static const GLfloat front[3] = { 0.0f, 0.0f, 1.0f };
+	static const GLfloat back[3] = { 0.0f, 0.0f, -1.0f };
+	IndexedMesh mesh;
+	MeshBuffer *buffer;
+
+	if (find(Key(SHAPE_PLANE, size, 0.0f, 1, 1), buffer)) {
+		return *buffer;
+	}
+
+	// Back face culling would hide a single sided plane from behind
+	appendSquare(mesh, front, 0.0f, 0.5f * size);
+	appendSquare(mesh, back, 0.0f, 0.5f * size);
+
+	upload(mesh, *buffer);
+
+	return *buffer;
+}
+
+unsigned int PrimitiveCache::getMeshCount() const {
+	return static_cast<unsigned int>(meshes.size());
+}
+
+void PrimitiveCache::release() {
+	std::map<Key, MeshBuffer>::iterator it;
+
+	for (it = meshes.begin(); it != meshes.end(); it++) {
+		it->second.release();
+	}
+
+	meshes.clear();
+}
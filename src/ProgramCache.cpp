@@ -0,0 +1,275 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <GL/glew.h>
+
+#ifdef _WIN32
+#	include <direct.h>
+#	include <process.h>
+#else
+#	include <sys/stat.h>
+#	include <sys/types.h>
+#	include <unistd.h>
+#endif
+
+#include "ProgramCache.h"
+
+/** Identifies a program binary file */
+static const char PROGRAM_CACHE_MAGIC[4] = { 'C', 'S', 'P', 'B' };
+
+/**
+ * The file header, followed by the binary itself.
+ */
+struct ProgramCacheHeader {
+	char magic[4];
+	/** The key the binary was stored under, low and high half */
+	GLuint key[2];
+	/** The format returned by glGetProgramBinary */
+	GLenum format;
+	/** The size of the binary in bytes */
+	GLuint length;
+};
+
+/**
+ * Continues an FNV-1a hash over a string, including its terminating zero so that consecutive strings
+ * can't run into each other.
+ */
+static unsigned long long hashString(unsigned long long hash, const char* text) {
+	if (text == NULL) {
+		text = "";
+	}
+
+	do {
+		hash = (hash ^ static_cast<unsigned char>(*text)) * 1099511628211ull;
+	} while (*text++ != '\0');
+
+	return hash;
+}
+
+ProgramCache::ProgramCache(const std::string& directory)
+	: directory(directory),
+	  enabled(true),
+	  driverChecked(false),
+	  supported(false),
+	  driverHash(0),
+	  hits(0),
+	  misses(0)
+{
+}
+
+bool ProgramCache::isSupported() {
+	GLint formats;
+
+	if ((!GLEW_VERSION_4_1) && (!GLEW_ARB_get_program_binary)) {
+		return false;
+	}
+
+	// Some drivers expose the entry points without supporting a single format
+	formats = 0;
+	glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+
+	return formats > 0;
+}
+
+void ProgramCache::setEnabled(bool enabled) {
+	this->enabled = enabled;
+}
+
+bool ProgramCache::isEnabled() {
+	if (!enabled) {
+		return false;
+	}
+
+	// This is asked for every program, but the driver's answer and identification won't change
+	if (!driverChecked) {
+		supported = isSupported();
+		driverHash = 14695981039346656037ull;
+		driverHash = hashString(driverHash, reinterpret_cast<const char*>(glGetString(GL_VENDOR)));
+		driverHash = hashString(driverHash, reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+		driverHash = hashString(driverHash, reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+		driverChecked = true;
+	}
+
+	return supported;
+}
+
+unsigned long long ProgramCache::computeKey(const GLchar* vertexSource, const GLchar* fragmentSource, const ProgramAttribBinding* bindings, unsigned int bindingCount) const {
+	unsigned long long hash;
+	unsigned int i;
+
+	hash = driverHash;
+	hash = hashString(hash, vertexSource);
+	hash = hashString(hash, fragmentSource);
+
+	// The bindings are set before linking, a binary linked with different ones puts attributes elsewhere
+	for (i = 0; i < bindingCount; i++) {
+		hash = (hash ^ bindings[i].index) * 1099511628211ull;
+		hash = hashString(hash, bindings[i].name);
+	}
+
+	return hash;
+}
+
+std::string ProgramCache::getPath(unsigned long long key) const {
+	char name[32];
+
+	sprintf(name, "%016llx.bin", key);
+
+	return directory + "/" + name;
+}
+
+/**
+ * Creates a program from a binary file, if it was stored under the expected key and the driver accepts it.
+ */
+static GLuint readBinary(const std::string& path, unsigned long long key) {
+	ProgramCacheHeader header;
+	std::vector<char> binary;
+	GLuint program;
+	GLint linked;
+
+	std::ifstream inFile(path.c_str(), std::ios_base::in | std::ios_base::binary);
+	if (!inFile.good()) {
+		return 0;
+	}
+
+	inFile.read(reinterpret_cast<char*>(&header), sizeof(header));
+	if ((!inFile.good()) || (memcmp(header.magic, PROGRAM_CACHE_MAGIC, sizeof(header.magic)) != 0) ||
+	    (header.key[0] != static_cast<GLuint>(key)) || (header.key[1] != static_cast<GLuint>(key >> 32)) || (header.length == 0)) {
+		return 0;
+	}
+
+	binary.resize(header.length);
+	inFile.read(&binary[0], binary.size());
+	if (!inFile.good()) {
+		return 0;
+	}
+
+	// The driver has the final say, it may reject binaries from an older version of itself
+	program = glCreateProgram();
+	glProgramBinary(program, header.format, &binary[0], header.length);
+	glGetProgramiv(program, GL_LINK_STATUS, &linked);
+
+	if (!linked) {
+		glDeleteProgram(program);
+		return 0;
+	}
+
+	return program;
+}
+
+GLuint ProgramCache::load(const GLchar* vertexSource, const GLchar* fragmentSource, const ProgramAttribBinding* bindings, unsigned int bindingCount) {
+	unsigned long long key;
+	GLuint program;
+
+	if (!isEnabled()) {
+		return 0;
+	}
+
+	key = computeKey(vertexSource, fragmentSource, bindings, bindingCount);
+	program = readBinary(getPath(key), key);
+
+	if (program != 0) {
+		hits++;
+	}
+	else {
+		misses++;
+	}
+
+	return program;
+}
+
+bool ProgramCache::store(const GLchar* vertexSource, const GLchar* fragmentSource, const ProgramAttribBinding* bindings, unsigned int bindingCount, GLuint program) {
+	ProgramCacheHeader header;
+	std::vector<char> binary;
+	std::ostringstream tempPath;
+	std::string path;
+	unsigned long long key;
+	GLint length;
+	GLsizei written;
+	bool good;
+
+	if (!isEnabled()) {
+		return false;
+	}
+
+	length = 0;
+	glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+	if (length <= 0) {
+		return false;
+	}
+
+	binary.resize(length);
+	written = 0;
+	glGetProgramBinary(program, length, &written, &header.format, &binary[0]);
+	if (written <= 0) {
+		return false;
+	}
+
+	key = computeKey(vertexSource, fragmentSource, bindings, bindingCount);
+	memcpy(header.magic, PROGRAM_CACHE_MAGIC, sizeof(header.magic));
+	header.key[0] = static_cast<GLuint>(key);
+	header.key[1] = static_cast<GLuint>(key >> 32);
+	header.length = static_cast<GLuint>(written);
+
+	// Fails harmlessly when the directory already exists
+#ifdef _WIN32
+	_mkdir(directory.c_str());
+	tempPath << getPath(key) << "." << _getpid() << ".tmp";
+#else
+	mkdir(directory.c_str(), 0755);
+	tempPath << getPath(key) << "." << getpid() << ".tmp";
+#endif
+
+	// Write under a name only this process uses and rename it into place, so that processes starting at
+	// the same time never read a half written binary
+	std::ofstream outFile(tempPath.str().c_str(), std::ios_base::out | std::ios_base::binary);
+	if (!outFile.good()) {
+		return false;
+	}
+
+	outFile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+	outFile.write(&binary[0], written);
+	good = outFile.good();
+	outFile.close();
+
+	path = getPath(key);
+	if ((!good) || (rename(tempPath.str().c_str(), path.c_str()) != 0)) {
+		// Windows won't rename over an existing file, which means another process got there first
+		remove(tempPath.str().c_str());
+		return false;
+	}
+
+	return true;
+}
+
+unsigned int ProgramCache::getHits() const {
+	return hits;
+}
+
+unsigned int ProgramCache::getMisses() const {
+	return misses;
+}
@@ -23,35 +23,119 @@
 #include <string>
 #include <iostream>
 #include <fstream>
+#include <chrono>
+
+#ifdef _WIN32
+#	include <windows.h>
+#else
+#	include <sys/mman.h>
+#	include <sys/stat.h>
+#	include <fcntl.h>
+#	include <unistd.h>
+#endif
 
 #include "RawMeshLoader.h"
 
+/** Bytes between the reads that fault in a mapped file, no larger than the smallest page size */
+#define RAW_MESH_PAGE_STEP 4096
+
 RawMeshLoader::RawMeshLoader() {
 	vertexArray = NULL;
 	normalArray = NULL;
 	colourArray = NULL;
 	uvArray = NULL;
 	size = 0;
+	vertexStride = 0;
+	normalStride = 0;
+	colourStride = 0;
+	uvStride = 0;
+	loadMode = LOAD_STREAM;
+	mappedData = NULL;
+	mappedLength = 0;
+#ifdef _WIN32
+	fileHandle = NULL;
+	mappingHandle = NULL;
+#endif
+	loadTime = 0.0;
+	loadBytes = 0;
 }
 
 RawMeshLoader::~RawMeshLoader() {
 	releaseArrays();
 }
 
-unsigned int RawMeshLoader::load(const std::string& path) {
-	std::ifstream inFile(path.c_str(), std::ios_base::in | std::ios_base::binary);
+unsigned int RawMeshLoader::load(const std::string& path, LoadMode mode, ThreadPool* threadPool) {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
 	unsigned int i;
 	unsigned int entrySize;
 	unsigned int uvSize;
 
+	releaseArrays();
+	loadTime = 0.0;
+	loadBytes = 0;
+
+	if (mode == LOAD_MAPPED) {
+		if (!mapFile(path)) {
+			return 0;
+		}
+
+		// The pages would otherwise fault in during the upload, outside the timed load. Reading every page
+		// here makes the time comparable with the modes that copy the file
+		touchPages();
+
+		loadMode = LOAD_MAPPED;
+		loadBytes = RAW_MESH_HEADER_SIZE + static_cast<size_t>(size) * RAW_MESH_RECORD_SIZE;
+		loadTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		return size;
+	}
+
+	if (mode == LOAD_PARALLEL) {
+		const unsigned char *records;
+
+		if (!mapFile(path)) {
+			return 0;
+		}
+
+		// The records are fixed size, so every range can be located without reading the ones before it
+		records = static_cast<const unsigned char*>(vertexArray);
+		vertexArray = new GLfloat[size * 3];
+		normalArray = new GLfloat[size * 3];
+		colourArray = new GLfloat[size * 3];
+		uvArray = new GLfloat[size * 2];
+
+		if (threadPool != NULL) {
+			threadPool->parallelFor(size, [this, records](unsigned int begin, unsigned int end) {
+				scatterRecords(records, begin, end);
+			});
+		}
+		else {
+			scatterRecords(records, 0, size);
+		}
+
+		// Only the mapping goes, the arrays now live on the heap
+		unmapFile();
+
+		vertexStride = 3 * sizeof(GLfloat);
+		normalStride = 3 * sizeof(GLfloat);
+		colourStride = 3 * sizeof(GLfloat);
+		uvStride = 2 * sizeof(GLfloat);
+		loadMode = LOAD_PARALLEL;
+		loadBytes = RAW_MESH_HEADER_SIZE + static_cast<size_t>(size) * RAW_MESH_RECORD_SIZE;
+		loadTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		return size;
+	}
+
+	std::ifstream inFile(path.c_str(), std::ios_base::in | std::ios_base::binary);
+
 	if (!inFile.good()) {
 		return 0;
 	}
 
-	releaseArrays();
-
 	size = 0;
 	inFile.read(reinterpret_cast<char*>(&size), sizeof(size));
+	loadBytes += static_cast<size_t>(inFile.gcount());
 	vertexArray = new GLfloat[size * 3];
 	normalArray = new GLfloat[size * 3];
 	colourArray = new GLfloat[size * 3];
@@ -59,25 +143,189 @@ unsigned int RawMeshLoader::load(const std::string& path) {
 
 	entrySize = 3 * sizeof(GLfloat);
 	uvSize = 2 * sizeof(GLfloat);
+	vertexStride = entrySize;
+	normalStride = entrySize;
+	colourStride = entrySize;
+	uvStride = uvSize;
+	loadMode = LOAD_STREAM;
+
+	// Count only complete records and never more than the header allocated for, a truncated file stops short of
+	// the size in its header and a longer one must not run past the arrays
 	i = 0;
-	while (inFile.good()) {
+	while ((i < size) && (inFile.good())) {
 		inFile.read(reinterpret_cast<char*>(vertexArray) + i * entrySize, entrySize);
-		if (inFile.good()) {
-			inFile.read(reinterpret_cast<char*>(normalArray) + i * entrySize, entrySize);
-			if (inFile.good()) {
-				inFile.read(reinterpret_cast<char*>(colourArray) + i * entrySize, entrySize);
-				if (inFile.good()) {
-					inFile.read(reinterpret_cast<char*>(uvArray) + i * uvSize, uvSize);
-				}
-			}
+		loadBytes += static_cast<size_t>(inFile.gcount());
+		inFile.read(reinterpret_cast<char*>(normalArray) + i * entrySize, entrySize);
+		loadBytes += static_cast<size_t>(inFile.gcount());
+		inFile.read(reinterpret_cast<char*>(colourArray) + i * entrySize, entrySize);
+		loadBytes += static_cast<size_t>(inFile.gcount());
+		inFile.read(reinterpret_cast<char*>(uvArray) + i * uvSize, uvSize);
+		loadBytes += static_cast<size_t>(inFile.gcount());
+		if (!inFile.good()) {
+			break;
 		}
 		i++;
 	}
+	size = i;
 	inFile.close();
 
+	loadTime = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
 	return i;
 }
 
+bool RawMeshLoader::mapFile(const std::string& path) {
+	size_t fileLength;
+	const unsigned char *records;
+	GLuint count;
+
+#ifdef _WIN32
+	LARGE_INTEGER length;
+
+	fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+	                         FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (fileHandle == INVALID_HANDLE_VALUE) {
+		fileHandle = NULL;
+		return false;
+	}
+
+	if ((!GetFileSizeEx(fileHandle, &length)) || (length.QuadPart < RAW_MESH_HEADER_SIZE)) {
+		unmapFile();
+		return false;
+	}
+	fileLength = static_cast<size_t>(length.QuadPart);
+
+	mappingHandle = CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mappingHandle == NULL) {
+		unmapFile();
+		return false;
+	}
+
+	mappedData = MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0);
+	if (mappedData == NULL) {
+		unmapFile();
+		return false;
+	}
+#else
+	struct stat fileStat;
+	int fd;
+
+	fd = open(path.c_str(), O_RDONLY);
+	if (fd < 0) {
+		return false;
+	}
+
+	if ((fstat(fd, &fileStat) != 0) || (fileStat.st_size < RAW_MESH_HEADER_SIZE)) {
+		close(fd);
+		return false;
+	}
+	fileLength = static_cast<size_t>(fileStat.st_size);
+
+	mappedData = mmap(NULL, fileLength, PROT_READ, MAP_PRIVATE, fd, 0);
+	// The mapping holds its own reference to the file
+	close(fd);
+
+	if (mappedData == MAP_FAILED) {
+		mappedData = NULL;
+		return false;
+	}
+
+	// The records are consumed front to back, so let the kernel read ahead aggressively
+	madvise(mappedData, fileLength, MADV_SEQUENTIAL);
+	madvise(mappedData, fileLength, MADV_WILLNEED);
+#endif
+
+	mappedLength = fileLength;
+	records = static_cast<const unsigned char*>(mappedData);
+
+	// Never trust the count beyond what the file actually holds
+	count = *reinterpret_cast<const GLuint*>(records);
+	if (count > (fileLength - RAW_MESH_HEADER_SIZE) / RAW_MESH_RECORD_SIZE) {
+		count = static_cast<GLuint>((fileLength - RAW_MESH_HEADER_SIZE) / RAW_MESH_RECORD_SIZE);
+	}
+	size = count;
+
+	records += RAW_MESH_HEADER_SIZE;
+	vertexArray = const_cast<unsigned char*>(records);
+	normalArray = const_cast<unsigned char*>(records + 3 * sizeof(GLfloat));
+	colourArray = const_cast<unsigned char*>(records + 6 * sizeof(GLfloat));
+	uvArray = const_cast<unsigned char*>(records + 9 * sizeof(GLfloat));
+	vertexStride = RAW_MESH_RECORD_SIZE;
+	normalStride = RAW_MESH_RECORD_SIZE;
+	colourStride = RAW_MESH_RECORD_SIZE;
+	uvStride = RAW_MESH_RECORD_SIZE;
+
+	return true;
+}
+
+void RawMeshLoader::touchPages() const {
+	const volatile unsigned char *bytes;
+	unsigned char sum;
+	size_t offset;
+
+	bytes = static_cast<const volatile unsigned char*>(mappedData);
+	sum = 0;
+	for (offset = 0; offset < mappedLength; offset += RAW_MESH_PAGE_STEP) {
+		sum += bytes[offset];
+	}
+	(void) sum;
+}
+
+void RawMeshLoader::scatterRecords(const unsigned char* records, unsigned int begin, unsigned int end) {
+	const GLfloat *record;
+	GLfloat *vertices;
+	GLfloat *normals;
+	GLfloat *colours;
+	GLfloat *uvs;
+	unsigned int i;
+
+	vertices = static_cast<GLfloat*>(vertexArray);
+	normals = static_cast<GLfloat*>(normalArray);
+	colours = static_cast<GLfloat*>(colourArray);
+	uvs = static_cast<GLfloat*>(uvArray);
+
+	for (i = begin; i < end; i++) {
+		record = reinterpret_cast<const GLfloat*>(records + static_cast<size_t>(i) * RAW_MESH_RECORD_SIZE);
+
+		vertices[i * 3 + 0] = record[0];
+		vertices[i * 3 + 1] = record[1];
+		vertices[i * 3 + 2] = record[2];
+		normals[i * 3 + 0] = record[3];
+		normals[i * 3 + 1] = record[4];
+		normals[i * 3 + 2] = record[5];
+		colours[i * 3 + 0] = record[6];
+		colours[i * 3 + 1] = record[7];
+		colours[i * 3 + 2] = record[8];
+		uvs[i * 2 + 0] = record[9];
+		uvs[i * 2 + 1] = record[10];
+	}
+}
+
+void RawMeshLoader::unmapFile() {
+#ifdef _WIN32
+	if (mappedData != NULL) {
+		UnmapViewOfFile(mappedData);
+	}
+
+	if (mappingHandle != NULL) {
+		CloseHandle(mappingHandle);
+		mappingHandle = NULL;
+	}
+
+	if (fileHandle != NULL) {
+		CloseHandle(fileHandle);
+		fileHandle = NULL;
+	}
+#else
+	if (mappedData != NULL) {
+		munmap(mappedData, mappedLength);
+	}
+#endif
+
+	mappedData = NULL;
+	mappedLength = 0;
+}
+
 const GLvoid* RawMeshLoader::getVertexArray() const {
 	return vertexArray;
 }
@@ -94,11 +342,68 @@ const GLvoid* RawMeshLoader::getUVArray() const {
 	return uvArray;
 }
 
+GLsizei RawMeshLoader::getVertexStride() const {
+	return vertexStride;
+}
+
+GLsizei RawMeshLoader::getNormalStride() const {
+	return normalStride;
+}
+
+GLsizei RawMeshLoader::getColourStride() const {
+	return colourStride;
+}
+
+GLsizei RawMeshLoader::getUVStride() const {
+	return uvStride;
+}
+
+const GLfloat* RawMeshLoader::getVertex(unsigned int index) const {
+	return reinterpret_cast<const GLfloat*>(static_cast<const char*>(vertexArray) + static_cast<size_t>(index) * vertexStride);
+}
+
+const GLfloat* RawMeshLoader::getNormal(unsigned int index) const {
+	return reinterpret_cast<const GLfloat*>(static_cast<const char*>(normalArray) + static_cast<size_t>(index) * normalStride);
+}
+
+const GLfloat* RawMeshLoader::getColour(unsigned int index) const {
+	return reinterpret_cast<const GLfloat*>(static_cast<const char*>(colourArray) + static_cast<size_t>(index) * colourStride);
+}
+
+const GLfloat* RawMeshLoader::getUV(unsigned int index) const {
+	return reinterpret_cast<const GLfloat*>(static_cast<const char*>(uvArray) + static_cast<size_t>(index) * uvStride);
+}
+
 const unsigned int RawMeshLoader::getSize() const {
 	return size;
 }
 
+RawMeshLoader::LoadMode RawMeshLoader::getLoadMode() const {
+	return loadMode;
+}
+
+double RawMeshLoader::getLoadTime() const {
+	return loadTime;
+}
+
+double RawMeshLoader::getLoadThroughput() const {
+	if (loadTime <= 0.0) {
+		return 0.0;
+	}
+
+	return (static_cast<double>(loadBytes) / (1024.0 * 1024.0)) / loadTime;
+}
+
 void RawMeshLoader::releaseArrays() {
+	// Mapped arrays point into the file mapping, so there is nothing to delete
+	if (mappedData != NULL) {
+		unmapFile();
+		vertexArray = NULL;
+		normalArray = NULL;
+		colourArray = NULL;
+		uvArray = NULL;
+	}
+
 	if (vertexArray != NULL) {
 		delete [] static_cast<GLfloat*>(vertexArray);
 		vertexArray = NULL;
@@ -118,6 +423,8 @@ void RawMeshLoader::releaseArrays() {
 		delete [] static_cast<GLfloat*>(uvArray);
 		uvArray = NULL;
 	}
+
+	size = 0;
 }
 
 // Copyright (c) 2012, ME Chamberlain
@@ -0,0 +1,189 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <GL/glew.h>
+
+#include "RenderQueue.h"
+
+/** Where each field of the sort key starts, the depth takes the lowest bits */
+#define KEY_PASS_SHIFT 56
+#define KEY_PROGRAM_SHIFT 40
+#define KEY_STATE_SHIFT 24
+#define KEY_DEPTH_BITS 24
+/** The number of states in a RenderState */
+#define STATE_COUNT 5
+
+RenderQueue::RenderQueue(GLfloat nearPlane, GLfloat farPlane)
+	: nearPlane(nearPlane),
+	  farPlane(farPlane),
+	  stateValid(false),
+	  sorted(true),
+	  drawCount(0),
+	  stateChangeCount(0),
+	  skippedStateChangeCount(0)
+{
+}
+
+void RenderQueue::clear() {
+	items.clear();
+	order.clear();
+	drawCount = 0;
+	stateChangeCount = 0;
+	skippedStateChangeCount = 0;
+}
+
+void RenderQueue::submit(Pass pass, const RenderState& state, const GLfloat color[3], const std::function<void()>& draw) {
+	Item item;
+
+	item.state = state;
+	glGetFloatv(GL_MODELVIEW_MATRIX, item.modelView);
+	item.color[0] = color[0];
+	item.color[1] = color[1];
+	item.color[2] = color[2];
+	item.draw = draw;
+
+	order.push_back(std::make_pair(makeKey(pass, item), static_cast<unsigned int>(items.size())));
+	items.push_back(item);
+	sorted = false;
+}
+
+uint64_t RenderQueue::makeKey(Pass pass, const Item& item) const {
+	uint64_t state;
+	GLfloat depth;
+	uint64_t quantizedDepth;
+
+	// Only the states that tell the passes apart go in the key, draws that differ in the rest still end up
+	// next to each other
+	state = ((item.state.polygonMode == GL_LINE) ? 1 : 0) | ((item.state.cullFace == GL_FRONT) ? 2 : 0) |
+	        ((item.state.depthFunc == GL_LEQUAL) ? 4 : 0);
+
+	// The distance of the object's origin along the view direction, nearest first so that the depth test
+	// rejects as much as it can
+	depth = (-item.modelView[14] - nearPlane) / (farPlane - nearPlane);
+	depth = std::min(std::max(depth, 0.0f), 1.0f);
+	quantizedDepth = static_cast<uint64_t>(depth * ((1 << KEY_DEPTH_BITS) - 1));
+
+	return (static_cast<uint64_t>(pass) << KEY_PASS_SHIFT) |
+	       (static_cast<uint64_t>(item.state.program & 0xFFFF) << KEY_PROGRAM_SHIFT) |
+	       (state << KEY_STATE_SHIFT) | quantizedDepth;
+}
+
+void RenderQueue::applyState(const RenderState& state) {
+	unsigned int changes;
+
+	changes = 0;
+
+	if ((!stateValid) || (state.program != current.program)) {
+		glUseProgram(state.program);
+		changes++;
+	}
+
+	if ((!stateValid) || (state.polygonMode != current.polygonMode)) {
+		glPolygonMode(GL_FRONT_AND_BACK, state.polygonMode);
+		changes++;
+	}
+
+	if ((!stateValid) || (state.cullFace != current.cullFace)) {
+		glCullFace(state.cullFace);
+		changes++;
+	}
+
+	if ((!stateValid) || (state.depthFunc != current.depthFunc)) {
+		glDepthFunc(state.depthFunc);
+		changes++;
+	}
+
+	if ((!stateValid) || (state.lineWidth != current.lineWidth)) {
+		glLineWidth(state.lineWidth);
+		changes++;
+	}
+
+	// Without the queue every draw would set every state
+	stateChangeCount += changes;
+	skippedStateChangeCount += STATE_COUNT - changes;
+
+	current = state;
+	stateValid = true;
+}
+
+void RenderQueue::flush() {
+	if (!sorted) {
+		std::sort(order.begin(), order.end());
+		sorted = true;
+	}
+
+	submitRange(0, static_cast<unsigned int>(order.size()));
+
+	items.clear();
+	order.clear();
+}
+
+void RenderQueue::flush(Pass pass) {
+	std::vector<std::pair<uint64_t, unsigned int> >::iterator first;
+	std::vector<std::pair<uint64_t, unsigned int> >::iterator last;
+
+	if (!sorted) {
+		std::sort(order.begin(), order.end());
+		sorted = true;
+	}
+
+	// The pass is in the highest bits of the key, so its draws are next to each other
+	first = std::lower_bound(order.begin(), order.end(), std::make_pair(static_cast<uint64_t>(pass) << KEY_PASS_SHIFT, 0u));
+	last = std::lower_bound(first, order.end(), std::make_pair(static_cast<uint64_t>(pass + 1) << KEY_PASS_SHIFT, 0u));
+
+	submitRange(static_cast<unsigned int>(first - order.begin()), static_cast<unsigned int>(last - order.begin()));
+}
+
+void RenderQueue::submitRange(unsigned int first, unsigned int last) {
+	unsigned int i;
+
+	// Code outside the queue may have changed any of the states since the last flush
+	stateValid = false;
+
+	glMatrixMode(GL_MODELVIEW);
+	glPushMatrix();
+
+	for (i = first; i < last; i++) {
+		const Item& item = items[order[i].second];
+
+		applyState(item.state);
+		glLoadMatrixf(item.modelView);
+		glColor3fv(item.color);
+		item.draw();
+		drawCount++;
+	}
+
+	glPopMatrix();
+}
+
+unsigned int RenderQueue::getDrawCount() const {
+	return drawCount;
+}
+
+unsigned int RenderQueue::getStateChangeCount() const {
+	return stateChangeCount;
+}
+
+unsigned int RenderQueue::getSkippedStateChangeCount() const {
+	return skippedStateChangeCount;
+}
@@ -0,0 +1,98 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+
+#include "ShaderPermutation.h"
+
+ToonRamp ShaderPermutation::defaultRamp() {
+	ToonRamp ramp;
+
+	ramp.bandCount = 3;
+	ramp.thresholds[0] = 0.5f;
+	ramp.thresholds[1] = 0.9f;
+	ramp.thresholds[2] = 1.0f;
+	ramp.levels[0] = 0.5f;
+	ramp.levels[1] = 0.7f;
+	ramp.levels[2] = 1.1f;
+	ramp.levels[3] = 1.1f;
+	ramp.specular = true;
+
+	return ramp;
+}
+
+std::string ShaderPermutation::buildDefines(const ToonRamp& ramp, bool writeNormals) {
+	std::ostringstream defines;
+	unsigned int bands;
+	unsigned int i;
+
+	bands = clampBands(ramp);
+
+	// GLSL 1.10 doesn't convert integers to floats, so every number needs its decimal point
+	defines.setf(std::ios::fixed);
+	defines.precision(4);
+
+	defines << "#define TOON_BANDS " << bands << "\n";
+	for (i = 1; i < bands; i++) {
+		defines << "#define TOON_THRESHOLD_" << i << " " << ramp.thresholds[i - 1] << "\n";
+	}
+	for (i = 0; i < bands; i++) {
+		defines << "#define TOON_LEVEL_" << i << " " << ramp.levels[i] << "\n";
+	}
+	defines << "#define TOON_SPECULAR " << (ramp.specular ? 1 : 0) << "\n";
+	defines << "#define WRITE_NORMALS " << (writeNormals ? 1 : 0) << "\n";
+
+	return defines.str();
+}
+
+int ShaderPermutation::compareRamps(const ToonRamp& a, const ToonRamp& b) {
+	unsigned int bands;
+	unsigned int i;
+
+	bands = clampBands(a);
+	if (bands != clampBands(b)) {
+		return (bands < clampBands(b)) ? -1 : 1;
+	}
+
+	// Only the values that end up in the defines count, the rest of the arrays may hold anything
+	for (i = 1; i < bands; i++) {
+		if (a.thresholds[i - 1] != b.thresholds[i - 1]) {
+			return (a.thresholds[i - 1] < b.thresholds[i - 1]) ? -1 : 1;
+		}
+	}
+	for (i = 0; i < bands; i++) {
+		if (a.levels[i] != b.levels[i]) {
+			return (a.levels[i] < b.levels[i]) ? -1 : 1;
+		}
+	}
+	if (a.specular != b.specular) {
+		return b.specular ? -1 : 1;
+	}
+
+	return 0;
+}
+
+unsigned int ShaderPermutation::clampBands(const ToonRamp& ramp) {
+	return std::min(std::max(ramp.bandCount, 1u), static_cast<unsigned int>(TOON_RAMP_MAX_BANDS));
+}
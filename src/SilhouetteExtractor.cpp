@@ -0,0 +1,174 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+#include <GL/glew.h>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#	include <xmmintrin.h>
+#	define SILHOUETTE_SSE
+#endif
+
+#include "SilhouetteExtractor.h"
+
+SilhouetteExtractor::SilhouetteExtractor()
+	: lastAdjacency(NULL),
+	  lastLevel(0),
+	  edgeCount(0),
+	  cached(false)
+{
+	lastEye[0] = lastEye[1] = lastEye[2] = 0.0f;
+}
+
+void SilhouetteExtractor::eyeFromModelView(const GLfloat modelView[16], GLfloat eye[3]) {
+	unsigned int i;
+
+	// The inverse of a rigid transform is the transposed rotation applied to the negated translation
+	for (i = 0; i < 3; i++) {
+		eye[i] = -(modelView[i * 4] * modelView[12] + modelView[i * 4 + 1] * modelView[13] + modelView[i * 4 + 2] * modelView[14]);
+	}
+}
+
+bool SilhouetteExtractor::update(const EdgeAdjacency& adjacency, unsigned int level, const GLfloat eye[3], ThreadPool& threadPool) {
+	unsigned int chunks;
+	unsigned int chunkSize;
+	unsigned int i;
+
+	// A still camera sees the same silhouette
+	if ((lastAdjacency == &adjacency) && (lastLevel == level) && (lastEye[0] == eye[0]) && (lastEye[1] == eye[1]) && (lastEye[2] == eye[2])) {
+		cached = true;
+		return false;
+	}
+
+	lastAdjacency = &adjacency;
+	lastLevel = level;
+	lastEye[0] = eye[0];
+	lastEye[1] = eye[1];
+	lastEye[2] = eye[2];
+	cached = false;
+	lines.clear();
+
+	if (level >= adjacency.getLodCount()) {
+		edgeCount = 0;
+		return true;
+	}
+
+	const EdgeAdjacencyLevel& info = adjacency.getLevel(level);
+	edgeCount = info.edgeCount;
+	facing.resize(info.faceCount);
+
+	if (info.edgeCount < SILHOUETTE_PARALLEL_EDGES) {
+		classifyFaces(adjacency, info, eye, 0, info.faceCount);
+		collectEdges(adjacency, info, 0, info.edgeCount, lines);
+		return true;
+	}
+
+	threadPool.parallelFor(info.faceCount, [this, &adjacency, &info, eye](unsigned int begin, unsigned int end) {
+		classifyFaces(adjacency, info, eye, begin, end);
+	});
+
+	// Fixed chunks, each with its own list, keep the order of the lines the same from frame to frame
+	chunks = threadPool.getThreadCount();
+	chunkSize = (info.edgeCount + chunks - 1) / chunks;
+	chunkLines.resize(chunks);
+	threadPool.parallelFor(chunks, [this, &adjacency, &info, chunkSize](unsigned int begin, unsigned int end) {
+		unsigned int chunk;
+
+		for (chunk = begin; chunk < end; chunk++) {
+			chunkLines[chunk].clear();
+			collectEdges(adjacency, info, std::min(chunk * chunkSize, info.edgeCount), std::min((chunk + 1) * chunkSize, info.edgeCount),
+			             chunkLines[chunk]);
+		}
+	});
+
+	for (i = 0; i < chunks; i++) {
+		lines.insert(lines.end(), chunkLines[i].begin(), chunkLines[i].end());
+	}
+
+	return true;
+}
+
+void SilhouetteExtractor::classifyFaces(const EdgeAdjacency& adjacency, const EdgeAdjacencyLevel& info, const GLfloat eye[3],
+                                        unsigned int begin, unsigned int end) {
+	const GLfloat *nx = adjacency.getFaceNormalX() + info.firstFace;
+	const GLfloat *ny = adjacency.getFaceNormalY() + info.firstFace;
+	const GLfloat *nz = adjacency.getFaceNormalZ() + info.firstFace;
+	const GLfloat *d = adjacency.getFaceDistance() + info.firstFace;
+	unsigned int i;
+
+	i = begin;
+
+#ifdef SILHOUETTE_SSE
+	__m128 ex = _mm_set1_ps(eye[0]);
+	__m128 ey = _mm_set1_ps(eye[1]);
+	__m128 ez = _mm_set1_ps(eye[2]);
+	int mask;
+
+	for (; i + 4 <= end; i += 4) {
+		__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(_mm_loadu_ps(nx + i), ex), _mm_mul_ps(_mm_loadu_ps(ny + i), ey)),
+		                             _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(nz + i), ez), _mm_loadu_ps(d + i)));
+
+		mask = _mm_movemask_ps(_mm_cmpgt_ps(distance, _mm_setzero_ps()));
+		facing[i] = mask & 1;
+		facing[i + 1] = (mask >> 1) & 1;
+		facing[i + 2] = (mask >> 2) & 1;
+		facing[i + 3] = (mask >> 3) & 1;
+	}
+#endif
+
+	for (; i < end; i++) {
+		facing[i] = (nx[i] * eye[0] + ny[i] * eye[1] + nz[i] * eye[2] + d[i] > 0.0f) ? 1 : 0;
+	}
+}
+
+void SilhouetteExtractor::collectEdges(const EdgeAdjacency& adjacency, const EdgeAdjacencyLevel& info, unsigned int begin, unsigned int end,
+                                       std::vector<GLuint>& out) const {
+	const GLuint *vertices = adjacency.getEdgeVertices() + info.firstEdge * 2;
+	const GLuint *faces = adjacency.getEdgeFaces() + info.firstEdge * 2;
+	unsigned int i;
+
+	for (i = begin; i < end; i++) {
+		if ((faces[i * 2 + 1] == EDGE_ADJACENCY_NO_FACE) || (facing[faces[i * 2]] != facing[faces[i * 2 + 1]])) {
+			out.push_back(vertices[i * 2]);
+			out.push_back(vertices[i * 2 + 1]);
+		}
+	}
+}
+
+const std::vector<GLuint>& SilhouetteExtractor::getLines() const {
+	return lines;
+}
+
+unsigned int SilhouetteExtractor::getEdgeCount() const {
+	return edgeCount;
+}
+
+bool SilhouetteExtractor::wasCached() const {
+	return cached;
+}
+
+void SilhouetteExtractor::invalidate() {
+	lastAdjacency = NULL;
+	lines.clear();
+}
@@ -0,0 +1,724 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "SoftwareRasterizer.h"
+
+SoftwareRasterizer::SoftwareRasterizer(ThreadPool* threadPool)
+	: threadPool(threadPool),
+	  width(0),
+	  height(0),
+	  tilesX(0),
+	  tilesY(0),
+	  nearPlane(0.1f),
+	  ramp(ShaderPermutation::defaultRamp()),
+	  outlines(true),
+	  sourcePositions(NULL),
+	  sourceNormals(NULL),
+	  sourceColours(NULL),
+	  positionStride(0),
+	  normalStride(0),
+	  colourStride(0)
+{
+	static const GLfloat identity[16] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f,
+	                                      0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+	static const GLfloat origin[4] = { 0.0f, 0.0f, 0.0f, 1.0f };
+
+	std::copy(identity, identity + 16, projection);
+	setModelView(identity);
+	setLight(origin);
+}
+
+void SoftwareRasterizer::resize(int width, int height) {
+	this->width = std::max(width, 0);
+	this->height = std::max(height, 0);
+	tilesX = (this->width + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+	tilesY = (this->height + RASTER_TILE_SIZE - 1) / RASTER_TILE_SIZE;
+
+	pixels.assign(static_cast<size_t>(this->width) * this->height * 3, 0);
+	depths.assign(static_cast<size_t>(this->width) * this->height, 1.0f);
+}
+
+int SoftwareRasterizer::getWidth() const {
+	return width;
+}
+
+int SoftwareRasterizer::getHeight() const {
+	return height;
+}
+
+void SoftwareRasterizer::setPerspective(GLfloat fieldOfView, GLfloat nearPlane, GLfloat farPlane) {
+	GLfloat f;
+
+	// The same matrix gluPerspective builds
+	f = 1.0f / tanf(fieldOfView * static_cast<GLfloat>(M_PI) / 360.0f);
+	std::fill(projection, projection + 16, 0.0f);
+	projection[0] = f * height / std::max(width, 1);
+	projection[5] = f;
+	projection[10] = (farPlane + nearPlane) / (nearPlane - farPlane);
+	projection[11] = -1.0f;
+	projection[14] = 2.0f * farPlane * nearPlane / (nearPlane - farPlane);
+
+	this->nearPlane = nearPlane;
+}
+
+void SoftwareRasterizer::setModelView(const GLfloat matrix[16]) {
+	GLfloat cofactors[9];
+	GLfloat det;
+	unsigned int i;
+
+	std::copy(matrix, matrix + 16, modelView);
+
+	// The inverse transpose of the rotation is its cofactor matrix over its determinant, like gl_NormalMatrix
+	cofactors[0] = matrix[5] * matrix[10] - matrix[9] * matrix[6];
+	cofactors[1] = matrix[8] * matrix[6] - matrix[4] * matrix[10];
+	cofactors[2] = matrix[4] * matrix[9] - matrix[8] * matrix[5];
+	cofactors[3] = matrix[9] * matrix[2] - matrix[1] * matrix[10];
+	cofactors[4] = matrix[0] * matrix[10] - matrix[8] * matrix[2];
+	cofactors[5] = matrix[8] * matrix[1] - matrix[0] * matrix[9];
+	cofactors[6] = matrix[1] * matrix[6] - matrix[5] * matrix[2];
+	cofactors[7] = matrix[4] * matrix[2] - matrix[0] * matrix[6];
+	cofactors[8] = matrix[0] * matrix[5] - matrix[4] * matrix[1];
+	det = matrix[0] * cofactors[0] + matrix[4] * cofactors[3] + matrix[8] * cofactors[6];
+
+	for (i = 0; i < 9; i++) {
+		normalMatrix[i] = (det != 0.0f) ? cofactors[i] / det : 0.0f;
+	}
+}
+
+void SoftwareRasterizer::setLight(const GLfloat position[4]) {
+	unsigned int i;
+
+	for (i = 0; i < 3; i++) {
+		light[i] = modelView[i] * position[0] + modelView[4 + i] * position[1] + modelView[8 + i] * position[2] +
+		           modelView[12 + i] * position[3];
+	}
+}
+
+void SoftwareRasterizer::setRamp(const ToonRamp& ramp) {
+	this->ramp = ramp;
+}
+
+void SoftwareRasterizer::setOutlines(bool outlines) {
+	this->outlines = outlines;
+}
+
+void SoftwareRasterizer::clear(const GLfloat colour[3]) {
+	GLubyte rgb[3];
+	size_t i;
+
+	for (i = 0; i < 3; i++) {
+		rgb[i] = static_cast<GLubyte>(std::min(std::max(colour[i], 0.0f), 1.0f) * 255.0f + 0.5f);
+	}
+
+	for (i = 0; i < pixels.size(); i += 3) {
+		pixels[i] = rgb[0];
+		pixels[i + 1] = rgb[1];
+		pixels[i + 2] = rgb[2];
+	}
+
+	std::fill(depths.begin(), depths.end(), 1.0f);
+}
+
+void SoftwareRasterizer::draw(const RawMeshLoader& mesh) {
+	draw(mesh.getVertexArray(), mesh.getVertexStride(), mesh.getNormalArray(), mesh.getNormalStride(),
+	     mesh.getColourArray(), mesh.getColourStride(), mesh.getSize());
+}
+
+void SoftwareRasterizer::draw(const GLvoid* positions, GLsizei positionStride, const GLvoid* normals, GLsizei normalStride,
+                              const GLvoid* colours, GLsizei colourStride, unsigned int vertexCount) {
+	std::atomic<unsigned int> nextTile(0);
+	unsigned int triangleCount;
+	unsigned int tileCount;
+	unsigned int binCount;
+	unsigned int i;
+
+	triangleCount = vertexCount / 3;
+	tileCount = tilesX * tilesY;
+	if ((triangleCount == 0) || (tileCount == 0)) {
+		return;
+	}
+
+	// Like glVertexPointer, a stride of 0 means the floats are tightly packed
+	sourcePositions = static_cast<const GLubyte*>(positions);
+	sourceNormals = static_cast<const GLubyte*>(normals);
+	sourceColours = static_cast<const GLubyte*>(colours);
+	this->positionStride = (positionStride != 0) ? positionStride : 3 * sizeof(GLfloat);
+	this->normalStride = (normalStride != 0) ? normalStride : 3 * sizeof(GLfloat);
+	this->colourStride = (colourStride != 0) ? colourStride : 3 * sizeof(GLfloat);
+
+	vertices.resize(triangleCount * 3);
+	triangles.resize(triangleCount);
+
+	if (threadPool == NULL) {
+		bins.resize(tileCount);
+		for (i = 0; i < bins.size(); i++) {
+			bins[i].clear();
+		}
+
+		transformVertices(0, triangleCount * 3);
+		binTriangles(0, 0, triangleCount);
+		for (i = 0; i < tileCount; i++) {
+			rasterizeTile(i);
+		}
+		return;
+	}
+
+	threadPool->parallelFor(triangleCount * 3, [this](unsigned int begin, unsigned int end) {
+		transformVertices(begin, end);
+	});
+
+	// Every thread bins a contiguous range of triangles into its own set of tiles, and the tiles read the sets
+	// in order, so the triangles are drawn in the order they were given
+	binCount = threadPool->getThreadCount();
+	bins.resize(static_cast<size_t>(binCount) * tileCount);
+	for (i = 0; i < bins.size(); i++) {
+		bins[i].clear();
+	}
+
+	threadPool->parallelFor(binCount, [this, binCount, triangleCount](unsigned int begin, unsigned int end) {
+		unsigned int bin;
+
+		for (bin = begin; bin < end; bin++) {
+			binTriangles(bin, static_cast<unsigned int>(static_cast<unsigned long long>(triangleCount) * bin / binCount),
+			             static_cast<unsigned int>(static_cast<unsigned long long>(triangleCount) * (bin + 1) / binCount));
+		}
+	});
+
+	// The tiles in the middle of the model take far longer than those at the edges, so the threads take the
+	// next tile as they finish one instead of being handed an equal share up front
+	threadPool->parallelFor(threadPool->getThreadCount(), [this, &nextTile, tileCount](unsigned int, unsigned int) {
+		unsigned int tile;
+
+		while ((tile = nextTile.fetch_add(1)) < tileCount) {
+			rasterizeTile(tile);
+		}
+	});
+}
+
+void SoftwareRasterizer::transformVertices(unsigned int begin, unsigned int end) {
+	const GLfloat *position;
+	const GLfloat *normal;
+	const GLfloat *colour;
+	GLfloat clip[4];
+	unsigned int i;
+	unsigned int j;
+
+	for (i = begin; i < end; i++) {
+		Vertex& vertex = vertices[i];
+
+		position = reinterpret_cast<const GLfloat*>(sourcePositions + static_cast<size_t>(i) * positionStride);
+		normal = reinterpret_cast<const GLfloat*>(sourceNormals + static_cast<size_t>(i) * normalStride);
+		colour = reinterpret_cast<const GLfloat*>(sourceColours + static_cast<size_t>(i) * colourStride);
+
+		for (j = 0; j < 3; j++) {
+			vertex.eye[j] = modelView[j] * position[0] + modelView[4 + j] * position[1] + modelView[8 + j] * position[2] +
+			                modelView[12 + j];
+			vertex.normal[j] = normalMatrix[j] * normal[0] + normalMatrix[3 + j] * normal[1] + normalMatrix[6 + j] * normal[2];
+			vertex.colour[j] = colour[j];
+		}
+
+		for (j = 0; j < 4; j++) {
+			clip[j] = projection[j] * vertex.eye[0] + projection[4 + j] * vertex.eye[1] + projection[8 + j] * vertex.eye[2] +
+			          projection[12 + j];
+		}
+
+		vertex.visible = -vertex.eye[2] >= nearPlane;
+		if (!vertex.visible) {
+			continue;
+		}
+
+		vertex.invW = 1.0f / clip[3];
+		vertex.window[0] = (clip[0] * vertex.invW * 0.5f + 0.5f) * width;
+		vertex.window[1] = (clip[1] * vertex.invW * 0.5f + 0.5f) * height;
+		vertex.window[2] = clip[2] * vertex.invW * 0.5f + 0.5f;
+	}
+}
+
+bool SoftwareRasterizer::setupTriangle(Triangle& triangle) const {
+	const Vertex *v[3];
+	GLfloat area;
+	GLfloat border;
+	unsigned int i;
+	unsigned int j;
+	unsigned int k;
+
+	for (i = 0; i < 3; i++) {
+		v[i] = &vertices[triangle.vertices[i]];
+
+		if (!v[i]->visible) {
+			return false;
+		}
+	}
+
+	for (i = 0; i < 3; i++) {
+		j = (i + 1) % 3;
+		k = (i + 2) % 3;
+
+		triangle.edgeX[i] = v[j]->window[1] - v[k]->window[1];
+		triangle.edgeY[i] = v[k]->window[0] - v[j]->window[0];
+		triangle.edgeC[i] = v[j]->window[0] * v[k]->window[1] - v[k]->window[0] * v[j]->window[1];
+	}
+
+	// Counter clockwise triangles face the camera, like glFrontFace(GL_CCW)
+	area = triangle.edgeX[0] * v[0]->window[0] + triangle.edgeY[0] * v[0]->window[1] + triangle.edgeC[0];
+	triangle.backFacing = area < 0.0f;
+	if ((area == 0.0f) || ((triangle.backFacing) && (!outlines))) {
+		return false;
+	}
+	triangle.invArea = 1.0f / area;
+
+	// The outlines reach half their width past the edges
+	border = triangle.backFacing ? RASTER_OUTLINE_WIDTH * 0.5f : 0.0f;
+	triangle.minX = std::max(static_cast<int>(floorf(std::min(std::min(v[0]->window[0], v[1]->window[0]), v[2]->window[0]) - border)), 0);
+	triangle.minY = std::max(static_cast<int>(floorf(std::min(std::min(v[0]->window[1], v[1]->window[1]), v[2]->window[1]) - border)), 0);
+	triangle.maxX = std::min(static_cast<int>(ceilf(std::max(std::max(v[0]->window[0], v[1]->window[0]), v[2]->window[0]) + border)), width - 1);
+	triangle.maxY = std::min(static_cast<int>(ceilf(std::max(std::max(v[0]->window[1], v[1]->window[1]), v[2]->window[1]) + border)), height - 1);
+
+	return (triangle.minX <= triangle.maxX) && (triangle.minY <= triangle.maxY);
+}
+
+void SoftwareRasterizer::binTriangles(unsigned int bin, unsigned int begin, unsigned int end) {
+	std::vector<unsigned int> *tiles;
+	unsigned int tileX;
+	unsigned int tileY;
+	unsigned int i;
+
+	tiles = &bins[static_cast<size_t>(bin) * tilesX * tilesY];
+
+	for (i = begin; i < end; i++) {
+		Triangle& triangle = triangles[i];
+
+		triangle.vertices[0] = i * 3;
+		triangle.vertices[1] = i * 3 + 1;
+		triangle.vertices[2] = i * 3 + 2;
+
+		if (!setupTriangle(triangle)) {
+			continue;
+		}
+
+		for (tileY = triangle.minY / RASTER_TILE_SIZE; tileY <= static_cast<unsigned int>(triangle.maxY) / RASTER_TILE_SIZE; tileY++) {
+			for (tileX = triangle.minX / RASTER_TILE_SIZE; tileX <= static_cast<unsigned int>(triangle.maxX) / RASTER_TILE_SIZE; tileX++) {
+				tiles[tileY * tilesX + tileX].push_back(i);
+			}
+		}
+	}
+}
+
+void SoftwareRasterizer::rasterizeTile(unsigned int tile) {
+	unsigned int tileCount;
+	unsigned int bin;
+	unsigned int pass;
+	unsigned int i;
+	int x0;
+	int y0;
+	int x1;
+	int y1;
+
+	tileCount = tilesX * tilesY;
+	x0 = static_cast<int>(tile % tilesX) * RASTER_TILE_SIZE;
+	y0 = static_cast<int>(tile / tilesX) * RASTER_TILE_SIZE;
+	x1 = std::min(x0 + RASTER_TILE_SIZE, width);
+	y1 = std::min(y0 + RASTER_TILE_SIZE, height);
+
+	// The outlines are drawn first and the front faces over them, like the two passes of the GL renderer
+	for (pass = 0; pass < 2; pass++) {
+		for (bin = 0; bin < bins.size() / tileCount; bin++) {
+			const std::vector<unsigned int>& binned = bins[bin * tileCount + tile];
+
+			for (i = 0; i < binned.size(); i++) {
+				const Triangle& triangle = triangles[binned[i]];
+
+				if (triangle.backFacing != (pass == 0)) {
+					continue;
+				}
+
+				if (triangle.backFacing) {
+					outlineTriangle(triangle, std::max(x0, triangle.minX), std::max(y0, triangle.minY),
+					                std::min(x1, triangle.maxX + 1), std::min(y1, triangle.maxY + 1));
+				}
+				else {
+					fillTriangle(triangle, std::max(x0, triangle.minX), std::max(y0, triangle.minY),
+					             std::min(x1, triangle.maxX + 1), std::min(y1, triangle.maxY + 1));
+				}
+			}
+		}
+	}
+}
+
+void SoftwareRasterizer::fillTriangle(const Triangle& triangle, int x0, int y0, int x1, int y1) {
+	const Vertex *v[3];
+	GLfloat rowEdge[3];
+	GLfloat weights[3];
+	unsigned int mask;
+	unsigned int lane;
+	unsigned int i;
+	size_t index;
+	int x;
+	int y;
+#if defined(__SSE2__)
+	const __m128 laneOffsets = _mm_set_ps(3.5f, 2.5f, 1.5f, 0.5f);
+	GLfloat laneWeights[3][4];
+	GLfloat groupDepths[4];
+	GLubyte groupPixels[4 * 3];
+	__m128 edge[3];
+	__m128 weight[3];
+	__m128 inside;
+	__m128 depths4;
+	__m128 stored;
+	__m128 passed;
+	__m128 total;
+	int lanes;
+#else
+	GLfloat edges[3][4];
+	GLfloat depth;
+	GLfloat sum;
+#endif
+
+	for (i = 0; i < 3; i++) {
+		v[i] = &vertices[triangle.vertices[i]];
+	}
+
+	for (y = y0; y < y1; y++) {
+		for (i = 0; i < 3; i++) {
+			rowEdge[i] = triangle.edgeY[i] * (y + 0.5f) + triangle.edgeC[i];
+		}
+
+		// Test four pixel centres against the three edges at once
+		for (x = x0; x < x1; x += 4) {
+#if defined(__SSE2__)
+			inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+			for (i = 0; i < 3; i++) {
+				edge[i] = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle.edgeX[i]), _mm_add_ps(_mm_set1_ps(static_cast<float>(x)), laneOffsets)),
+				                     _mm_set1_ps(rowEdge[i]));
+				inside = _mm_and_ps(inside, _mm_cmpge_ps(edge[i], _mm_setzero_ps()));
+			}
+
+			// The last group of a row may hang over the rectangle, those lanes belong to another tile and are
+			// neither read nor written
+			lanes = std::min(x1 - x, 4);
+			mask = static_cast<unsigned int>(_mm_movemask_ps(inside)) & ((1u << lanes) - 1);
+			if (mask == 0) {
+				continue;
+			}
+
+			// Depth is interpolated linearly in window space, with a <= test, for all four lanes at once
+			index = static_cast<size_t>(y) * width + x;
+			for (i = 0; i < 3; i++) {
+				weight[i] = _mm_mul_ps(edge[i], _mm_set1_ps(triangle.invArea));
+			}
+			depths4 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(weight[0], _mm_set1_ps(v[0]->window[2])), _mm_mul_ps(weight[1], _mm_set1_ps(v[1]->window[2]))),
+			                     _mm_mul_ps(weight[2], _mm_set1_ps(v[2]->window[2])));
+
+			if (lanes == 4) {
+				stored = _mm_loadu_ps(&depths[index]);
+			}
+			else {
+				memcpy(groupDepths, &depths[index], lanes * sizeof(GLfloat));
+				stored = _mm_loadu_ps(groupDepths);
+			}
+
+			passed = _mm_and_ps(_mm_cmple_ps(depths4, stored),
+			                    _mm_and_ps(_mm_cmpge_ps(depths4, _mm_setzero_ps()), _mm_cmple_ps(depths4, _mm_set1_ps(1.0f))));
+			mask &= static_cast<unsigned int>(_mm_movemask_ps(passed));
+			if (mask == 0) {
+				continue;
+			}
+
+			// Write the new depths of the lanes that passed and keep the others
+			passed = _mm_and_ps(passed, inside);
+			stored = _mm_or_ps(_mm_and_ps(passed, depths4), _mm_andnot_ps(passed, stored));
+			if (lanes == 4) {
+				_mm_storeu_ps(&depths[index], stored);
+			}
+			else {
+				_mm_storeu_ps(groupDepths, stored);
+				memcpy(&depths[index], groupDepths, lanes * sizeof(GLfloat));
+			}
+
+			// Everything else is interpolated with perspective correction
+			for (i = 0; i < 3; i++) {
+				weight[i] = _mm_mul_ps(weight[i], _mm_set1_ps(v[i]->invW));
+			}
+			total = _mm_add_ps(_mm_add_ps(weight[0], weight[1]), weight[2]);
+			for (i = 0; i < 3; i++) {
+				_mm_storeu_ps(laneWeights[i], _mm_div_ps(weight[i], total));
+			}
+
+			// Shade the lanes that passed into a copy of the group's pixels and write the group back in one go
+			memcpy(groupPixels, &pixels[index * 3], lanes * 3);
+			for (lane = 0; mask != 0; lane++, mask >>= 1) {
+				if ((mask & 1) == 0) {
+					continue;
+				}
+
+				weights[0] = laneWeights[0][lane];
+				weights[1] = laneWeights[1][lane];
+				weights[2] = laneWeights[2][lane];
+				shade(triangle, weights, &groupPixels[lane * 3]);
+			}
+			memcpy(&pixels[index * 3], groupPixels, lanes * 3);
+#else
+			mask = 0;
+			for (lane = 0; lane < 4; lane++) {
+				for (i = 0; i < 3; i++) {
+					edges[i][lane] = triangle.edgeX[i] * (x + lane + 0.5f) + rowEdge[i];
+				}
+
+				if ((edges[0][lane] >= 0.0f) && (edges[1][lane] >= 0.0f) && (edges[2][lane] >= 0.0f)) {
+					mask |= 1 << lane;
+				}
+			}
+
+			// The last group of a row may hang over the rectangle
+			if (x1 - x < 4) {
+				mask &= (1u << (x1 - x)) - 1;
+			}
+
+			for (lane = 0; mask != 0; lane++, mask >>= 1) {
+				if ((mask & 1) == 0) {
+					continue;
+				}
+
+				for (i = 0; i < 3; i++) {
+					weights[i] = edges[i][lane] * triangle.invArea;
+				}
+
+				// Depth is interpolated linearly in window space, with a <= test
+				depth = weights[0] * v[0]->window[2] + weights[1] * v[1]->window[2] + weights[2] * v[2]->window[2];
+				index = static_cast<size_t>(y) * width + x + lane;
+				if ((depth > depths[index]) || (depth < 0.0f) || (depth > 1.0f)) {
+					continue;
+				}
+				depths[index] = depth;
+
+				// Everything else is interpolated with perspective correction
+				sum = 0.0f;
+				for (i = 0; i < 3; i++) {
+					weights[i] *= v[i]->invW;
+					sum += weights[i];
+				}
+				for (i = 0; i < 3; i++) {
+					weights[i] /= sum;
+				}
+
+				shade(triangle, weights, &pixels[index * 3]);
+			}
+#endif
+		}
+	}
+}
+
+void SoftwareRasterizer::outlineTriangle(const Triangle& triangle, int x0, int y0, int x1, int y1) {
+	const GLfloat halfWidth = RASTER_OUTLINE_WIDTH * 0.5f;
+	const Vertex *a;
+	const Vertex *b;
+	GLfloat dx;
+	GLfloat dy;
+	GLfloat px;
+	GLfloat py;
+	GLfloat t;
+	GLfloat offset;
+	GLfloat depth;
+	unsigned int i;
+	size_t index;
+	int x;
+	int y;
+
+	for (y = y0; y < y1; y++) {
+		for (x = x0; x < x1; x++) {
+			px = x + 0.5f;
+			py = y + 0.5f;
+			index = static_cast<size_t>(y) * width + x;
+
+			// Each edge is drawn like a wide GL line, black with a < depth test. A wide line covers the pixels
+			// within half its width of the line along the minor axis, between the ends along the major axis
+			for (i = 0; i < 3; i++) {
+				a = &vertices[triangle.vertices[i]];
+				b = &vertices[triangle.vertices[(i + 1) % 3]];
+
+				dx = b->window[0] - a->window[0];
+				dy = b->window[1] - a->window[1];
+				if ((dx == 0.0f) && (dy == 0.0f)) {
+					continue;
+				}
+
+				if (fabsf(dx) >= fabsf(dy)) {
+					t = (px - a->window[0]) / dx;
+					offset = py - (a->window[1] + t * dy);
+				}
+				else {
+					t = (py - a->window[1]) / dy;
+					offset = px - (a->window[0] + t * dx);
+				}
+
+				if ((t < 0.0f) || (t > 1.0f) || (fabsf(offset) > halfWidth)) {
+					continue;
+				}
+
+				depth = a->window[2] + t * (b->window[2] - a->window[2]);
+				if ((depth < depths[index]) && (depth >= 0.0f)) {
+					depths[index] = depth;
+					pixels[index * 3] = 0;
+					pixels[index * 3 + 1] = 0;
+					pixels[index * 3 + 2] = 0;
+				}
+			}
+		}
+	}
+}
+
+void SoftwareRasterizer::shade(const Triangle& triangle, const GLfloat weights[3], GLubyte pixel[3]) const {
+	const Vertex *v[3];
+	GLfloat position[3];
+	GLfloat normal[3];
+	GLfloat colour[3];
+	GLfloat lightDir[3];
+	GLfloat eyeDir[3];
+	GLfloat reflectDir[3];
+	GLfloat length;
+	GLfloat diffuse;
+	GLfloat intensity;
+	GLfloat level;
+	GLfloat dot;
+	unsigned int band;
+	unsigned int i;
+
+	for (i = 0; i < 3; i++) {
+		v[i] = &vertices[triangle.vertices[i]];
+	}
+
+	for (i = 0; i < 3; i++) {
+		position[i] = weights[0] * v[0]->eye[i] + weights[1] * v[1]->eye[i] + weights[2] * v[2]->eye[i];
+		normal[i] = weights[0] * v[0]->normal[i] + weights[1] * v[1]->normal[i] + weights[2] * v[2]->normal[i];
+		colour[i] = weights[0] * v[0]->colour[i] + weights[1] * v[1]->colour[i] + weights[2] * v[2]->colour[i];
+		lightDir[i] = position[i] - light[i];
+	}
+
+	// From here on this follows celShader.frag line for line
+	length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+	length = (length > 0.0f) ? 1.0f / length : 0.0f;
+	normal[0] *= length;
+	normal[1] *= length;
+	normal[2] *= length;
+
+	length = sqrtf(lightDir[0] * lightDir[0] + lightDir[1] * lightDir[1] + lightDir[2] * lightDir[2]);
+	length = (length > 0.0f) ? 1.0f / length : 0.0f;
+	lightDir[0] *= length;
+	lightDir[1] *= length;
+	lightDir[2] *= length;
+
+	diffuse = std::max(-(lightDir[0] * normal[0] + lightDir[1] * normal[1] + lightDir[2] * normal[2]), 0.0f);
+	intensity = diffuse;
+
+	if (ramp.specular) {
+		length = sqrtf(position[0] * position[0] + position[1] * position[1] + position[2] * position[2]);
+		length = (length > 0.0f) ? 1.0f / length : 0.0f;
+		dot = lightDir[0] * normal[0] + lightDir[1] * normal[1] + lightDir[2] * normal[2];
+
+		for (i = 0; i < 3; i++) {
+			eyeDir[i] = -position[i] * length;
+			reflectDir[i] = lightDir[i] - 2.0f * dot * normal[i];
+		}
+
+		length = sqrtf(reflectDir[0] * reflectDir[0] + reflectDir[1] * reflectDir[1] + reflectDir[2] * reflectDir[2]);
+		length = (length > 0.0f) ? 1.0f / length : 0.0f;
+		dot = (reflectDir[0] * eyeDir[0] + reflectDir[1] * eyeDir[1] + reflectDir[2] * eyeDir[2]) * length;
+
+		intensity = 0.6f * diffuse + 0.4f * std::max(dot, 0.0f);
+	}
+
+	level = ramp.levels[0];
+	for (band = 1; band < ramp.bandCount; band++) {
+		if (intensity >= ramp.thresholds[band - 1]) {
+			level += ramp.levels[band] - ramp.levels[band - 1];
+		}
+	}
+
+	for (i = 0; i < 3; i++) {
+		pixel[i] = static_cast<GLubyte>(std::min(std::max(colour[i] * level, 0.0f), 1.0f) * 255.0f + 0.5f);
+	}
+}
+
+const std::vector<GLubyte>& SoftwareRasterizer::getPixels() const {
+	return pixels;
+}
+
+bool SoftwareRasterizer::writeImage(const std::string& path) const {
+	std::ofstream file;
+	size_t rowSize;
+	int y;
+
+	file.open(path.c_str(), std::ios::out | std::ios::binary);
+	if (!file.good()) {
+		std::cout << "Could not write " << path << std::endl;
+		return false;
+	}
+
+	// PPM rows go from the top down, the image's from the bottom up
+	rowSize = static_cast<size_t>(width) * 3;
+	file << "P6\n" << width << " " << height << "\n255\n";
+	for (y = height - 1; y >= 0; y--) {
+		file.write(reinterpret_cast<const char*>(&pixels[y * rowSize]), rowSize);
+	}
+
+	return file.good();
+}
+
+void SoftwareRasterizer::orbitMatrix(GLfloat viewAngle, GLfloat pitch, GLfloat distance, GLfloat matrix[16]) {
+	GLfloat cosPitch;
+	GLfloat sinPitch;
+	GLfloat cosAngle;
+	GLfloat sinAngle;
+
+	cosPitch = cosf(pitch);
+	sinPitch = sinf(pitch);
+	cosAngle = cosf(viewAngle);
+	sinAngle = sinf(viewAngle);
+
+	// glTranslatef(0, 0, -distance), then glRotatef by the pitch around x and by the angle around y
+	matrix[0] = cosAngle;
+	matrix[1] = sinPitch * sinAngle;
+	matrix[2] = -cosPitch * sinAngle;
+	matrix[3] = 0.0f;
+	matrix[4] = 0.0f;
+	matrix[5] = cosPitch;
+	matrix[6] = sinPitch;
+	matrix[7] = 0.0f;
+	matrix[8] = sinAngle;
+	matrix[9] = -sinPitch * cosAngle;
+	matrix[10] = cosPitch * cosAngle;
+	matrix[11] = 0.0f;
+	matrix[12] = 0.0f;
+	matrix[13] = 0.0f;
+	matrix[14] = -distance;
+	matrix[15] = 1.0f;
+}
@@ -0,0 +1,209 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+#include "ThreadPool.h"
+
+/**
+ * The chunks of one parallelFor call. Each call has its own, so it only ever waits for its own chunks.
+ */
+struct ParallelForChunks {
+	/** The loop body, only touched while a chunk is claimed */
+	const std::function<void(unsigned int, unsigned int)> *body;
+	/** The size of the range */
+	unsigned int count;
+	/** The size of every chunk but the last */
+	unsigned int chunkSize;
+	/** The number of chunks */
+	unsigned int chunkCount;
+	/** The next chunk to be claimed */
+	std::atomic<unsigned int> nextChunk;
+	/** Number of chunks not finished yet */
+	unsigned int remaining;
+	/** Guards remaining */
+	std::mutex mutex;
+	/** Signalled when the last chunk finishes */
+	std::condition_variable chunksDone;
+};
+
+/**
+ * Claims and runs chunks until none are left.
+ * @param chunks The chunks of a parallelFor call.
+ */
+static void runChunks(ParallelForChunks& chunks) {
+	unsigned int chunk;
+	unsigned int begin;
+
+	while ((chunk = chunks.nextChunk.fetch_add(1)) < chunks.chunkCount) {
+		begin = chunk * chunks.chunkSize;
+		(*chunks.body)(begin, std::min(chunks.count, begin + chunks.chunkSize));
+
+		std::unique_lock<std::mutex> lock(chunks.mutex);
+		chunks.remaining--;
+
+		if (chunks.remaining == 0) {
+			chunks.chunksDone.notify_all();
+		}
+	}
+}
+
+ThreadPool::ThreadPool(unsigned int threadCount)
+	: pending(0),
+	  stopping(false)
+{
+	unsigned int i;
+
+	if (threadCount == 0) {
+		threadCount = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	for (i = 0; i < threadCount; i++) {
+		workers.push_back(std::thread(&ThreadPool::workerLoop, this));
+	}
+}
+
+ThreadPool::~ThreadPool() {
+	unsigned int i;
+
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	taskAvailable.notify_all();
+
+	for (i = 0; i < workers.size(); i++) {
+		workers[i].join();
+	}
+}
+
+void ThreadPool::enqueue(const std::function<void()>& task) {
+	{
+		std::unique_lock<std::mutex> lock(mutex);
+		tasks.push_back(task);
+		pending++;
+	}
+	taskAvailable.notify_one();
+}
+
+void ThreadPool::wait() {
+	std::unique_lock<std::mutex> lock(mutex);
+
+	while (pending != 0) {
+		tasksDone.wait(lock);
+	}
+}
+
+void ThreadPool::parallelFor(unsigned int count, const std::function<void(unsigned int, unsigned int)>& body) {
+	std::shared_ptr<ParallelForChunks> chunks;
+	unsigned int i;
+
+	if (count == 0) {
+		return;
+	}
+
+	chunks = std::make_shared<ParallelForChunks>();
+	chunks->body = &body;
+	chunks->count = count;
+	chunks->chunkCount = std::min(count, static_cast<unsigned int>(workers.size()));
+	chunks->chunkSize = (count + chunks->chunkCount - 1) / chunks->chunkCount;
+	chunks->chunkCount = (count + chunks->chunkSize - 1) / chunks->chunkSize;
+	chunks->nextChunk = 0;
+	chunks->remaining = chunks->chunkCount;
+
+	// The helpers hold on to the chunks, a helper that only gets to run after the call has returned finds
+	// nothing left to claim and never touches body
+	for (i = 1; i < chunks->chunkCount; i++) {
+		enqueue([chunks]() {
+			runChunks(*chunks);
+		});
+	}
+
+	// The caller works through the chunks too, so a call made from a busy pool, or from one of its own
+	// tasks, still finishes. Afterwards it only waits for chunks that a worker is already running.
+	runChunks(*chunks);
+
+	std::unique_lock<std::mutex> lock(chunks->mutex);
+	while (chunks->remaining != 0) {
+		chunks->chunksDone.wait(lock);
+	}
+}
+
+unsigned int ThreadPool::getThreadCount() const {
+	return static_cast<unsigned int>(workers.size());
+}
+
+void ThreadPool::workerLoop() {
+	std::function<void()> task;
+
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+
+			while ((tasks.empty()) && (!stopping)) {
+				taskAvailable.wait(lock);
+			}
+
+			if (tasks.empty()) {
+				return;
+			}
+
+			task = tasks.front();
+			tasks.pop_front();
+		}
+
+		task();
+
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			pending--;
+
+			if (pending == 0) {
+				tasksDone.notify_all();
+			}
+		}
+	}
+}
+
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
@@ -25,6 +25,7 @@
 //TODO: Include implementations of methods which have specific types,
 // e.g. cross (float + double in 3D) and perp (int, float, double in 2D)
 
+#if !defined(VECTORN_SIMD_FLOAT)
 /** Computes the cross product between two vectors and
  * returns the result.
  * @param vector The vector to compute this vector's cross product
@@ -41,6 +42,7 @@ Vector3f Vector3f::cross(const Vector3f& vector) const {
 
     return result;
 }
+#endif
 
 /** Computes the cross product between two vectors and
  * returns the result.
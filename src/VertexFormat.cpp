@@ -0,0 +1,160 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <cstddef>
+#include <GL/glew.h>
+
+#include "VertexFormat.h"
+
+/**
+ * Gets the size in bytes of a GL component type.
+ */
+static GLsizei typeSize(GLenum type) {
+	switch (type) {
+		case GL_BYTE:
+		case GL_UNSIGNED_BYTE:
+			return 1;
+		case GL_SHORT:
+		case GL_UNSIGNED_SHORT:
+		case GL_HALF_FLOAT:
+			return 2;
+		case GL_DOUBLE:
+			return 8;
+		default:
+			return 4;
+	}
+}
+
+/**
+ * Converts a byte offset into the pointer argument of the gl*Pointer functions.
+ */
+static const GLvoid* bufferOffset(GLsizei offset) {
+	return reinterpret_cast<const GLvoid*>(static_cast<size_t>(offset));
+}
+
+VertexFormat::VertexFormat()
+	: stride(0)
+{
+	int i;
+
+	for (i = 0; i < VERTEX_SEMANTIC_COUNT; i++) {
+		attributes[i].components = 0;
+		attributes[i].type = GL_FLOAT;
+		attributes[i].normalized = GL_FALSE;
+		attributes[i].offset = 0;
+	}
+}
+
+void VertexFormat::addAttribute(VertexSemantic semantic, GLint components, GLenum type, GLboolean normalized) {
+	attributes[semantic].components = components;
+	attributes[semantic].type = type;
+	attributes[semantic].normalized = normalized;
+	attributes[semantic].offset = stride;
+
+	stride += components * typeSize(type);
+}
+
+const VertexAttribute* VertexFormat::getAttribute(VertexSemantic semantic) const {
+	if (attributes[semantic].components == 0) {
+		return NULL;
+	}
+
+	return &attributes[semantic];
+}
+
+GLsizei VertexFormat::getStride() const {
+	return stride;
+}
+
+void VertexFormat::setupArrays(bool withColour) const {
+	const VertexAttribute *position = getAttribute(VERTEX_POSITION);
+	const VertexAttribute *normal = getAttribute(VERTEX_NORMAL);
+	const VertexAttribute *colour = getAttribute(VERTEX_COLOUR);
+
+	glEnableClientState(GL_VERTEX_ARRAY);
+	glVertexPointer(position->components, position->type, stride, bufferOffset(position->offset));
+
+	if ((normal != NULL) && (normal->type == GL_FLOAT) && (normal->components == 3)) {
+		glEnableClientState(GL_NORMAL_ARRAY);
+		glNormalPointer(normal->type, stride, bufferOffset(normal->offset));
+	}
+	else if (normal != NULL) {
+		// The fixed function normal array only takes 3 components, packed normals are decoded by the shader
+		glDisableClientState(GL_NORMAL_ARRAY);
+		glEnableVertexAttribArray(VERTEX_ATTRIB_OCT_NORMAL);
+		glVertexAttribPointer(VERTEX_ATTRIB_OCT_NORMAL, normal->components, normal->type, normal->normalized, stride, bufferOffset(normal->offset));
+	}
+
+	if ((withColour) && (colour != NULL)) {
+		glEnableClientState(GL_COLOR_ARRAY);
+		glColorPointer(colour->components, colour->type, stride, bufferOffset(colour->offset));
+	}
+	else {
+		glDisableClientState(GL_COLOR_ARRAY);
+	}
+}
+
+VertexFormat VertexFormat::floatFormat() {
+	VertexFormat format;
+
+	format.addAttribute(VERTEX_POSITION, 3, GL_FLOAT, GL_FALSE);
+	format.addAttribute(VERTEX_NORMAL, 3, GL_FLOAT, GL_FALSE);
+	format.addAttribute(VERTEX_COLOUR, 3, GL_FLOAT, GL_FALSE);
+	format.addAttribute(VERTEX_UV, 2, GL_FLOAT, GL_FALSE);
+
+	return format;
+}
+
+VertexFormat VertexFormat::quantizedFormat() {
+	VertexFormat format;
+
+	// The fourth position component is always 1 and keeps the normal on a 4 byte boundary. Positions are
+	// read as plain integers, the mesh's dequantization transform is applied through the modelview matrix
+	format.addAttribute(VERTEX_POSITION, 4, GL_SHORT, GL_FALSE);
+	format.addAttribute(VERTEX_NORMAL, 2, GL_SHORT, GL_TRUE);
+	format.addAttribute(VERTEX_COLOUR, 4, GL_UNSIGNED_BYTE, GL_TRUE);
+	format.addAttribute(VERTEX_UV, 2, GL_HALF_FLOAT, GL_FALSE);
+
+	return format;
+}
+
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
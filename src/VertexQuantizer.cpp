@@ -0,0 +1,459 @@
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <cmath>
+#include <cstring>
+#include <algorithm>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#	include <emmintrin.h>
+#	define VERTEX_QUANTIZER_SSE
+#endif
+
+#include "VectorArray.h"
+#include "VertexQuantizer.h"
+
+/** The largest magnitude of a snorm16 value */
+#define SNORM16_MAX 32767.0f
+
+/**
+ * Rounds to the nearest integer in the current rounding mode, halves to even by default. This is how
+ * _mm_cvtps_epi32 rounds, so the SSE and scalar paths give the same results.
+ */
+static GLint roundToInt(GLfloat value) {
+	return static_cast<GLint>(lrintf(value));
+}
+
+/**
+ * Rounds to the nearest integer and clamps to the snorm16 range.
+ */
+static GLshort toSnorm16(GLfloat value) {
+	value = std::max(-SNORM16_MAX, std::min(SNORM16_MAX, value));
+
+	return static_cast<GLshort>(roundToInt(value));
+}
+
+/**
+ * Returns 1 for positive numbers and zero, -1 otherwise.
+ */
+static GLfloat signNotZero(GLfloat value) {
+	return (value >= 0.0f) ? 1.0f : -1.0f;
+}
+
+/**
+ * Quantizes a single vertex. Used where SSE is unavailable and for the vertices left over after the
+ * vectorized loop.
+ */
+static void encodeVertex(const MeshVertex& in, const GLfloat center[3], GLfloat invScale, QuantizedVertex& out) {
+	GLfloat length;
+	GLfloat x;
+	GLfloat y;
+	int i;
+
+	for (i = 0; i < 3; i++) {
+		out.position[i] = toSnorm16((in.position[i] - center[i]) * invScale);
+		out.colour[i] = static_cast<GLubyte>(roundToInt(std::max(0.0f, std::min(1.0f, in.colour[i])) * 255.0f));
+	}
+	out.position[3] = 1;
+	out.colour[3] = 255;
+
+	// Project onto the octahedron, then fold the lower half over the upper one
+	length = fabsf(in.normal[0]) + fabsf(in.normal[1]) + fabsf(in.normal[2]);
+	x = (length > 0.0f) ? in.normal[0] / length : 0.0f;
+	y = (length > 0.0f) ? in.normal[1] / length : 0.0f;
+	if (in.normal[2] < 0.0f) {
+		GLfloat foldedX = (1.0f - fabsf(y)) * signNotZero(x);
+
+		y = (1.0f - fabsf(x)) * signNotZero(y);
+		x = foldedX;
+	}
+	out.normal[0] = toSnorm16(x * SNORM16_MAX);
+	out.normal[1] = toSnorm16(y * SNORM16_MAX);
+
+	out.uv[0] = VertexQuantizer::floatToHalf(in.uv[0]);
+	out.uv[1] = VertexQuantizer::floatToHalf(in.uv[1]);
+}
+
+/**
+ * Expands a single quantized vertex.
+ */
+static void decodeVertex(const QuantizedVertex& in, const GLfloat center[3], GLfloat scale, MeshVertex& out) {
+	GLfloat length;
+	GLfloat x;
+	GLfloat y;
+	GLfloat z;
+	int i;
+
+	for (i = 0; i < 3; i++) {
+		out.position[i] = center[i] + static_cast<GLfloat>(in.position[i]) * scale;
+		out.colour[i] = static_cast<GLfloat>(in.colour[i]) * (1.0f / 255.0f);
+	}
+
+	// Multiply by the reciprocals like the SSE path does, so that both expand to the same floats
+	x = static_cast<GLfloat>(in.normal[0]) * (1.0f / SNORM16_MAX);
+	y = static_cast<GLfloat>(in.normal[1]) * (1.0f / SNORM16_MAX);
+	z = 1.0f - fabsf(x) - fabsf(y);
+	if (z < 0.0f) {
+		GLfloat unfoldedX = (1.0f - fabsf(y)) * signNotZero(x);
+
+		y = (1.0f - fabsf(x)) * signNotZero(y);
+		x = unfoldedX;
+	}
+	length = sqrtf(x * x + y * y + z * z);
+	out.normal[0] = x / length;
+	out.normal[1] = y / length;
+	out.normal[2] = z / length;
+
+	out.uv[0] = VertexQuantizer::halfToFloat(in.uv[0]);
+	out.uv[1] = VertexQuantizer::halfToFloat(in.uv[1]);
+}
+
+#ifdef VERTEX_QUANTIZER_SSE
+/**
+ * Selects a where mask is set and b elsewhere.
+ */
+static inline __m128 select(__m128 mask, __m128 a, __m128 b) {
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+/**
+ * Returns 1 for positive lanes and zero, -1 otherwise. Negative zero counts as zero, like the scalar version.
+ */
+static inline __m128 signNotZero(__m128 value) {
+	return select(_mm_cmpge_ps(value, _mm_setzero_ps()), _mm_set1_ps(1.0f), _mm_set1_ps(-1.0f));
+}
+
+/**
+ * Returns the absolute value of every lane.
+ */
+static inline __m128 absolute(__m128 value) {
+	return _mm_andnot_ps(_mm_set1_ps(-0.0f), value);
+}
+#endif
+
+void VertexQuantizer::computeTransform(const MeshVertex* vertices, unsigned int count, GLfloat center[3], GLfloat& scale) {
+	Vector3f minimum;
+	Vector3f maximum;
+	GLfloat extent;
+	int j;
+
+	if (count == 0) {
+		center[0] = center[1] = center[2] = 0.0f;
+		scale = 1.0f;
+		return;
+	}
+
+	ConstVector3fArray(vertices[0].position, count, sizeof(MeshVertex)).bounds(minimum, maximum);
+
+	extent = 0.0f;
+	for (j = 0; j < 3; j++) {
+		center[j] = 0.5f * (minimum[j] + maximum[j]);
+		extent = std::max(extent, 0.5f * (maximum[j] - minimum[j]));
+	}
+
+	scale = (extent > 0.0f) ? extent / SNORM16_MAX : 1.0f;
+}
+
+void VertexQuantizer::encode(const MeshVertex* in, unsigned int count, const GLfloat center[3], GLfloat scale, QuantizedVertex* out) {
+	GLfloat invScale = 1.0f / scale;
+	unsigned int i;
+
+	i = 0;
+
+#ifdef VERTEX_QUANTIZER_SSE
+	const __m128 centerX = _mm_set1_ps(center[0]);
+	const __m128 centerY = _mm_set1_ps(center[1]);
+	const __m128 centerZ = _mm_set1_ps(center[2]);
+	const __m128 invScales = _mm_set1_ps(invScale);
+	const __m128 snormMax = _mm_set1_ps(SNORM16_MAX);
+	const __m128 snormMin = _mm_set1_ps(-SNORM16_MAX);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 unormMax = _mm_set1_ps(255.0f);
+
+	// Transpose four vertices at a time into x, y and z lanes. Every unaligned load reads one float past
+	// the attribute, which still lies inside the vertex
+	for (; i + 4 <= count; i += 4) {
+		__m128 x = _mm_loadu_ps(in[i].position);
+		__m128 y = _mm_loadu_ps(in[i + 1].position);
+		__m128 z = _mm_loadu_ps(in[i + 2].position);
+		__m128 w = _mm_loadu_ps(in[i + 3].position);
+		__m128 nx = _mm_loadu_ps(in[i].normal);
+		__m128 ny = _mm_loadu_ps(in[i + 1].normal);
+		__m128 nz = _mm_loadu_ps(in[i + 2].normal);
+		__m128 nw = _mm_loadu_ps(in[i + 3].normal);
+		__m128 r = _mm_loadu_ps(in[i].colour);
+		__m128 g = _mm_loadu_ps(in[i + 1].colour);
+		__m128 b = _mm_loadu_ps(in[i + 2].colour);
+		__m128 a = _mm_loadu_ps(in[i + 3].colour);
+		__m128 length;
+		__m128 lower;
+		__m128 foldedX;
+		__m128 foldedY;
+		__m128i qx;
+		__m128i qy;
+		__m128i qz;
+		__m128i qnx;
+		__m128i qny;
+		__m128i rgba;
+		GLint px[4];
+		GLint py[4];
+		GLint pz[4];
+		GLint pnx[4];
+		GLint pny[4];
+		GLuint colours[4];
+		int k;
+
+		_MM_TRANSPOSE4_PS(x, y, z, w);
+		_MM_TRANSPOSE4_PS(nx, ny, nz, nw);
+		_MM_TRANSPOSE4_PS(r, g, b, a);
+
+		qx = _mm_cvtps_epi32(_mm_max_ps(snormMin, _mm_min_ps(snormMax, _mm_mul_ps(_mm_sub_ps(x, centerX), invScales))));
+		qy = _mm_cvtps_epi32(_mm_max_ps(snormMin, _mm_min_ps(snormMax, _mm_mul_ps(_mm_sub_ps(y, centerY), invScales))));
+		qz = _mm_cvtps_epi32(_mm_max_ps(snormMin, _mm_min_ps(snormMax, _mm_mul_ps(_mm_sub_ps(z, centerZ), invScales))));
+
+		length = _mm_add_ps(_mm_add_ps(absolute(nx), absolute(ny)), absolute(nz));
+		length = _mm_max_ps(length, _mm_set1_ps(1e-20f));
+		nx = _mm_div_ps(nx, length);
+		ny = _mm_div_ps(ny, length);
+		lower = _mm_cmplt_ps(nz, zero);
+		foldedX = _mm_mul_ps(_mm_sub_ps(one, absolute(ny)), signNotZero(nx));
+		foldedY = _mm_mul_ps(_mm_sub_ps(one, absolute(nx)), signNotZero(ny));
+		qnx = _mm_cvtps_epi32(_mm_mul_ps(select(lower, foldedX, nx), snormMax));
+		qny = _mm_cvtps_epi32(_mm_mul_ps(select(lower, foldedY, ny), snormMax));
+
+		// Pack the colours down to bytes, every lane ends up as one r, g, b, 255 word
+		r = _mm_mul_ps(_mm_max_ps(zero, _mm_min_ps(one, r)), unormMax);
+		g = _mm_mul_ps(_mm_max_ps(zero, _mm_min_ps(one, g)), unormMax);
+		b = _mm_mul_ps(_mm_max_ps(zero, _mm_min_ps(one, b)), unormMax);
+		rgba = _mm_or_si128(_mm_cvtps_epi32(r), _mm_slli_epi32(_mm_cvtps_epi32(g), 8));
+		rgba = _mm_or_si128(rgba, _mm_slli_epi32(_mm_cvtps_epi32(b), 16));
+		rgba = _mm_or_si128(rgba, _mm_set1_epi32(static_cast<int>(0xff000000u)));
+
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(px), qx);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(py), qy);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pz), qz);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pnx), qnx);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(pny), qny);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(colours), rgba);
+
+		for (k = 0; k < 4; k++) {
+			QuantizedVertex& v = out[i + k];
+
+			v.position[0] = static_cast<GLshort>(px[k]);
+			v.position[1] = static_cast<GLshort>(py[k]);
+			v.position[2] = static_cast<GLshort>(pz[k]);
+			v.position[3] = 1;
+			v.normal[0] = static_cast<GLshort>(pnx[k]);
+			v.normal[1] = static_cast<GLshort>(pny[k]);
+			// The colour words were built little endian, r in the lowest byte
+			v.colour[0] = static_cast<GLubyte>(colours[k]);
+			v.colour[1] = static_cast<GLubyte>(colours[k] >> 8);
+			v.colour[2] = static_cast<GLubyte>(colours[k] >> 16);
+			v.colour[3] = static_cast<GLubyte>(colours[k] >> 24);
+			v.uv[0] = floatToHalf(in[i + k].uv[0]);
+			v.uv[1] = floatToHalf(in[i + k].uv[1]);
+		}
+	}
+#endif
+
+	for (; i < count; i++) {
+		encodeVertex(in[i], center, invScale, out[i]);
+	}
+}
+
+void VertexQuantizer::decode(const QuantizedVertex* in, unsigned int count, const GLfloat center[3], GLfloat scale, MeshVertex* out) {
+	unsigned int i;
+
+	i = 0;
+
+#ifdef VERTEX_QUANTIZER_SSE
+	const __m128 centers = _mm_set_ps(0.0f, center[2], center[1], center[0]);
+	const __m128 scales = _mm_set1_ps(scale);
+	const __m128 snormScale = _mm_set1_ps(1.0f / SNORM16_MAX);
+	const __m128 unormScale = _mm_set1_ps(1.0f / 255.0f);
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 zero = _mm_setzero_ps();
+
+	// Every unaligned store writes one float past its attribute, the spills are overwritten by the stores
+	// of the attribute that follows
+	for (; i + 4 <= count; i += 4) {
+		__m128i packedNormals;
+		__m128 nx;
+		__m128 ny;
+		__m128 nz;
+		__m128 nw;
+		__m128 lower;
+		__m128 unfoldedX;
+		__m128 unfoldedY;
+		__m128 length;
+		GLuint normals[4];
+		int k;
+
+		for (k = 0; k < 4; k++) {
+			const QuantizedVertex& v = in[i + k];
+			__m128i position = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(v.position));
+			__m128i colour;
+			int bytes;
+
+			// Copy the bytes out rather than reading them through an int pointer
+			memcpy(&bytes, v.colour, sizeof(bytes));
+			colour = _mm_cvtsi32_si128(bytes);
+
+			// Sign extend the shorts and zero extend the bytes to 32 bits
+			position = _mm_srai_epi32(_mm_unpacklo_epi16(position, position), 16);
+			colour = _mm_unpacklo_epi16(_mm_unpacklo_epi8(colour, _mm_setzero_si128()), _mm_setzero_si128());
+
+			_mm_storeu_ps(out[i + k].position, _mm_add_ps(centers, _mm_mul_ps(_mm_cvtepi32_ps(position), scales)));
+			memcpy(&normals[k], v.normal, sizeof(normals[k]));
+			_mm_storeu_ps(out[i + k].colour, _mm_mul_ps(_mm_cvtepi32_ps(colour), unormScale));
+		}
+
+		packedNormals = _mm_loadu_si128(reinterpret_cast<const __m128i*>(normals));
+		nx = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(packedNormals, 16), 16)), snormScale);
+		ny = _mm_mul_ps(_mm_cvtepi32_ps(_mm_srai_epi32(packedNormals, 16)), snormScale);
+		nz = _mm_sub_ps(_mm_sub_ps(one, absolute(nx)), absolute(ny));
+		lower = _mm_cmplt_ps(nz, zero);
+		unfoldedX = _mm_mul_ps(_mm_sub_ps(one, absolute(ny)), signNotZero(nx));
+		unfoldedY = _mm_mul_ps(_mm_sub_ps(one, absolute(nx)), signNotZero(ny));
+		nx = select(lower, unfoldedX, nx);
+		ny = select(lower, unfoldedY, ny);
+		length = _mm_sqrt_ps(_mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_mul_ps(nz, nz)));
+		nx = _mm_div_ps(nx, length);
+		ny = _mm_div_ps(ny, length);
+		nz = _mm_div_ps(nz, length);
+		nw = zero;
+		_MM_TRANSPOSE4_PS(nx, ny, nz, nw);
+
+		// The normal stores spill into the colour, so put the colour's first component back
+		_mm_storeu_ps(out[i].normal, nx);
+		_mm_storeu_ps(out[i + 1].normal, ny);
+		_mm_storeu_ps(out[i + 2].normal, nz);
+		_mm_storeu_ps(out[i + 3].normal, nw);
+
+		for (k = 0; k < 4; k++) {
+			out[i + k].colour[0] = static_cast<GLfloat>(in[i + k].colour[0]) / 255.0f;
+			out[i + k].uv[0] = halfToFloat(in[i + k].uv[0]);
+			out[i + k].uv[1] = halfToFloat(in[i + k].uv[1]);
+		}
+	}
+#endif
+
+	for (; i < count; i++) {
+		decodeVertex(in[i], center, scale, out[i]);
+	}
+}
+
+GLushort VertexQuantizer::floatToHalf(GLfloat value) {
+	const GLuint infinity = 255u << 23;
+	const GLuint halfMaximum = (127u + 16u) << 23;
+	const GLuint denormalMagic = ((127u - 15u) + (23u - 10u) + 1u) << 23;
+	GLuint bits;
+	GLuint sign;
+	GLuint mantissaOdd;
+	GLfloat magic;
+	GLushort result;
+
+	memcpy(&bits, &value, sizeof(bits));
+	sign = bits & 0x80000000u;
+	bits ^= sign;
+
+	if (bits >= halfMaximum) {
+		// Too large for a half becomes infinity, NaN stays NaN
+		result = (bits > infinity) ? 0x7e00 : 0x7c00;
+	}
+	else if (bits < (113u << 23)) {
+		// Denormal half, let the FPU do the rounding by adding a magic number
+		memcpy(&magic, &denormalMagic, sizeof(magic));
+		memcpy(&value, &bits, sizeof(value));
+		value += magic;
+		memcpy(&bits, &value, sizeof(bits));
+		result = static_cast<GLushort>(bits - denormalMagic);
+	}
+	else {
+		// Rebias the exponent and round to nearest even
+		mantissaOdd = (bits >> 13) & 1;
+		bits += (static_cast<GLuint>(15 - 127) << 23) + 0xfff;
+		bits += mantissaOdd;
+		result = static_cast<GLushort>(bits >> 13);
+	}
+
+	return static_cast<GLushort>(result | (sign >> 16));
+}
+
+GLfloat VertexQuantizer::halfToFloat(GLushort value) {
+	const GLuint shiftedExponent = 0x7c00u << 13;
+	const GLuint magicBits = 113u << 23;
+	GLuint bits;
+	GLuint exponent;
+	GLfloat magic;
+	GLfloat result;
+
+	bits = static_cast<GLuint>(value & 0x7fff) << 13;
+	exponent = shiftedExponent & bits;
+	bits += (127u - 15u) << 23;
+
+	if (exponent == shiftedExponent) {
+		// Infinity or NaN
+		bits += (128u - 16u) << 23;
+		memcpy(&result, &bits, sizeof(result));
+	}
+	else if (exponent == 0) {
+		// Zero or denormal, renormalize through the FPU
+		bits += 1u << 23;
+		memcpy(&result, &bits, sizeof(result));
+		memcpy(&magic, &magicBits, sizeof(magic));
+		result -= magic;
+	}
+	else {
+		memcpy(&result, &bits, sizeof(result));
+	}
+
+	bits = static_cast<GLuint>(value & 0x8000) << 16;
+	if (bits != 0) {
+		result = -result;
+	}
+
+	return result;
+}
+
+// Copyright (c) 2012, ME Chamberlain
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification,
+// are permitted provided that the following conditions are met:
+// 
+// 	- Redistributions of source code must retain the above copyright notice, this
+// 	  list of conditions and the following disclaimer.
+// 	- Redistributions in binary form must reproduce the above copyright notice,
+// 	  this list of conditions and the following disclaimer in the documentation 
+// 	  and/or other materials provided with the distribution.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+// OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT
+// SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+// INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED
+// TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR
+// BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN
+// CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY
+// WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
@@ -24,11 +24,24 @@
 #include <GL/glew.h>
 #include <GL/glu.h>
 #include <GL/glut.h>
+#include <algorithm>
+#include <chrono>
 #include <cstdlib>
+#include <cstring>
+#include <iomanip>
 #include <iostream>
+#include <sstream>
+#include <string>
 
 #include "MiscGL.h"
+#include "BatchRenderer.h"
+#include "Benchmark.h"
 #include "CelShader.h"
+#include "HeadlessContext.h"
+#include "MeshCodec.h"
+#include "RawMeshLoader.h"
+#include "SoftwareRasterizer.h"
+#include "ThreadPool.h"
 
 #define DEFAULT_WINDOW_MAX_X 800.0f
 #define DEFAULT_WINDOW_MAX_Y 600.0f
@@ -36,6 +49,12 @@
 #define INITIAL_VIEWPORT_WIDTH 800
 #define INITIAL_VIEWPORT_HEIGHT 600
 #define BOUNDARY 0.05f
+/** The projection the software renderer uses, the same as the cel shader's */
+#define SOFTWARE_FIELD_OF_VIEW 45.0f
+#define SOFTWARE_NEAR_PLANE 0.1f
+#define SOFTWARE_FAR_PLANE 100.0f
+/** The time every frame of the software renderer moves the light by, in seconds */
+#define SOFTWARE_TIMESTEP (1.0f / 60.0f)
 
 /*#ifndef DEBUG_CELSHADER
 #define PRINTD(str,...)
@@ -46,6 +65,10 @@
 
 /** The main instance for the program */
 CelShader* csInstance;
+/** The benchmark being run, NULL when running interactively */
+Benchmark* benchmark = NULL;
+/** The path the benchmark results are written to */
+std::string benchmarkReport;
 
 /** Display callback */
 void display() {
@@ -111,48 +134,51 @@ void keyboardUpHandler(unsigned char key, int x, int y) {
 	csInstance->keyboardUpHandler(key, x, y);
 }
 
+/**
+ * Prints the benchmark results and writes them to the report.
+ * @return the exit code.
+ */
+int reportBenchmark() {
+	benchmark->printTable();
+
+	if (!benchmark->writeJson(benchmarkReport)) {
+		std::cout << "Could not write the benchmark results to " << benchmarkReport << std::endl;
+		return 4;
+	}
+
+	std::cout << "Benchmark results written to " << benchmarkReport << std::endl;
+
+	return 0;
+}
+
 /**
  * Called once every iteration of the main loop if there are no other events.
  */
 void idleFunc() {
-	csInstance->step();
+	int result;
+
+	if (benchmark == NULL) {
+		csInstance->step();
+	}
+	else if (!benchmark->runFrame()) {
+		result = reportBenchmark();
+
+		if (result != 0) {
+			exit(result);
+		}
+
+		csInstance->quit();
+	}
 }
 
 /**
- * Main method.
- * @param argc The number of command line arguments.
- * @param argv An array of strings containing the command line arguments.
- * @return 0 on successful termination, otherwise some error code.
+ * Sets up the OpenGL state the cel shader expects, once the context is current.
  */
-int main(int argc, char **argv) {
-	int mainWindow;
+void setupGLState() {
 	// Define the light source and it's properties
 	GLfloat light_diffuse[] = {1.0f, 1.0f, 1.0f, 1.0f};
 	GLfloat light_position[] = { 0.0f, 10.0f, 10.0f, 0.0f };
 
-	glutInit(&argc, argv);
-	glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
-	glutInitWindowSize(INITIAL_VIEWPORT_WIDTH, INITIAL_VIEWPORT_HEIGHT);
-	glutInitWindowPosition(10, 10);
-	mainWindow = glutCreateWindow("Cel Shader");
-
-	// If the window could not be created, print an error message.
-	if (mainWindow <= 0) {
-		std::cout << "Error creating window. Check your OpenGL, and GLUT installations." << std::endl;
-		exit(1);
-	}
-
-	// Initialize GLEW so that all openGL 2.0 extensions are supported
-	GLenum err = glewInit();
-	if (err != GLEW_OK)
-    {
-        std::cout << "Failed to initialise glew: " << glewGetErrorString(err) << std::endl;
-        exit(2);
-    }
-
-	csInstance = new CelShader(INITIAL_VIEWPORT_WIDTH, INITIAL_VIEWPORT_HEIGHT);
-	std::cout << "Setting up shaders: " << csInstance->setupShaders("shaders/celShader.vs", "shaders/celShader.frag") << std::endl;
-
 	// Set the background to black
 	glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
 
@@ -187,6 +213,338 @@ int main(int argc, char **argv) {
 	glEnableClientState(GL_VERTEX_ARRAY);
 	glEnableClientState(GL_NORMAL_ARRAY);
 	glEnableClientState(GL_COLOR_ARRAY);
+}
+
+/**
+ * Draws frames into the headless context's framebuffer as fast as possible, writing each one to an image.
+ * @param context The current headless context.
+ * @param frameCount The number of frames to draw.
+ * @param imagePrefix The path each image's number and extension is appended to, empty to not write any.
+ * @return the exit code.
+ */
+int renderHeadless(HeadlessContext& context, unsigned int frameCount, const std::string& imagePrefix) {
+	std::chrono::steady_clock::time_point start;
+	std::ostringstream path;
+	double seconds;
+	unsigned int frame;
+	int result;
+
+	// The loaded model is streamed in over several frames, which show the previous scene
+	while (!csInstance->isSceneReady()) {
+		csInstance->step();
+	}
+
+	result = 0;
+	start = std::chrono::steady_clock::now();
+
+	for (frame = 0; frame < frameCount; frame++) {
+		csInstance->step();
+
+		if (!imagePrefix.empty()) {
+			path.str("");
+			path << imagePrefix << std::setw(4) << std::setfill('0') << frame << ".ppm";
+
+			if (!context.writeImage(path.str())) {
+				result = 4;
+				break;
+			}
+		}
+	}
+
+	seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	if (frame > 0) {
+		std::cout << frame << " frames in " << seconds * 1000.0 << "ms, " << frame / seconds << " frames per second" << std::endl;
+	}
+
+	return result;
+}
+
+/**
+ * Draws frames of a model with the software rasterizer, without OpenGL, writing each one to an image.
+ * @param modelPath The .raw file to draw.
+ * @param width The width of the images.
+ * @param height The height of the images.
+ * @param frameCount The number of frames to draw.
+ * @param imagePrefix The path each image's number and extension is appended to, empty to not write any.
+ * @param viewAngle The camera's angle around the model, in radians.
+ * @param pitch The camera's pitch, in radians.
+ * @param distance The camera's distance from the model.
+ * @return the exit code.
+ */
+int renderSoftware(const std::string& modelPath, int width, int height, unsigned int frameCount, const std::string& imagePrefix,
+                   float viewAngle, float pitch, float distance) {
+	static const GLfloat background[3] = { 0.0f, 0.4f, 0.4f };
+	std::chrono::steady_clock::time_point start;
+	std::ostringstream path;
+	ThreadPool pool;
+	RawMeshLoader mesh;
+	SoftwareRasterizer rasterizer(&pool);
+	GLfloat modelView[16];
+	GLfloat light[4];
+	double seconds;
+	float angle;
+	unsigned int frame;
+	int result;
+
+	if (mesh.load(modelPath, RawMeshLoader::LOAD_PARALLEL, &pool) == 0) {
+		std::cout << "Could not load " << modelPath << std::endl;
+		return 1;
+	}
+
+	std::cout << "Rendering " << mesh.getSize() / 3 << " triangles in software on " << pool.getThreadCount() << " threads" << std::endl;
+
+	rasterizer.resize(width, height);
+	rasterizer.setPerspective(SOFTWARE_FIELD_OF_VIEW, SOFTWARE_NEAR_PLANE, SOFTWARE_FAR_PLANE);
+	SoftwareRasterizer::orbitMatrix(viewAngle, pitch, distance, modelView);
+	rasterizer.setModelView(modelView);
+
+	result = 0;
+	angle = 0.0f;
+	start = std::chrono::steady_clock::now();
+
+	for (frame = 0; frame < frameCount; frame++) {
+		// The light circles the model like it does in CelShader::step
+		light[0] = 10.0f * cosf(angle);
+		light[1] = 5.0f;
+		light[2] = 10.0f * sinf(angle);
+		light[3] = 1.0f;
+		angle += SOFTWARE_TIMESTEP * 0.5f;
+
+		rasterizer.setLight(light);
+		rasterizer.clear(background);
+		rasterizer.draw(mesh);
+
+		if (!imagePrefix.empty()) {
+			path.str("");
+			path << imagePrefix << std::setw(4) << std::setfill('0') << frame << ".ppm";
+
+			if (!rasterizer.writeImage(path.str())) {
+				result = 4;
+				break;
+			}
+		}
+	}
+
+	seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	if (frame > 0) {
+		std::cout << frame << " frames in " << seconds * 1000.0 << "ms, " << frame / seconds << " frames per second" << std::endl;
+	}
+
+	return result;
+}
+
+/**
+ * Main method.
+ * @param argc The number of command line arguments.
+ * @param argv An array of strings containing the command line arguments.
+ * @return 0 on successful termination, otherwise some error code.
+ */
+int main(int argc, char **argv) {
+	std::chrono::steady_clock::time_point shaderStart;
+	HeadlessContext headlessContext;
+	std::string imagePrefix;
+	std::string profilePath;
+	std::string modelPath;
+	bool quantize;
+	bool screenSpaceOutlines;
+	bool shaderCache;
+	bool headless;
+	bool software;
+	unsigned int instanceCount;
+	unsigned int frameCount;
+	unsigned int benchmarkFrames;
+	int width;
+	int height;
+	int scene;
+	bool sceneSelected;
+	float viewAngle;
+	float pitch;
+	float distance;
+	int mainWindow;
+	int result;
+	int i;
+
+	// Converting a model doesn't need a window
+	if ((argc == 4) && (strcmp(argv[1], "--convert") == 0)) {
+		ThreadPool pool;
+
+		return MeshCodec::convert(argv[2], argv[3], pool) ? 0 : 1;
+	}
+
+	// Neither does rendering a batch of turntables, which is done in software
+	if ((argc >= 3) && (strcmp(argv[1], "--batch") == 0)) {
+		BatchRenderer batch((argc > 3) ? static_cast<unsigned int>(atoi(argv[3])) : 0);
+
+		if (!batch.loadManifest(argv[2])) {
+			return 1;
+		}
+
+		result = batch.run() ? 0 : 4;
+		batch.printReport();
+		return result;
+	}
+
+	quantize = false;
+	screenSpaceOutlines = true;
+	shaderCache = true;
+	headless = false;
+	software = false;
+	instanceCount = 1;
+	frameCount = 0;
+	benchmarkFrames = 0;
+	width = INITIAL_VIEWPORT_WIDTH;
+	height = INITIAL_VIEWPORT_HEIGHT;
+	scene = 0;
+	sceneSelected = false;
+	viewAngle = 0.0f;
+	pitch = 0.0f;
+	distance = 35.0f;
+
+	// Read the arguments before GLUT is touched, a headless run mustn't need a display. The arguments
+	// meant for GLUT are simply skipped
+	for (i = 1; i < argc; i++) {
+		if (strcmp(argv[i], "--quantize") == 0) {
+			quantize = true;
+		}
+		else if (strcmp(argv[i], "--back-face-outlines") == 0) {
+			screenSpaceOutlines = false;
+		}
+		else if (strcmp(argv[i], "--no-shader-cache") == 0) {
+			shaderCache = false;
+		}
+		else if ((strcmp(argv[i], "--instances") == 0) && (i + 1 < argc)) {
+			instanceCount = static_cast<unsigned int>(atoi(argv[++i]));
+		}
+		else if (strcmp(argv[i], "--software") == 0) {
+			software = true;
+		}
+		else if ((strcmp(argv[i], "--model") == 0) && (i + 1 < argc)) {
+			modelPath = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--headless") == 0) && (i + 2 < argc)) {
+			headless = true;
+			frameCount = static_cast<unsigned int>(atoi(argv[++i]));
+			imagePrefix = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--benchmark") == 0) && (i + 2 < argc)) {
+			benchmarkFrames = std::max(atoi(argv[++i]), 1);
+			benchmarkReport = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--profile") == 0) && (i + 1 < argc)) {
+			profilePath = argv[++i];
+		}
+		else if ((strcmp(argv[i], "--size") == 0) && (i + 2 < argc)) {
+			width = std::max(atoi(argv[++i]), 1);
+			height = std::max(atoi(argv[++i]), 1);
+		}
+		else if ((strcmp(argv[i], "--view") == 0) && (i + 4 < argc)) {
+			scene = atoi(argv[++i]);
+			sceneSelected = true;
+			viewAngle = static_cast<float>(atof(argv[++i]));
+			pitch = static_cast<float>(atof(argv[++i]));
+			distance = static_cast<float>(atof(argv[++i]));
+		}
+	}
+
+	// The software renderer needs neither a window nor an OpenGL context
+	if (software) {
+		if (!headless) {
+			std::cout << "The software renderer only draws headless, add --headless" << std::endl;
+			return 1;
+		}
+
+		// Only the loaded model's scene can be drawn in software, other scenes need a model of their own
+		if (modelPath.empty()) {
+			if ((sceneSelected) && (scene != CEL_MODEL_SCENE)) {
+				std::cout << "Scene " << scene << " can't be drawn in software, pick scene " << CEL_MODEL_SCENE
+				          << " or give a model with --model" << std::endl;
+				return 1;
+			}
+
+			modelPath = CEL_MODEL_PATH ".raw";
+		}
+
+		return renderSoftware(modelPath, width, height, frameCount, imagePrefix, viewAngle, pitch, distance);
+	}
+
+	if (headless) {
+		if (!headlessContext.create(width, height)) {
+			exit(2);
+		}
+	}
+	else {
+		glutInit(&argc, argv);
+		glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGB | GLUT_DEPTH);
+		glutInitWindowSize(width, height);
+		glutInitWindowPosition(10, 10);
+		mainWindow = glutCreateWindow("Cel Shader");
+
+		// If the window could not be created, print an error message.
+		if (mainWindow <= 0) {
+			std::cout << "Error creating window. Check your OpenGL, and GLUT installations." << std::endl;
+			exit(1);
+		}
+
+		// Initialize GLEW so that all openGL 2.0 extensions are supported
+		GLenum err = glewInit();
+		if (err != GLEW_OK)
+	    {
+	        std::cout << "Failed to initialise glew: " << glewGetErrorString(err) << std::endl;
+	        exit(2);
+	    }
+	}
+
+	csInstance = new CelShader(width, height);
+	csInstance->setQuantizeMeshes(quantize);
+	csInstance->getProgramCache().setEnabled(shaderCache);
+	csInstance->getProfiler().setGpuTiming(true);
+	csInstance->setProfileCsvPath(profilePath);
+	csInstance->setView(static_cast<unsigned char>(scene), viewAngle, pitch, distance);
+
+	// The screen space outline pass has to composite into the headless framebuffer instead of the window
+	if (headless) {
+		csInstance->setWindowed(false);
+		csInstance->setTargetFramebuffer(headlessContext.getFramebuffer());
+	}
+
+	shaderStart = std::chrono::steady_clock::now();
+	std::cout << "Setting up shaders: " << csInstance->setupShaders("shaders/celShader.vs", "shaders/celShader.frag", "shaders/celShaderQuantized.vs") << std::endl;
+	std::cout << "Setting up outline shaders: " << csInstance->setupOutlineShaders("shaders/outline.vs", "shaders/outline.frag") << std::endl;
+	std::cout << "Setting up instanced shaders: " << csInstance->setupInstancedShaders("shaders/celShaderInstanced.vs") << std::endl;
+	std::cout << "Shaders ready in " << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - shaderStart).count() << "ms, "
+	          << csInstance->getProgramCache().getHits() << " of " << csInstance->getProgramCache().getHits() + csInstance->getProgramCache().getMisses()
+	          << " programs from the binary cache" << std::endl;
+	csInstance->setOutlineMode(screenSpaceOutlines ? CelShader::OUTLINE_SCREEN_SPACE : CelShader::OUTLINE_BACK_FACES);
+	csInstance->setInstanceCount(instanceCount);
+
+	setupGLState();
+
+	if (benchmarkFrames > 0) {
+		benchmark = new Benchmark(*csInstance, benchmarkFrames);
+	}
+
+	// Without a window nothing calls back into the cel shader, the frames are simply drawn in a loop
+	if (headless) {
+		csInstance->reshapeWindow(width, height);
+		result = 0;
+
+		if (benchmark != NULL) {
+			while (benchmark->runFrame()) {
+			}
+
+			result = reportBenchmark();
+		}
+
+		if (result == 0) {
+			result = renderHeadless(headlessContext, frameCount, imagePrefix);
+		}
+
+		if (result != 0) {
+			exit(result);
+		}
+
+		csInstance->quit();
+	}
 
 	// Setup the glut callbacks
 	glutReshapeFunc(reshapeFunc);